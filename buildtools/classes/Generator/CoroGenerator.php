@@ -116,7 +116,8 @@ EOT;
      */
     public function saveHeader(string $content): void
     {
-        $content .= "[[nodiscard]] async<http_request_completion_t> co_request(const std::string &url, http_method method, const std::string &postdata = \"\", const std::string &mimetype = \"text/plain\", const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = \"1.1\");\n\n";
+        $content .= "[[nodiscard]] async<http_request_completion_t> co_request(const std::string &url, http_method method, const std::string &postdata = \"\", const std::string &mimetype = \"text/plain\", const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = \"1.1\");\n";
+        $content .= "[[nodiscard]] async<http_request_completion_t> co_request_to_file(const std::string &url, const std::string &path, const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = \"1.1\");\n\n";
         file_put_contents('include/dpp/cluster_coro_calls.h', $content);
     }
 
@@ -127,6 +128,8 @@ EOT;
     {
         $cppcontent .= "dpp::async<dpp::http_request_completion_t> dpp::cluster::co_request(const std::string &url, http_method method, const std::string &postdata, const std::string &mimetype, const std::multimap<std::string, std::string> &headers, const std::string &protocol) {\n\treturn async<http_request_completion_t>{ [&, this] <typename C> (C &&cc) { return this->request(url, method, std::forward<C>(cc), postdata, mimetype, headers, protocol); }};\n}
 
+dpp::async<dpp::http_request_completion_t> dpp::cluster::co_request_to_file(const std::string &url, const std::string &path, const std::multimap<std::string, std::string> &headers, const std::string &protocol) {\n\treturn async<http_request_completion_t>{ [&, this] <typename C> (C &&cc) { return this->request_to_file(url, path, std::forward<C>(cc), headers, protocol); }};\n}
+
 #endif
 ";
         file_put_contents('src/dpp/cluster_coro_calls.cpp', $cppcontent);
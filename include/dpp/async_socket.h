@@ -0,0 +1,204 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+
+#include <dpp/export.h>
+#include <dpp/socket.h>
+
+#ifndef DPP_NO_CORO
+
+#include <dpp/coro/task.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace dpp {
+
+class cluster;
+
+namespace detail::async_io {
+
+struct io_state;
+
+}
+
+/**
+ * @brief A non-blocking socket whose operations are awaited by coroutines, with readiness delivered by the cluster's socket engine.
+ *
+ * This lets a coroutine event handler talk to a database, cache or local service without blocking a thread pool worker:
+ * while an operation cannot make progress the coroutine is suspended, and it is resumed on the cluster's thread pool once
+ * the socket engine reports the socket as ready.
+ *
+ * ```cpp
+ * dpp::async_socket redis = co_await dpp::async_socket::connect(&bot, "127.0.0.1", 6379);
+ * co_await redis.write("PING\r\n");
+ * char reply[64];
+ * size_t length = co_await redis.read(reply, sizeof(reply));
+ * ```
+ *
+ * Only one read and one write may be in progress at the same time on a socket.
+ * Operations throw dpp::connection_exception if the socket fails or is closed while they are in progress.
+ *
+ * @warning - This feature is EXPERIMENTAL. The API may change at any time and there may be bugs.
+ * Please report any to <a href="https://github.com/brainboxdotcc/DPP/issues">GitHub Issues</a> or to our <a href="https://discord.gg/dpp">Discord Server</a>.
+ */
+class DPP_EXPORT async_socket {
+	/**
+	 * @brief State shared with the socket engine callbacks and pending operations
+	 */
+	std::shared_ptr<detail::async_io::io_state> state;
+
+public:
+	/**
+	 * @brief Construct a closed socket
+	 */
+	async_socket() = default;
+
+	/**
+	 * @brief Take ownership of a connected or listening socket, switch it to non-blocking mode and register it with the socket engine
+	 *
+	 * @param owner Cluster whose socket engine and thread pool are used
+	 * @param fd Socket to take ownership of, closed when this object is closed or destroyed
+	 * @throw dpp::connection_exception The socket could not be made non-blocking or registered
+	 */
+	async_socket(cluster* owner, dpp::socket fd);
+
+	/**
+	 * @brief Copy constructor is disabled
+	 */
+	async_socket(const async_socket&) = delete;
+
+	/**
+	 * @brief Move constructor
+	 */
+	async_socket(async_socket&&) noexcept = default;
+
+	/**
+	 * @brief Copy assignment is disabled
+	 */
+	async_socket& operator=(const async_socket&) = delete;
+
+	/**
+	 * @brief Move assignment, closing the socket currently held
+	 *
+	 * @return *this
+	 */
+	async_socket& operator=(async_socket&& rhs) noexcept;
+
+	/**
+	 * @brief Close the socket
+	 */
+	~async_socket();
+
+	/**
+	 * @brief Connect to a TCP server. The hostname is resolved by a thread pool worker,
+	 * so a slow DNS lookup does not block the awaiting coroutine's thread.
+	 *
+	 * @param owner Cluster whose socket engine and thread pool are used
+	 * @param hostname Hostname or IP address to connect to
+	 * @param port Port to connect to
+	 * @return task<async_socket> The connected socket
+	 * @throw dpp::connection_exception The hostname could not be resolved or the connection failed
+	 */
+	static task<async_socket> connect(cluster* owner, std::string hostname, uint16_t port);
+
+	/**
+	 * @brief Create a TCP socket listening for connections, to be used with @ref accept()
+	 *
+	 * @param owner Cluster whose socket engine and thread pool are used
+	 * @param address IPv4 address to bind to
+	 * @param port Port to bind to
+	 * @return async_socket The listening socket
+	 * @throw dpp::connection_exception The socket could not be bound or put into listening mode
+	 */
+	static async_socket listen(cluster* owner, std::string_view address, uint16_t port);
+
+	/**
+	 * @brief Accept a connection on a listening socket
+	 *
+	 * @return task<async_socket> The accepted connection, registered with the same cluster
+	 * @throw dpp::connection_exception The listening socket failed or was closed
+	 */
+	task<async_socket> accept();
+
+	/**
+	 * @brief Read whatever data is available, waiting until at least one byte can be read
+	 *
+	 * @param buffer Buffer to read into, which must stay valid until the read completes
+	 * @param length Size of the buffer
+	 * @return task<size_t> Number of bytes read, or 0 if the peer closed the connection
+	 * @throw dpp::connection_exception The socket failed or was closed
+	 */
+	task<size_t> read(void* buffer, size_t length);
+
+	/**
+	 * @brief Write all of the given data, waiting for the socket to become writable as often as needed
+	 *
+	 * @param data Data to write, which must stay valid until the write completes
+	 * @return task<size_t> Number of bytes written, which is always data.size()
+	 * @throw dpp::connection_exception The socket failed or was closed
+	 */
+	task<size_t> write(std::string_view data);
+
+	/**
+	 * @brief Close the socket and remove it from the socket engine.
+	 * Operations still waiting on the socket throw dpp::connection_exception.
+	 */
+	void close();
+
+	/**
+	 * @brief Check if the socket is open
+	 *
+	 * @return bool True if the socket is open
+	 */
+	bool is_open() const;
+
+	/**
+	 * @brief Get the socket's file descriptor
+	 *
+	 * @return dpp::socket File descriptor, or INVALID_SOCKET if closed
+	 */
+	dpp::socket get_fd() const;
+};
+
+/**
+ * @brief Read part or all of a file on the cluster's thread pool, without blocking the awaiting coroutine's thread.
+ *
+ * Regular files are always reported as ready by socket engines, so the read is done by a thread pool worker
+ * and the coroutine is resumed once it completes.
+ *
+ * @warning - This feature is EXPERIMENTAL. The API may change at any time and there may be bugs.
+ * Please report any to <a href="https://github.com/brainboxdotcc/DPP/issues">GitHub Issues</a> or to our <a href="https://discord.gg/dpp">Discord Server</a>.
+ * @param owner Cluster whose thread pool is used
+ * @param path Path of the file
+ * @param offset Offset to start reading at
+ * @param length Maximum number of bytes to read, by default the rest of the file
+ * @return task<std::string> The bytes read, shorter than length if the end of the file was reached
+ * @throw dpp::file_exception The file could not be opened or read
+ */
+DPP_EXPORT task<std::string> async_read_file(cluster* owner, std::string path, uint64_t offset = 0, size_t length = std::numeric_limits<size_t>::max());
+
+}
+
+#endif
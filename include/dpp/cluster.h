@@ -47,8 +47,10 @@
 #include <cstring>
 #include <dpp/restresults.h>
 #include <dpp/event_router.h>
+#include <dpp/component_router.h>
 #include <dpp/coro/async.h>
 #include <dpp/socketengine.h>
+#include <dpp/voice_decode_pool.h>
 
 namespace dpp {
 
@@ -188,6 +190,12 @@ class DPP_EXPORT cluster {
 	 */
 	std::unique_ptr<thread_pool> pool{nullptr};
 
+	/**
+	 * @brief Shared pool used by voice connections to decode received audio, if enabled
+	 * by set_voice_decode_pool(). Voice connections hold a reference to it while they exist.
+	 */
+	std::shared_ptr<voice_decode_pool> voice_decoders;
+
 	/**
 	 * @brief Used to spawn the socket engine into its own thread if
 	 * the cluster is started with dpp::st_return. It is unused otherwise.
@@ -279,6 +287,12 @@ public:
 	 */
 	uint16_t request_timeout = 60;
 
+	/**
+	 * @brief Priority class given to REST requests which have no priority set by
+	 * cluster::set_request_priority() and are not interaction responses.
+	 */
+	request_priority default_request_priority{rp_user};
+
 	/**
 	 * @brief Socket engine instance
 	 */
@@ -440,6 +454,45 @@ public:
 	 */
 	std::string get_audit_reason();
 
+	/**
+	 * @brief Set the priority class for the next REST call to be made.
+	 * This is set per-thread, so you must ensure that if you call this method, your request that
+	 * is associated with the priority happens on the same thread where you set the priority.
+	 * Once the next call is made, the priority is cleared for this thread automatically.
+	 *
+	 * Example:
+	 * ```
+	 * bot.set_request_priority(dpp::rp_background)
+	 *	.guild_member_add_role(guild_id, user_id, role_id);
+	 * ```
+	 *
+	 * @param priority The priority to use for the next REST call on this thread
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_request_priority(request_priority priority);
+
+	/**
+	 * @brief Set the priority class for all REST calls on this cluster which do not have
+	 * a priority set by cluster::set_request_priority().
+	 * @note Interaction responses and followups are always sent with dpp::rp_interaction
+	 * unless a priority is explicitly set for the call.
+	 *
+	 * @param priority The default priority for REST calls. Default: dpp::rp_user.
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_default_request_priority(request_priority priority);
+
+	/**
+	 * @brief Get the priority class to use for the next REST call to be made on this thread.
+	 *
+	 * @note This method call clears the priority set by cluster::set_request_priority()
+	 * when it returns it.
+	 *
+	 * @param interaction True if the request is an interaction response or followup
+	 * @return request_priority The priority to be used.
+	 */
+	request_priority get_request_priority(bool interaction = false);
+
 	/**
 	 * @brief Sets the address of the default gateway, for connecting the websockets.
 	 *
@@ -589,6 +642,22 @@ public:
 	 */
 	cluster& set_request_timeout(uint16_t timeout);
 
+	/**
+	 * @brief Decode received voice audio on a shared pool of threads, rather than on a courier
+	 * thread started by each voice connection. This scales better for bots receiving audio in
+	 * many voice channels at once, where most connections are quiet at any moment.
+	 *
+	 * @note Only affects voice connections made after this is called. With the pool enabled,
+	 * discord_voice_client::set_iteration_interval() has no effect; the flush interval here is used instead.
+	 *
+	 * @param threads Number of threads in the pool. Zero disables the pool.
+	 * @param flush_interval_ms Time in milliseconds between audio arriving and it being passed to
+	 * on_voice_receive. Packets which arrive out of order within this time are put back in order. Default: 100.
+	 *
+	 * @return cluster& Reference to self for chaining.
+	 */
+	cluster& set_voice_decode_pool(uint32_t threads, uint16_t flush_interval_ms = 100);
+
 	/* Functions for attaching to event handlers */
 
 	/**
@@ -753,6 +822,7 @@ public:
 	 *
 	 * @note Use operator() to attach a lambda to this event, and the detach method to detach the listener using the returned ID.
 	 * The function signature for this event takes a single `const` reference of type button_click_t&, and returns void.
+	 * @note The key of this event is the custom_id of the button, for use with event_router_t::attach_key() and event_router_t::when_key().
 	 */
 	event_router_t<button_click_t> on_button_click;
 	
@@ -774,6 +844,7 @@ public:
 	 *
 	 * @note Use operator() to attach a lambda to this event, and the detach method to detach the listener using the returned ID.
 	 * The function signature for this event takes a single `const` reference of type select_click_t&, and returns void.
+	 * @note The key of this event is the custom_id of the select menu, for use with event_router_t::attach_key() and event_router_t::when_key().
 	 */
 	event_router_t<select_click_t> on_select_click;
 
@@ -802,6 +873,7 @@ public:
 	 *
 	 * @note Use operator() to attach a lambda to this event, and the detach method to detach the listener using the returned ID.
 	 * The function signature for this event takes a single `const` reference of type form_submit_t&, and returns void.
+	 * @note The key of this event is the custom_id of the modal dialog, for use with event_router_t::attach_key() and event_router_t::when_key().
 	 */
 	event_router_t<form_submit_t> on_form_submit;
 
@@ -915,6 +987,7 @@ public:
 	 * @see https://discord.com/developers/docs/topics/gateway-events#message-reaction-add
 	 * @note Use operator() to attach a lambda to this event, and the detach method to detach the listener using the returned ID.
 	 * The function signature for this event takes a single `const` reference of type message_reaction_add_t&, and returns void.
+	 * @note The key of this event is the ID of the message reacted to, for use with event_router_t::attach_key() and event_router_t::when_key().
 	 */
 	event_router_t<message_reaction_add_t> on_message_reaction_add;
 
@@ -1240,6 +1313,7 @@ public:
 	 * @see https://discord.com/developers/docs/topics/gateway-events#message-create
 	 * @note Use operator() to attach a lambda to this event, and the detach method to detach the listener using the returned ID.
 	 * The function signature for this event takes a single `const` reference of type message_create_t&, and returns void.
+	 * @note The key of this event is the ID of the channel the message was sent in, for use with event_router_t::attach_key() and event_router_t::when_key().
 	 */
 	event_router_t<message_create_t> on_message_create;
 
@@ -1600,6 +1674,35 @@ public:
 	 * The function signature for this event takes a single `const` reference of type channel_update_t&, and returns void.
 	 */
 	event_router_t<entitlement_delete_t> on_entitlement_delete;
+
+	/**
+	 * @brief Routes button clicks to handlers registered for their custom_id.
+	 * Use this instead of comparing custom_id in an on_button_click handler, so that
+	 * each click only reaches the handler for its own button.
+	 *
+	 * @details Example: @code{cpp}
+	 * bot.button_router.add("confirm", [](const dpp::button_click_t& event) {
+	 *	event.reply("Confirmed!");
+	 * }, 600);
+	 * bot.button_router.add_prefix("vote:", [](const dpp::button_click_t& event) {
+	 *	// custom_id is e.g. "vote:yes"
+	 * });
+	 * @endcode
+	 * @see component_router
+	 */
+	component_router<button_click_t> button_router{on_button_click};
+
+	/**
+	 * @brief Routes select menu interactions to handlers registered for their custom_id.
+	 * @see component_router
+	 */
+	component_router<select_click_t> select_router{on_select_click};
+
+	/**
+	 * @brief Routes modal dialog submissions to handlers registered for their custom_id.
+	 * @see component_router
+	 */
+	component_router<form_submit_t> form_router{on_form_submit};
 	
 	/**
 	 * @brief Post a REST request. Where possible use a helper method instead like message_create
@@ -1643,6 +1746,40 @@ public:
 	 */
 	void request(const std::string &url, http_method method, http_completion_event callback, const std::string &postdata = "", const std::string &mimetype = "text/plain", const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = "1.1");
 
+	/**
+	 * @brief Make a HTTP(S) request, receiving the response body in parts as it arrives rather than
+	 * all at once. Memory use stays bounded regardless of the size of the response, which makes this
+	 * suitable for downloading attachments and other large files.
+	 *
+	 * @param url Full URL to post to, e.g. https://api.somewhere.com/v1/foo/
+	 * @param method Method, e.g. GET, POST
+	 * @param on_body Function called with each part of the body in order as it arrives. This is called on
+	 * the socket engine thread and must not block for long.
+	 * @param callback Function to call when the HTTP call completes. http_request_completion_t::body will be empty.
+	 * @param postdata POST data
+	 * @param mimetype MIME type of POST data
+	 * @param headers Headers to send with the request
+	 * @param protocol HTTP protocol to use (1.1 and 1.0 are supported)
+	 */
+	void request_stream(const std::string &url, http_method method, https_client_body_event on_body, http_completion_event callback, const std::string &postdata = "", const std::string &mimetype = "text/plain", const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = "1.1");
+
+	/**
+	 * @brief Download the response body of a HTTP(S) GET request directly into a file, without
+	 * holding it in memory.
+	 *
+	 * @note The body is written whatever the HTTP status of the response, so check
+	 * http_request_completion_t::status in the callback. If the file could not be written,
+	 * http_request_completion_t::error is set to dpp::h_write.
+	 *
+	 * @param url Full URL to fetch, e.g. https://cdn.discordapp.com/attachments/...
+	 * @param path Path of the file to write. It is created, or truncated if it exists.
+	 * @param callback Function to call when the download completes. http_request_completion_t::body will be empty.
+	 * @param headers Headers to send with the request
+	 * @param protocol HTTP protocol to use (1.1 and 1.0 are supported)
+	 * @throw dpp::file_exception The file could not be opened for writing
+	 */
+	void request_to_file(const std::string &url, const std::string &path, http_completion_event callback, const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = "1.1");
+
 	/**
 	 * @brief Respond to a slash command
 	 *
@@ -2678,4 +2678,5 @@
 
 /* End of auto-generated definitions */
 [[nodiscard]] async<http_request_completion_t> co_request(const std::string &url, http_method method, const std::string &postdata = "", const std::string &mimetype = "text/plain", const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = "1.1");
+[[nodiscard]] async<http_request_completion_t> co_request_to_file(const std::string &url, const std::string &path, const std::multimap<std::string, std::string> &headers = {}, const std::string &protocol = "1.1");
 
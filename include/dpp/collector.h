@@ -99,6 +99,34 @@ public:
 		});
 	}
 
+	/**
+	 * @brief Construct a new collector object which only collects events with a certain key,
+	 * e.g. reactions to one message. Events with other keys never reach the collector,
+	 * so many keyed collectors can run at once without each seeing every event.
+	 * 
+	 * The timer for the collector begins immediately on construction of the object.
+	 * 
+	 * @param cl Pointer to cluster which manages this collector
+	 * @param duration Duration in seconds to run the collector for
+	 * @param event Event to attach to, e.g. cluster::on_message_reaction_add. The event must have a key.
+	 * @param key Key of the events to collect, see event_router_t::attach_key(). If empty, all events are collected.
+	 * @throw dpp::logic_exception The event has no key
+	 */
+	collector(class cluster* cl, uint64_t duration, event_router_t<T> & event, const std::string& key) : owner(cl), triggered(false) {
+		std::function<void(const T&)> f = [this](const T& event) {
+			const C* v = filter(event);
+			if (v) {
+				stored.push_back(*v);
+			}
+		};
+		tl = new dpp::timed_listener<event_router_t<T>, std::function<void(const T&)>>(cl, duration, event, key, f, [this]([[maybe_unused]] dpp::timer timer_handle) {
+			if (!triggered) {
+				triggered = true;
+				completed(stored);
+			}
+		});
+	}
+
 	/**
 	 * @brief You must implement this function to receive the completed list of
 	 * captured objects.
@@ -281,9 +309,10 @@ public:
 	 * 
 	 * @param cl cluster to associate the collector with
 	 * @param duration Duration of time to run the collector for in seconds
-	 * @param msg_id Optional message ID. If specified, only collects reactions for the given message
+	 * @param msg_id Optional message ID. If specified, only collects reactions for the given message,
+	 * and only reactions to that message are passed to the collector.
 	 */
-	reaction_collector(cluster* cl, uint64_t duration, snowflake msg_id = 0) : reaction_collector_t::collector(cl, duration, cl->on_message_reaction_add), message_id(msg_id) { }
+	reaction_collector(cluster* cl, uint64_t duration, snowflake msg_id = 0) : reaction_collector_t::collector(cl, duration, cl->on_message_reaction_add, msg_id.empty() ? std::string{} : msg_id.str()), message_id(msg_id) { }
 
 	/**
 	 * @brief Return the completed collection
@@ -0,0 +1,436 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <dpp/event_router.h>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <queue>
+#include <vector>
+#include <variant>
+#include <functional>
+#include <shared_mutex>
+#include <ctime>
+
+namespace dpp {
+
+/**
+ * @brief Routes component interactions, such as button clicks, select menus and modal dialog
+ * submissions, to handlers registered for their custom_id.
+ *
+ * Handlers are found by hashing the custom_id, so dispatch takes the same time however many
+ * components are registered. A handler may be registered for an exact custom_id, or for a prefix
+ * of custom_ids such as `"vote:"`, in which case the longest matching prefix wins. An exact
+ * match always wins over a prefix.
+ *
+ * Each route may be given a time to live, after which it is removed. This suits buttons on
+ * messages which stop being useful after a while. Expired routes are removed as the router is
+ * used, without a timer.
+ *
+ * The router attaches itself to its event the first time a route is added, so an unused
+ * router costs nothing.
+ *
+ * @tparam T Event type, e.g. dpp::button_click_t. The event must have a custom_id.
+ */
+template <typename T>
+class component_router {
+public:
+	/**
+	 * @brief Handler type for a route
+	 */
+	using handler_t = std::function<void(const T&)>;
+
+#ifndef DPP_NO_CORO
+	/**
+	 * @brief Handler type for a coroutine route
+	 */
+	using co_handler_t = std::function<dpp::task<void>(const T&)>;
+#else
+	/**
+	 * @brief Placeholder for the coroutine handler type, for ABI compatibility between DPP_CORO and not
+	 */
+	using co_handler_t = std::function<task_dummy(T)>;
+#endif
+
+	/**
+	 * @brief Variant of coroutine and regular handler types, as used by cluster::register_command()
+	 */
+	using handler_variant = std::variant<handler_t, co_handler_t>;
+
+private:
+	/**
+	 * @brief A registered route
+	 */
+	struct route {
+		/**
+		 * @brief Handler to call
+		 */
+		handler_variant handler;
+
+		/**
+		 * @brief Time the route expires, or 0 if it never expires
+		 */
+		time_t expires{0};
+
+		/**
+		 * @brief Check if the route is still live
+		 * @param now current time
+		 * @return true if the route has not expired
+		 */
+		bool live(time_t now) const {
+			return expires == 0 || expires > now;
+		}
+	};
+
+	/**
+	 * @brief An entry in the expiry queue
+	 */
+	struct expiry {
+		/**
+		 * @brief Time the route expires
+		 */
+		time_t at;
+
+		/**
+		 * @brief True if the route is a prefix route
+		 */
+		bool prefix;
+
+		/**
+		 * @brief custom_id or prefix of the route
+		 */
+		std::string custom_id;
+
+		/**
+		 * @brief Order by expiry time, for a min-heap
+		 * @param other other entry
+		 * @return true if this entry expires later
+		 */
+		bool operator>(const expiry& other) const {
+			return at > other.at;
+		}
+	};
+
+	/**
+	 * @brief Event this router handles
+	 */
+	event_router_t<T>& events;
+
+	/**
+	 * @brief Mutex guarding the routes
+	 */
+	mutable std::shared_mutex mutex;
+
+	/**
+	 * @brief Routes by exact custom_id
+	 */
+	std::unordered_map<std::string, route> exact;
+
+	/**
+	 * @brief Routes by custom_id prefix
+	 */
+	std::unordered_map<std::string, route> prefixes;
+
+	/**
+	 * @brief Number of prefix routes of each prefix length, longest first
+	 */
+	std::map<size_t, size_t, std::greater<size_t>> prefix_lengths;
+
+	/**
+	 * @brief Expiry times of routes with a time to live, soonest first.
+	 * Entries for routes which were removed or replaced are skipped when they come due.
+	 */
+	std::priority_queue<expiry, std::vector<expiry>, std::greater<expiry>> expiries;
+
+	/**
+	 * @brief Handle of this router's listener on the event, or 0 if not yet attached
+	 */
+	event_handle listener{0};
+
+	/**
+	 * @brief Remove a prefix route. mutex must be held.
+	 * @param it route to remove
+	 */
+	void erase_prefix(typename std::unordered_map<std::string, route>::iterator it) {
+		auto length = prefix_lengths.find(it->first.length());
+		if (length != prefix_lengths.end() && --length->second == 0) {
+			prefix_lengths.erase(length);
+		}
+		prefixes.erase(it);
+	}
+
+	/**
+	 * @brief Remove routes which have expired. mutex must be held.
+	 * @param now current time
+	 */
+	void purge_expired(time_t now) {
+		while (!expiries.empty() && expiries.top().at <= now) {
+			const expiry& due = expiries.top();
+			auto& routes = due.prefix ? prefixes : exact;
+			auto it = routes.find(due.custom_id);
+			/* The route may have been removed or replaced since this entry was queued */
+			if (it != routes.end() && !it->second.live(now)) {
+				if (due.prefix) {
+					erase_prefix(it);
+				} else {
+					routes.erase(it);
+				}
+			}
+			expiries.pop();
+		}
+	}
+
+	/**
+	 * @brief Add a route
+	 * @param prefix true to add a prefix route
+	 * @param custom_id custom_id or prefix
+	 * @param handler handler to call
+	 * @param ttl time to live in seconds, or 0 to never expire
+	 * @return true if added, false if a live route already exists for the custom_id or prefix
+	 */
+	bool add_route(bool prefix, const std::string& custom_id, handler_variant&& handler, uint64_t ttl) {
+		std::unique_lock l(mutex);
+		const time_t now = time(nullptr);
+		purge_expired(now);
+		auto& routes = prefix ? prefixes : exact;
+		auto existing = routes.find(custom_id);
+		if (existing != routes.end()) {
+			if (existing->second.live(now)) {
+				return false;
+			}
+			if (prefix) {
+				erase_prefix(existing);
+			} else {
+				routes.erase(existing);
+			}
+		}
+		const time_t expires = ttl == 0 ? 0 : now + static_cast<time_t>(ttl);
+		routes.emplace(custom_id, route{std::move(handler), expires});
+		if (prefix) {
+			++prefix_lengths[custom_id.length()];
+		}
+		if (expires != 0) {
+			expiries.push(expiry{expires, prefix, custom_id});
+		}
+		if (listener == 0) {
+			attach();
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Remove a route
+	 * @param prefix true to remove a prefix route
+	 * @param custom_id custom_id or prefix
+	 * @return true if a route was removed
+	 */
+	bool remove_route(bool prefix, const std::string& custom_id) {
+		std::unique_lock l(mutex);
+		auto& routes = prefix ? prefixes : exact;
+		auto it = routes.find(custom_id);
+		if (it == routes.end()) {
+			return false;
+		}
+		if (prefix) {
+			erase_prefix(it);
+		} else {
+			routes.erase(it);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Attach this router's listener to its event. mutex must be held.
+	 */
+	void attach() {
+#ifndef DPP_NO_CORO
+		listener = events.attach([this](const T& event) -> dpp::task<void> {
+			handler_variant handler;
+			if (!find(event.custom_id, handler)) {
+				co_return;
+			}
+			if (std::holds_alternative<co_handler_t>(handler)) {
+				co_await std::get<co_handler_t>(handler)(event);
+			} else if (std::holds_alternative<handler_t>(handler)) {
+				std::get<handler_t>(handler)(event);
+			}
+			co_return;
+		});
+#else
+		listener = events.attach([this](const T& event) {
+			handler_variant handler;
+			if (find(event.custom_id, handler) && std::holds_alternative<handler_t>(handler)) {
+				std::get<handler_t>(handler)(event);
+			}
+		});
+#endif
+	}
+
+public:
+	/**
+	 * @brief Construct a new component router
+	 * @param event Event to route, e.g. cluster::on_button_click
+	 */
+	explicit component_router(event_router_t<T>& event) : events(event) {
+	}
+
+	component_router(const component_router&) = delete;
+	component_router& operator=(const component_router&) = delete;
+
+	/**
+	 * @brief Destroy the component router, detaching it from its event
+	 */
+	~component_router() {
+		if (listener != 0) {
+			events.detach_and_wait(listener);
+		}
+	}
+
+	/**
+	 * @brief Find the handler for a custom_id. An exact route is preferred,
+	 * then the route with the longest matching prefix.
+	 *
+	 * @param custom_id custom_id of the component
+	 * @param handler receives a copy of the handler
+	 * @return true if a live route was found
+	 */
+	bool find(const std::string& custom_id, handler_variant& handler) {
+		bool found = false, purge = false;
+		const time_t now = time(nullptr);
+		{
+			std::shared_lock l(mutex);
+			purge = !expiries.empty() && expiries.top().at <= now;
+			auto it = exact.find(custom_id);
+			if (it != exact.end() && it->second.live(now)) {
+				handler = it->second.handler;
+				found = true;
+			} else {
+				for (const auto& [length, _] : prefix_lengths) {
+					if (length > custom_id.length()) {
+						continue;
+					}
+					auto p = prefixes.find(custom_id.substr(0, length));
+					if (p != prefixes.end() && p->second.live(now)) {
+						handler = p->second.handler;
+						found = true;
+						break;
+					}
+				}
+			}
+		}
+		if (purge) {
+			std::unique_lock l(mutex);
+			purge_expired(now);
+		}
+		return found;
+	}
+
+	/**
+	 * @brief Add a route for an exact custom_id
+	 *
+	 * @param custom_id custom_id of the component
+	 * @param handler A handler function of the form `void(const T&)`
+	 * @param ttl Time to live in seconds, after which the route is removed. 0 to never expire.
+	 * @return bool Returns `true` if the route was added, or `false` if a route for the
+	 * custom_id already exists
+	 */
+	template <typename F>
+	std::enable_if_t<utility::callable_returns_v<F, void, const T&>, bool> add(const std::string& custom_id, F&& handler, uint64_t ttl = 0) {
+		return add_route(false, custom_id, handler_variant{std::in_place_type<handler_t>, std::forward<F>(handler)}, ttl);
+	}
+
+	/**
+	 * @brief Add a route for every custom_id starting with a prefix, e.g. `"vote:"`
+	 *
+	 * @param prefix custom_id prefix
+	 * @param handler A handler function of the form `void(const T&)`
+	 * @param ttl Time to live in seconds, after which the route is removed. 0 to never expire.
+	 * @return bool Returns `true` if the route was added, or `false` if a route for the
+	 * prefix already exists
+	 */
+	template <typename F>
+	std::enable_if_t<utility::callable_returns_v<F, void, const T&>, bool> add_prefix(const std::string& prefix, F&& handler, uint64_t ttl = 0) {
+		return add_route(true, prefix, handler_variant{std::in_place_type<handler_t>, std::forward<F>(handler)}, ttl);
+	}
+
+#ifndef DPP_NO_CORO
+	/**
+	 * @brief Add a coroutine route for an exact custom_id
+	 *
+	 * @param custom_id custom_id of the component
+	 * @param handler A coroutine handler function of the form `dpp::task<void>(const T&)`
+	 * @param ttl Time to live in seconds, after which the route is removed. 0 to never expire.
+	 * @return bool Returns `true` if the route was added, or `false` if a route for the
+	 * custom_id already exists
+	 */
+	template <typename F>
+	requires (utility::callable_returns<F, dpp::task<void>, const T&>)
+	bool add(const std::string& custom_id, F&& handler, uint64_t ttl = 0) {
+		return add_route(false, custom_id, handler_variant{std::in_place_type<co_handler_t>, std::forward<F>(handler)}, ttl);
+	}
+
+	/**
+	 * @brief Add a coroutine route for every custom_id starting with a prefix, e.g. `"vote:"`
+	 *
+	 * @param prefix custom_id prefix
+	 * @param handler A coroutine handler function of the form `dpp::task<void>(const T&)`
+	 * @param ttl Time to live in seconds, after which the route is removed. 0 to never expire.
+	 * @return bool Returns `true` if the route was added, or `false` if a route for the
+	 * prefix already exists
+	 */
+	template <typename F>
+	requires (utility::callable_returns<F, dpp::task<void>, const T&>)
+	bool add_prefix(const std::string& prefix, F&& handler, uint64_t ttl = 0) {
+		return add_route(true, prefix, handler_variant{std::in_place_type<co_handler_t>, std::forward<F>(handler)}, ttl);
+	}
+#endif
+
+	/**
+	 * @brief Remove the route for an exact custom_id
+	 * @param custom_id custom_id of the component
+	 * @return bool Returns `true` if the route was removed, or `false` if it was not found
+	 */
+	bool remove(const std::string& custom_id) {
+		return remove_route(false, custom_id);
+	}
+
+	/**
+	 * @brief Remove the route for a prefix
+	 * @param prefix custom_id prefix
+	 * @return bool Returns `true` if the route was removed, or `false` if it was not found
+	 */
+	bool remove_prefix(const std::string& prefix) {
+		return remove_route(true, prefix);
+	}
+
+	/**
+	 * @brief Get the number of routes, including any which have expired but not yet been removed
+	 * @return size_t number of exact and prefix routes
+	 */
+	size_t size() const {
+		std::shared_lock l(mutex);
+		return exact.size() + prefixes.size();
+	}
+};
+
+}
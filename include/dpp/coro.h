@@ -25,5 +25,7 @@
 #include "coro/async.h"
 #include "coro/coroutine.h"
 #include "coro/job.h"
+#include "coro/semaphore.h"
 #include "coro/task.h"
+#include "coro/when_all.h"
 #include "coro/when_any.h"
@@ -35,6 +35,7 @@ struct async_dummy : awaitable_dummy {
 #ifndef DPP_NO_CORO
 
 #include "coro.h"
+#include "frame_pool.h"
 
 #include <utility>
 #include <type_traits>
@@ -115,6 +116,19 @@ class async : public awaitable<R> {
 	 */
 	explicit async(std::shared_ptr<basic_promise<R>> &&promise) : awaitable<R>{promise.get()}, api_callback{std::move(promise)} {}
 
+	/**
+	 * @brief Allocate the promise object shared with the callback, from the coroutine frame pool unless it is compiled out
+	 *
+	 * @return std::shared_ptr<basic_promise<R>> New promise object
+	 */
+	static std::shared_ptr<basic_promise<R>> make_promise() {
+#ifdef DPP_NO_CORO_FRAME_POOL
+		return std::make_shared<basic_promise<R>>();
+#else
+		return std::allocate_shared<basic_promise<R>>(detail::frame_pool::allocator<basic_promise<R>>{});
+#endif
+	}
+
 public:
 	using awaitable<R>::awaitable; // use awaitable's constructors
 	using awaitable<R>::operator=; // use async_base's assignment operator
@@ -136,7 +150,7 @@ public:
 #ifndef _DOXYGEN_
 	requires std::invocable<Fun, Obj, Args..., std::function<void(R)>>
 #endif
-	explicit async(Obj &&obj, Fun &&fun, Args&&... args) : async{std::make_shared<basic_promise<R>>()} {
+	explicit async(Obj &&obj, Fun &&fun, Args&&... args) : async{make_promise()} {
 		std::invoke(std::forward<Fun>(fun), std::forward<Obj>(obj), std::forward<Args>(args)..., api_callback);
 	}
 
@@ -150,7 +164,7 @@ public:
 #ifndef _DOXYGEN_
 	requires std::invocable<Fun, Args..., std::function<void(R)>>
 #endif
-	explicit async(Fun &&fun, Args&&... args) : async{std::make_shared<basic_promise<R>>()} {
+	explicit async(Fun &&fun, Args&&... args) : async{make_promise()} {
 		std::invoke(std::forward<Fun>(fun), std::forward<Args>(args)..., api_callback);
 	}
 
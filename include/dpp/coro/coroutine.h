@@ -34,6 +34,7 @@ struct coroutine_dummy {
 
 #include <dpp/coro/coro.h>
 #include <dpp/coro/awaitable.h>
+#include <dpp/coro/frame_pool.h>
 
 #include <optional>
 #include <type_traits>
@@ -203,7 +204,7 @@ namespace detail::coroutine {
 	 * @brief Promise type for coroutine.
 	 */
 	template <typename R>
-	struct promise_t {
+	struct promise_t : frame_pool::pooled_promise {
 		/**
 		 * @brief Handle of the coroutine co_await-ing this coroutine.
 		 */
@@ -337,7 +338,7 @@ namespace detail::coroutine {
 	 * @brief Struct returned by a coroutine's final_suspend, resumes the continuation
 	 */
 	template <>
-	struct promise_t<void> {
+	struct promise_t<void> : frame_pool::pooled_promise {
 		/**
 		 * @brief Handle of the coroutine co_await-ing this coroutine.
 		 */
@@ -0,0 +1,146 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * Copyright 2022 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+
+#include <dpp/export.h>
+
+#include <cstddef>
+
+namespace dpp {
+
+/**
+ * @brief Enable or disable pooling of coroutine frames at runtime. Pooling is enabled by default.
+ *
+ * When enabled, the frames of @ref task, @ref job and @ref coroutine, and the shared state of @ref async, are allocated from
+ * per-thread free lists of a few size classes instead of going to the global allocator every time. When disabled, every allocation
+ * goes to the global allocator; memory already held by the free lists is kept until the thread exits.
+ *
+ * Pooling can also be removed at compile time by configuring with `-DDPP_CORO_FRAME_POOL=OFF`.
+ *
+ * @param enabled True to take allocations from the free lists, false to always use the global allocator
+ */
+DPP_EXPORT void set_coroutine_frame_pool(bool enabled) noexcept;
+
+/**
+ * @brief Check whether coroutine frames are taken from the per-thread free lists
+ *
+ * @return bool True if pooling is enabled
+ * @see set_coroutine_frame_pool
+ */
+DPP_EXPORT bool coroutine_frame_pool_enabled() noexcept;
+
+namespace detail {
+
+/**
+ * @brief Size-classed, thread-local free lists for coroutine frames and async states
+ */
+namespace frame_pool {
+
+/**
+ * @brief Allocate memory for a coroutine frame
+ *
+ * @param size Size in bytes
+ * @return void* Memory aligned to __STDCPP_DEFAULT_NEW_ALIGNMENT__
+ * @throw std::bad_alloc on allocation failure
+ */
+DPP_EXPORT void* allocate(size_t size);
+
+/**
+ * @brief Free memory returned by @ref allocate. It may be freed on a different thread than it was allocated on.
+ *
+ * @param ptr Memory to free
+ * @param size Size in bytes, as passed to @ref allocate
+ */
+DPP_EXPORT void deallocate(void* ptr, size_t size) noexcept;
+
+/**
+ * @brief Base of promise types, routing the allocation of their coroutine frame through the pool
+ */
+struct pooled_promise {
+#ifndef DPP_NO_CORO_FRAME_POOL
+	/**
+	 * @brief Allocate a coroutine frame
+	 *
+	 * @param size Size of the frame
+	 * @return void* Memory for the frame
+	 */
+	static void* operator new(size_t size) {
+		return allocate(size);
+	}
+
+	/**
+	 * @brief Free a coroutine frame
+	 *
+	 * @param ptr Frame to free
+	 * @param size Size of the frame
+	 */
+	static void operator delete(void* ptr, size_t size) noexcept {
+		deallocate(ptr, size);
+	}
+#endif
+};
+
+/**
+ * @brief Standard allocator over the pool, used for the shared state of @ref dpp::async
+ *
+ * @tparam T Type to allocate
+ */
+template <typename T>
+struct allocator {
+	using value_type = T;
+
+	allocator() noexcept = default;
+
+	template <typename U>
+	allocator(const allocator<U>&) noexcept {}
+
+	/**
+	 * @brief Allocate memory for n objects of type T
+	 *
+	 * @param n Number of objects
+	 * @return T* Uninitialized memory
+	 */
+	T* allocate(size_t n) {
+		static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types cannot be pooled");
+		return static_cast<T*>(frame_pool::allocate(n * sizeof(T)));
+	}
+
+	/**
+	 * @brief Free memory returned by allocate
+	 *
+	 * @param ptr Memory to free
+	 * @param n Number of objects, as passed to allocate
+	 */
+	void deallocate(T* ptr, size_t n) noexcept {
+		frame_pool::deallocate(ptr, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const allocator<U>&) const noexcept {
+		return true;
+	}
+};
+
+} // namespace frame_pool
+
+} // namespace detail
+
+} /* namespace dpp */
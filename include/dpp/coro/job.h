@@ -32,6 +32,7 @@ struct job_dummy {
 #ifndef DPP_NO_CORO
 
 #include "coro.h"
+#include "frame_pool.h"
 
 #include <type_traits>
 #include <utility>
@@ -67,7 +68,7 @@ namespace job {
  * @brief Coroutine promise type for a job
  */
 template <typename... Args>
-struct promise {
+struct promise : frame_pool::pooled_promise {
 
 #ifdef DPP_CORO_TEST
 	promise() {
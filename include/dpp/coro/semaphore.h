@@ -0,0 +1,292 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * Copyright 2022 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#ifndef DPP_NO_CORO
+#pragma once
+
+#include "coro.h"
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace dpp {
+
+/**
+ * @class semaphore semaphore.h coro/semaphore.h
+ * @brief Counting semaphore which suspends coroutines instead of blocking threads, used to cap how many operations run at once.
+ *
+ * Coroutines waiting on a permit are resumed in the order they started waiting. A released permit is handed directly to the
+ * first waiter, which is resumed on the thread that called @ref release().
+ *
+ * ```cpp
+ * dpp::semaphore limit{4};
+ *
+ * dpp::task<void> fetch(dpp::cluster* bot, dpp::semaphore* limit, dpp::snowflake id) {
+ *     auto permit = co_await limit->lock(); // at most 4 of these past this line at once
+ *     co_await bot->co_user_get(id);
+ * } // permit is released here
+ * ```
+ *
+ * @warning - This feature is EXPERIMENTAL. The API may change at any time and there may be bugs.
+ * Please report any to <a href="https://github.com/brainboxdotcc/DPP/issues">GitHub Issues</a> or to our <a href="https://discord.gg/dpp">Discord Server</a>.
+ */
+class semaphore {
+	/**
+	 * @brief Mutex protecting the permit count and the waiters
+	 */
+	mutable std::mutex mutex;
+
+	/**
+	 * @brief Number of permits available
+	 */
+	size_t permits;
+
+	/**
+	 * @brief Coroutines waiting for a permit, in the order they started waiting
+	 */
+	std::deque<detail::std_coroutine::coroutine_handle<>> waiters;
+
+public:
+	/**
+	 * @brief RAII object holding one permit of a semaphore, releasing it on destruction
+	 */
+	class guard {
+		/**
+		 * @brief Semaphore the permit belongs to, or nullptr if the permit was released
+		 */
+		semaphore* owner{nullptr};
+
+	public:
+		/**
+		 * @brief Construct a guard which holds no permit
+		 */
+		guard() = default;
+
+		/**
+		 * @brief Take ownership of a permit which has already been acquired
+		 *
+		 * @param s Semaphore the permit was acquired from
+		 */
+		explicit guard(semaphore& s) noexcept : owner{&s} {}
+
+		/**
+		 * @brief Copy constructor is disabled
+		 */
+		guard(const guard&) = delete;
+
+		/**
+		 * @brief Move constructor, the permit is transferred to the new guard
+		 */
+		guard(guard&& rhs) noexcept : owner{std::exchange(rhs.owner, nullptr)} {}
+
+		/**
+		 * @brief Copy assignment is disabled
+		 */
+		guard& operator=(const guard&) = delete;
+
+		/**
+		 * @brief Move assignment, releasing any permit already held
+		 *
+		 * @return *this
+		 */
+		guard& operator=(guard&& rhs) noexcept {
+			if (this != &rhs) {
+				release();
+				owner = std::exchange(rhs.owner, nullptr);
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief Release the permit early, if still held
+		 */
+		void release() noexcept {
+			if (owner) {
+				std::exchange(owner, nullptr)->release();
+			}
+		}
+
+		/**
+		 * @brief Check whether this guard still holds a permit
+		 *
+		 * @return bool True if a permit is held
+		 */
+		bool owns_permit() const noexcept {
+			return owner != nullptr;
+		}
+
+		/**
+		 * @brief Release the permit, if still held
+		 */
+		~guard() {
+			release();
+		}
+	};
+
+	/**
+	 * @brief Awaiter returned by @ref acquire() and @ref lock()
+	 *
+	 * @tparam Guarded If true, co_await returns a @ref guard holding the permit, otherwise the caller must call @ref release() itself
+	 */
+	template <bool Guarded>
+	struct awaiter {
+		/**
+		 * @brief Semaphore to acquire a permit from
+		 */
+		semaphore& owner;
+
+		/**
+		 * @brief Take a permit immediately if one is available
+		 *
+		 * @return bool True if a permit was taken and the coroutine does not need to suspend
+		 */
+		bool await_ready() noexcept {
+			return owner.try_acquire();
+		}
+
+		/**
+		 * @brief Take a permit if one became available, otherwise queue the coroutine to be resumed by @ref release()
+		 *
+		 * @param handle Coroutine waiting for the permit
+		 * @return bool True if the coroutine was queued and must suspend
+		 */
+		bool await_suspend(detail::std_coroutine::coroutine_handle<> handle) {
+			std::lock_guard lock{owner.mutex};
+			if (owner.permits > 0) {
+				--owner.permits;
+				return false;
+			}
+			owner.waiters.push_back(handle);
+			return true;
+		}
+
+		/**
+		 * @brief Called when the permit is acquired
+		 *
+		 * @return A @ref guard holding the permit if Guarded is true, nothing otherwise
+		 */
+		auto await_resume() const noexcept {
+			if constexpr (Guarded) {
+				return guard{owner};
+			}
+		}
+	};
+
+	/**
+	 * @brief Construct a semaphore
+	 *
+	 * @param initial_permits Number of operations which may hold a permit at the same time
+	 */
+	explicit semaphore(size_t initial_permits) noexcept : permits{initial_permits} {}
+
+	/**
+	 * @brief Copy constructor is disabled
+	 */
+	semaphore(const semaphore&) = delete;
+
+	/**
+	 * @brief Move constructor is disabled, waiters hold a reference to the semaphore
+	 */
+	semaphore(semaphore&&) = delete;
+
+	/**
+	 * @brief Copy assignment is disabled
+	 */
+	semaphore& operator=(const semaphore&) = delete;
+
+	/**
+	 * @brief Move assignment is disabled
+	 */
+	semaphore& operator=(semaphore&&) = delete;
+
+	/**
+	 * @brief Destructor
+	 *
+	 * @warning Destroying a semaphore which still has coroutines waiting on it leaves them suspended forever.
+	 */
+	~semaphore() = default;
+
+	/**
+	 * @brief Take a permit if one is available, without waiting
+	 *
+	 * @return bool True if a permit was taken, in which case @ref release() must be called once done
+	 */
+	bool try_acquire() noexcept {
+		std::lock_guard lock{mutex};
+		if (permits == 0) {
+			return false;
+		}
+		--permits;
+		return true;
+	}
+
+	/**
+	 * @brief Wait for a permit. @ref release() must be called once done with it.
+	 *
+	 * @return awaiter Object to co_await
+	 */
+	[[nodiscard]] awaiter<false> acquire() noexcept {
+		return {*this};
+	}
+
+	/**
+	 * @brief Wait for a permit, which is held by the returned guard and released when the guard is destroyed.
+	 *
+	 * @return awaiter Object to co_await, yielding a @ref guard
+	 */
+	[[nodiscard]] awaiter<true> lock() noexcept {
+		return {*this};
+	}
+
+	/**
+	 * @brief Give a permit back. If a coroutine is waiting for one, the permit is handed to it
+	 * and it is resumed on this thread before this function returns.
+	 */
+	void release() {
+		detail::std_coroutine::coroutine_handle<> next{};
+		{
+			std::lock_guard lock{mutex};
+			if (waiters.empty()) {
+				++permits;
+				return;
+			}
+			next = waiters.front();
+			waiters.pop_front();
+		}
+		next.resume();
+	}
+
+	/**
+	 * @brief Get the number of permits available right now
+	 *
+	 * @return size_t Number of permits which can be taken without waiting
+	 */
+	size_t available() const noexcept {
+		std::lock_guard lock{mutex};
+		return permits;
+	}
+};
+
+} /* namespace dpp */
+
+#endif
@@ -34,6 +34,7 @@ struct task_dummy : awaitable_dummy {
 #ifndef DPP_NO_CORO
 
 #include <dpp/coro/coro.h>
+#include <dpp/coro/frame_pool.h>
 
 #include <utility>
 #include <type_traits>
@@ -225,7 +226,7 @@ struct final_awaiter {
  * @brief Base implementation of task::promise_t, without the logic that would depend on the return type. Meant to be inherited from
  */
 template <typename R>
-struct promise_base : basic_promise<R> {
+struct promise_base : basic_promise<R>, frame_pool::pooled_promise {
 	/**
 	 * @brief Whether the task is cancelled or not.
 	 */
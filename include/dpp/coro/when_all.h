@@ -0,0 +1,207 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * Copyright 2022 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#ifndef DPP_NO_CORO
+#pragma once
+
+#include "coro.h"
+#include "task.h"
+#include "semaphore.h"
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dpp {
+
+namespace detail {
+
+/**
+ * @brief Internal cogwheels for dpp::when_all and dpp::when_all_bounded
+ */
+namespace when_all {
+
+/**
+ * @brief Empty result slot for void-returning awaitables
+ */
+struct empty{};
+
+/**
+ * @brief Result type of co_await-ing an awaitable, without references or qualifiers
+ */
+template <typename T>
+using result_of = std::remove_cvref_t<awaitable_result<T>>;
+
+/**
+ * @brief Value a when_all over results of type T resolves to, a vector of results or void
+ */
+template <typename T>
+using collected_type = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+/**
+ * @brief Storage for the result of one call made by when_all_bounded, filled in when it completes
+ */
+template <typename T>
+using slot_type = std::conditional_t<std::is_void_v<T>, empty, std::optional<T>>;
+
+/**
+ * @brief Result of calling F on an element of Range, when_all_bounded awaits this
+ */
+template <typename Range, typename F>
+using call_result = result_of<std::invoke_result_t<F&, std::ranges::range_value_t<Range>>>;
+
+/**
+ * @brief Run one call of when_all_bounded, holding the permit until it completes
+ *
+ * @param permit Permit taken from the window of the caller, released when the call completes
+ * @param fn Function to call
+ * @param item Argument to call fn with
+ * @param out Slot to store the result in
+ */
+template <typename R, typename F, typename Item>
+dpp::task<void> run_bounded(semaphore::guard permit, F* fn, Item item, slot_type<R>* out) {
+	/* Parameters live as long as the coroutine frame, move the permit to a local so it is released as soon as the call completes */
+	semaphore::guard held = std::move(permit);
+	if constexpr (std::is_void_v<R>) {
+		co_await std::invoke(*fn, std::move(item));
+	} else {
+		out->emplace(co_await std::invoke(*fn, std::move(item)));
+	}
+}
+
+} // namespace when_all
+
+} // namespace detail
+
+/**
+ * @brief Await every awaitable in a range, resuming when all of them have completed.
+ *
+ * Awaitables such as @ref async and @ref task start running when they are created, so they all run concurrently;
+ * this only waits for them in order. Results are returned in the same order as the range.
+ *
+ * If any of the awaitables throws, the rest are still awaited, then the first exception is rethrown.
+ *
+ * ```cpp
+ * std::vector<dpp::async<dpp::confirmation_callback_t>> calls;
+ * for (dpp::snowflake id : ids) {
+ *     calls.push_back(bot.co_user_get(id));
+ * }
+ * std::vector<dpp::confirmation_callback_t> results = co_await dpp::when_all(std::move(calls));
+ * ```
+ *
+ * @warning - This feature is EXPERIMENTAL. The API may change at any time and there may be bugs.
+ * Please report any to <a href="https://github.com/brainboxdotcc/DPP/issues">GitHub Issues</a> or to our <a href="https://discord.gg/dpp">Discord Server</a>.
+ * @param awaitables Range of awaitables, which is moved into the returned task
+ * @return task Task resolving to a std::vector of the results, or void if the awaitables return void
+ */
+template <std::ranges::input_range Range>
+#ifndef _DOXYGEN_
+requires (awaitable_type<std::ranges::range_value_t<Range>>)
+#endif
+auto when_all(Range awaitables) -> task<detail::when_all::collected_type<detail::when_all::result_of<std::ranges::range_value_t<Range>>>> {
+	using result_t = detail::when_all::result_of<std::ranges::range_value_t<Range>>;
+	std::exception_ptr first_exception;
+	[[maybe_unused]] std::conditional_t<std::is_void_v<result_t>, detail::when_all::empty, std::vector<result_t>> results;
+
+	if constexpr (!std::is_void_v<result_t> && std::ranges::sized_range<Range>) {
+		results.reserve(std::ranges::size(awaitables));
+	}
+	for (auto&& awaitable : awaitables) {
+		try {
+			if constexpr (std::is_void_v<result_t>) {
+				co_await std::move(awaitable);
+			} else {
+				results.push_back(co_await std::move(awaitable));
+			}
+		} catch (...) {
+			if (!first_exception) {
+				first_exception = std::current_exception();
+			}
+		}
+	}
+	if (first_exception) {
+		std::rethrow_exception(first_exception);
+	}
+	if constexpr (!std::is_void_v<result_t>) {
+		co_return results;
+	}
+}
+
+/**
+ * @brief Call a function on every element of a range and await the results, with at most `window` calls in flight at once.
+ *
+ * This is meant for fanning out many `co_*` REST calls without queueing all of them on the cluster at once:
+ * a new call is only made once one of the previous calls has completed. Results are returned in the same order as the range.
+ *
+ * If any of the calls throws, the rest are still made and awaited, then the first exception is rethrown.
+ *
+ * ```cpp
+ * std::vector<dpp::confirmation_callback_t> results = co_await dpp::when_all_bounded(4, message_ids, [&bot, channel_id](dpp::snowflake id) {
+ *     return bot.co_message_get(id, channel_id);
+ * });
+ * ```
+ *
+ * @warning - This feature is EXPERIMENTAL. The API may change at any time and there may be bugs.
+ * Please report any to <a href="https://github.com/brainboxdotcc/DPP/issues">GitHub Issues</a> or to our <a href="https://discord.gg/dpp">Discord Server</a>.
+ * @param window Maximum number of calls awaited at the same time, 0 is treated as 1
+ * @param items Range of arguments, which is moved into the returned task. Each element is copied into its call.
+ * @param fn Function called with each element, returning an awaitable such as the @ref async returned by the `co_*` methods of @ref cluster
+ * @return task Task resolving to a std::vector of the results, or void if the calls return void
+ */
+template <std::ranges::input_range Range, typename F>
+#ifndef _DOXYGEN_
+requires (std::invocable<F&, std::ranges::range_value_t<Range>> && awaitable_type<std::invoke_result_t<F&, std::ranges::range_value_t<Range>>>)
+#endif
+auto when_all_bounded(size_t window, Range items, F fn) -> task<detail::when_all::collected_type<detail::when_all::call_result<Range, F>>> {
+	using result_t = detail::when_all::call_result<Range, F>;
+	using slot_t = detail::when_all::slot_type<result_t>;
+	semaphore limit{window == 0 ? 1 : window};
+	std::vector<task<void>> running;
+	/* A deque, so slots handed out to running calls keep their address as more are added */
+	std::deque<slot_t> slots;
+
+	if constexpr (std::ranges::sized_range<Range>) {
+		running.reserve(std::ranges::size(items));
+	}
+	for (auto&& item : items) {
+		semaphore::guard permit = co_await limit.lock();
+		slot_t& slot = slots.emplace_back();
+		running.push_back(detail::when_all::run_bounded<result_t>(std::move(permit), &fn, std::ranges::range_value_t<Range>{item}, &slot));
+	}
+	co_await when_all(std::move(running));
+	if constexpr (!std::is_void_v<result_t>) {
+		std::vector<result_t> results;
+		results.reserve(slots.size());
+		for (slot_t& slot : slots) {
+			results.push_back(std::move(*slot));
+		}
+		co_return results;
+	}
+}
+
+} /* namespace dpp */
+
+#endif
@@ -39,7 +39,7 @@ namespace dpp {
 struct discord_webhook_server : public http_server {
 
 	/**
-	 * @brief Verifier for signed requests
+	 * @brief Verifier for signed requests, holding the parsed public key
 	 */
 	signature_verifier verifier;
 
@@ -48,6 +48,17 @@ struct discord_webhook_server : public http_server {
 	 */
 	std::string public_key_hex;
 
+	/**
+	 * @brief How long to wait for an event handler to reply before the interaction is
+	 * automatically deferred, so Discord's three second limit is never missed.
+	 * Commands and modal submissions are deferred as a "thinking" message, components
+	 * with a deferred update, and autocompletes with no choices. A later reply from the
+	 * handler edits the deferred response, or is sent as a follow-up if editing it would
+	 * change the wrong message or lose the ephemeral flag. Timeouts are checked once a
+	 * second, so the deferral is never later than this, but may be up to a second earlier.
+	 */
+	std::chrono::milliseconds ack_timeout{2000};
+
 	/**
 	 * @brief Constructor for creation of a HTTP(S) server
 	 * @param creator Cluster creator
@@ -60,7 +71,10 @@ struct discord_webhook_server : public http_server {
 	discord_webhook_server(cluster* creator, const std::string& discord_public_key, const std::string_view address, uint16_t port,  const std::string& ssl_private_key = "", const std::string& ssl_public_key = "");
 
 	/**
-	 * @brief Handle Discord outbound webhook
+	 * @brief Handle Discord outbound webhook.
+	 * The HTTP response is deferred until an event handler replies to the interaction,
+	 * whether it does so before returning, from a coroutine, or from another thread,
+	 * so no thread pool thread waits for the reply.
 	 * @param request Request from discord
 	 */
 	void handle_request(http_server_request* request);
@@ -37,6 +37,7 @@
 #include <mutex>
 #include <shared_mutex>
 #include <dpp/zlibcontext.h>
+#include <dpp/json_writer.h>
 
 namespace dpp {
 
@@ -328,6 +329,12 @@ private:
 	 */
 	std::unique_ptr<zlibcontext> zlib{};
 
+	/**
+	 * @brief Writer for JSON heartbeats, cleared and reused for each one so that
+	 * sending a heartbeat does not allocate
+	 */
+	detail::json_writer heartbeat_writer{32};
+
 	/**
 	 * @brief Last connect time of cluster
 	 */
@@ -40,6 +40,11 @@
 #include <dpp/discordevents.h>
 #include <dpp/socket.h>
 #include <dpp/socketengine.h>
+#include <dpp/voice_decode_pool.h>
+#include <dpp/voice_broadcast.h>
+#include <dpp/ogg_opus.h>
+#include <dpp/voice_mixer.h>
+#include <dpp/coro/async.h>
 #include <queue>
 #include <thread>
 #include <deque>
@@ -50,6 +55,8 @@
 #include <functional>
 #include <chrono>
 #include <set>
+#include <array>
+#include <atomic>
 
 struct OpusDecoder;
 struct OpusEncoder;
@@ -90,6 +97,37 @@ inline constexpr size_t secret_key_size = 32;
 
 struct dave_state;
 
+namespace detail {
+	struct opus_recording_state;
+	struct parallel_encode_job;
+	struct send_mixer_state;
+}
+
+/**
+ * @brief Counters for the UDP socket of a voice client, to see how many packets each system call moves
+ */
+struct DPP_EXPORT voice_udp_stats {
+	/**
+	 * @brief Packets received
+	 */
+	uint64_t packets_received{0};
+
+	/**
+	 * @brief Receive system calls made, including the last call of each drain which finds nothing
+	 */
+	uint64_t receive_calls{0};
+
+	/**
+	 * @brief Packets sent
+	 */
+	uint64_t packets_sent{0};
+
+	/**
+	 * @brief Send system calls made
+	 */
+	uint64_t send_calls{0};
+};
+
 /*
 * @brief For holding a moving average of the number of current voice users, for applying a smooth gain ramp.
 */
@@ -126,6 +164,159 @@ struct DPP_EXPORT voice_out_packet {
 	uint64_t duration;
 };
 
+/**
+ * @brief A queue of outbound voice packets, held in a ring of reusable slots.
+ *
+ * A slot keeps the memory of the packets it has held, so once the ring has grown to fit
+ * the audio being queued, queueing a packet does not allocate, and removing packets from
+ * the front takes constant time. The ring doubles in size if a packet is queued while it is full.
+ */
+class DPP_EXPORT voice_out_queue {
+	/**
+	 * @brief Packet slots
+	 */
+	std::vector<voice_out_packet> slots;
+
+	/**
+	 * @brief Index of the slot holding the first packet
+	 */
+	size_t head{0};
+
+	/**
+	 * @brief Number of packets queued
+	 */
+	size_t count{0};
+
+public:
+	/**
+	 * @brief Construct a new voice out queue
+	 * @param initial_capacity Number of slots to allocate up front
+	 */
+	explicit voice_out_queue(size_t initial_capacity = 256);
+
+	/**
+	 * @brief Get the number of packets queued
+	 * @return size_t number of packets
+	 */
+	inline size_t size() const {
+		return count;
+	}
+
+	/**
+	 * @brief Check if there are no packets queued
+	 * @return true if empty
+	 */
+	inline bool empty() const {
+		return count == 0;
+	}
+
+	/**
+	 * @brief Get the number of packets which can be queued before the ring must grow
+	 * @return size_t number of slots
+	 */
+	inline size_t capacity() const {
+		return slots.size();
+	}
+
+	/**
+	 * @brief Get a queued packet
+	 * @param index position in the queue, 0 being the front, which must be less than size()
+	 * @return voice_out_packet& packet
+	 */
+	inline voice_out_packet& operator[](size_t index) {
+		return slots[(head + index) % slots.size()];
+	}
+
+	/**
+	 * @brief Get a queued packet
+	 * @param index position in the queue, 0 being the front, which must be less than size()
+	 * @return const voice_out_packet& packet
+	 */
+	inline const voice_out_packet& operator[](size_t index) const {
+		return slots[(head + index) % slots.size()];
+	}
+
+	/**
+	 * @brief Get the packet at the front of the queue, which must not be empty
+	 * @return voice_out_packet& packet
+	 */
+	inline voice_out_packet& front() {
+		return slots[head];
+	}
+
+	/**
+	 * @brief Add a packet to the back of the queue, and return its slot to be filled in.
+	 * The slot's packet string still holds the content of an earlier packet, and its memory,
+	 * so it should be assigned or resized rather than appended to.
+	 * @return voice_out_packet& slot for the new packet
+	 */
+	voice_out_packet& emplace_back();
+
+	/**
+	 * @brief Remove packets from the front of the queue
+	 * @param n number of packets to remove, which must not be more than size()
+	 */
+	void pop_front(size_t n = 1);
+
+	/**
+	 * @brief Remove all packets, keeping the slots and their memory
+	 */
+	void clear();
+};
+
+/**
+ * @brief The RTP sequence number, RTP timestamp and transport nonce of the packets a voice client sends.
+ *
+ * Each packet is built and queued by a function called with the lock held, and takes the next
+ * sequence number and nonce, so packets sent from several threads at once never share either,
+ * and are queued in the order of their sequence numbers.
+ */
+class voice_packet_sequencer {
+	/**
+	 * @brief Serialises the building of packets
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief Sequence number of the last packet
+	 */
+	uint16_t sequence{0};
+
+	/**
+	 * @brief RTP timestamp of the next packet, in samples
+	 */
+	uint32_t timestamp{0};
+
+	/**
+	 * @brief Transport nonce of the next packet. Discord expects this to start at 1.
+	 */
+	uint32_t nonce{1};
+
+public:
+	/**
+	 * @brief Build the next packet
+	 *
+	 * @param samples Samples per channel in the packet, which the timestamp of the packet after it is advanced by
+	 * @param build Called with the lock held, with the sequence number, RTP timestamp and nonce of the packet
+	 */
+	template <typename F>
+	void next(uint32_t samples, F&& build) {
+		std::lock_guard<std::mutex> lock(mutex);
+		++sequence;
+		build(sequence, timestamp, nonce);
+		timestamp += samples;
+		++nonce;
+	}
+
+	/**
+	 * @brief Start the nonces again from 1, for a new secret key
+	 */
+	void reset_nonce() {
+		std::lock_guard<std::mutex> lock(mutex);
+		nonce = 1;
+	}
+};
+
 /**
  * @brief Supported DAVE (Discord Audio Visual Encryption) protocol versions
  */
@@ -240,6 +431,22 @@ using full_reconnection_callback_t = std::function<void()>;
  */
 class DPP_EXPORT discord_voice_client : public websocket_client
 {
+	friend struct voice_decode_pool;
+	friend class voice_broadcast;
+
+public:
+	/**
+	 * @brief Most packets received or sent with one system call
+	 */
+	static constexpr size_t udp_batch_size = 16;
+
+	/**
+	 * @brief Space for each packet in receive_slab. Voice packets fit within one Ethernet MTU,
+	 * anything longer than this is truncated by the kernel and dropped.
+	 */
+	static constexpr size_t udp_slot_size = 2048;
+
+private:
 	/**
 	 * @brief Clean up resources
 	 */
@@ -310,7 +517,143 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 	/**
 	 * @brief Output buffer
 	 */
-	std::vector<voice_out_packet> outbuf;
+	voice_out_queue outbuf;
+
+	/**
+	 * @brief Number of packets outbuf may hold before send_queue_full() returns true, 0 for no limit
+	 */
+	size_t send_queue_limit{0};
+
+	/**
+	 * @brief Callbacks waiting for outbuf to have room, see on_send_queue_space()
+	 */
+	std::vector<std::function<void(size_t)>> send_queue_space_waiters;
+
+	/**
+	 * @brief Call the callbacks waiting for outbuf to have room, if it now has.
+	 * stream_mutex must be held.
+	 */
+	void notify_send_queue_space();
+
+	/**
+	 * @brief An Ogg Opus file being played by play_ogg_opus()
+	 */
+	struct ogg_playback_t {
+		/**
+		 * @brief File being played, or empty if nothing is
+		 */
+		std::shared_ptr<const ogg_opus_file> file;
+
+		/**
+		 * @brief Index of the next packet to queue
+		 */
+		size_t next_packet{0};
+
+		/**
+		 * @brief True to start again from the beginning at the end of the file
+		 */
+		bool loop{false};
+	} ogg_playback;
+
+	/**
+	 * @brief Protects ogg_playback. Taken before stream_mutex when both are held.
+	 */
+	std::mutex ogg_playback_mutex;
+
+	/**
+	 * @brief Queue packets from the file being played until ogg_playback_queue_high packets are queued.
+	 * Does nothing unless fewer than ogg_playback_queue_low are queued, so it can be called every packet cheaply.
+	 */
+	void refill_ogg_playback();
+
+	/**
+	 * @brief Number of queued packets below which refill_ogg_playback() queues more
+	 */
+	static constexpr size_t ogg_playback_queue_low = 25;
+
+	/**
+	 * @brief Number of queued packets refill_ogg_playback() fills the queue to
+	 */
+	static constexpr size_t ogg_playback_queue_high = 50;
+
+	/**
+	 * @brief Broadcasts this connection is subscribed to, which it leaves on cleanup. Protected by stream_mutex.
+	 */
+	std::vector<std::weak_ptr<detail::voice_broadcast_state>> broadcasts;
+
+	/**
+	 * @brief Encodes started by send_audio_raw_parallel() which may still be running. Protected by stream_mutex.
+	 */
+	std::vector<std::weak_ptr<detail::parallel_encode_job>> encode_jobs;
+
+	/**
+	 * @brief Send mixer, or empty if add_mixer_source() was never called. Once created it is kept
+	 * until the client is destroyed. Protected by send_mixer_mutex, and its contents by its own mutex,
+	 * which is taken before stream_mutex when both are held.
+	 */
+	std::shared_ptr<detail::send_mixer_state> send_mixer;
+
+	/**
+	 * @brief Protects send_mixer
+	 */
+	std::mutex send_mixer_mutex;
+
+	/**
+	 * @brief Get the send mixer
+	 * @return std::shared_ptr<detail::send_mixer_state> send mixer, or empty if add_mixer_source() was never called
+	 */
+	std::shared_ptr<detail::send_mixer_state> get_send_mixer();
+
+	/**
+	 * @brief If fewer than send_mixer_queue_low packets are queued, schedule mix_send_frames() on the
+	 * thread pool, so frames are not encoded on the socket engine's thread
+	 */
+	void refill_send_mixer();
+
+	/**
+	 * @brief Mix, encode and queue frames from the mixer's sources until send_mixer_queue_high packets are queued,
+	 * or the sources run out of audio. Called on the thread pool, with the mixer's mutex held.
+	 * @param state Send mixer
+	 */
+	void mix_send_frames(detail::send_mixer_state& state);
+
+	/**
+	 * @brief Stop any mixing already scheduled on the thread pool from using this client, waiting for any
+	 * which is running now. Called when the client is destroyed.
+	 */
+	void detach_send_mixer();
+
+	/**
+	 * @brief Discard the audio waiting in every mixer source, keeping the sources
+	 */
+	void clear_send_mixer_audio();
+
+	/**
+	 * @brief Number of queued packets below which refill_send_mixer() mixes more.
+	 * This is kept low so audio sent to a source is heard soon after, even while other sources are playing.
+	 */
+	static constexpr size_t send_mixer_queue_low = 5;
+
+	/**
+	 * @brief Number of queued packets refill_send_mixer() fills the queue to
+	 */
+	static constexpr size_t send_mixer_queue_high = 10;
+
+	/**
+	 * @brief Stop all encodes started by send_audio_raw_parallel() from queueing any more audio,
+	 * waiting for any which is queueing audio right now
+	 */
+	void cancel_parallel_encodes();
+
+	/**
+	 * @brief Reused buffer for the DAVE encrypted form of the opus packet being sent. Only used with send_sequence locked.
+	 */
+	std::vector<uint8_t> dave_send_buffer;
+
+	/**
+	 * @brief Reused buffer for packets sent immediately, without being queued. Only used with send_sequence locked.
+	 */
+	std::vector<uint8_t> immediate_send_buffer;
 
 	/**
 	 * @brief Data type of RTP packet sequence number field.
@@ -422,13 +765,42 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 		 * @note Pending payloads are delivered first before termination.
 		 */
 		bool terminating = false;
+
+		/**
+		 * @brief True while the connection is waiting for, or being flushed by, the decode pool.
+		 */
+		bool scheduled = false;
+
+		/**
+		 * @brief Check if any speaker has payloads waiting to be delivered. mtx must be held.
+		 * @return true if there are payloads to deliver
+		 */
+		bool has_parked_payloads() const;
 	} voice_courier_shared_state;
 
+	/**
+	 * @brief Shared decode pool from the cluster, if enabled when this connection was made.
+	 * If this is set, the pool flushes parked payloads and no courier thread is started.
+	 */
+	std::shared_ptr<voice_decode_pool> decode_pool;
+
 	/**
 	 * @brief The run loop of the voice courier thread.
 	 */
 	static void voice_courier_loop(discord_voice_client&, courier_shared_state_t&);
 
+	/**
+	 * @brief Take all parked payloads, then decrypt, decode and mix them and deliver them to handlers.
+	 * Used by both the courier thread and the decode pool.
+	 */
+	static void deliver_parked_payloads(discord_voice_client&, courier_shared_state_t&);
+
+	/**
+	 * @brief Called by the decode pool when this connection is due to be flushed.
+	 * @return true if more payloads arrived meanwhile, so the connection must be scheduled again
+	 */
+	bool flush_on_decode_pool();
+
 	/**
 	 * @brief If true, audio packet sending is paused
 	 */
@@ -517,12 +889,6 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 	 */
 	bool has_secret_key{false};
 
-	/**
-	 * @brief Sequence number of outbound audio. This is incremented
-	 * once per frame sent.
-	 */
-	uint16_t sequence{};
-
 	/**
 	 * @brief Last received sequence from gateway.
 	 *
@@ -531,22 +897,11 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 	int32_t receive_sequence{};
 
 	/**
-	 * @brief Timestamp value used in outbound audio. Each packet
-	 * has the timestamp value which is incremented to match
-	 * how many frames are sent.
+	 * @brief Sequence number, timestamp and nonce of outbound audio. Each packet sent takes
+	 * the next of each, and its lock is held while the packet is built and queued, so it also
+	 * guards dave_send_buffer and immediate_send_buffer. Taken before stream_mutex.
 	 */
-	uint32_t timestamp{};
-
-	/**
-	 * @brief Each packet should have a nonce, a 32-bit incremental
-	 * integer value appended to payload.
-	 *
-	 * We should keep track of this value and increment it for each
-	 * packet sent.
-	 *
-	 * Current initial value is hardcoded to 1.
-	 */
-	uint32_t packet_nonce{};
+	voice_packet_sequencer send_sequence;
 
 	/**
 	 * @brief Last sent packet high-resolution timestamp
@@ -616,6 +971,15 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 	 */
 	int udp_send(const char* data, size_t length);
 
+	/**
+	 * @brief Send several packets to the UDP socket immediately, with one system call where supported.
+	 *
+	 * @param packets queue holding the packets to send
+	 * @param count number of packets to send from the front of the queue
+	 * @return size_t number of packets sent, counted from the front of the queue
+	 */
+	size_t udp_send_batch(const voice_out_queue& packets, size_t count);
+
 	/**
 	 * @brief Receive data from UDP socket immediately.
 	 * 
@@ -626,6 +990,89 @@ class DPP_EXPORT discord_voice_client : public websocket_client
 	 */
 	int udp_recv(char* data, size_t max_length);
 
+	/**
+	 * @brief Receive as many packets as are waiting, up to udp_batch_size, into receive_slab.
+	 * Uses recvmmsg() where supported.
+	 *
+	 * @param sizes Set to the length of each packet received, packet n starts at receive_slab.data() + n * udp_slot_size
+	 * @return size_t number of packets received. Fewer than udp_batch_size means the socket has been drained.
+	 */
+	size_t udp_recv_batch(std::array<size_t, udp_batch_size>& sizes);
+
+	/**
+	 * @brief Process one RTP packet received on the UDP socket, queueing it for the voice courier
+	 *
+	 * @param buffer packet
+	 * @param packet_size length of packet
+	 */
+	void handle_udp_packet(const uint8_t* buffer, size_t packet_size);
+
+	/**
+	 * @brief Remove the transport encryption from a received RTP packet, and the DAVE encryption if in use
+	 *
+	 * @param buffer RTP packet
+	 * @param packet_size length of packet
+	 * @param user_id speaker, whose DAVE decryptor is used
+	 * @param decrypted buffer of at least packet_size bytes, which the transport decrypted payload is written to
+	 * @param dave_frame buffer the DAVE decrypted frame is written to, if DAVE is in use
+	 * @param opus_packet set to the start of the opus packet, within decrypted or dave_frame
+	 * @param opus_packet_len set to the length of the opus packet
+	 * @return true on success, false if the packet could not be decrypted
+	 */
+	bool decrypt_rtp_payload(const uint8_t* buffer, size_t packet_size, snowflake user_id, uint8_t* decrypted, std::vector<uint8_t>& dave_frame, uint8_t*& opus_packet, size_t& opus_packet_len);
+
+	/**
+	 * @brief Recording started by start_opus_recording(), or empty if not recording. Protected by opus_recording_mutex.
+	 */
+	std::shared_ptr<detail::opus_recording_state> opus_recording;
+
+	/**
+	 * @brief Protects opus_recording
+	 */
+	std::mutex opus_recording_mutex;
+
+	/**
+	 * @brief True while opus_recording is set, so received packets can skip the lock when not recording
+	 */
+	std::atomic<bool> opus_recording_active{false};
+
+	/**
+	 * @brief Decrypt a received RTP packet and write its opus packet to the speaker's recording
+	 *
+	 * @param buffer RTP packet
+	 * @param packet_size length of packet
+	 * @param user_id speaker
+	 * @param seq RTP sequence number
+	 * @param timestamp RTP timestamp
+	 */
+	void record_opus_packet(const uint8_t* buffer, size_t packet_size, snowflake user_id, rtp_seq_t seq, rtp_timestamp_t timestamp);
+
+	/**
+	 * @brief Buffer received packets are read into, udp_batch_size slots of udp_slot_size bytes.
+	 * Allocated on first use.
+	 */
+	std::vector<uint8_t> receive_slab;
+
+	/**
+	 * @brief Packets received
+	 */
+	std::atomic<uint64_t> udp_packets_received{0};
+
+	/**
+	 * @brief Receive system calls made
+	 */
+	std::atomic<uint64_t> udp_receive_calls{0};
+
+	/**
+	 * @brief Packets sent
+	 */
+	std::atomic<uint64_t> udp_packets_sent{0};
+
+	/**
+	 * @brief Send system calls made
+	 */
+	std::atomic<uint64_t> udp_send_calls{0};
+
 	/**
 	 * @brief Called by socketengine when the socket is ready
 	 * for writing, at this point we pick the head item off
@@ -953,6 +1400,28 @@ public:
 	 */
 	discord_voice_client& send_audio_raw(uint16_t* audio_data, const size_t length);
 
+	/**
+	 * @brief Send a whole track of raw audio, encoding it on the cluster's thread pool instead of the calling thread.
+	 *
+	 * The audio is split into chunks of a few seconds, each encoded by its own opus encoder in parallel. A few chunks
+	 * are encoded at once, below the priority of event handlers, so a long track does not hold up other work. Each
+	 * encoder first encodes a little of the audio before its chunk and discards it, so it starts its chunk with
+	 * the state and lookahead a single encoder would have had, and chunks join without clicks or gaps.
+	 * Packets are queued in order as soon as each chunk and all the chunks before it are encoded, so playback
+	 * starts before the whole track is encoded. stop_audio() cancels what is left to queue.
+	 *
+	 * @warning **The audio data needs to be 48000Hz signed 16 bit stereo audio, otherwise, the audio will come through incorrectly!**
+	 *
+	 * @param audio_data Raw PCM audio data, with the two channels interleaved. This is moved into the encode rather than copied.
+	 * Silence is appended to complete the last frame.
+	 * @param on_queued Called on the thread pool with the number of packets queued, once all of the audio is queued.
+	 * Not called if the encode is cancelled.
+	 * @return discord_voice_client& Reference to self
+	 *
+	 * @throw dpp::voice_exception If data length is invalid or voice support not compiled into D++
+	 */
+	discord_voice_client& send_audio_raw_parallel(std::vector<uint16_t> audio_data, std::function<void(size_t)> on_queued = {});
+
 	/**
 	 * @brief Send opus packets to the voice channel
 	 * 
@@ -1127,6 +1596,194 @@ public:
 	 */
 	uint32_t get_tracks_remaining();
 
+	/**
+	 * @brief Get counters for the UDP socket, e.g. to see how many packets each system call receives
+	 *
+	 * @return voice_udp_stats counters since the voice client was created
+	 */
+	voice_udp_stats get_udp_stats() const;
+
+	/**
+	 * @brief Limit how much audio should be queued for sending, so that a producer such as
+	 * a file or stream decoder can pace itself rather than queueing a whole track in memory.
+	 *
+	 * The limit is advisory: audio sent while the queue is full is still queued. Producers
+	 * should check send_queue_full(), and wait with on_send_queue_space() or co_wait_for_send_queue_space().
+	 *
+	 * @param max_packets Number of packets, 0 for no limit (the default). At 20ms per packet, 250 packets are five seconds of audio.
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_send_queue_limit(size_t max_packets);
+
+	/**
+	 * @brief Play an Ogg Opus file. Packets are sent straight from the file's memory mapping without
+	 * being decoded, and are queued a second or so at a time as the audio plays, however long the file is.
+	 * Playing a file replaces any file already playing; use stop_audio() to stop.
+	 *
+	 * @note Other audio sent while a file is playing is queued between its packets.
+	 * @param file File to play. The file may be shared by any number of voice connections at once.
+	 * @param start_ms Position to start from, in milliseconds
+	 * @param loop True to play the file again from the beginning each time it ends
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& play_ogg_opus(std::shared_ptr<const ogg_opus_file> file, uint64_t start_ms = 0, bool loop = false);
+
+	/**
+	 * @brief Move to a new position in the Ogg Opus file being played.
+	 * Audio already queued is discarded, so the new position is heard at once.
+	 *
+	 * @param position_ms Position in milliseconds
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& seek_ogg_opus(uint64_t position_ms);
+
+	/**
+	 * @brief Get the position in the Ogg Opus file being played, of the audio being queued.
+	 * @return uint64_t position in milliseconds, which runs up to a second ahead of what is heard. 0 if no file is playing.
+	 */
+	uint64_t get_ogg_opus_position();
+
+	/**
+	 * @brief Add a source of raw audio to the send mixer.
+	 *
+	 * Audio sent to the mixer's sources with send_mixer_audio() is mixed in 20ms frames using the SIMD
+	 * audio_mixer and encoded once, so several sounds can be played over each other, e.g. music, speech
+	 * and sound effects. Each source has its own gain, and a source marked as ducking others lowers the
+	 * gain of the rest while it has audio. Gain changes are faded over one frame, so they do not click.
+	 * Sources can be added, changed and removed while audio is playing.
+	 *
+	 * Mixed audio is queued a few frames ahead of what is heard, after any audio already queued.
+	 * Sources are mixed a whole frame at a time, and sit out any frame they do not have all the audio for,
+	 * until more is sent to them or they are flushed with flush_mixer_source(). Nothing is queued while
+	 * none of the sources have audio. Mixing and encoding run on the cluster's thread pool.
+	 *
+	 * @param options Gain and ducking of the source
+	 * @return uint32_t ID of the source
+	 * @throw dpp::voice_exception If the encoder could not be created or voice support not compiled into D++
+	 */
+	uint32_t add_mixer_source(const voice_mixer_source_options& options = {});
+
+	/**
+	 * @brief Remove a source from the send mixer. Audio of the source which is playing fades out over
+	 * the next frame, and the rest of its audio is discarded.
+	 *
+	 * @param source_id ID returned by add_mixer_source()
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& remove_mixer_source(uint32_t source_id);
+
+	/**
+	 * @brief Change the gain and ducking of a source of the send mixer
+	 *
+	 * @param source_id ID returned by add_mixer_source()
+	 * @param options New options of the source
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& set_mixer_source_options(uint32_t source_id, const voice_mixer_source_options& options);
+
+	/**
+	 * @brief Send raw audio to a source of the send mixer, to be played after the audio already sent to it.
+	 *
+	 * @warning **The audio data needs to be 48000Hz signed 16 bit stereo audio, otherwise, the audio will come through incorrectly!**
+	 *
+	 * @param source_id ID returned by add_mixer_source(). Audio for a source which has been removed is ignored.
+	 * @param audio_data Raw PCM audio data, with the two channels interleaved
+	 * @param length The length of the audio data in bytes, which must be a multiple of 4. It need not be
+	 * a whole number of frames; less than a frame waits for more, or for flush_mixer_source().
+	 * @return discord_voice_client& Reference to self
+	 * @throw dpp::voice_exception If data length is invalid or voice support not compiled into D++
+	 */
+	discord_voice_client& send_mixer_audio(uint32_t source_id, const uint16_t* audio_data, size_t length);
+
+	/**
+	 * @brief Get how much audio a source of the send mixer has waiting to be mixed
+	 *
+	 * @param source_id ID returned by add_mixer_source()
+	 * @return uint64_t milliseconds of audio, 0 if the source does not exist
+	 */
+	uint64_t get_mixer_source_buffered_ms(uint32_t source_id);
+
+	/**
+	 * @brief Mix the last of the audio sent to a source of the send mixer. Sources are only mixed a whole
+	 * frame (20ms) at a time, so audio sent a little at a time is not padded with silence, and less than
+	 * a frame waits for more audio to be sent; call this at the end of the audio to play what is left.
+	 *
+	 * @param source_id ID returned by add_mixer_source()
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& flush_mixer_source(uint32_t source_id);
+
+	/**
+	 * @brief Record the audio received from each user into an Ogg Opus file per user, without decoding it.
+	 * Received packets are only decrypted and written out, so recording costs a small fraction of the CPU
+	 * time of decoding, and on_voice_receive handlers are not needed.
+	 *
+	 * Packets are put back in order by their RTP sequence number after a short wait for late ones, and
+	 * lost packets and pauses in speech are filled with empty frames according to their RTP timestamps,
+	 * so each file keeps the timing of what was said. A user's file starts when they first speak.
+	 * Files are written a few seconds at a time on the cluster's thread pool.
+	 *
+	 * @param path_for_user Called with a user's ID when they first speak, to choose the path of their file.
+	 * An existing file is replaced.
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& start_opus_recording(std::function<std::string(snowflake)> path_for_user);
+
+	/**
+	 * @brief Record the audio received from each user into an Ogg Opus file per user, without decoding it.
+	 * See the other overload for details.
+	 *
+	 * @param directory Directory to write the files to, which are named after user IDs, e.g. 189759562910400512.opus
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& start_opus_recording(const std::string& directory);
+
+	/**
+	 * @brief Stop recording started by start_opus_recording(), completing the files.
+	 * The last of each file is written shortly afterwards on the cluster's thread pool.
+	 * This is called when the voice connection ends.
+	 *
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& stop_opus_recording();
+
+	/**
+	 * @brief Check if audio is being recorded by start_opus_recording()
+	 * @return true if recording
+	 */
+	bool is_recording_opus() const;
+
+	/**
+	 * @brief Get the limit set by set_send_queue_limit()
+	 * @return size_t number of packets, 0 for no limit
+	 */
+	size_t get_send_queue_limit();
+
+	/**
+	 * @brief Check if the queue of audio to send has reached the limit set by set_send_queue_limit()
+	 * @return true if full, always false if no limit is set
+	 */
+	bool send_queue_full();
+
+	/**
+	 * @brief Call a function once the queue of audio to send is below the limit set by set_send_queue_limit().
+	 * The function is called on the cluster's thread pool, immediately if the queue already has room.
+	 *
+	 * @note If the voice connection is closed first, the function is never called.
+	 * @param callback Function to call, which is passed the number of packets queued when there was room
+	 * @return discord_voice_client& Reference to self
+	 */
+	discord_voice_client& on_send_queue_space(std::function<void(size_t)> callback);
+
+#ifndef DPP_NO_CORO
+	/**
+	 * @brief Wait until the queue of audio to send is below the limit set by set_send_queue_limit().
+	 * @see on_send_queue_space
+	 * @return dpp::async<size_t> awaitable which completes when there is room, with the number of packets queued at that time
+	 */
+	dpp::async<size_t> co_wait_for_send_queue_space();
+#endif
+
 	/**
 	 * @brief Get the time remaining to send the
 	 * audio output buffer in hours:minutes:seconds
@@ -1269,5 +1926,35 @@ public:
 	void on_disconnect() override;
 };
 
+namespace detail {
+
+/**
+ * @brief Send packets from the front of a queue to a UDP socket, with one sendmmsg() call where supported.
+ * Sending stops at the first packet which fails, e.g. because the socket's buffer is full.
+ *
+ * @param fd socket to send on
+ * @param destination address to send each packet to
+ * @param packets queue holding the packets to send
+ * @param count number of packets to send from the front of the queue, at most discord_voice_client::udp_batch_size are sent
+ * @param calls incremented by the number of system calls made
+ * @return size_t number of packets sent, counted from the front of the queue
+ */
+DPP_EXPORT size_t udp_send_batch(dpp::socket fd, address_t& destination, const voice_out_queue& packets, size_t count, uint64_t& calls);
+
+/**
+ * @brief Receive as many packets as are waiting on a UDP socket, up to discord_voice_client::udp_batch_size,
+ * with one recvmmsg() call where supported.
+ *
+ * @param fd non-blocking socket to receive from
+ * @param slab buffer of discord_voice_client::udp_batch_size slots, each discord_voice_client::udp_slot_size bytes
+ * @param sizes Set to the length of each packet received, packet n starts at slab + n * udp_slot_size.
+ * A packet too long for its slot is truncated, and its length is set to 0.
+ * @param calls incremented by the number of system calls made
+ * @return size_t number of packets received. Fewer than udp_batch_size means the socket has been drained.
+ */
+DPP_EXPORT size_t udp_recv_batch(dpp::socket fd, uint8_t* slab, std::array<size_t, discord_voice_client::udp_batch_size>& sizes, uint64_t& calls);
+
+}
+
 }
 
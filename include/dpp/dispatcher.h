@@ -43,6 +43,7 @@
 #include <exception>
 #include <algorithm>
 #include <string>
+#include <memory>
 
 #ifndef DPP_NO_CORO
 #include <dpp/coro.h>
@@ -55,6 +56,37 @@ struct confirmation_callback_t;
 class discord_client;
 class discord_voice_client;
 
+namespace detail {
+
+/**
+ * @brief Receives the response to an interaction which arrived through a webhook server,
+ * to be sent as the body of the HTTP response. Shared by all copies of the event, so a
+ * handler may reply from any thread, including after a coroutine has resumed.
+ */
+struct DPP_EXPORT interaction_webhook_response {
+	/**
+	 * @brief Destroy the interaction webhook response
+	 */
+	virtual ~interaction_webhook_response() = default;
+
+	/**
+	 * @brief Send the response to the interaction as the HTTP response
+	 * @param json JSON interaction response
+	 * @return true if sent, false if the HTTP response has already been sent, e.g.
+	 * because the interaction was automatically deferred when no reply came in time
+	 */
+	virtual bool respond(const std::string& json) = 0;
+
+	/**
+	 * @brief Get how the interaction was automatically acknowledged
+	 * @return uint8_t interaction_response_type of the automatic acknowledgement, or 0 if
+	 * the interaction has not been automatically acknowledged
+	 */
+	virtual uint8_t get_automatic_ack() const = 0;
+};
+
+}
+
 /**
  * @brief A function used as a callback for any REST based command
  */
@@ -68,10 +100,14 @@ using command_completion_event_t = std::function<void(const confirmation_callbac
  * @param d JSON data for the event
  * @param raw Raw JSON string
  * @param from_webhook True if the interaction comes from a webhook
- * @return JSON interaction response, only valid when from_webhook is true
+ * @param webhook_response If from_webhook is true and this is set, handlers reply through
+ * it whenever they are ready rather than before this function returns
+ * @return JSON interaction response, only valid when from_webhook is true. If
+ * webhook_response is set, this is empty when a handler was called, as the response
+ * will arrive through webhook_response instead.
  */
 namespace events {
-	std::string DPP_EXPORT internal_handle_interaction(cluster* creator, uint16_t shard_id, json &d, const std::string &raw, bool from_webhook);
+	std::string DPP_EXPORT internal_handle_interaction(cluster* creator, uint16_t shard_id, json &d, const std::string &raw, bool from_webhook, std::shared_ptr<detail::interaction_webhook_response> webhook_response = {});
 }
 
 /** @brief Base event parameter struct.
@@ -517,12 +553,26 @@ struct DPP_EXPORT interaction_create_t : public event_dispatch_t {
 	 */
 	bool from_webhook{false};
 
+	/**
+	 * @brief For an interaction from a webhook server, where the response is sent.
+	 * If a handler replies after the webhook server has automatically deferred the
+	 * interaction, the reply is made by editing the original response instead.
+	 */
+	std::shared_ptr<detail::interaction_webhook_response> webhook_response;
+
+	/**
+	 * @brief Send a response to an interaction from a webhook
+	 * @param r response
+	 * @param callback User function to execute once the response is sent
+	 */
+	void reply_to_webhook(const interaction_response& r, command_completion_event_t callback) const;
+
 	/**
 	 * @brief If this interaction is created from a webhook server,
 	 * it fills this value with a JSON string which is sent as the HTTP response.
 	 * This is thread local so that it is preserved when the event is copied, we
 	 * guarantee that the request/response is in the same thread so this will always
-	 * be valid.
+	 * be valid. If webhook_response is set, the response is sent to it instead.
 	 * @param response response to set
 	 */
 	void set_queued_response(const std::string& response) const;
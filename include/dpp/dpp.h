@@ -68,6 +68,7 @@
 #include <dpp/cluster.h>
 #include <dpp/cache.h>
 #include <dpp/httpsclient.h>
+#include <dpp/upload_source.h>
 #include <dpp/queues.h>
 #include <dpp/commandhandler.h>
 #include <dpp/once.h>
@@ -75,9 +76,14 @@
 #include <dpp/discordevents.h>
 #include <dpp/timed_listener.h>
 #include <dpp/collector.h>
+#include <dpp/component_router.h>
 #include <dpp/bignum.h>
 #include <dpp/thread_pool.h>
 #include <dpp/signature_verifier.h>
 #include <dpp/socket_listener.h>
+#include <dpp/async_socket.h>
+#include <dpp/voice_broadcast.h>
+#include <dpp/ogg_opus.h>
+#include <dpp/voice_mixer.h>
 #include <dpp/http_server.h>
 #include <dpp/discord_webhook_server.h>
@@ -24,6 +24,9 @@
 #include <dpp/export.h>
 #include <string>
 #include <map>
+#include <vector>
+#include <memory>
+#include <unordered_map>
 #include <variant>
 #include <dpp/snowflake.h>
 #include <dpp/misc-enum.h>
@@ -33,6 +36,7 @@
 #include <shared_mutex>
 #include <cstring>
 #include <atomic>
+#include <condition_variable>
 #include <dpp/exception.h>
 #include <dpp/coro/job.h>
 #include <dpp/coro/task.h>
@@ -90,6 +94,12 @@ class awaitable {
 	/** @brief The state of the awaiting coroutine */
 	std::atomic<awaiter_state> state = awaiter_state::none;
 
+	/** @brief Key of the events to wait for, if keyed */
+	std::string key;
+
+	/** @brief True if only events with a matching key can resume this object */
+	bool keyed = false;
+
 	/** Default constructor is accessible only to event_router_t */
 	awaitable() = default;
 
@@ -97,12 +107,16 @@ class awaitable {
 	template <typename F>
 	awaitable(event_router_t<T> *router, F&& fun) : self{router}, predicate{std::forward<F>(fun)} {}
 
+	/** Keyed constructor is accessible only to event_router_t */
+	template <typename F>
+	awaitable(event_router_t<T> *router, std::string event_key, F&& fun) : self{router}, predicate{std::forward<F>(fun)}, key{std::move(event_key)}, keyed{true} {}
+
 public:
 	/** This object is not copyable. */
 	awaitable(const awaitable &) = delete;
 
 	/** Move constructor. */
-	awaitable(awaitable &&rhs) noexcept : self{rhs.self}, predicate{std::move(rhs.predicate)}, event{rhs.event}, handle{std::exchange(rhs.handle, nullptr)}, state{rhs.state.load(std::memory_order_relaxed)} {}
+	awaitable(awaitable &&rhs) noexcept : self{rhs.self}, predicate{std::move(rhs.predicate)}, event{rhs.event}, handle{std::exchange(rhs.handle, nullptr)}, state{rhs.state.load(std::memory_order_relaxed)}, key{std::move(rhs.key)}, keyed{rhs.keyed} {}
 
 	/** This object is not copyable. */
 	awaitable& operator=(const awaitable &) = delete;
@@ -114,6 +128,8 @@ public:
 		event = rhs.event;
 		handle = std::exchange(rhs.handle, nullptr);
 		state = rhs.state.load(std::memory_order_relaxed);
+		key = std::move(rhs.key);
+		keyed = rhs.keyed;
 		return *this;
 	}
 
@@ -235,17 +251,107 @@ private:
 	event_handle next_handle = 1;
 
 	/**
-	 * @brief Thread safety mutex
+	 * @brief An attached handler, with the count of calls to it which are running,
+	 * so that detach_and_wait() can wait for them to return
+	 */
+	struct listener_state {
+		/**
+		 * @brief Construct the handler
+		 * @param args arguments to construct the event_handler_t with
+		 */
+		template <typename... Args>
+		explicit listener_state(Args&&... args) : handler(std::forward<Args>(args)...) {
+		}
+
+		/**
+		 * @brief The handler
+		 */
+		event_handler_t handler;
+
+		/**
+		 * @brief Number of calls to the handler which are running, on any thread
+		 */
+		mutable std::atomic<size_t> in_flight{0};
+
+		/**
+		 * @brief Set when the listener is detached, so that no new call starts
+		 */
+		std::atomic<bool> detached{false};
+
+		/**
+		 * @brief Mutex for waking a detach_and_wait() when a call returns
+		 */
+		mutable std::mutex wait_mutex;
+
+		/**
+		 * @brief Notified when a call to a detached listener returns
+		 */
+		mutable std::condition_variable returned;
+	};
+
+	/**
+	 * @brief A listener, made up of its handle and its handler. The handler is shared
+	 * between snapshots, so building a new snapshot never copies a handler.
 	 */
-	mutable std::shared_mutex mutex;
+	using listener_t = std::pair<event_handle, std::shared_ptr<listener_state>>;
 
 	/**
-	 * @brief Container of event listeners keyed by handle,
-	 * as handles are handed out sequentially they will always
-	 * be called in they order they are bound to the event
-	 * as std::map is an ordered container.
+	 * @brief Attached listeners. As handles are handed out sequentially and new
+	 * listeners are appended, listeners are called in the order they were bound to the event.
 	 */
-	std::map<event_handle, event_handler_t> dispatch_container;
+	using listener_list_t = std::vector<listener_t>;
+
+	/**
+	 * @brief An immutable snapshot of the attached listeners, with the number of
+	 * events being dispatched from it
+	 */
+	struct snapshot_t {
+		/**
+		 * @brief Construct a snapshot
+		 * @param listeners listeners of the snapshot
+		 */
+		explicit snapshot_t(listener_list_t&& listeners) : list(std::move(listeners)) {
+		}
+
+		/**
+		 * @brief The listeners
+		 */
+		listener_list_t list;
+
+		/**
+		 * @brief Number of events being dispatched from this snapshot
+		 */
+		mutable std::atomic<size_t> pins{0};
+	};
+
+	/**
+	 * @brief Mutex serialising attach() and detach(). Dispatching an event never takes it.
+	 */
+	mutable std::mutex mutex;
+
+	/**
+	 * @brief Current snapshot of listeners, or nullptr if there are none.
+	 * attach() and detach() build a new snapshot and swap it in, so events are dispatched
+	 * without locking, and handlers may attach or detach listeners while they run.
+	 */
+	std::atomic<const snapshot_t*> listeners{nullptr};
+
+	/**
+	 * @brief Number of events between loading the current snapshot and pinning it.
+	 * While this is zero, a snapshot which has been replaced cannot gain new pins.
+	 */
+	mutable std::atomic<size_t> loading{0};
+
+	/**
+	 * @brief Snapshots which have been replaced but may still be in use by an event being
+	 * dispatched. Each is freed once nothing has it pinned. Guarded by mutex.
+	 */
+	mutable std::vector<const snapshot_t*> retired;
+
+	/**
+	 * @brief True if there are retired snapshots waiting to be freed
+	 */
+	mutable std::atomic<bool> has_retired{false};
 
 #ifndef DPP_NO_CORO
 	/**
@@ -257,6 +363,11 @@ private:
 	 * @brief Vector containing the awaitables currently being awaited on for this event router.
 	 */
 	mutable std::vector<detail::event_router::awaitable<T> *> coro_awaiters;
+
+	/**
+	 * @brief Size of coro_awaiters, readable without locking coro_mutex
+	 */
+	mutable std::atomic<size_t> awaiter_count{0};
 #else
 	/**
 	 * @brief Dummy for ABI compatibility between DPP_CORO and not
@@ -267,8 +378,399 @@ private:
 	 * @brief Dummy for ABI compatibility between DPP_CORO and not
 	 */
 	utility::dummy<std::vector<void*>> definitely_not_a_vector;
+
+	/**
+	 * @brief Dummy for ABI compatibility between DPP_CORO and not
+	 */
+	utility::dummy<std::atomic<size_t>> definitely_not_a_counter;
 #endif
 
+	/**
+	 * @brief Listeners and awaiters which only want events with a particular key,
+	 * such as a custom_id, so an event reaches only those with its key.
+	 */
+	struct keyed_index {
+		/**
+		 * @brief Mutex guarding the index
+		 */
+		std::shared_mutex mutex;
+
+		/**
+		 * @brief Keyed listeners, by key
+		 */
+		std::unordered_multimap<std::string, listener_t> listeners;
+
+		/**
+		 * @brief Key of each keyed listener, by handle
+		 */
+		std::unordered_map<event_handle, std::string> keys;
+
+		/**
+		 * @brief Keyed awaiters, by key. These are detail::event_router::awaitable<T>,
+		 * type-erased so that the layout does not depend on DPP_CORO.
+		 */
+		std::unordered_multimap<std::string, void*> awaiters;
+	};
+
+	/**
+	 * @brief Index of keyed listeners and awaiters
+	 */
+	mutable keyed_index keyed;
+
+	/**
+	 * @brief Number of keyed listeners and awaiters, readable without locking the index
+	 */
+	mutable std::atomic<size_t> keyed_count{0};
+
+	/**
+	 * @brief True if a key of type K is an ID, rather than a string such as a custom_id
+	 */
+	template <typename K>
+	static constexpr bool is_id_key_v = std::is_same_v<K, snowflake> || (std::is_integral_v<K> && !std::is_same_v<K, bool>);
+
+	/**
+	 * @brief Gets the key of an event, for routing it to keyed listeners and awaiters.
+	 * Empty if this event has no key.
+	 */
+	std::function<std::string(const T&)> key_function;
+
+	/**
+	 * @brief Pins the current snapshot of listeners while an event is dispatched from it,
+	 * so that it is not freed if a listener is attached or detached meanwhile.
+	 */
+	class snapshot_pin {
+		/**
+		 * @brief Owning event router
+		 */
+		const event_router_t* router;
+
+		/**
+		 * @brief Pinned snapshot, or nullptr if there are no listeners
+		 */
+		const snapshot_t* pinned{nullptr};
+
+	public:
+		/**
+		 * @brief Pin the current snapshot of an event router
+		 * @param owner event router
+		 */
+		explicit snapshot_pin(const event_router_t* owner) : router(owner) {
+			/* Nothing attached: skip the shared counter entirely */
+			if (router->listeners.load(std::memory_order_acquire) == nullptr) {
+				return;
+			}
+			router->loading.fetch_add(1);
+			pinned = router->listeners.load();
+			if (pinned != nullptr) {
+				pinned->pins.fetch_add(1);
+			}
+			router->loading.fetch_sub(1);
+		}
+
+		snapshot_pin(const snapshot_pin&) = delete;
+		snapshot_pin& operator=(const snapshot_pin&) = delete;
+
+		/**
+		 * @brief Unpin the snapshot
+		 */
+		~snapshot_pin() {
+			if (pinned != nullptr) {
+				router->unpin(pinned);
+			}
+		}
+
+		/**
+		 * @brief Get the pinned listeners
+		 * @return const listener_list_t& listeners, which may be empty
+		 */
+		const listener_list_t& list() const {
+			static const listener_list_t none;
+			return pinned != nullptr ? pinned->list : none;
+		}
+	};
+
+	/**
+	 * @brief Listeners being called by the current thread, innermost last, so that a
+	 * handler which calls detach_and_wait() on itself does not wait for its own call to return
+	 * @return std::vector<const listener_state*>& listeners being called
+	 */
+	static std::vector<const listener_state*>& running_listeners() {
+		thread_local std::vector<const listener_state*> running;
+		return running;
+	}
+
+	/**
+	 * @brief Counts a call to a listener as running for as long as it exists,
+	 * unless the listener had already been detached
+	 */
+	class listener_call {
+		/**
+		 * @brief Listener being called
+		 */
+		const listener_state& state;
+
+		/**
+		 * @brief True if the call may go ahead
+		 */
+		bool entered{false};
+
+	public:
+		/**
+		 * @brief Start a call to a listener
+		 * @param listener listener to call
+		 */
+		explicit listener_call(const listener_state& listener) : state(listener) {
+			state.in_flight.fetch_add(1);
+			if (state.detached.load()) {
+				leave();
+				return;
+			}
+			entered = true;
+			running_listeners().emplace_back(&state);
+		}
+
+		listener_call(const listener_call&) = delete;
+		listener_call& operator=(const listener_call&) = delete;
+
+		/**
+		 * @brief End the call
+		 */
+		~listener_call() {
+			if (entered) {
+				running_listeners().pop_back();
+				leave();
+			}
+		}
+
+		/**
+		 * @brief Check if the listener may be called
+		 * @return true if it was not detached
+		 */
+		explicit operator bool() const {
+			return entered;
+		}
+
+	private:
+		/**
+		 * @brief Stop counting the call, waking a detach_and_wait() waiting for it
+		 */
+		void leave() {
+			state.in_flight.fetch_sub(1);
+			if (state.detached.load()) {
+				std::lock_guard lock(state.wait_mutex);
+				state.returned.notify_all();
+			}
+		}
+	};
+
+	/**
+	 * @brief Wait for the calls to a detached listener running on other threads to
+	 * return. Calls running further up this thread's stack, i.e. a handler detaching
+	 * itself, are not waited for. No mutex may be held.
+	 * @param listener listener which has been detached
+	 */
+	static void wait_for_listener(const listener_state& listener) {
+		const auto& running = running_listeners();
+		const size_t own = static_cast<size_t>(std::count(running.begin(), running.end(), &listener));
+		std::unique_lock lock(listener.wait_mutex);
+		listener.returned.wait(lock, [&listener, own]() {
+			return listener.in_flight.load() <= own;
+		});
+	}
+
+	/**
+	 * @brief Release a pin on a snapshot. The last event to finish dispatching from a
+	 * snapshot frees any retired snapshots nothing has pinned, unless an attach or
+	 * detach is in progress, which will.
+	 * @param snapshot pinned snapshot, which may be freed once this returns
+	 */
+	void unpin(const snapshot_t* snapshot) const {
+		if (snapshot->pins.fetch_sub(1) == 1 && has_retired.load()) {
+			std::unique_lock lock(mutex, std::try_to_lock);
+			if (lock.owns_lock()) {
+				reclaim();
+			}
+		}
+	}
+
+	/**
+	 * @brief Free the retired snapshots which no event has pinned. mutex must be held.
+	 */
+	void reclaim() const {
+		/* A retired snapshot can only be pinned by an event which loaded it before it was
+		 * retired. Once no event is between loading and pinning, its pins can only fall,
+		 * so one with no pins is unreachable. A long running handler only keeps its own
+		 * snapshot alive.
+		 */
+		if (loading.load() != 0) {
+			return;
+		}
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [](const snapshot_t* snapshot) {
+			if (snapshot->pins.load() != 0) {
+				return false;
+			}
+			delete snapshot;
+			return true;
+		}), retired.end());
+		has_retired.store(!retired.empty());
+	}
+
+	/**
+	 * @brief Swap in a new snapshot of listeners. mutex must be held.
+	 * @param next listeners of the new snapshot
+	 */
+	void publish(listener_list_t&& next) {
+		const snapshot_t* old = listeners.exchange(next.empty() ? nullptr : new snapshot_t(std::move(next)));
+		if (old != nullptr) {
+			retired.emplace_back(old);
+			has_retired.store(true);
+		}
+		reclaim();
+	}
+
+	/**
+	 * @brief Attach a new listener
+	 * @param args arguments to construct the event_handler_t with
+	 * @return event_handle handle of the new listener
+	 */
+	template <typename... Args>
+	event_handle add_listener(Args&&... args) {
+		std::unique_lock l(mutex);
+		const snapshot_t* current = listeners.load();
+		listener_list_t next;
+		if (current != nullptr) {
+			next.reserve(current->list.size() + 1);
+			next.assign(current->list.begin(), current->list.end());
+		}
+		event_handle h = next_handle++;
+		next.emplace_back(h, std::make_shared<listener_state>(std::forward<Args>(args)...));
+		publish(std::move(next));
+		return h;
+	}
+
+	/**
+	 * @brief Attach a new keyed listener
+	 * @param key key of the events to call the listener for
+	 * @param args arguments to construct the event_handler_t with
+	 * @return event_handle handle of the new listener
+	 */
+	template <typename... Args>
+	event_handle add_keyed_listener(std::string key, Args&&... args) {
+		if (!key_function) {
+			throw dpp::logic_exception("This event has no key to attach a keyed listener to");
+		}
+		event_handle h;
+		{
+			std::unique_lock l(mutex);
+			h = next_handle++;
+		}
+		auto handler = std::make_shared<listener_state>(std::forward<Args>(args)...);
+		std::unique_lock l(keyed.mutex);
+		keyed.keys.emplace(h, key);
+		keyed.listeners.emplace(std::move(key), listener_t{h, std::move(handler)});
+		keyed_count.fetch_add(1);
+		return h;
+	}
+
+	/**
+	 * @brief Detach a keyed listener
+	 * @param handle handle of the listener
+	 * @return std::shared_ptr<listener_state> the listener, or nullptr if it was not found
+	 */
+	std::shared_ptr<listener_state> remove_keyed_listener(const event_handle& handle) {
+		std::unique_lock l(keyed.mutex);
+		auto key = keyed.keys.find(handle);
+		if (key == keyed.keys.end()) {
+			return nullptr;
+		}
+		std::shared_ptr<listener_state> removed;
+		auto [begin, end] = keyed.listeners.equal_range(key->second);
+		for (auto it = begin; it != end; ++it) {
+			if (it->second.first == handle) {
+				removed = std::move(it->second.second);
+				keyed.listeners.erase(it);
+				break;
+			}
+		}
+		keyed.keys.erase(key);
+		keyed_count.fetch_sub(1);
+		return removed;
+	}
+
+	/**
+	 * @brief Detach a listener, keyed or not, so that no new call to it starts
+	 * @param handle handle of the listener
+	 * @return std::shared_ptr<listener_state> the listener, or nullptr if it was not found
+	 */
+	std::shared_ptr<listener_state> remove_listener(const event_handle& handle) {
+		std::shared_ptr<listener_state> removed;
+		if (keyed_count.load() > 0) {
+			removed = remove_keyed_listener(handle);
+		}
+		if (!removed) {
+			std::unique_lock l(mutex);
+			const snapshot_t* current = listeners.load();
+			if (current == nullptr) {
+				return nullptr;
+			}
+			auto it = std::find_if(current->list.begin(), current->list.end(), [&handle](const listener_t& listener) {
+				return listener.first == handle;
+			});
+			if (it == current->list.end()) {
+				return nullptr;
+			}
+			removed = it->second;
+			listener_list_t next;
+			next.reserve(current->list.size() - 1);
+			next.insert(next.end(), current->list.begin(), it);
+			next.insert(next.end(), it + 1, current->list.end());
+			publish(std::move(next));
+		}
+		removed->detached.store(true);
+		return removed;
+	}
+
+	/**
+	 * @brief Get the keyed listeners for an event's key. The handlers are copied out,
+	 * so they are called without the index locked and may attach or detach listeners.
+	 * @param key key of the event
+	 * @return std::vector<std::shared_ptr<listener_state>> handlers to call, in the order they were attached
+	 */
+	std::vector<std::shared_ptr<listener_state>> keyed_listeners(const std::string& key) const {
+		std::vector<listener_t> found;
+		{
+			std::shared_lock l(keyed.mutex);
+			auto [begin, end] = keyed.listeners.equal_range(key);
+			for (auto it = begin; it != end; ++it) {
+				found.emplace_back(it->second);
+			}
+		}
+		std::sort(found.begin(), found.end(), [](const listener_t& a, const listener_t& b) {
+			return a.first < b.first;
+		});
+		std::vector<std::shared_ptr<listener_state>> handlers;
+		handlers.reserve(found.size());
+		for (auto& listener : found) {
+			handlers.emplace_back(std::move(listener.second));
+		}
+		return handlers;
+	}
+
+	/**
+	 * @brief Get the key of an event, if anything keyed is waiting for events
+	 * @param event event
+	 * @param key receives the key
+	 * @return true if the event has a key which keyed listeners or awaiters may want
+	 */
+	bool event_key(const T& event, std::string& key) const {
+		/* Nothing keyed attached: don't lock the index or build the key */
+		if (keyed_count.load(std::memory_order_acquire) == 0 || !key_function) {
+			return false;
+		}
+		key = key_function(event);
+		return !key.empty();
+	}
+
 	/**
 	 * @brief A function to be called whenever the method is called, to check
 	 * some condition that is required for this event to trigger correctly.
@@ -291,6 +793,16 @@ protected:
 		warning = warning_function;
 	}
 
+	/**
+	 * @brief Set the function which gets the key of an event, enabling
+	 * keyed listeners and awaiters for this event
+	 *
+	 * @param get_key A function returning the key of an event, or an empty string if it has none
+	 */
+	void set_key_function(std::function<std::string(const T&)> get_key) {
+		key_function = get_key;
+	}
+
 	/**
 	 * @brief Handle an event. This function should only be used without coro enabled, otherwise use handle_coro.
 	 */
@@ -299,16 +811,32 @@ protected:
 			warning(event);
 		}
 
-		std::shared_lock l(mutex);
-		for (const auto& [_, listener] : dispatch_container) {
+		snapshot_pin snapshot(this);
+		for (const auto& [_, listener] : snapshot.list()) {
 			if (!event.is_cancelled()) {
-				if (std::holds_alternative<regular_handler_t>(listener)) {
-					std::get<regular_handler_t>(listener)(event);
+				listener_call running(*listener);
+				if (!running) {
+					continue;
+				}
+				if (std::holds_alternative<regular_handler_t>(listener->handler)) {
+					std::get<regular_handler_t>(listener->handler)(event);
 				} else {
 					throw dpp::logic_exception("cannot handle a coroutine event handler with a library built without DPP_CORO");
 				}
 			}
 		};
+
+		std::string key;
+		if (event_key(event, key)) {
+			for (const auto& listener : keyed_listeners(key)) {
+				if (!event.is_cancelled() && std::holds_alternative<regular_handler_t>(listener->handler)) {
+					listener_call running(*listener);
+					if (running) {
+						std::get<regular_handler_t>(listener->handler)(event);
+					}
+				}
+			}
+		}
 	}
 
 #ifndef DPP_NO_CORO
@@ -320,22 +848,42 @@ protected:
 			warning(event);
 		}
 
+		std::string key;
+		const bool has_key = event_key(event, key);
+
 		resume_awaiters(event);
+		if (has_key) {
+			resume_keyed_awaiters(event, key);
+		}
 
 		std::vector<dpp::task<void>> tasks;
 		{
-			std::shared_lock l(mutex);
+			snapshot_pin snapshot(this);
 
-			for (const auto& [_, listener] : dispatch_container) {
+			for (const auto& [_, listener] : snapshot.list()) {
 				if (!event.is_cancelled()) {
-					if (std::holds_alternative<task_handler_t>(listener)) {
-						tasks.push_back(std::get<task_handler_t>(listener)(event));
-					} else if (std::holds_alternative<regular_handler_t>(listener)) {
-						std::get<regular_handler_t>(listener)(event);
+					listener_call running(*listener);
+					if (!running) {
+						continue;
+					}
+					if (std::holds_alternative<task_handler_t>(listener->handler)) {
+						tasks.push_back(std::get<task_handler_t>(listener->handler)(event));
+					} else if (std::holds_alternative<regular_handler_t>(listener->handler)) {
+						std::get<regular_handler_t>(listener->handler)(event);
 					}
 				}
 			};
 		}
+		if (has_key) {
+			for (const auto& listener : keyed_listeners(key)) {
+				if (!event.is_cancelled() && std::holds_alternative<regular_handler_t>(listener->handler)) {
+					listener_call running(*listener);
+					if (running) {
+						std::get<regular_handler_t>(listener->handler)(event);
+					}
+				}
+			}
+		}
 
 		for (dpp::task<void>& t : tasks) {
 			co_await t; // keep the event object alive until all tasks finished
@@ -352,9 +900,16 @@ protected:
 	 * @param awaiter Awaiter to attach
 	 */
 	void attach_awaiter(detail::event_router::awaitable<T> *awaiter) {
+		if (awaiter->keyed) {
+			std::unique_lock lock{keyed.mutex};
+			keyed.awaiters.emplace(awaiter->key, awaiter);
+			keyed_count.fetch_add(1);
+			return;
+		}
 		std::unique_lock lock{coro_mutex};
 
 		coro_awaiters.emplace_back(awaiter);
+		awaiter_count.store(coro_awaiters.size());
 	}
 
 	/**
@@ -367,6 +922,58 @@ protected:
 		std::unique_lock lock{coro_mutex};
 
 		coro_awaiters.erase(std::remove_if(coro_awaiters.begin(), coro_awaiters.end(), [handle](detail::event_router::awaitable<T> const *awaiter) { return awaiter->handle == handle; }), coro_awaiters.end());
+		awaiter_count.store(coro_awaiters.size());
+	}
+
+	/**
+	 * @brief Detach a keyed awaiter from this event router.
+	 * This is called when a keyed detail::event_router::awaitable is cancelled.
+	 *
+	 * @param awaiter Awaiter to detach
+	 */
+	void detach_keyed_awaiter(detail::event_router::awaitable<T> *awaiter) {
+		std::unique_lock lock{keyed.mutex};
+
+		auto [begin, end] = keyed.awaiters.equal_range(awaiter->key);
+		for (auto it = begin; it != end; ++it) {
+			if (it->second == awaiter) {
+				keyed.awaiters.erase(it);
+				keyed_count.fetch_sub(1);
+				break;
+			}
+		}
+	}
+
+	/**
+	 * @brief Resume the keyed awaiters for this event's key whose predicate matches, or is null.
+	 * Only awaiters with the key are examined.
+	 *
+	 * @param event Event to compare and pass to accepting awaiters
+	 * @param key Key of the event
+	 */
+	void resume_keyed_awaiters(const T& event, const std::string& key) const {
+		std::vector<detail::event_router::awaitable<T>*> to_resume;
+		std::unique_lock lock{keyed.mutex};
+
+		auto [begin, end] = keyed.awaiters.equal_range(key);
+		for (auto it = begin; it != end;) {
+			auto* awaiter = static_cast<detail::event_router::awaitable<T>*>(it->second);
+			using state_t = detail::event_router::awaiter_state;
+
+			/* As in resume_awaiters(), an awaiter which is not waiting is being cancelled */
+			state_t s = state_t::waiting;
+			if ((!awaiter->predicate || awaiter->predicate(event)) && awaiter->state.compare_exchange_strong(s, state_t::resuming)) {
+				to_resume.emplace_back(awaiter);
+				awaiter->event = &event;
+				it = keyed.awaiters.erase(it);
+				keyed_count.fetch_sub(1);
+			} else {
+				++it;
+			}
+		}
+		lock.unlock();
+		for (detail::event_router::awaitable<T>* awaiter : to_resume)
+			awaiter->resume();
 	}
 
 	/**
@@ -375,6 +982,10 @@ protected:
 	 * @param event Event to compare and pass to accepting awaiters
 	 */
 	void resume_awaiters(const T& event) const {
+		if (awaiter_count.load(std::memory_order_acquire) == 0) {
+			/* Nothing is awaiting this event, so don't touch coro_mutex */
+			return;
+		}
 		std::vector<detail::event_router::awaitable<T>*> to_resume;
 		std::unique_lock lock{coro_mutex};
 
@@ -406,6 +1017,7 @@ protected:
 				}
 			}
 		}
+		awaiter_count.store(coro_awaiters.size());
 		lock.unlock();
 		for (detail::event_router::awaitable<T>* awaiter : to_resume)
 			awaiter->resume();
@@ -439,7 +1051,26 @@ public:
 				// ok. likely we threw this one
 			}
 		}
+		for (;;) {
+			detail::event_router::awaitable<T>* awaiter;
+			{
+				std::shared_lock lock{keyed.mutex};
+				if (keyed.awaiters.empty()) {
+					break;
+				}
+				awaiter = static_cast<detail::event_router::awaitable<T>*>(keyed.awaiters.begin()->second);
+			}
+			try {
+				awaiter->cancel();
+			} catch (const dpp::task_cancelled_exception &) {
+				// ok. likely we threw this one
+			}
+		}
 #endif
+		delete listeners.load();
+		for (const snapshot_t* snapshot : retired) {
+			delete snapshot;
+		}
 	}
 
 	/**
@@ -532,6 +1163,82 @@ public:
 	[[nodiscard]] auto operator co_await() noexcept {
 		return detail::event_router::awaitable<T>{this, nullptr};
 	}
+
+	/**
+	 * @brief Obtain an awaitable object that refers to the next event with a certain key.
+	 * The key of an event depends on its type, e.g. the custom_id of a button click,
+	 * or the channel ID of a message create. See dpp::cluster for which events have keys.
+	 *
+	 * Keyed awaiters are looked up by key in a hash index, so an event only ever examines
+	 * the awaiters waiting for its own key, no matter how many others are waiting.
+	 *
+	 * @details Example: @code{cpp}
+	 * dpp::task<> my_handler(const dpp::slashcommand_t& event) {
+	 *	co_await event.co_reply(dpp::message().add_component(dpp::component().add_component().set_label("click me!").set_id("test")));
+	 *
+	 *	auto result = co_await dpp::when_any{c->on_button_click.when_key("test"), c->co_sleep(60)};
+	 *	if (result.index() == 0) {
+	 *		// do something on button click
+	 *	}
+	 * }
+	 * @endcode
+	 *
+	 * Combined with dpp::when_any and dpp::cluster::co_sleep as above, expiry is handled by
+	 * the cluster's timers, and the awaiter is removed from the index when it expires.
+	 *
+	 * @warning On resumption the awaiter will be given <b>a reference</b> to the event.
+	 * This means that variable may become dangling at the next co_await, be careful and save it in a variable
+	 * if you need to.
+	 * @param key Key of the event to wait for
+	 * @return awaitable An awaitable object that can be co_await-ed to await an event with the key.
+	 * @throw dpp::logic_exception This event has no key
+	 */
+	[[nodiscard]] auto when_key(std::string key) {
+		if (!key_function) {
+			throw dpp::logic_exception("This event has no key to wait for");
+		}
+		return detail::event_router::awaitable<T>{this, std::move(key), nullptr};
+	}
+
+	/**
+	 * @brief Obtain an awaitable object that refers to the next event with a certain ID as its key,
+	 * such as the channel ID of a message create.
+	 *
+	 * @see when_key(std::string)
+	 * @tparam Id dpp::snowflake or an integer type
+	 * @param id Key of the event to wait for
+	 * @return awaitable An awaitable object that can be co_await-ed to await an event with the key.
+	 * @throw dpp::logic_exception This event has no key
+	 */
+	template <typename Id>
+#ifndef _DOXYGEN_
+	requires is_id_key_v<Id>
+#endif
+	[[nodiscard]] auto when_key(Id id) {
+		return when_key(snowflake(id).str());
+	}
+
+	/**
+	 * @brief Obtain an awaitable object that refers to the next event with a certain key
+	 * which also satisfies a condition. The predicate is only called for events with the key.
+	 *
+	 * @see when_key(std::string)
+	 * @param key Key of the event to wait for
+	 * @param pred Predicate to check the event against. This should be a callable of the form `bool(const T&)`
+	 * where T is the event type, returning true if the event is to match.
+	 * @return awaitable An awaitable object that can be co_await-ed to await an event matching the key and condition.
+	 * @throw dpp::logic_exception This event has no key
+	 */
+	template <typename Predicate>
+#ifndef _DOXYGEN_
+	requires utility::callable_returns<Predicate, bool, const T&>
+#endif
+	[[nodiscard]] auto when_key(std::string key, Predicate&& pred) {
+		if (!key_function) {
+			throw dpp::logic_exception("This event has no key to wait for");
+		}
+		return detail::event_router::awaitable<T>{this, std::move(key), std::forward<Predicate>(pred)};
+	}
 #endif
 
 	/**
@@ -543,14 +1250,9 @@ public:
 	 */
 	[[nodiscard]] bool empty() const {
 #ifndef DPP_NO_CORO
-		std::shared_lock lock{mutex};
-		std::shared_lock coro_lock{coro_mutex};
-
-		return dispatch_container.empty() && coro_awaiters.empty();
+		return listeners.load() == nullptr && awaiter_count.load() == 0 && keyed_count.load() == 0;
 #else
-		std::shared_lock lock{mutex};
-
-		return dispatch_container.empty();
+		return listeners.load() == nullptr && keyed_count.load() == 0;
 #endif
 	}
 
@@ -623,10 +1325,7 @@ public:
 	template <typename F>
 	requires (utility::callable_returns<F, void, const T&>)
 	[[maybe_unused]] event_handle attach(F&& fun) {
-		std::unique_lock l(mutex);
-		event_handle h = next_handle++;
-		dispatch_container.emplace(std::piecewise_construct, std::forward_as_tuple(h), std::forward_as_tuple(std::in_place_type_t<regular_handler_t>{}, std::forward<F>(fun)));
-		return h;
+		return add_listener(std::in_place_type_t<regular_handler_t>{}, std::forward<F>(fun));
 	}
 
 	/**
@@ -643,10 +1342,7 @@ public:
 	[[maybe_unused]] event_handle attach(F&& fun) {
 		assert(dpp::utility::is_coro_enabled());
 
-		std::unique_lock l(mutex);
-		event_handle h = next_handle++;
-		dispatch_container.emplace(std::piecewise_construct, std::forward_as_tuple(h), std::forward_as_tuple(std::in_place_type_t<task_handler_t>{}, std::forward<F>(fun)));
-		return h;
+		return add_listener(std::in_place_type_t<task_handler_t>{}, std::forward<F>(fun));
 	}
 #  else
 	/**
@@ -667,8 +1363,6 @@ public:
 	 * @brief Attach a callable to the event, adding a listener.
 	 * The callable should be of the form `void(const T&)`
 	 * where T is the event type for this event router.
-	 *f
-	 * @warning You cannot call this within an event handler.
 	 *
 	 * @param fun Callable to attach to event
 	 * @return event_handle An event handle unique to this event, used to
@@ -676,25 +1370,83 @@ public:
 	 */
 	template <typename F>
 	[[maybe_unused]] std::enable_if_t<utility::callable_returns_v<F, void, const T&>, event_handle> attach(F&& fun) {
-		std::unique_lock l(mutex);
-		event_handle h = next_handle++;
-		dispatch_container.emplace(h, std::forward<F>(fun));
-		return h;
+		return add_listener(std::in_place_type_t<regular_handler_t>{}, std::forward<F>(fun));
 	}
 #  endif /* DPP_NO_CORO */
 #endif /* _DOXYGEN_ */
 	/**
-	 * @brief Detach a listener from the event using a previously obtained ID.
+	 * @brief Attach a callable to the event which is only called for events with a certain key,
+	 * e.g. the custom_id of a button click, or the message ID of a reaction. See dpp::cluster
+	 * for which events have keys. The callable should be of the form `void(const T&)`.
 	 *
-	 * @warning You cannot call this within an event handler.
+	 * Keyed listeners are looked up by key in a hash index, so an event only ever calls
+	 * the listeners for its own key, no matter how many others are attached. They are
+	 * called after the listeners attached without a key.
+	 *
+	 * @param key Key of the events to call the listener for
+	 * @param fun Callable to attach to event
+	 * @return event_handle An event handle unique to this event, used to
+	 * detach the listener from the event later if necessary.
+	 * @throw dpp::logic_exception This event has no key
+	 */
+	template <typename F>
+	[[maybe_unused]] std::enable_if_t<utility::callable_returns_v<F, void, const T&>, event_handle> attach_key(std::string key, F&& fun) {
+		return add_keyed_listener(std::move(key), std::in_place_type_t<regular_handler_t>{}, std::forward<F>(fun));
+	}
+
+	/**
+	 * @brief Attach a callable to the event which is only called for events with a certain ID as their key.
+	 *
+	 * @see attach_key(std::string, F&&)
+	 * @tparam Id dpp::snowflake or an integer type
+	 * @param id Key of the events to call the listener for
+	 * @param fun Callable to attach to event
+	 * @return event_handle An event handle unique to this event, used to
+	 * detach the listener from the event later if necessary.
+	 * @throw dpp::logic_exception This event has no key
+	 */
+	template <typename Id, typename F>
+	[[maybe_unused]] std::enable_if_t<is_id_key_v<Id> && utility::callable_returns_v<F, void, const T&>, event_handle> attach_key(Id id, F&& fun) {
+		return attach_key(snowflake(id).str(), std::forward<F>(fun));
+	}
+
+	/**
+	 * @brief Detach a listener from the event using a previously obtained ID.
+	 * Once this returns no new call to the listener starts, but calls to it which are
+	 * already running on other threads may still be running. This does not block, so a
+	 * handler may detach any listener, including itself. If the listener captured
+	 * something which is about to be destroyed, use detach_and_wait().
 	 *
 	 * @param handle An ID obtained from @ref operator(F&&) "operator()"
 	 * @retval true  The event was successfully detached
 	 * @retval false The ID is invalid (possibly already detached, or does not exist)
 	 */
 	[[maybe_unused]] bool detach(const event_handle& handle) {
-		std::unique_lock l(mutex);
-		return this->dispatch_container.erase(handle);
+		return remove_listener(handle) != nullptr;
+	}
+
+	/**
+	 * @brief Detach a listener from the event, and wait for calls to it which are
+	 * running on other threads to return, so that anything it captured may be destroyed.
+	 * A coroutine listener is only waited for until it first suspends. A listener may
+	 * detach itself, in which case its own call is not waited for.
+	 *
+	 * @warning This blocks until the running calls return. Calling it while holding a
+	 * lock the listener needs, or from two handlers which detach each other while both
+	 * are running, deadlocks. Prefer detach() unless you need the guarantee.
+	 *
+	 * @param handle An ID obtained from @ref operator(F&&) "operator()"
+	 * @retval true  The event was successfully detached
+	 * @retval false The ID is invalid (possibly already detached, or does not exist)
+	 */
+	[[maybe_unused]] bool detach_and_wait(const event_handle& handle) {
+		std::shared_ptr<listener_state> removed = remove_listener(handle);
+		if (!removed) {
+			return false;
+		}
+		/* Not under mutex, as the calls being waited for may attach or detach listeners */
+		wait_for_listener(*removed);
+		return true;
 	}
 };
 
@@ -711,7 +1463,11 @@ void awaitable<T>::cancel() {
 		* If state == resuming || cancelling, ignore
 		*/
 	if (state.compare_exchange_strong(s, awaiter_state::cancelling)) {
-		self->detach_coro(handle);
+		if (keyed) {
+			self->detach_keyed_awaiter(this);
+		} else {
+			self->detach_coro(handle);
+		}
 		resume();
 	}
 }
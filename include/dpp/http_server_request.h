@@ -26,6 +26,12 @@
 #include <list>
 #include <vector>
 #include <variant>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
 #include <dpp/sslconnection.h>
 #include <dpp/version.h>
 #include <dpp/stringops.h>
@@ -39,20 +45,105 @@ namespace dpp {
  */
 using http_server_request_event = std::function<void(class http_server_request*)>;
 
+class http_server_request;
+
+namespace detail {
+
+/**
+ * @brief State shared between a http_server_request and the handle used to complete
+ * its response once the request handler has deferred it
+ */
+struct deferred_http_response {
+	/**
+	 * @brief Serialises completion, timeout and detachment
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief The request, or nullptr once its connection is gone or the response is sent
+	 */
+	http_server_request* request{nullptr};
+
+	/**
+	 * @brief True once the response content has been decided
+	 */
+	bool completed{false};
+
+	/**
+	 * @brief True once the request handler has returned. The response is sent
+	 * when both this and completed are true.
+	 */
+	bool handler_returned{false};
+
+	/**
+	 * @brief When to call on_timeout, if the response has not been completed by then
+	 */
+	std::chrono::steady_clock::time_point deadline{};
+
+	/**
+	 * @brief Fills in the response if it is not completed in time
+	 */
+	http_server_request_event on_timeout{};
+};
+
+}
+
+/**
+ * @brief Handle through which a deferred http_server_request response is completed.
+ * It may be copied and completed from any thread, and stays safe to use after the
+ * client has disconnected, in which case the response is discarded.
+ */
+class DPP_EXPORT http_server_deferred_response {
+	/**
+	 * @brief Shared state with the request
+	 */
+	std::shared_ptr<detail::deferred_http_response> state;
+
+public:
+	/**
+	 * @brief Construct an empty handle, which cannot complete anything
+	 */
+	http_server_deferred_response() = default;
+
+	/**
+	 * @brief Construct a handle for a deferred response
+	 * @param shared_state State shared with the request
+	 */
+	explicit http_server_deferred_response(std::shared_ptr<detail::deferred_http_response> shared_state);
+
+	/**
+	 * @brief Complete the response and send it
+	 * @param status HTTP status
+	 * @param body response body
+	 * @param headers additional response headers
+	 * @return true if this completed the response, false if it was already completed,
+	 * timed out, or the client has gone away
+	 */
+	bool complete(uint16_t status, const std::string& body, const http_headers& headers = {}) const;
+};
+
 /*
  * @brief Implements a HTTPS socket client based on the SSL client.
  * @note plaintext HTTP without SSL is also supported via a "downgrade" setting
  */
 class DPP_EXPORT http_server_request : public ssl_connection {
+	friend class http_server_deferred_response;
+
 	/**
 	 * @brief The request body, e.g. form data
 	 */
 	std::string request_body;
 
 	/**
-	 * @brief Headers from the client
+	 * @brief Header section of the current request, as received from the client
+	 */
+	std::string raw_headers;
+
+	/**
+	 * @brief Headers from the client, as views of names and values within raw_headers.
+	 * Names are kept as sent, and compared case insensitively.
 	 */
-	http_headers request_headers;
+	std::vector<std::pair<std::string_view, std::string_view>> request_headers;
 
 	/**
 	 * @brief Time at which the request should be abandoned
@@ -74,6 +165,81 @@ class DPP_EXPORT http_server_request : public ssl_connection {
 	 */
 	std::string response_body;
 
+	/**
+	 * @brief True if the request was made with HTTP/1.1 or later
+	 */
+	bool http11{false};
+
+	/**
+	 * @brief True if the connection stays open for the next request once this one is answered
+	 */
+	bool persistent{false};
+
+	/**
+	 * @brief True once the current request has been passed on to be answered
+	 */
+	bool dispatched{false};
+
+	/**
+	 * @brief Set from the thread answering the request, once the response is queued for sending
+	 */
+	std::atomic<bool> responded{false};
+
+	/**
+	 * @brief Number of requests answered on this connection so far
+	 */
+	uint32_t requests_served{0};
+
+	/**
+	 * @brief State of the response if the handler deferred it, otherwise empty
+	 */
+	std::shared_ptr<detail::deferred_http_response> deferred;
+
+	/**
+	 * @brief Protects the deferred pointer, which the timer reads from the socket thread
+	 */
+	mutable std::mutex deferred_mutex;
+
+	/**
+	 * @brief Get the state of a deferred response
+	 * @return std::shared_ptr<detail::deferred_http_response> state, or empty if not deferred
+	 */
+	std::shared_ptr<detail::deferred_http_response> get_deferred() const;
+
+	/**
+	 * @brief Detach any deferred response from this request, so it can no longer complete it
+	 */
+	void detach_deferred();
+
+	/**
+	 * @brief Called on the worker thread once the handler has returned.
+	 * Sends the response unless it is deferred and not yet completed.
+	 */
+	void handler_returned();
+
+	/**
+	 * @brief Queue the response for sending
+	 */
+	void finish();
+
+	/**
+	 * @brief Parse the request line and headers held in raw_headers
+	 * @return true if the request line is valid. If false, an error response has been generated.
+	 */
+	bool parse_headers();
+
+	/**
+	 * @brief Answer the current request on a worker thread: call the handler
+	 * if there is one, then queue the response
+	 */
+	void respond();
+
+	/**
+	 * @brief Clear the state of the answered request, ready for the next request
+	 * on a persistent connection
+	 */
+	void reset_request();
+
 protected:
 
 	/**
@@ -116,6 +282,12 @@ protected:
 	 */
 	[[nodiscard]] uint64_t get_max_header_size() const;
 
+	/**
+	 * @brief Maximum number of requests answered on one persistent connection
+	 * before it is closed
+	 */
+	[[nodiscard]] uint32_t get_max_keepalive_requests() const;
+
 	/**
 	 * @brief Reply with an error message
 	 * @param error_code error code
@@ -211,6 +383,15 @@ public:
 	 */
 	[[nodiscard]] const std::string get_header(const std::string& header_name) const;
 
+	/**
+	 * @brief Get a HTTP request header without copying it
+	 *
+	 * @param header_name Header name to find, case insensitive
+	 * @return View of the header content, or an empty view if not found.
+	 * The view is only valid until the response to this request is sent.
+	 */
+	[[nodiscard]] std::string_view get_header_view(std::string_view header_name) const;
+
 	/**
 	 * @brief Get the number of headers with the same header name
 	 *
@@ -234,6 +415,19 @@ public:
 	 */
 	[[nodiscard]] std::multimap<std::string, std::string> get_headers() const;
 
+	/**
+	 * @brief Defer the response, for a handler that answers the request later.
+	 * Call this from within the request handler; once it returns, the response is not
+	 * sent until it is completed through the returned handle, from any thread.
+	 *
+	 * @param timeout If non-zero, time after which on_timeout is called to fill in the
+	 * response instead. Timeouts are checked once a second, so on_timeout is called on the
+	 * last check before the timeout: never later than it, but up to a second earlier.
+	 * @param on_timeout Called on timeout to set the response status, headers and body
+	 * @return http_server_deferred_response handle to complete the response with
+	 */
+	http_server_deferred_response defer(std::chrono::milliseconds timeout = std::chrono::milliseconds(0), http_server_request_event on_timeout = {});
+
 	/**
 	 * @brief Set a response header
 	 * @param header header name
@@ -258,7 +452,11 @@ public:
 	http_server_request& set_status(uint16_t new_status);
 
 	/**
-	 * @brief Get whole response as a string
+	 * @brief Get whole response as a string.
+	 * Requests made with HTTP/1.1 are answered with HTTP/1.1, and the connection is
+	 * kept open for further (optionally pipelined) requests unless the client sent
+	 * `Connection: close`. HTTP/1.0 connections are only kept open if the client
+	 * asked for it with `Connection: keep-alive`.
 	 */
 	[[nodiscard]] std::string get_response();
 };
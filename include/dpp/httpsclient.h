@@ -29,6 +29,8 @@
 #include <dpp/sslconnection.h>
 #include <dpp/version.h>
 #include <dpp/stringops.h>
+#include <dpp/upload_source.h>
+#include <dpp/zlibcontext.h>
 
 namespace dpp {
 
@@ -84,6 +86,30 @@ enum http_state : uint8_t {
  */
 typedef std::multimap<std::string, std::string> http_headers;
 
+/**
+ * @brief One part of a request body which is sent in sequence with other parts.
+ * This is either literal data, or an upload_source which is streamed into the socket.
+ */
+struct http_body_segment {
+	/**
+	 * @brief Literal data, used if source is empty
+	 */
+	std::string data;
+
+	/**
+	 * @brief Source to stream the content of this segment from
+	 */
+	std::shared_ptr<upload_source> source;
+
+	/**
+	 * @brief Get the length of this segment
+	 * @return uint64_t length in bytes
+	 */
+	uint64_t size() const {
+		return source ? source->size() : data.length();
+	}
+};
+
 /**
  * @brief Represents a multipart mime body and the correct top-level mime type
  * If a non-multipart request is passed in, this is represented as a plain body
@@ -99,6 +125,12 @@ struct multipart_content {
 	 * @brief MIME type
 	 */
 	std::string mimetype;
+
+	/**
+	 * @brief Body segments to be streamed in order. If this is non-empty,
+	 * the body is sent from these segments and body is empty.
+	 */
+	std::vector<http_body_segment> segments;
 };
 
 /**
@@ -130,6 +162,12 @@ struct http_connect_info {
 
 using https_client_completion_event = std::function<void(class https_client*)>;
 
+/**
+ * @brief Called with each part of a response body as it arrives, when a response is streamed.
+ * @note This is called on the socket engine thread, so it must not block for long.
+ */
+using https_client_body_event = std::function<void(std::string_view)>;
+
 /**
  * @brief Implements a HTTPS socket client based on the SSL client.
  * @note plaintext HTTP without SSL is also supported via a "downgrade" setting
@@ -151,11 +189,83 @@ class DPP_EXPORT https_client : public ssl_connection {
 	 */
 	std::string request_body;
 
+	/**
+	 * @brief Streamed request body segments, used instead of request_body if non-empty
+	 */
+	std::vector<http_body_segment> request_segments;
+
+	/**
+	 * @brief Index into request_segments of the segment currently being sent
+	 */
+	size_t segment_index;
+
+	/**
+	 * @brief Offset into the segment currently being sent
+	 */
+	uint64_t segment_offset;
+
+	/**
+	 * @brief Scratch buffer for reading upload_source segments
+	 */
+	std::string segment_scratch;
+
+	/**
+	 * @brief Queue the next part of a streamed request body into the output buffer
+	 */
+	void stream_request_body();
+
 	/**
 	 * @brief The response body, e.g. file content or JSON
 	 */
 	std::string body;
 
+	/**
+	 * @brief If set, response body content is passed here as it arrives rather than kept in body
+	 */
+	https_client_body_event body_handler;
+
+	/**
+	 * @brief Number of bytes of response body content received
+	 */
+	uint64_t body_received;
+
+	/**
+	 * @brief True if we sent Accept-Encoding ourselves, so will decompress the response body
+	 */
+	bool accept_compressed;
+
+	/**
+	 * @brief Decompresses a gzip or deflate encoded response body, if the response has one
+	 */
+	std::unique_ptr<zlibcontext> inflater;
+
+	/**
+	 * @brief Buffer for decompressed response body content
+	 */
+	std::string decompressed_part;
+
+	/**
+	 * @brief Number of decompressed bytes of response body content
+	 */
+	uint64_t body_decompressed;
+
+	/**
+	 * @brief True if the response body could not be decompressed
+	 */
+	bool decompression_failed;
+
+	/**
+	 * @brief Decompress (if needed) then store or stream some received response body content
+	 * @param data body content as received from the socket
+	 */
+	void receive_body(std::string_view data);
+
+	/**
+	 * @brief Store or stream some decoded response body content
+	 * @param data body content
+	 */
+	void deliver_body(std::string_view data);
+
 	/**
 	 * @brief The reported length of the content. If this is
 	 * UULONG_MAX, then no length was reported by the server.
@@ -217,6 +327,11 @@ protected:
 	 */
 	http_state get_state();
 
+	/**
+	 * @brief Called when the output buffer has been sent, to queue more of a streamed request body
+	 */
+	virtual void on_buffer_drained() override;
+
 public:
 	/**
 	 * @brief If true the response timed out while waiting
@@ -257,6 +372,25 @@ public:
 	 */
         https_client(cluster* creator, const std::string &hostname, uint16_t port = 443, const std::string &urlpath = "/", const std::string &verb = "GET", const std::string &req_body = "", const http_headers& extra_headers = {}, bool plaintext_connection = false, uint16_t request_timeout = 5, const std::string &protocol = "1.1", https_client_completion_event done = {});
 
+	/**
+	 * @brief Connect to a specific HTTP(S) server and complete a request, sending a request body
+	 * that may be streamed from upload sources rather than held in memory as a whole.
+	 *
+	 * @param hostname Hostname to connect to
+	 * @param port Port number to connect to, usually 443 for SSL and 80 for plaintext
+	 * @param urlpath path part of URL, e.g. "/api"
+	 * @param verb Request verb, e.g. GET or POST
+	 * @param req_body Request body, as built by dpp::https_client::build_multipart()
+	 * @param extra_headers Additional request headers, e.g. user-agent, authorization, etc
+	 * @param plaintext_connection Set to true to make the connection plaintext (turns off SSL)
+	 * @param request_timeout How many seconds before the connection is considered failed if not finished
+	 * @param protocol Request HTTP protocol (default: 1.1)
+	 * @param done Function to call when https_client request is completed
+	 * @param on_body If set, the response body is passed to this function as it arrives instead of
+	 * being kept in memory, and get_content() will return an empty string.
+	 */
+	https_client(cluster* creator, const std::string &hostname, uint16_t port, const std::string &urlpath, const std::string &verb, const multipart_content &req_body, const http_headers& extra_headers = {}, bool plaintext_connection = false, uint16_t request_timeout = 5, const std::string &protocol = "1.1", https_client_completion_event done = {}, https_client_body_event on_body = {});
+
 	/**
 	 * @brief Destroy the https client object
 	 */
@@ -273,6 +407,23 @@ public:
 	 */
 	static multipart_content build_multipart(const std::string &json, const std::vector<std::string>& filenames = {}, const std::vector<std::string>& contents = {}, const std::vector<std::string>& mimetypes = {});
 
+	/**
+	 * @brief Build a multipart content from a set of files and some json, where
+	 * some files may be streamed from upload sources.
+	 *
+	 * If any entry of sources is set, the returned content has its body in
+	 * multipart_content::segments, and the content of that file is never copied
+	 * into memory as a whole. Otherwise this is identical to the overload without sources.
+	 *
+	 * @param json The json content
+	 * @param filenames File names of files to send
+	 * @param contents Contents of each of the files to send, used where there is no source
+	 * @param mimetypes MIME types of each of the files to send
+	 * @param sources Upload sources of each of the files to send. Entries may be empty.
+	 * @return multipart mime content and headers
+	 */
+	static multipart_content build_multipart(const std::string &json, const std::vector<std::string>& filenames, const std::vector<std::string>& contents, const std::vector<std::string>& mimetypes, const std::vector<std::shared_ptr<upload_source>>& sources);
+
 	/**
 	 * @brief Processes incoming data from the SSL socket input buffer.
 	 * 
@@ -328,10 +479,34 @@ public:
 	/**
 	 * @brief Get the response content
 	 * 
-	 * @return response content
+	 * @return response content. This is empty if the response was streamed to a body handler.
 	 */
 	const std::string get_content() const;
 
+	/**
+	 * @brief Get the number of compressed response body bytes received.
+	 * This is zero unless the server sent a gzip or deflate encoded body.
+	 *
+	 * @return uint64_t compressed bytes received
+	 */
+	uint64_t get_compressed_bytes_in() const;
+
+	/**
+	 * @brief Get the number of response body bytes produced by decompression.
+	 * This is zero unless the server sent a gzip or deflate encoded body.
+	 *
+	 * @return uint64_t decompressed bytes
+	 */
+	uint64_t get_decompressed_bytes_in() const;
+
+	/**
+	 * @brief Returns true if the response body was compressed and could not be decompressed.
+	 * The content is incomplete if this is true.
+	 *
+	 * @return true on decompression error
+	 */
+	bool has_decompression_error() const;
+
 	/**
 	 * @brief Get the response HTTP status, e.g.
 	 * 200 for OK, 404 for not found, 429 for rate limited.
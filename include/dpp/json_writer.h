@@ -0,0 +1,214 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace dpp {
+
+namespace detail {
+
+/**
+ * @brief A streaming JSON serializer which writes directly into a reusable output buffer.
+ * This is internal to the library, which uses it for the gateway heartbeat.
+ *
+ * Values are appended to the buffer as they are written, so no intermediate document is
+ * built, for payloads which are sent often enough that building a json document for each
+ * one costs more than it is worth, such as gateway heartbeats. Strings are escaped as
+ * `json::dump(-1, ' ', false, error_handler_t::replace)` would, so invalid UTF-8 is
+ * replaced with U+FFFD. Clearing the writer keeps the buffer's capacity, so a long lived
+ * writer stops allocating once it has grown to fit the largest payload it serializes.
+ *
+ * Commas and colons are inserted automatically:
+ * ```cpp
+ * w.clear();
+ * w.begin_object().key("op").value(1).key("d").value(seq).end_object();
+ * send(w.str());
+ * ```
+ *
+ * @note The writer does not validate structure; keys must only be written inside objects
+ * and every begin must be matched by an end.
+ */
+class DPP_EXPORT json_writer {
+	/**
+	 * @brief Output buffer
+	 */
+	std::string buffer;
+
+	/**
+	 * @brief True if the next value must be preceded by a comma
+	 */
+	bool need_comma{false};
+
+	/**
+	 * @brief True if a key has just been written, so the next value follows its colon
+	 */
+	bool after_key{false};
+
+	/**
+	 * @brief Write a separator if one is required before the next value
+	 */
+	inline void separator() {
+		if (after_key) {
+			after_key = false;
+		} else if (need_comma) {
+			buffer.push_back(',');
+		}
+		need_comma = true;
+	}
+
+	/**
+	 * @brief Write an unsigned integer without a separator
+	 * @param v value
+	 */
+	void write_unsigned(uint64_t v);
+
+	/**
+	 * @brief Write a signed integer without a separator
+	 * @param v value
+	 */
+	void write_signed(int64_t v);
+
+public:
+	/**
+	 * @brief Construct a new json writer
+	 * @param reserve Initial capacity of the output buffer
+	 */
+	explicit json_writer(size_t reserve = 1024);
+
+	/**
+	 * @brief Begin an object
+	 * @return json_writer& reference to self
+	 */
+	json_writer& begin_object();
+
+	/**
+	 * @brief End the current object
+	 * @return json_writer& reference to self
+	 */
+	json_writer& end_object();
+
+	/**
+	 * @brief Begin an array
+	 * @return json_writer& reference to self
+	 */
+	json_writer& begin_array();
+
+	/**
+	 * @brief End the current array
+	 * @return json_writer& reference to self
+	 */
+	json_writer& end_array();
+
+	/**
+	 * @brief Write the key of the next member of the current object
+	 * @param k key
+	 * @return json_writer& reference to self
+	 */
+	json_writer& key(std::string_view k);
+
+	/**
+	 * @brief Write a string value
+	 * @param v value
+	 * @return json_writer& reference to self
+	 */
+	json_writer& value(std::string_view v);
+
+	/**
+	 * @brief Write a string value
+	 * @param v value, which must be null terminated
+	 * @return json_writer& reference to self
+	 */
+	json_writer& value(const char* v);
+
+	/**
+	 * @brief Write a string value
+	 * @param v value
+	 * @return json_writer& reference to self
+	 */
+	json_writer& value(const std::string& v);
+
+	/**
+	 * @brief Write a boolean value
+	 * @param v value
+	 * @return json_writer& reference to self
+	 */
+	json_writer& value(bool v);
+
+	/**
+	 * @brief Write a floating point value
+	 * @param v value
+	 * @return json_writer& reference to self
+	 */
+	json_writer& value(double v);
+
+	/**
+	 * @brief Write a null value
+	 * @return json_writer& reference to self
+	 */
+	json_writer& value(std::nullptr_t);
+
+	/**
+	 * @brief Write an integer value
+	 * @tparam T integral type, other than bool
+	 * @param v value
+	 * @return json_writer& reference to self
+	 */
+	template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+	json_writer& value(T v) {
+		separator();
+		if constexpr (std::is_signed_v<T>) {
+			write_signed(static_cast<int64_t>(v));
+		} else {
+			write_unsigned(static_cast<uint64_t>(v));
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Get the output written so far
+	 * @return const std::string& output buffer
+	 */
+	const std::string& str() const;
+
+	/**
+	 * @brief Clear the output, keeping the buffer's capacity
+	 */
+	void clear();
+
+	/**
+	 * @brief Append a string to a buffer as an escaped, quoted JSON string.
+	 * Runs of characters which need no escaping are found sixteen bytes at a time
+	 * using SIMD where the platform supports it.
+	 *
+	 * @param out buffer to append to
+	 * @param s string to escape
+	 */
+	static void escape_string(std::string& out, std::string_view s);
+};
+
+}
+
+}
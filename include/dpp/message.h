@@ -195,6 +195,12 @@ struct message_file_data {
 	 */
 	std::string content{};
 
+	/**
+	 * @brief Source to stream the file content from when uploading, instead of content.
+	 * If this is set, content is ignored.
+	 */
+	std::shared_ptr<upload_source> source{};
+
 	/**
 	 * @brief Mime type of files to upload.
 	 *
@@ -2940,6 +2946,18 @@ public:
 	 */
 	message& add_file(std::string_view filename, std::string_view filecontent, std::string_view filemimetype = "");
 
+	/**
+	 * @brief Add a file to the message, whose content is streamed from an upload source
+	 * when the message is sent rather than being held in memory.
+	 *
+	 * @param filename filename
+	 * @param source source of the file content, e.g. from dpp::upload_source::from_file().
+	 * The same source may be attached to several messages without being copied.
+	 * @param filemimetype optional mime type of the file
+	 * @return message& reference to self
+	 */
+	message& add_file(std::string_view filename, std::shared_ptr<upload_source> source, std::string_view filemimetype = "");
+
 	/**
 	 * @brief Set the message content
 	 * 
@@ -0,0 +1,293 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <dpp/upload_source.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dpp {
+
+/**
+ * @brief An Ogg Opus file, indexed so that its Opus packets can be sent to a voice channel
+ * without decoding or copying them.
+ *
+ * The file is memory mapped where supported (see dpp::upload_source::from_file), and packets
+ * are returned as views into the mapping. One file may be shared by any number of playbacks
+ * on different voice connections at once, e.g. the clips of a soundboard bot.
+ *
+ * Only the first logical stream of the file is read. Packets which span an Ogg page boundary
+ * are rare, and are joined into a small buffer held by the index.
+ *
+ * @see dpp::discord_voice_client::play_ogg_opus
+ */
+class DPP_EXPORT ogg_opus_file {
+public:
+	/**
+	 * @brief The location of one Opus packet
+	 */
+	struct packet_entry {
+		/**
+		 * @brief Offset of the packet in the file, or in the joined packet buffer if joined is true
+		 */
+		uint64_t offset;
+
+		/**
+		 * @brief Length of the packet in bytes
+		 */
+		uint32_t length;
+
+		/**
+		 * @brief Number of samples per channel the packet decodes to, at 48kHz
+		 */
+		uint32_t samples;
+
+		/**
+		 * @brief Position of the start of the packet in the stream, in samples per channel at 48kHz
+		 */
+		uint64_t position;
+
+		/**
+		 * @brief True if the packet spans pages, and is held in the joined packet buffer
+		 */
+		bool joined;
+	};
+
+private:
+	/**
+	 * @brief Content of the file
+	 */
+	std::shared_ptr<upload_source> source;
+
+	/**
+	 * @brief Copy of the content, if the source could not return a view of all of it at once
+	 */
+	std::string content_copy;
+
+	/**
+	 * @brief View of the whole file
+	 */
+	std::string_view content;
+
+	/**
+	 * @brief Packets which span pages, joined together
+	 */
+	std::string joined_packets;
+
+	/**
+	 * @brief Index of audio packets
+	 */
+	std::vector<packet_entry> packets;
+
+	/**
+	 * @brief Channel count from the OpusHead header
+	 */
+	uint8_t channels{0};
+
+	/**
+	 * @brief Pre-skip from the OpusHead header, in samples at 48kHz
+	 */
+	uint16_t pre_skip{0};
+
+	/**
+	 * @brief Parse the Ogg pages of the content, building the packet index
+	 * @throw dpp::voice_exception The content is not an Ogg Opus stream
+	 */
+	void index();
+
+public:
+	/**
+	 * @brief Open and index an Ogg Opus file
+	 * @param path Path of the file
+	 * @throw dpp::file_exception The file could not be opened
+	 * @throw dpp::voice_exception The file is not an Ogg Opus file
+	 */
+	explicit ogg_opus_file(const std::string& path);
+
+	/**
+	 * @brief Index Ogg Opus content from an upload source, e.g. one created with dpp::upload_source::from_memory
+	 * @param source Content of the file
+	 * @throw dpp::voice_exception The content is not an Ogg Opus stream
+	 */
+	explicit ogg_opus_file(std::shared_ptr<upload_source> source);
+
+	/**
+	 * @brief Get the number of audio packets in the file
+	 * @return size_t number of packets
+	 */
+	size_t get_packet_count() const;
+
+	/**
+	 * @brief Get an audio packet
+	 * @param index index of packet, which must be less than get_packet_count()
+	 * @return std::string_view the Opus packet, which is valid for the lifetime of this object
+	 */
+	std::string_view get_packet(size_t index) const;
+
+	/**
+	 * @brief Get the location and length of an audio packet
+	 * @param index index of packet, which must be less than get_packet_count()
+	 * @return const packet_entry& packet details
+	 */
+	const packet_entry& get_packet_entry(size_t index) const;
+
+	/**
+	 * @brief Find the packet playing at a given time from the start of the stream
+	 * @param position_ms time in milliseconds
+	 * @return size_t index of packet, or get_packet_count() if the time is past the end
+	 */
+	size_t find_packet(uint64_t position_ms) const;
+
+	/**
+	 * @brief Get the length of the stream
+	 * @return uint64_t length in milliseconds
+	 */
+	uint64_t get_duration_ms() const;
+
+	/**
+	 * @brief Get the number of channels, from the OpusHead header
+	 * @return uint8_t channel count
+	 */
+	uint8_t get_channels() const;
+
+	/**
+	 * @brief Get the number of samples to discard from the start of the decoded stream, from the OpusHead header
+	 * @return uint16_t pre-skip in samples per channel at 48kHz
+	 */
+	uint16_t get_pre_skip() const;
+
+	/**
+	 * @brief Get the number of samples per channel an Opus packet decodes to, from its TOC byte
+	 * @param packet Opus packet
+	 * @return uint32_t samples per channel at 48kHz, or 0 if the packet is invalid
+	 */
+	static uint32_t packet_samples(std::string_view packet);
+};
+
+
+/**
+ * @brief Writes Opus packets into an Ogg Opus stream, without decoding or re-encoding them.
+ *
+ * The stream is built in memory; take_output() moves out what has been written so far so that
+ * it can be appended to a file, leaving the writer ready to continue. Pages are closed once
+ * they hold about a second of audio, so little is lost if a recording is cut off.
+ *
+ * ```cpp
+ * dpp::ogg_opus_writer w(2);
+ * w.write_packet(packet, dpp::ogg_opus_file::packet_samples(packet));
+ * w.finish();
+ * file << w.take_output();
+ * ```
+ *
+ * @see dpp::discord_voice_client::start_opus_recording
+ */
+class DPP_EXPORT ogg_opus_writer {
+	/**
+	 * @brief Encoded pages not yet taken by take_output()
+	 */
+	std::string output;
+
+	/**
+	 * @brief Lacing values of the page being built
+	 */
+	std::vector<uint8_t> lacing;
+
+	/**
+	 * @brief Body of the page being built
+	 */
+	std::string body;
+
+	/**
+	 * @brief Serial number of the logical stream
+	 */
+	uint32_t serial;
+
+	/**
+	 * @brief Sequence number of the next page
+	 */
+	uint32_t page_sequence{0};
+
+	/**
+	 * @brief Samples per channel written, at 48kHz, which is the granule position of the end of the last packet
+	 */
+	uint64_t granule{0};
+
+	/**
+	 * @brief Samples per channel on the page being built
+	 */
+	uint32_t page_samples{0};
+
+	/**
+	 * @brief True once finish() has been called
+	 */
+	bool finished{false};
+
+	/**
+	 * @brief Encode the page being built onto the output
+	 * @param header_type Ogg header flags of the page
+	 */
+	void flush_page(uint8_t header_type);
+
+public:
+	/**
+	 * @brief Start an Ogg Opus stream, writing its OpusHead and OpusTags headers
+	 * @param channels Number of channels of the packets to be written
+	 * @param serial Serial number of the Ogg logical stream
+	 */
+	explicit ogg_opus_writer(uint8_t channels = 2, uint32_t serial = 1);
+
+	/**
+	 * @brief Append an Opus packet to the stream
+	 * @param packet Opus packet
+	 * @param samples Number of samples per channel the packet decodes to at 48kHz, see ogg_opus_file::packet_samples()
+	 * @throw dpp::voice_exception The packet is too large, or finish() has been called
+	 */
+	void write_packet(std::string_view packet, uint32_t samples);
+
+	/**
+	 * @brief End the stream, closing its last page
+	 */
+	void finish();
+
+	/**
+	 * @brief Get the size of the output not yet taken
+	 * @return size_t size in bytes
+	 */
+	size_t output_size() const;
+
+	/**
+	 * @brief Move out the output written since the last call
+	 * @return std::string complete Ogg pages
+	 */
+	std::string take_output();
+
+	/**
+	 * @brief Get the length of audio written
+	 * @return uint64_t length in samples per channel at 48kHz
+	 */
+	uint64_t get_position() const;
+};
+
+}
@@ -28,6 +28,8 @@
 #include <shared_mutex>
 #include <memory>
 #include <vector>
+#include <array>
+#include <mutex>
 #include <functional>
 #include <atomic>
 #include <condition_variable>		
@@ -105,6 +107,80 @@ enum http_error : uint8_t {
 	h_compression,
 };
 
+/**
+ * @brief Priority classes for REST requests.
+ *
+ * Within each request_concurrency_queue, requests of a lower numeric priority are
+ * dispatched before requests of a higher numeric priority, subject to rate limits.
+ * Requests of the same priority are dispatched in the order they were queued.
+ * While a request is held back by the rate limit of its bucket, the lower priority
+ * requests for that bucket wait behind it, and when the bucket resets only as many
+ * requests as its limit allows are sent, highest priority first.
+ */
+enum request_priority : uint8_t {
+	/**
+	 * @brief Interaction responses and followups, which must arrive within three seconds.
+	 */
+	rp_interaction = 0,
+
+	/**
+	 * @brief User-facing requests such as sending messages. This is the default.
+	 */
+	rp_user = 1,
+
+	/**
+	 * @brief Bulk background work such as role syncs or member fetches.
+	 */
+	rp_background = 2,
+
+	/**
+	 * @brief Number of priority classes. Not a valid priority.
+	 */
+	rp_count = 3,
+};
+
+/**
+ * @brief Latency figures gathered for one request_priority class of a request_queue.
+ */
+struct DPP_EXPORT request_priority_stats {
+	/**
+	 * @brief Number of requests completed in this class.
+	 */
+	uint64_t completed = 0;
+
+	/**
+	 * @brief Total time (seconds) completed requests spent queued before being sent.
+	 */
+	double total_queue_time = 0;
+
+	/**
+	 * @brief Longest time (seconds) any completed request spent queued before being sent.
+	 */
+	double max_queue_time = 0;
+
+	/**
+	 * @brief Total time (seconds) from queueing to completion of completed requests.
+	 */
+	double total_latency = 0;
+
+	/**
+	 * @brief Longest time (seconds) from queueing to completion of any completed request.
+	 */
+	double max_latency = 0;
+
+	/**
+	 * @brief Get the mean time requests in this class spent queued before being sent
+	 * @return double mean queue time in seconds, or zero if no requests have completed
+	 */
+	double average_queue_time() const;
+
+	/**
+	 * @brief Get the mean time from queueing to completion of requests in this class
+	 * @return double mean latency in seconds, or zero if no requests have completed
+	 */
+	double average_latency() const;
+};
+
 /**
  * @brief The result of any HTTP request. Contains the headers, vital
  * rate limit figures, and returned request body.
@@ -166,6 +242,16 @@ struct DPP_EXPORT http_request_completion_t {
 	 * @brief Ping latency.
 	 */
 	double latency;
+
+	/**
+	 * @brief Number of compressed body bytes received, if the response body was compressed.
+	 */
+	uint64_t compressed_bytes = 0;
+
+	/**
+	 * @brief Number of body bytes produced by decompression, if the response body was compressed.
+	 */
+	uint64_t decompressed_bytes = 0;
 };
 
 /**
@@ -300,6 +386,12 @@ public:
 	 */
 	std::vector<std::string> file_mimetypes;
 
+	/**
+	 * @brief Upload file sources to stream content from.
+	 * Where an entry is set, the corresponding file_content entry is ignored.
+	 */
+	std::vector<std::shared_ptr<upload_source>> file_sources;
+
 	/**
 	 * @brief Request mime type.
 	 */
@@ -320,6 +412,22 @@ public:
 	 */
 	std::string protocol;
 
+	/**
+	 * @brief If set, the response body is passed to this function as it arrives,
+	 * and http_request_completion_t::body is empty.
+	 */
+	https_client_body_event body_handler;
+
+	/**
+	 * @brief Priority class of this request.
+	 */
+	request_priority priority{rp_user};
+
+	/**
+	 * @brief Time (from dpp::utility::time_f()) the request was placed into a queue.
+	 */
+	double queued_at{0};
+
 	/**
 	 * @brief Constructor. When constructing one of these objects it should be passed to request_queue::post_request().
 	 * @param _endpoint The API endpoint, e.g. /api/guilds
@@ -475,6 +583,7 @@ public:
 
 	/**
 	 * @brief Queue of requests to be made. Sorted by http_request::endpoint.
+	 * Dispatch order is by http_request::priority, then by time queued.
 	 */
 	std::vector<std::unique_ptr<http_request>> requests_in;
 
@@ -606,6 +715,34 @@ public:
 	 */
 	uint32_t in_queue_pool_size;
 
+	/**
+	 * @brief Mutex for priority_stats
+	 */
+	mutable std::mutex stats_mutex;
+
+	/**
+	 * @brief Total compressed response body bytes received
+	 */
+	std::atomic<uint64_t> compressed_bytes_in{0};
+
+	/**
+	 * @brief Total response body bytes produced by decompression
+	 */
+	std::atomic<uint64_t> decompressed_bytes_in{0};
+
+	/**
+	 * @brief Latency figures for each request_priority class
+	 */
+	std::array<request_priority_stats, rp_count> priority_stats{};
+
+	/**
+	 * @brief Record the latency figures of a completed request
+	 * @param priority Priority class of the request
+	 * @param queue_time Time (seconds) the request spent queued before being sent
+	 * @param latency Time (seconds) from queueing to completion
+	 */
+	void record_latency(request_priority priority, double queue_time, double latency);
+
 	/**
 	 * @brief constructor
 	 * @param owner The creating cluster.
@@ -651,6 +788,25 @@ public:
 	 * @return Total number of active requests
 	 */
 	size_t get_active_request_count() const;
+
+	/**
+	 * @brief Returns the latency figures for a request priority class
+	 * @param priority Priority class to get figures for
+	 * @return request_priority_stats A copy of the figures at the time of the call
+	 */
+	request_priority_stats get_priority_stats(request_priority priority) const;
+
+	/**
+	 * @brief Get the total number of compressed response body bytes received by this queue
+	 * @return uint64_t compressed bytes received
+	 */
+	uint64_t get_compressed_bytes_in() const;
+
+	/**
+	 * @brief Get the total number of response body bytes produced by decompression in this queue
+	 * @return uint64_t decompressed bytes
+	 */
+	uint64_t get_decompressed_bytes_in() const;
 };
 
 }
@@ -23,14 +23,64 @@
 
 #include <dpp/export.h>
 #include <string>
-#include <mutex>
+#include <string_view>
+#include <memory>
+#include <vector>
 
 namespace dpp {
 
 /**
- * @brief Verifies signatures on incoming webhooks using OpenSSL
+ * @brief A parsed Ed25519 public key, opaque outside of the verifier
  */
-class signature_verifier {
+struct ed25519_public_key;
+
+/**
+ * @brief A signed request to verify, for signature_verifier::verify_signatures()
+ */
+struct signed_request {
+	/**
+	 * @brief Timestamp of the request, from the X-Signature-Timestamp header
+	 */
+	std::string_view timestamp;
+
+	/**
+	 * @brief Body of the request
+	 */
+	std::string_view body;
+
+	/**
+	 * @brief Hex encoded signature, from the X-Signature-Ed25519 header
+	 */
+	std::string_view signature;
+};
+
+/**
+ * @brief Verifies signatures on incoming webhooks using OpenSSL.
+ *
+ * The public key given at construction is parsed once and never changes, so it is
+ * read without locking, and each thread reuses its own verification context, so
+ * verifying does not allocate once warmed up. A verifier may be used from several
+ * threads at once.
+ */
+class DPP_EXPORT signature_verifier {
+	/**
+	 * @brief Hex encoded public key given at construction
+	 */
+	const std::string key_hex;
+
+	/**
+	 * @brief Public key parsed at construction, or empty if there is none or it is invalid
+	 */
+	const std::shared_ptr<const ed25519_public_key> key;
+
+	/**
+	 * @brief Get a key, which is the one parsed at construction if it matches,
+	 * otherwise it is parsed for this call only
+	 * @param public_key_hex The hex-encoded public key
+	 * @return std::shared_ptr<const ed25519_public_key> key, or empty if the key is invalid
+	 */
+	std::shared_ptr<const ed25519_public_key> get_key(std::string_view public_key_hex) const;
+
 public:
 	/**
 	 * @brief Constructor initializes the OpenSSL context and public key buffer
@@ -38,7 +88,14 @@ public:
 	signature_verifier();
 
 	/**
-	 * @brief Verifies the signature with the provided public key, timestamp, body, and signature
+	 * @brief Construct a verifier for one public key, which is parsed once up front
+	 * @param public_key_hex The hex-encoded public key
+	 */
+	explicit signature_verifier(std::string_view public_key_hex);
+
+	/**
+	 * @brief Verifies the signature with the provided public key, timestamp, body, and signature.
+	 * The key is only parsed if it is not the one given at construction.
 	 * @param timestamp The timestamp of the request
 	 * @param body The body of the request
 	 * @param signature The hex-encoded signature to verify
@@ -47,7 +104,23 @@ public:
 	 */
 	bool verify_signature(const std::string& timestamp, const std::string& body, const std::string& signature, const std::string& public_key_hex);
 
+	/**
+	 * @brief Verifies the signature with the public key given at construction
+	 * @param timestamp The timestamp of the request
+	 * @param body The body of the request
+	 * @param signature The hex-encoded signature to verify
+	 * @return true if the signature is valid, false otherwise, or if there is no valid public key
+	 */
+	bool verify_signature(std::string_view timestamp, std::string_view body, std::string_view signature) const;
+
+	/**
+	 * @brief Verifies a batch of signatures with the public key given at construction,
+	 * e.g. the requests queued during a burst. The key and verification context are
+	 * looked up once for the whole batch.
+	 * @param requests The requests to verify
+	 * @return std::vector<bool> For each request, true if its signature is valid
+	 */
+	std::vector<bool> verify_signatures(const std::vector<signed_request>& requests) const;
 };
 
 }
-
@@ -28,6 +28,8 @@
 #include <type_traits>
 #include <memory>
 #include <unordered_map>
+#include <atomic>
+#include <cerrno>
 #include <string_view>
 #include <string>
 
@@ -85,6 +87,23 @@ struct socket_listener {
 	 */
 	socket_events events;
 
+	/**
+	 * @brief A spare file descriptor, closed to make room to accept and drop a connection
+	 * when the process or system has run out of file descriptors
+	 */
+	socket spare_fd{INVALID_SOCKET};
+
+	/**
+	 * @brief Number of connections accepted and handed to emplace()
+	 */
+	std::atomic<uint64_t> accepted{0};
+
+	/**
+	 * @brief Number of connections accepted and closed straight away because
+	 * there were no file descriptors left
+	 */
+	std::atomic<uint64_t> dropped{0};
+
 	/**
 	 * @brief Create a new socket listener (TCP server)
 	 * @param owner Owning cluster
@@ -107,6 +126,9 @@ struct socket_listener {
 			// error
 			throw dpp::connection_exception("Could not listen for connections on " + std::string(address) + ":" + std::to_string(port));
 		}
+		/* Non-blocking, so handle_accept() can drain the backlog until it is empty */
+		set_nonblocking(fd.fd, true);
+		spare_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
 		events = dpp::socket_events(
 			fd.fd,
 			WANT_READ | WANT_ERROR,
@@ -127,19 +149,82 @@ struct socket_listener {
 	 * @brief Destructor, detaches on_socket_close event
 	 */
 	~socket_listener() {
-		creator->on_socket_close.detach(close_event);
+		creator->on_socket_close.detach_and_wait(close_event);
+		if (spare_fd != INVALID_SOCKET) {
+			close_socket(spare_fd);
+		}
+	}
+
+	/**
+	 * @brief Get the number of connections accepted since the listener was created
+	 * @return uint64_t accepted connections
+	 */
+	uint64_t get_accepted() const {
+		return accepted.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Get the number of connections dropped since the listener was created,
+	 * because the process or system had run out of file descriptors
+	 * @return uint64_t dropped connections
+	 */
+	uint64_t get_dropped() const {
+		return dropped.load(std::memory_order_relaxed);
 	}
 
 	/**
-	 * @brief Handle a new incoming socket with accept()
-	 * Accepts a new connection, and calls emplace() if valid
+	 * @brief Handle new incoming sockets with accept()
+	 * Accepts connections until the backlog of the listening socket is empty,
+	 * and calls emplace() for each one, so a burst of connections is handled in one wakeup.
+	 * The socket engine only reports the listening socket again when a new connection
+	 * arrives, so the backlog must be emptied even when connections can't be accepted:
+	 * if there are no file descriptors left, they are accepted and closed straight away.
 	 * @param sfd File descriptor for listening socket
 	 * @param e socket events for the listening socket
 	 */
 	virtual void handle_accept(socket sfd, const struct socket_events &e) {
-		socket new_fd{fd.accept()};
-		if (new_fd >= 0) {
-			emplace(new_fd);
+		for (;;) {
+			socket new_fd{fd.accept()};
+			if (new_fd != INVALID_SOCKET) {
+				accepted.fetch_add(1, std::memory_order_relaxed);
+				emplace(new_fd);
+				continue;
+			}
+#ifdef _WIN32
+			const int error = WSAGetLastError();
+			if (error == WSAEMFILE) {
+#else
+			const int error = errno;
+			if (error == EMFILE || error == ENFILE) {
+#endif
+				if (spare_fd == INVALID_SOCKET) {
+					creator->log(ll_error, "Out of file descriptors, unable to accept or drop incoming connections");
+					break;
+				}
+				/* Use the spare descriptor to take the connection off the backlog, then drop it */
+				close_socket(spare_fd);
+				new_fd = fd.accept();
+				if (new_fd != INVALID_SOCKET) {
+					close_socket(new_fd);
+					dropped.fetch_add(1, std::memory_order_relaxed);
+				}
+				spare_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+				creator->log(ll_warning, "Out of file descriptors, dropped an incoming connection");
+				if (new_fd == INVALID_SOCKET) {
+					break;
+				}
+				continue;
+			}
+#ifdef _WIN32
+			if (error == WSAEINTR || error == WSAECONNRESET) {
+#else
+			if (error == EINTR || error == ECONNABORTED) {
+#endif
+				/* The connection was dropped before it was accepted, try the next one */
+				continue;
+			}
+			/* The backlog is empty (EAGAIN/EWOULDBLOCK), or the listening socket has failed */
+			break;
 		}
 	}
 
@@ -235,6 +235,10 @@ protected:
 	 */
 	void do_raw_trace(const std::string& message) const;
 
+	/**
+	 * @brief Called when the output buffer has been emptied into the socket.
+	 * Derived classes may call socket_write() from here to queue more output.
+	 */
 	virtual void on_buffer_drained();
 
 	/**
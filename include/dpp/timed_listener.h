@@ -92,12 +92,43 @@ public:
 		}, duration, on_end);
 	}
 
+	/**
+	 * @brief Construct a new timed listener object which only receives events with a certain key,
+	 * e.g. reactions to one message. The event router looks the listener up by key, so it costs
+	 * nothing for events with other keys.
+	 * 
+	 * @param cl Owning cluster
+	 * @param _duration Duration of timed event in seconds
+	 * @param event Event to hook, e.g. cluster.on_message_reaction_add. The event must have a key.
+	 * @param key Key of the events to receive, see event_router_t::attach_key(). If empty, all events are received.
+	 * @param listener Lambda to receive events. Type must match up properly with that passed into the 'event' parameter.
+	 * @param on_end An optional void() lambda to trigger when the timed_listener times out.
+	 * Calling the destructor before the timeout is reached does not call this lambda.
+	 * @throw dpp::logic_exception The event has no key
+	 */
+	timed_listener(cluster* cl, uint64_t _duration, attached_event& event, const std::string& key, listening_function listener, timer_callback_t on_end = {})
+	: owner(cl), duration(_duration), ev(event)
+	{
+		/* Attach event */
+		listener_handle = key.empty() ? ev(listener) : ev.attach_key(key, listener);
+		/* Create timer */
+		th = cl->start_timer([this]([[maybe_unused]] dpp::timer timer_handle) {
+			/* Timer has finished, detach it from event.
+			 * Only allowed to tick once.
+			 */
+			ev.detach(listener_handle);
+			owner->stop_timer(th);
+		}, duration, on_end);
+	}
+
 	/**
 	 * @brief Destroy the timed listener object
 	 */
 	~timed_listener() {
-		/* Stop timer and detach event, but do not call on_end */
-		ev.detach(listener_handle);
+		/* Stop timer and detach event, but do not call on_end. Wait for the listener
+		 * to return on other threads, as what it captured is about to be destroyed.
+		 */
+		ev.detach_and_wait(listener_handle);
 		owner->stop_timer(th);
 	}
 };
@@ -0,0 +1,99 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <memory>
+
+namespace dpp {
+
+/**
+ * @brief The content of a file to be uploaded, which is streamed into the socket
+ * in chunks rather than held in memory as a whole string.
+ *
+ * Upload sources are shared by reference, so one source may be attached to many
+ * messages at once (e.g. the same attachment sent to several channels) without
+ * being copied. Sources must be safe to read from several threads at once.
+ */
+class DPP_EXPORT upload_source {
+public:
+	/**
+	 * @brief Destroy the upload source, releasing any file descriptor or mapping it owns
+	 */
+	virtual ~upload_source() = default;
+
+	/**
+	 * @brief Get the total size of the content
+	 * @return uint64_t size in bytes
+	 */
+	virtual uint64_t size() const = 0;
+
+	/**
+	 * @brief Read part of the content
+	 *
+	 * @param offset Offset from the start of the content to read from
+	 * @param length Maximum number of bytes to read
+	 * @param scratch A buffer the source may read into, if it cannot return a view of
+	 * its own memory. The returned view is valid until scratch is next modified.
+	 * @return std::string_view The bytes read. This is shorter than length only at the
+	 * end of the content or on error, and empty past the end of the content.
+	 */
+	virtual std::string_view read(uint64_t offset, size_t length, std::string& scratch) const = 0;
+
+	/**
+	 * @brief Create an upload source from a file on disk.
+	 * Where supported the file is memory mapped, otherwise it is read on demand.
+	 *
+	 * @param path Path of the file
+	 * @return std::shared_ptr<upload_source> new upload source
+	 * @throw dpp::file_exception The file could not be opened
+	 */
+	static std::shared_ptr<upload_source> from_file(const std::string& path);
+
+	/**
+	 * @brief Create an upload source from an open file descriptor.
+	 * The content is read on demand from the descriptor at absolute offsets, so the
+	 * file position of the descriptor is not relied upon.
+	 *
+	 * @param fd File descriptor, which must refer to a regular file
+	 * @param take_ownership If true, the descriptor is closed when the source is destroyed
+	 * @return std::shared_ptr<upload_source> new upload source
+	 * @throw dpp::file_exception The size of the file could not be determined
+	 */
+	static std::shared_ptr<upload_source> from_fd(int fd, bool take_ownership = false);
+
+	/**
+	 * @brief Create an upload source from a region of memory, such as a memory mapping.
+	 * The memory is never copied as a whole.
+	 *
+	 * @param data Start of the memory region
+	 * @param length Length of the memory region in bytes
+	 * @param keep_alive Optional owner of the memory, held until the source is destroyed.
+	 * If this is empty, you must ensure the memory outlives all requests using the source.
+	 * @return std::shared_ptr<upload_source> new upload source
+	 */
+	static std::shared_ptr<upload_source> from_memory(const void* data, size_t length, std::shared_ptr<const void> keep_alive = {});
+};
+
+}
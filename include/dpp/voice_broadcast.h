@@ -0,0 +1,134 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace dpp {
+
+class discord_voice_client;
+
+namespace detail {
+	struct voice_broadcast_state;
+}
+
+/**
+ * @brief Plays one audio source into many voice connections, encoding it only once.
+ *
+ * A radio or announcement bot playing the same audio in many guilds would otherwise encode
+ * it with Opus once per connection. A broadcast encodes raw audio once, and each subscribed
+ * voice connection only adds its own RTP header and encryption (including DAVE) to the
+ * encoded packet.
+ *
+ * ```cpp
+ * dpp::voice_broadcast radio;
+ * radio.subscribe(event.voice_client);
+ * radio.send_audio_raw(pcm, dpp::send_audio_raw_max_length);
+ * ```
+ *
+ * A voice connection leaves every broadcast it is subscribed to when it is closed, so it is
+ * safe to delete either the broadcast or its subscribers at any time.
+ *
+ * @note Audio is only passed to subscribers which are ready to send audio. A connection
+ * joining part way through hears the broadcast from that point on.
+ */
+class DPP_EXPORT voice_broadcast {
+	/**
+	 * @brief Subscribers and Opus encoder, shared with the subscribed voice clients
+	 */
+	std::shared_ptr<detail::voice_broadcast_state> state;
+
+public:
+	/**
+	 * @brief Create a new voice broadcast with no subscribers
+	 * @throw dpp::voice_exception Voice support is not compiled into D++, or the Opus encoder could not be created
+	 */
+	voice_broadcast();
+
+	/**
+	 * @brief Destroy the voice broadcast. Audio already queued on subscribers still plays.
+	 */
+	~voice_broadcast();
+
+	/**
+	 * @brief Voice broadcasts are not copyable
+	 */
+	voice_broadcast(const voice_broadcast&) = delete;
+
+	/**
+	 * @brief Voice broadcasts are not copyable
+	 */
+	voice_broadcast& operator=(const voice_broadcast&) = delete;
+
+	/**
+	 * @brief Add a voice connection to the broadcast. Adding a connection which is already subscribed does nothing.
+	 * @param client voice connection
+	 * @return voice_broadcast& Reference to self
+	 */
+	voice_broadcast& subscribe(discord_voice_client* client);
+
+	/**
+	 * @brief Remove a voice connection from the broadcast. Audio already queued on it still plays.
+	 * @param client voice connection
+	 * @return voice_broadcast& Reference to self
+	 */
+	voice_broadcast& unsubscribe(discord_voice_client* client);
+
+	/**
+	 * @brief Get the number of subscribed voice connections
+	 * @return size_t number of subscribers
+	 */
+	size_t get_subscriber_count() const;
+
+	/**
+	 * @brief Encode raw audio once and send it to every subscriber.
+	 * Takes the same audio as dpp::discord_voice_client::send_audio_raw().
+	 *
+	 * @param audio_data Raw PCM audio data, 48000Hz signed 16 bit stereo with the channels interleaved
+	 * @param length The length of the audio data in bytes, which should be a multiple of 4.
+	 * Audio longer than `send_audio_raw_max_length` is split, and shorter audio is padded with silence.
+	 * @return voice_broadcast& Reference to self
+	 * @throw dpp::voice_exception If data length is invalid
+	 */
+	voice_broadcast& send_audio_raw(uint16_t* audio_data, const size_t length);
+
+	/**
+	 * @brief Send an already encoded Opus packet to every subscriber
+	 * @param opus_packet Opus packet, encoded at 48000Hz
+	 * @param length Length of the packet
+	 * @return voice_broadcast& Reference to self
+	 */
+	voice_broadcast& send_audio_opus(const uint8_t* opus_packet, const size_t length);
+
+	/**
+	 * @brief Insert a track marker into the audio queued on every subscriber
+	 * @see dpp::discord_voice_client::insert_marker
+	 * @param metadata Arbitrary information related to the track
+	 * @return voice_broadcast& Reference to self
+	 */
+	voice_broadcast& insert_marker(const std::string& metadata = "");
+};
+
+}
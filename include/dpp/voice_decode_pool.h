@@ -0,0 +1,132 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace dpp {
+
+class discord_voice_client;
+
+/**
+ * @brief A fixed size pool of threads which decode, mix and deliver received voice audio
+ * for many voice connections, in place of one courier thread per connection.
+ *
+ * A voice connection is scheduled onto the pool when it receives audio, and one of the
+ * pool's threads delivers everything it has received once the flush interval has passed.
+ * A connection is only ever handled by one thread at a time, so the order of its audio is
+ * kept. Enable the pool with dpp::cluster::set_voice_decode_pool().
+ */
+struct DPP_EXPORT voice_decode_pool {
+	/**
+	 * @brief Threads that comprise the pool
+	 */
+	std::vector<std::thread> threads;
+
+	/**
+	 * @brief Voice connections waiting to be flushed, by the time they are due
+	 */
+	std::multimap<std::chrono::steady_clock::time_point, discord_voice_client*> due;
+
+	/**
+	 * @brief Voice connections being flushed right now
+	 */
+	std::set<discord_voice_client*> running;
+
+	/**
+	 * @brief Mutex for accessing due and running
+	 */
+	std::mutex queue_mutex;
+
+	/**
+	 * @brief Condition variable to notify when a connection is scheduled
+	 */
+	std::condition_variable cv;
+
+	/**
+	 * @brief Condition variable to notify when a connection has been flushed
+	 */
+	std::condition_variable flushed;
+
+	/**
+	 * @brief Time between a connection receiving audio and that audio being delivered
+	 */
+	std::chrono::milliseconds flush_interval;
+
+	/**
+	 * @brief True if the pool is due to stop
+	 */
+	bool stop{false};
+
+	/**
+	 * @brief Flushes a voice connection, returning true if it has more audio and should be scheduled again
+	 */
+	std::function<bool(discord_voice_client*)> flush;
+
+	/**
+	 * @brief Create a new voice decode pool
+	 * @param creator creating cluster (for logging)
+	 * @param num_threads number of threads in the pool
+	 * @param flush_interval_ms time in milliseconds between a connection receiving audio and that audio being delivered
+	 */
+	voice_decode_pool(class cluster* creator, size_t num_threads, uint16_t flush_interval_ms);
+
+	/**
+	 * @brief Create a new voice decode pool which flushes connections with the given function, in place of
+	 * each connection's own. The function is called for a connection on one thread at a time.
+	 * @param creator creating cluster (for logging)
+	 * @param num_threads number of threads in the pool
+	 * @param flush_interval_ms time in milliseconds between a connection receiving audio and that audio being delivered
+	 * @param flush_connection flushes a connection, returning true if it should be scheduled again
+	 */
+	voice_decode_pool(class cluster* creator, size_t num_threads, uint16_t flush_interval_ms, std::function<bool(discord_voice_client*)> flush_connection);
+
+	/**
+	 * @brief Destroy the pool. Connections still waiting are not flushed.
+	 */
+	~voice_decode_pool();
+
+	/**
+	 * @brief Schedule a voice connection to be flushed after the flush interval.
+	 * The caller must ensure it is not already scheduled or running.
+	 * @param client voice connection
+	 */
+	void schedule(discord_voice_client* client);
+
+	/**
+	 * @brief Remove a voice connection from the pool, waiting for it to finish if a thread is flushing it.
+	 * After this returns, the pool no longer refers to the connection, even if the flush it waited for
+	 * had more audio to deliver.
+	 * @param client voice connection
+	 */
+	void cancel(discord_voice_client* client);
+};
+
+}
@@ -0,0 +1,255 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+#include <dpp/export.h>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace dpp {
+
+class audio_mixer;
+
+/**
+ * @brief Options of a source of audio mixed by a voice_mixer
+ */
+struct DPP_EXPORT voice_mixer_source_options {
+	/**
+	 * @brief Gain applied to the source, 1.0 to leave it unchanged
+	 */
+	float gain{1.0f};
+
+	/**
+	 * @brief True if the other sources are ducked while this source has audio, e.g. for speech over music
+	 */
+	bool ducks_others{false};
+
+	/**
+	 * @brief Multiplier of gain while this source is ducked by another, 1.0 to never duck it
+	 */
+	float ducked_gain{0.25f};
+};
+
+/**
+ * @brief Mixes several sources of 48kHz 16 bit stereo audio into one, 20ms at a time,
+ * using the SIMD audio_mixer kernels.
+ *
+ * Each source has its own gain, and a source marked as ducking others lowers the gain of
+ * the rest while it has audio. Gain changes, ducking and removal are faded over one frame,
+ * so they do not click. A frame is only mixed from the sources which have a whole frame of
+ * audio waiting, so audio sent a little at a time is not padded with silence, unless the
+ * source is flushed or removed.
+ *
+ * This is what discord_voice_client::add_mixer_source() mixes with. It is not thread safe.
+ */
+class DPP_EXPORT voice_mixer {
+	/**
+	 * @brief A source of audio
+	 */
+	struct source {
+		/**
+		 * @brief ID returned by add_source()
+		 */
+		uint32_t id{0};
+
+		/**
+		 * @brief Gain and ducking
+		 */
+		voice_mixer_source_options options;
+
+		/**
+		 * @brief Audio waiting to be mixed, from read_pos onwards
+		 */
+		std::vector<int16_t> pcm;
+
+		/**
+		 * @brief Index of the first value of pcm not yet mixed
+		 */
+		size_t read_pos{0};
+
+		/**
+		 * @brief Gain at the end of the last frame mixed, which the next frame fades from
+		 */
+		float current_gain{0.0f};
+
+		/**
+		 * @brief False until the first frame is mixed, which starts at the source's gain rather than fading in
+		 */
+		bool started{false};
+
+		/**
+		 * @brief True once flushed, so less than a frame of audio is mixed, until it runs out
+		 */
+		bool flushing{false};
+
+		/**
+		 * @brief True once removed, so the source fades out over one more frame
+		 */
+		bool removed{false};
+
+		/**
+		 * @brief Get the number of values waiting to be mixed
+		 * @return size_t values
+		 */
+		size_t buffered() const {
+			return pcm.size() - read_pos;
+		}
+
+		/**
+		 * @brief Get the number of values the next frame takes from this source
+		 * @return size_t values, 0 if the source sits this frame out
+		 */
+		size_t next_frame_values() const;
+	};
+
+	/**
+	 * @brief Sources, in the order they were added
+	 */
+	std::vector<source> sources;
+
+	/**
+	 * @brief ID of the next source to be added
+	 */
+	uint32_t next_id{1};
+
+	/**
+	 * @brief SIMD mixing kernels
+	 */
+	std::unique_ptr<audio_mixer> kernel;
+
+	/**
+	 * @brief Sum of the sources of the frame being mixed
+	 */
+	std::vector<int32_t> mix;
+
+	/**
+	 * @brief Audio of one source, widened to 32 bits for the kernels
+	 */
+	std::vector<int32_t> widened;
+
+	/**
+	 * @brief Audio of one source, with its gain applied
+	 */
+	std::vector<int16_t> scaled;
+
+	/**
+	 * @brief Last mixed frame, clipped to 16 bits
+	 */
+	std::vector<int16_t> out;
+
+	/**
+	 * @brief Find a source which has not been removed
+	 * @param id ID of source
+	 * @return source* source, or nullptr if there is none
+	 */
+	source* find(uint32_t id);
+
+public:
+	/**
+	 * @brief Samples per channel in each mixed frame, 20ms at 48kHz
+	 */
+	static constexpr size_t frame_samples = 960;
+
+	/**
+	 * @brief Interleaved values in each mixed frame
+	 */
+	static constexpr size_t frame_values = frame_samples * 2;
+
+	/**
+	 * @brief Construct a mixer with no sources
+	 */
+	voice_mixer();
+
+	/**
+	 * @brief Destroy the mixer
+	 */
+	~voice_mixer();
+
+	voice_mixer(const voice_mixer&) = delete;
+	voice_mixer& operator=(const voice_mixer&) = delete;
+
+	/**
+	 * @brief Add a source
+	 * @param options Gain and ducking of the source
+	 * @return uint32_t ID of the source
+	 */
+	uint32_t add_source(const voice_mixer_source_options& options = {});
+
+	/**
+	 * @brief Remove a source. The audio of the source fades out over the next frame, and the rest of it is discarded.
+	 * @param id ID of the source
+	 * @return true if the source was found
+	 */
+	bool remove_source(uint32_t id);
+
+	/**
+	 * @brief Change the gain and ducking of a source
+	 * @param id ID of the source
+	 * @param options New options of the source
+	 * @return true if the source was found
+	 */
+	bool set_source_options(uint32_t id, const voice_mixer_source_options& options);
+
+	/**
+	 * @brief Append audio to a source, to be mixed after the audio already sent to it
+	 * @param id ID of the source
+	 * @param samples Interleaved stereo samples
+	 * @param count Number of values, two per sample
+	 * @return true if the source was found
+	 */
+	bool send_audio(uint32_t id, const int16_t* samples, size_t count);
+
+	/**
+	 * @brief Mix the audio a source has waiting even if it is less than a frame, padding it with silence,
+	 * e.g. at the end of a sound. Audio sent to the source afterwards waits for whole frames again.
+	 * @param id ID of the source
+	 * @return true if the source was found
+	 */
+	bool flush_source(uint32_t id);
+
+	/**
+	 * @brief Get how much audio a source has waiting to be mixed
+	 * @param id ID of the source
+	 * @return size_t number of values, 0 if the source does not exist
+	 */
+	size_t get_buffered(uint32_t id);
+
+	/**
+	 * @brief Discard the audio waiting in every source, keeping the sources
+	 */
+	void clear();
+
+	/**
+	 * @brief Mix the next frame from the sources with enough audio waiting
+	 * @return true if a frame was mixed, false if no source has a frame of audio waiting
+	 */
+	bool mix_frame();
+
+	/**
+	 * @brief Get the last frame mixed by mix_frame()
+	 * @return const int16_t* frame_values interleaved stereo samples
+	 */
+	const int16_t* get_frame() const;
+};
+
+}
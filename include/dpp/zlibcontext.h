@@ -23,6 +23,8 @@
 #include <dpp/exception.h>
 #include <cstdint>
 #include <vector>
+#include <string>
+#include <string_view>
 #include <memory>
 
 /**
@@ -62,12 +64,33 @@ public:
 	 */
 	uint64_t decompressed_total{};
 
+	/**
+	 * @brief True until the first two bytes of an HTTP body have been seen, which tell
+	 * a zlib or gzip header apart from raw deflate data
+	 */
+	bool detect_format{false};
+
+	/**
+	 * @brief The first byte of an HTTP body, kept if it arrived on its own while detect_format is set
+	 */
+	std::string header_bytes{};
+
 	/**
 	 * @brief Initialise zlib struct via inflateInit()
 	 * and size the buffer
 	 */
 	zlibcontext();
 
+	/**
+	 * @brief Initialise zlib struct via inflateInit2()
+	 * and size the buffer
+	 * @param accept_gzip If true, gzip streams are accepted as well as zlib streams,
+	 * as used for HTTP Content-Encoding. Raw deflate data with neither header is accepted too,
+	 * as some servers send this for `Content-Encoding: deflate` in place of a zlib stream.
+	 * @param buffer_size Size of the decompression buffer
+	 */
+	zlibcontext(bool accept_gzip, size_t buffer_size = DECOMP_BUFFER_SIZE);
+
 	/**
 	 * @brief Destroy zlib struct via inflateEnd()
 	 */
@@ -79,7 +102,16 @@ public:
 	 * @param decompressed output decompressed content
 	 * @return an error code on error, or err_no_code_specified (0) on success
 	 */
-	exception_error_code decompress(const std::string& buffer, std::string& decompressed);
+	exception_error_code decompress(std::string_view buffer, std::string& decompressed);
+
+private:
+	/**
+	 * @brief Inflate input into the decompression buffer, appending the output
+	 * @param buffer input compressed stream
+	 * @param decompressed output decompressed content is appended to this
+	 * @return an error code on error, or err_no_code_specified (0) on success
+	 */
+	exception_error_code inflate_input(std::string_view buffer, std::string& decompressed);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/dpp.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/**
+ * Compares allocating coroutine frames from the thread-local frame pool with
+ * the global allocator, for nested tasks, async calls and jobs which all complete
+ * synchronously. Run with an optional iteration count.
+ */
+
+#ifndef DPP_NO_CORO
+
+namespace {
+
+size_t sink = 0;
+
+dpp::task<int> leaf(int n) {
+	co_return n;
+}
+
+dpp::task<int> nested_tasks(size_t iterations) {
+	int sum = 0;
+	for (size_t n = 0; n < iterations; ++n) {
+		sum += co_await leaf(static_cast<int>(n));
+	}
+	co_return sum;
+}
+
+dpp::task<int> async_calls(size_t iterations) {
+	int sum = 0;
+	for (size_t n = 0; n < iterations; ++n) {
+		sum += co_await dpp::async<int>{[n](std::function<void(int)> callback) {
+			callback(static_cast<int>(n));
+		}};
+	}
+	co_return sum;
+}
+
+dpp::job count_job(size_t* counter) {
+	++*counter;
+	co_return;
+}
+
+template <typename F>
+void measure(const std::string& name, size_t iterations, F&& f) {
+	for (bool pooled : {false, true}) {
+		dpp::set_coroutine_frame_pool(pooled);
+		auto start = std::chrono::steady_clock::now();
+		f();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << name << (pooled ? " (frame pool)    : " : " (global alloc)  : ") << (seconds * 1e9 / iterations) << "ns per coroutine\n";
+	}
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+	size_t iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	if (!dpp::coroutine_frame_pool_enabled()) {
+		std::cout << "Coroutine frame pooling is compiled out, both runs use the global allocator\n";
+	}
+	measure("nested task<int>", iterations, [&]() {
+		sink += nested_tasks(iterations).sync_wait();
+	});
+	measure("async<int>      ", iterations, [&]() {
+		sink += async_calls(iterations).sync_wait();
+	});
+	measure("job             ", iterations, [&]() {
+		size_t counter = 0;
+		for (size_t n = 0; n < iterations; ++n) {
+			count_job(&counter);
+		}
+		sink += counter;
+	});
+	return sink == 0;
+}
+
+#else
+
+int main() {
+	std::cout << "Coroutines are disabled in this build\n";
+	return 0;
+}
+
+#endif
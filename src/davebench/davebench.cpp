@@ -0,0 +1,121 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/dpp.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Measures DAVE end to end encryption of voice frames (AES-128-GCM) in frames per second
+ * on one core, with the cipher context set up and keyed for every frame as it used to be,
+ * and with the key set once per ratchet generation. Run with an optional iteration count.
+ */
+
+#ifdef HAVE_VOICE
+#include <openssl/evp.h>
+#include <bytes/bytes.h>
+#include "../dpp/dave/openssl_aead_cipher.h"
+
+namespace {
+
+/**
+ * Size of a typical 20ms opus voice frame
+ */
+constexpr size_t frame_size = 160;
+
+constexpr size_t nonce_size = 12;
+
+constexpr size_t tag_size = 8;
+
+template <typename F>
+void measure(const std::string& name, size_t frames, F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	bool valid = f();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << static_cast<uint64_t>(frames / seconds) << " frames/s" << (valid ? "" : " (FAILED)") << "\n";
+}
+
+/**
+ * @brief Encrypt a frame the way every frame used to be: set the cipher, nonce length and key, then the nonce
+ */
+bool encrypt_rekeyed(EVP_CIPHER_CTX* ctx, const std::vector<uint8_t>& key, std::vector<uint8_t>& out, const std::vector<uint8_t>& in, const uint8_t* nonce, std::vector<uint8_t>& tag) {
+	int len = 0;
+	return EVP_EncryptInit_ex(ctx, EVP_aes_128_gcm(), nullptr, nullptr, nullptr) != 0
+		&& EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, nonce_size, nullptr) != 0
+		&& EVP_EncryptInit_ex(ctx, nullptr, nullptr, key.data(), nonce) != 0
+		&& EVP_EncryptUpdate(ctx, out.data(), &len, in.data(), static_cast<int>(in.size())) != 0
+		&& EVP_EncryptFinal_ex(ctx, out.data() + len, &len) != 0
+		&& EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, tag_size, tag.data()) != 0;
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+	const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 500000;
+
+	dpp::cluster bot("");
+	std::vector<uint8_t> key(16, 0x5a);
+	std::vector<uint8_t> plaintext(frame_size, 0x42), ciphertext(frame_size), decrypted(frame_size), tag(tag_size);
+	std::vector<uint8_t> nonce(nonce_size, 0);
+
+	measure("Encrypt, keyed every frame      ", iterations, [&]() {
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			nonce[0] = static_cast<uint8_t>(n);
+			valid = encrypt_rekeyed(ctx, key, ciphertext, plaintext, nonce.data(), tag) && valid;
+		}
+		EVP_CIPHER_CTX_free(ctx);
+		return valid;
+	});
+
+	dpp::dave::openssl_aead_cipher cipher(bot, dpp::dave::encryption_key(key));
+	measure("Encrypt, keyed once per ratchet ", iterations, [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			nonce[0] = static_cast<uint8_t>(n);
+			valid = cipher.encrypt(dpp::dave::make_array_view(ciphertext), dpp::dave::make_array_view<const uint8_t>(plaintext.data(), plaintext.size()),
+				dpp::dave::make_array_view<const uint8_t>(nonce.data(), nonce.size()), {}, dpp::dave::make_array_view(tag)) && valid;
+		}
+		return valid;
+	});
+
+	measure("Decrypt, keyed once per ratchet ", iterations, [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			valid = cipher.decrypt(dpp::dave::make_array_view(decrypted), dpp::dave::make_array_view<const uint8_t>(ciphertext.data(), ciphertext.size()),
+				dpp::dave::make_array_view<const uint8_t>(tag.data(), tag.size()), dpp::dave::make_array_view<const uint8_t>(nonce.data(), nonce.size()), {}) && valid;
+		}
+		return valid && decrypted == plaintext;
+	});
+	return 0;
+}
+
+#else
+
+int main() {
+	std::cout << "Voice support is not enabled in this build of D++, so there is nothing to measure\n";
+	return 0;
+}
+
+#endif
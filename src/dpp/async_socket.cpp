@@ -0,0 +1,574 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/async_socket.h>
+
+#ifndef DPP_NO_CORO
+
+#include <dpp/cluster.h>
+#include <dpp/dns.h>
+#include <dpp/exception.h>
+#include <dpp/socketengine.h>
+#include <dpp/sslconnection.h>
+#include <dpp/upload_source.h>
+#include <dpp/coro/async.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <mutex>
+#include <system_error>
+#ifdef _WIN32
+	#include <WinSock2.h>
+	#include <WS2tcpip.h>
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+#endif
+
+namespace dpp {
+
+namespace detail::async_io {
+
+/**
+ * @brief State of an async_socket, shared with its socket engine callbacks and pending operations
+ */
+struct io_state {
+	/**
+	 * @brief Owning cluster
+	 */
+	cluster* owner{nullptr};
+
+	/**
+	 * @brief File descriptor, INVALID_SOCKET once closed
+	 */
+	dpp::socket fd{INVALID_SOCKET};
+
+	/**
+	 * @brief Protects everything below
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief Number of read events received, so an operation can tell if one arrived while it was trying
+	 */
+	uint64_t read_events{0};
+
+	/**
+	 * @brief Number of write events received
+	 */
+	uint64_t write_events{0};
+
+	/**
+	 * @brief Error reported by the socket engine, or 0
+	 */
+	int error{0};
+
+	/**
+	 * @brief True once close() has been called
+	 */
+	bool closed{false};
+
+	/**
+	 * @brief Coroutine waiting for a read event
+	 */
+	std_coroutine::coroutine_handle<> read_waiter{};
+
+	/**
+	 * @brief Coroutine waiting for a write event
+	 */
+	std_coroutine::coroutine_handle<> write_waiter{};
+};
+
+namespace {
+
+/**
+ * @brief Get the error code of the last failed socket call
+ * @return int error code
+ */
+int last_error() {
+#ifdef _WIN32
+	return WSAGetLastError();
+#else
+	return errno;
+#endif
+}
+
+/**
+ * @brief Check if an error code means the operation should be retried when the socket is ready
+ * @param error error code
+ * @return true if the socket would have blocked
+ */
+bool would_block(int error) {
+#ifdef _WIN32
+	return error == WSAEWOULDBLOCK;
+#else
+	return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+/**
+ * @brief Check if an error code means the call was interrupted and can be retried straight away
+ * @param error error code
+ * @return true if interrupted
+ */
+bool interrupted(int error) {
+#ifdef _WIN32
+	return error == WSAEINTR;
+#else
+	return error == EINTR;
+#endif
+}
+
+/**
+ * @brief Describe a socket error code
+ * @param error error code
+ * @return std::string description
+ */
+std::string describe(int error) {
+	return std::system_category().message(error);
+}
+
+/**
+ * @brief Resume a coroutine on the cluster's thread pool, so that the socket engine thread is never used to run user code
+ * @param owner cluster
+ * @param handle coroutine, which may be empty
+ */
+void resume_later(cluster* owner, std_coroutine::coroutine_handle<> handle) {
+	if (handle) {
+		owner->queue_work(0, [handle]() {
+			handle.resume();
+		});
+	}
+}
+
+/**
+ * @brief Record an event from the socket engine and resume any coroutine waiting for it
+ * @param weak state, which may have been destroyed already
+ * @param readable true for a read event
+ * @param writable true for a write event
+ * @param error error code for an error event, otherwise 0
+ */
+void notify(const std::weak_ptr<io_state>& weak, bool readable, bool writable, int error) {
+	std::shared_ptr<io_state> state = weak.lock();
+	if (!state) {
+		return;
+	}
+	detail::std_coroutine::coroutine_handle<> reader{};
+	detail::std_coroutine::coroutine_handle<> writer{};
+	{
+		std::lock_guard lock(state->mutex);
+		if (error != 0) {
+			state->error = error;
+		}
+		if (readable) {
+			++state->read_events;
+			reader = std::exchange(state->read_waiter, nullptr);
+		}
+		if (writable) {
+			++state->write_events;
+			writer = std::exchange(state->write_waiter, nullptr);
+		}
+	}
+	resume_later(state->owner, reader);
+	resume_later(state->owner, writer);
+}
+
+/**
+ * @brief Start an attempt at an operation: get the file descriptor and the current event count
+ * @param state socket state
+ * @param write true for a write operation
+ * @return std::pair<dpp::socket, uint64_t> file descriptor and event count to wait past if the attempt would block
+ * @throw dpp::connection_exception if the socket was closed
+ */
+std::pair<dpp::socket, uint64_t> begin_attempt(io_state& state, bool write) {
+	std::lock_guard lock(state.mutex);
+	if (state.closed) {
+		throw dpp::connection_exception(err_invalid_socket, "Socket was closed");
+	}
+	return {state.fd, write ? state.write_events : state.read_events};
+}
+
+/**
+ * @brief Throw if the socket engine has reported an error, called before waiting for an event which would then never arrive
+ * @param state socket state
+ * @throw dpp::connection_exception if an error was reported
+ */
+void throw_if_failed(io_state& state) {
+	std::lock_guard lock(state.mutex);
+	if (state.error != 0) {
+		throw dpp::connection_exception(err_socket_error, describe(state.error));
+	}
+}
+
+/**
+ * @brief Awaiter resuming once the socket engine delivers an event after the one an attempt started at
+ */
+struct readiness {
+	/**
+	 * @brief Socket state
+	 */
+	std::shared_ptr<io_state> state;
+
+	/**
+	 * @brief True to wait for a write event, false for a read event
+	 */
+	bool write;
+
+	/**
+	 * @brief Event count when the attempt started
+	 */
+	uint64_t seen;
+
+	/**
+	 * @brief Check whether the awaited event has already happened. Must be called with the mutex held.
+	 * @return true if there is no need to wait
+	 */
+	bool happened() const {
+		return state->closed || state->error != 0 || (write ? state->write_events : state->read_events) != seen;
+	}
+
+	bool await_ready() const {
+		std::lock_guard lock(state->mutex);
+		return happened();
+	}
+
+	bool await_suspend(std_coroutine::coroutine_handle<> handle) {
+		/* Once the handle is stored the coroutine may be resumed on another thread and this awaiter destroyed, so copy what is needed after that */
+		std::shared_ptr<io_state> s = state;
+		const bool want_write = write;
+		dpp::socket fd;
+		{
+			std::lock_guard lock(s->mutex);
+			if (happened()) {
+				return false;
+			}
+			(want_write ? s->write_waiter : s->read_waiter) = handle;
+			fd = s->fd;
+		}
+		if (want_write) {
+			/* Write events are one-shot, so ask for the next one */
+			s->owner->socketengine->inplace_modify_fd(fd, WANT_WRITE);
+		}
+		return true;
+	}
+
+	void await_resume() const noexcept {
+	}
+};
+
+/**
+ * @brief Data read from a file by a thread pool worker
+ */
+struct file_read_result {
+	/**
+	 * @brief Bytes read
+	 */
+	std::string data;
+
+	/**
+	 * @brief Exception thrown by the read, if any
+	 */
+	std::exception_ptr error;
+};
+
+/**
+ * @brief Socket and address to connect to, made by a thread pool worker
+ */
+struct resolve_result {
+	/**
+	 * @brief Socket to connect, or INVALID_SOCKET if it could not be made
+	 */
+	dpp::socket fd{INVALID_SOCKET};
+
+	/**
+	 * @brief Address to connect to
+	 */
+	address_t destination;
+
+	/**
+	 * @brief Exception thrown by the lookup, if any
+	 */
+	std::exception_ptr error;
+};
+
+dpp::task<size_t> do_read(std::shared_ptr<io_state> state, void* buffer, size_t length) {
+	for (;;) {
+		auto [fd, seen] = begin_attempt(*state, false);
+#ifdef _WIN32
+		int r = ::recv(fd, static_cast<char*>(buffer), static_cast<int>(std::min<size_t>(length, INT_MAX)), 0);
+#else
+		ssize_t r = ::recv(fd, buffer, length, 0);
+#endif
+		if (r >= 0) {
+			co_return static_cast<size_t>(r);
+		}
+		const int error = last_error();
+		if (interrupted(error)) {
+			continue;
+		}
+		if (!would_block(error)) {
+			throw dpp::connection_exception(err_socket_error, "recv() failed: " + describe(error));
+		}
+		throw_if_failed(*state);
+		co_await readiness{state, false, seen};
+	}
+}
+
+dpp::task<size_t> do_write(std::shared_ptr<io_state> state, std::string_view data) {
+	size_t done = 0;
+	while (done < data.size()) {
+		auto [fd, seen] = begin_attempt(*state, true);
+#ifdef _WIN32
+		int r = ::send(fd, data.data() + done, static_cast<int>(std::min<size_t>(data.size() - done, INT_MAX)), 0);
+#else
+		ssize_t r = ::send(fd, data.data() + done, data.size() - done, 0);
+#endif
+		if (r >= 0) {
+			done += static_cast<size_t>(r);
+			continue;
+		}
+		const int error = last_error();
+		if (interrupted(error)) {
+			continue;
+		}
+		if (!would_block(error)) {
+			throw dpp::connection_exception(err_write, "send() failed: " + describe(error));
+		}
+		throw_if_failed(*state);
+		co_await readiness{state, true, seen};
+	}
+	co_return done;
+}
+
+dpp::task<async_socket> do_accept(std::shared_ptr<io_state> state) {
+	for (;;) {
+		auto [fd, seen] = begin_attempt(*state, false);
+		dpp::socket client = ::accept(fd, nullptr, nullptr);
+		if (client != INVALID_SOCKET) {
+			co_return async_socket(state->owner, client);
+		}
+		const int error = last_error();
+#ifndef _WIN32
+		if (interrupted(error) || error == ECONNABORTED) {
+#else
+		if (interrupted(error) || error == WSAECONNRESET) {
+#endif
+			/* The connection was dropped before it was accepted, try the next one */
+			continue;
+		}
+		if (!would_block(error)) {
+			throw dpp::connection_exception(err_socket_error, "accept() failed: " + describe(error));
+		}
+		throw_if_failed(*state);
+		co_await readiness{state, false, seen};
+	}
+}
+
+}
+
+}
+
+async_socket::async_socket(cluster* owner, dpp::socket fd) : state(std::make_shared<detail::async_io::io_state>()) {
+	state->owner = owner;
+	state->fd = fd;
+	if (!set_nonblocking(fd, true)) {
+		close_socket(fd);
+		throw dpp::connection_exception(err_nonblocking_failure, "Can't switch socket to non-blocking mode!");
+	}
+	std::weak_ptr<detail::async_io::io_state> weak = state;
+	socket_events events(
+		fd,
+		WANT_READ | WANT_ERROR,
+		[weak](dpp::socket, const socket_events&) {
+			detail::async_io::notify(weak, true, false, 0);
+		},
+		[weak](dpp::socket, const socket_events&) {
+			detail::async_io::notify(weak, false, true, 0);
+		},
+		[weak](dpp::socket, const socket_events&, int error_code) {
+			/* Wake both directions, so that neither waits forever on a socket which has failed */
+			detail::async_io::notify(weak, true, true, error_code != 0 ? error_code : EIO);
+		}
+	);
+	if (!owner->socketengine->register_socket(events)) {
+		close_socket(fd);
+		throw dpp::connection_exception(err_invalid_socket, "Unable to register socket with the socket engine");
+	}
+}
+
+async_socket& async_socket::operator=(async_socket&& rhs) noexcept {
+	if (this != &rhs) {
+		close();
+		state = std::move(rhs.state);
+	}
+	return *this;
+}
+
+async_socket::~async_socket() {
+	close();
+}
+
+task<async_socket> async_socket::connect(cluster* owner, std::string hostname, uint16_t port) {
+	/* Name lookups block, so they are done by a thread pool worker rather than the awaiting coroutine's thread */
+	detail::async_io::resolve_result resolved = co_await dpp::async<detail::async_io::resolve_result>{[owner, &hostname, port](std::function<void(detail::async_io::resolve_result)> callback) {
+		owner->queue_work(0, [hostname, port, callback = std::move(callback)]() {
+			detail::async_io::resolve_result r;
+			try {
+				const dns_cache_entry* addr = resolve_hostname(hostname, std::to_string(port));
+				r.destination = addr->get_connecting_address(port);
+				r.fd = addr->make_connecting_socket();
+				if (r.fd == INVALID_SOCKET) {
+					throw dpp::connection_exception(err_connect_failure, "Unable to create socket: " + detail::async_io::describe(detail::async_io::last_error()));
+				}
+			}
+			catch (const std::exception&) {
+				r.error = std::current_exception();
+			}
+			callback(std::move(r));
+		});
+	}};
+	if (resolved.error) {
+		std::rethrow_exception(resolved.error);
+	}
+	const dpp::socket fd = resolved.fd;
+	address_t& destination = resolved.destination;
+	async_socket sock(owner, fd);
+	auto [unused, seen] = detail::async_io::begin_attempt(*sock.state, true);
+	if (::connect(fd, destination.get_socket_address(), static_cast<socklen_t>(destination.size())) != 0) {
+		const int error = detail::async_io::last_error();
+		if (error != EINPROGRESS && !detail::async_io::would_block(error)) {
+			throw dpp::connection_exception(err_connect_failure, "connect() to " + hostname + " failed: " + detail::async_io::describe(error));
+		}
+		/* The first write event on a connecting socket means connect() has finished, one way or the other */
+		co_await detail::async_io::readiness{sock.state, true, seen};
+		detail::async_io::begin_attempt(*sock.state, true);
+		int result{0};
+		socklen_t result_size = sizeof(result);
+		if (getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&result), &result_size) != 0) {
+			result = detail::async_io::last_error();
+		}
+		if (result != 0) {
+			throw dpp::connection_exception(err_connect_failure, "connect() to " + hostname + " failed: " + detail::async_io::describe(result));
+		}
+	}
+	co_return sock;
+}
+
+async_socket async_socket::listen(cluster* owner, std::string_view address, uint16_t port) {
+	dpp::socket fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (fd == INVALID_SOCKET) {
+		throw dpp::connection_exception(err_connect_failure, "Unable to create socket: " + detail::async_io::describe(detail::async_io::last_error()));
+	}
+	int reuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+	/* address_t needs a null terminated string */
+	const std::string ip{address};
+	address_t bind_address(ip, port);
+	if (::bind(fd, bind_address.get_socket_address(), static_cast<socklen_t>(bind_address.size())) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+		const int error = detail::async_io::last_error();
+		close_socket(fd);
+		throw dpp::connection_exception(err_bind_failure, "Unable to listen on " + ip + ":" + std::to_string(port) + ": " + detail::async_io::describe(error));
+	}
+	return async_socket(owner, fd);
+}
+
+task<async_socket> async_socket::accept() {
+	if (!state) {
+		throw dpp::connection_exception(err_invalid_socket, "Socket is not open");
+	}
+	return detail::async_io::do_accept(state);
+}
+
+task<size_t> async_socket::read(void* buffer, size_t length) {
+	if (!state) {
+		throw dpp::connection_exception(err_invalid_socket, "Socket is not open");
+	}
+	return detail::async_io::do_read(state, buffer, length);
+}
+
+task<size_t> async_socket::write(std::string_view data) {
+	if (!state) {
+		throw dpp::connection_exception(err_invalid_socket, "Socket is not open");
+	}
+	return detail::async_io::do_write(state, data);
+}
+
+void async_socket::close() {
+	if (!state) {
+		return;
+	}
+	std::shared_ptr<detail::async_io::io_state> s = std::move(state);
+	detail::std_coroutine::coroutine_handle<> reader{};
+	detail::std_coroutine::coroutine_handle<> writer{};
+	dpp::socket fd;
+	{
+		std::lock_guard lock(s->mutex);
+		s->closed = true;
+		fd = std::exchange(s->fd, INVALID_SOCKET);
+		reader = std::exchange(s->read_waiter, nullptr);
+		writer = std::exchange(s->write_waiter, nullptr);
+	}
+	if (fd != INVALID_SOCKET) {
+		s->owner->socketengine->delete_socket(fd);
+		close_socket(fd);
+	}
+	detail::async_io::resume_later(s->owner, reader);
+	detail::async_io::resume_later(s->owner, writer);
+}
+
+bool async_socket::is_open() const {
+	return state != nullptr;
+}
+
+dpp::socket async_socket::get_fd() const {
+	return state ? state->fd : INVALID_SOCKET;
+}
+
+task<std::string> async_read_file(cluster* owner, std::string path, uint64_t offset, size_t length) {
+	detail::async_io::file_read_result result = co_await dpp::async<detail::async_io::file_read_result>{[owner, &path, offset, length](std::function<void(detail::async_io::file_read_result)> callback) {
+		owner->queue_work(0, [path, offset, length, callback = std::move(callback)]() {
+			detail::async_io::file_read_result r;
+			try {
+				std::shared_ptr<upload_source> source = upload_source::from_file(path);
+				std::string scratch;
+				std::string_view data = source->read(offset, length, scratch);
+				if (!data.empty() && data.data() == scratch.data()) {
+					scratch.resize(data.size());
+					r.data = std::move(scratch);
+				} else {
+					r.data.assign(data);
+				}
+			}
+			catch (const std::exception&) {
+				r.error = std::current_exception();
+			}
+			callback(std::move(r));
+		});
+	}};
+	if (result.error) {
+		std::rethrow_exception(result.error);
+	}
+	co_return std::move(result.data);
+}
+
+}
+
+#endif
@@ -23,6 +23,8 @@
 #include <dpp/cluster.h>
 #include <chrono>
 #include <iostream>
+#include <optional>
+#include <fstream>
 #include <dpp/json.h>
 #include <dpp/discord_webhook_server.h>
 
@@ -36,6 +38,12 @@ namespace dpp {
  */
 thread_local std::string audit_reason;
 
+/**
+ * @brief A request priority for the next REST call on each thread, set by
+ * cluster::set_request_priority. Empty if none has been set.
+ */
+thread_local std::optional<request_priority> next_request_priority;
+
 /**
  * @brief Make a warning lambda for missing message intents
  *
@@ -121,6 +129,23 @@ cluster::cluster(const std::string &_token, uint32_t _intents, uint32_t _shards,
 			"You have attached an event to cluster::on_message_update() but have not specified the privileged intent dpp::i_message_content. Message content, embeds, attachments, and components on received guild messages will be empty.")
 	);
 
+	/* Keys for events which are commonly awaited or collected for one component, channel or message */
+	on_button_click.set_key_function([](const button_click_t& event) {
+		return event.custom_id;
+	});
+	on_select_click.set_key_function([](const select_click_t& event) {
+		return event.custom_id;
+	});
+	on_form_submit.set_key_function([](const form_submit_t& event) {
+		return event.custom_id;
+	});
+	on_message_create.set_key_function([](const message_create_t& event) {
+		return event.msg.channel_id.str();
+	});
+	on_message_reaction_add.set_key_function([](const message_reaction_add_t& event) {
+		return event.message_id.str();
+	});
+
 	/* Add slashcommand callback for named commands. */
 #ifndef DPP_NO_CORO
 	on_slashcommand([this](const slashcommand_t& event) -> task<void> {
@@ -519,8 +544,25 @@ json error_response(const std::string& message, http_request_completion_t& rv)
 	return j;
 }
 
+namespace {
+
+/**
+ * @brief Returns true if a REST endpoint is an interaction response or followup.
+ * Followups are sent via the application's own webhook, which has the same id as the bot.
+ *
+ * @param endpoint Endpoint being posted to
+ * @param major_parameters Major parameters of the endpoint
+ * @param me Current bot user
+ * @return True if the request belongs to an interaction
+ */
+bool is_interaction_endpoint(const std::string &endpoint, const std::string &major_parameters, const user& me) {
+	return endpoint == API_PATH "/interactions" || (endpoint == API_PATH "/webhooks" && !me.id.empty() && major_parameters == me.id.str());
+}
+
+}
+
 void cluster::post_rest(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::string &filename, const std::string &filecontent, const std::string &filemimetype, const std::string &protocol) {
-	rest->post_request(std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
+	auto req = std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
 		json j;
 		if (rv.error == h_success && !rv.body.empty()) {
 			try {
@@ -533,21 +575,27 @@ void cluster::post_rest(const std::string &endpoint, const std::string &major_pa
 		if (callback) {
 			callback(j, rv);
 		}
-	}, postdata, method, get_audit_reason(), filename, filecontent, filemimetype, protocol));
+	}, postdata, method, get_audit_reason(), filename, filecontent, filemimetype, protocol);
+	req->priority = get_request_priority(is_interaction_endpoint(endpoint, major_parameters, me));
+	rest->post_request(std::move(req));
 }
 
 void cluster::post_rest_multipart(const std::string &endpoint, const std::string &major_parameters, const std::string &parameters, http_method method, const std::string &postdata, json_encode_t callback, const std::vector<message_file_data> &file_data) {
 	std::vector<std::string> file_names{};
 	std::vector<std::string> file_contents{};
 	std::vector<std::string> file_mimetypes{};
+	std::vector<std::shared_ptr<upload_source>> file_sources{};
+	bool has_sources{false};
 
 	for(const message_file_data& data : file_data) {
 		file_names.push_back(data.name);
-		file_contents.push_back(data.content);
+		file_contents.push_back(data.source ? std::string() : data.content);
 		file_mimetypes.push_back(data.mimetype);
+		file_sources.push_back(data.source);
+		has_sources = has_sources || data.source;
 	}
 
-	rest->post_request(std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
+	auto req = std::make_unique<http_request>(endpoint + (!major_parameters.empty() ? "/" : "") + major_parameters, parameters, [endpoint, callback](http_request_completion_t rv) {
 		json j;
 		if (rv.error == h_success && !rv.body.empty()) {
 			try {
@@ -560,12 +608,49 @@ void cluster::post_rest_multipart(const std::string &endpoint, const std::string
 		if (callback) {
 			callback(j, rv);
 		}
-	}, postdata, method, get_audit_reason(), file_names, file_contents, file_mimetypes));
+	}, postdata, method, get_audit_reason(), file_names, file_contents, file_mimetypes);
+	if (has_sources) {
+		req->file_sources = std::move(file_sources);
+	}
+	req->priority = get_request_priority(is_interaction_endpoint(endpoint, major_parameters, me));
+	rest->post_request(std::move(req));
 }
 
 
 void cluster::request(const std::string &url, http_method method, http_completion_event callback, const std::string &postdata, const std::string &mimetype, const std::multimap<std::string, std::string> &headers, const std::string &protocol) {
-	raw_rest->post_request(std::make_unique<http_request>(url, callback, method, postdata, mimetype, headers, protocol));
+	auto req = std::make_unique<http_request>(url, callback, method, postdata, mimetype, headers, protocol);
+	req->priority = get_request_priority();
+	raw_rest->post_request(std::move(req));
+}
+
+void cluster::request_stream(const std::string &url, http_method method, https_client_body_event on_body, http_completion_event callback, const std::string &postdata, const std::string &mimetype, const std::multimap<std::string, std::string> &headers, const std::string &protocol) {
+	auto req = std::make_unique<http_request>(url, callback, method, postdata, mimetype, headers, protocol);
+	req->body_handler = std::move(on_body);
+	req->priority = get_request_priority();
+	raw_rest->post_request(std::move(req));
+}
+
+void cluster::request_to_file(const std::string &url, const std::string &path, http_completion_event callback, const std::multimap<std::string, std::string> &headers, const std::string &protocol) {
+	auto file = std::make_shared<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+	if (!file->is_open()) {
+		throw dpp::file_exception(err_unknown, "Unable to open " + path + " for writing");
+	}
+	request_stream(url, m_get, [file](std::string_view data) {
+		file->write(data.data(), static_cast<std::streamsize>(data.length()));
+	}, [file, callback](const http_request_completion_t& completion) {
+		file->close();
+		if (file->fail() && completion.error == h_success) {
+			http_request_completion_t failed{completion};
+			failed.error = h_write;
+			if (callback) {
+				callback(failed);
+			}
+			return;
+		}
+		if (callback) {
+			callback(completion);
+		}
+	}, "", "text/plain", headers, protocol);
 }
 
 gateway::gateway() : shards(0), session_start_total(0), session_start_remaining(0), session_start_reset_after(0), session_start_max_concurrency(0) {
@@ -610,6 +695,22 @@ cluster& cluster::clear_audit_reason() {
 	return *this;
 }
 
+cluster& cluster::set_request_priority(request_priority priority) {
+	next_request_priority = priority;
+	return *this;
+}
+
+cluster& cluster::set_default_request_priority(request_priority priority) {
+	default_request_priority = priority;
+	return *this;
+}
+
+request_priority cluster::get_request_priority(bool interaction) {
+	request_priority p = next_request_priority.value_or(interaction ? rp_interaction : default_request_priority);
+	next_request_priority.reset();
+	return p;
+}
+
 cluster& cluster::set_default_gateway(const std::string &default_gateway_new) {
 	default_gateway = default_gateway_new;
 	return *this;
@@ -640,6 +741,15 @@ cluster& cluster::set_request_timeout(uint16_t timeout) {
 	return *this;
 }
 
+cluster& cluster::set_voice_decode_pool(uint32_t threads, uint16_t flush_interval_ms) {
+	if (threads == 0) {
+		voice_decoders.reset();
+	} else {
+		voice_decoders = std::make_shared<voice_decode_pool>(this, threads, flush_interval_ms);
+	}
+	return *this;
+}
+
 bool cluster::unregister_command(const std::string &name) {
 	std::unique_lock lk(named_commands_mutex);
 	return named_commands.erase(name) == 1;
@@ -891,4 +891,8 @@ dpp::async<dpp::http_request_completion_t> dpp::cluster::co_request(const std::s
 	return async<http_request_completion_t>{ [&, this] <typename C> (C &&cc) { return this->request(url, method, std::forward<C>(cc), postdata, mimetype, headers, protocol); }};
 }
 
+dpp::async<dpp::http_request_completion_t> dpp::cluster::co_request_to_file(const std::string &url, const std::string &path, const std::multimap<std::string, std::string> &headers, const std::string &protocol) {
+	return async<http_request_completion_t>{ [&, this] <typename C> (C &&cc) { return this->request_to_file(url, path, std::forward<C>(cc), headers, protocol); }};
+}
+
 #endif
@@ -0,0 +1,191 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/coro/frame_pool.h>
+#include <array>
+#include <atomic>
+#include <new>
+
+namespace dpp {
+
+namespace detail::frame_pool {
+
+namespace {
+
+/**
+ * @brief Size classes are multiples of this many bytes
+ */
+constexpr size_t granularity = 64;
+
+/**
+ * @brief Largest allocation served from the free lists, larger ones go straight to the global allocator
+ */
+constexpr size_t max_pooled_size = 4096;
+
+/**
+ * @brief Number of size classes
+ */
+constexpr size_t class_count = max_pooled_size / granularity;
+
+/**
+ * @brief Most memory a thread keeps in its free lists, anything freed beyond this goes back to the global allocator.
+ * Frames are often freed on a different thread than the one that allocated them, so this stops one thread hoarding them.
+ */
+constexpr size_t max_retained_bytes = 1024 * 1024;
+
+/**
+ * @brief Runtime switch, see set_coroutine_frame_pool()
+ */
+std::atomic<bool> pool_enabled{true};
+
+/**
+ * @brief Set once this thread's free lists have been destroyed at thread exit
+ */
+thread_local bool cache_destroyed{false};
+
+/**
+ * @brief A free block, linked through its first bytes
+ */
+struct free_block {
+	free_block* next;
+};
+
+/**
+ * @brief Free lists of one thread
+ */
+class local_cache {
+	/**
+	 * @brief Head of the free list of each size class
+	 */
+	std::array<free_block*, class_count> heads{};
+
+	/**
+	 * @brief Bytes held across all free lists
+	 */
+	size_t retained{0};
+
+public:
+	local_cache() = default;
+
+	local_cache(const local_cache&) = delete;
+
+	local_cache& operator=(const local_cache&) = delete;
+
+	/**
+	 * @brief Take a block from a free list
+	 * @param index size class
+	 * @return void* block, or nullptr if the list is empty
+	 */
+	void* pop(size_t index) noexcept {
+		free_block* block = heads[index];
+		if (block) {
+			heads[index] = block->next;
+			retained -= (index + 1) * granularity;
+		}
+		return block;
+	}
+
+	/**
+	 * @brief Put a block on a free list
+	 * @param ptr block
+	 * @param index size class
+	 * @return true if the block was kept, false if the thread already holds as much as it may
+	 */
+	bool push(void* ptr, size_t index) noexcept {
+		const size_t size = (index + 1) * granularity;
+		if (retained + size > max_retained_bytes) {
+			return false;
+		}
+		heads[index] = new (ptr) free_block{heads[index]};
+		retained += size;
+		return true;
+	}
+
+	~local_cache() {
+		cache_destroyed = true;
+		for (free_block* head : heads) {
+			while (head) {
+				free_block* next = head->next;
+				::operator delete(head);
+				head = next;
+			}
+		}
+	}
+};
+
+/**
+ * @brief Get this thread's free lists
+ * @return local_cache& free lists
+ */
+local_cache& cache() noexcept {
+	thread_local local_cache c;
+	return c;
+}
+
+/**
+ * @brief Check whether the free lists of this thread may be used
+ * @return true if pooling is enabled and the thread is not exiting
+ */
+bool use_cache() noexcept {
+	return pool_enabled.load(std::memory_order_relaxed) && !cache_destroyed;
+}
+
+}
+
+void* allocate(size_t size) {
+	if (size == 0 || size > max_pooled_size) {
+		return ::operator new(size);
+	}
+	const size_t index = (size - 1) / granularity;
+	if (use_cache()) {
+		if (void* ptr = cache().pop(index)) {
+			return ptr;
+		}
+	}
+	/* Always allocate the whole size class, so that the block can go on a free list when it is freed whatever the switch says then */
+	return ::operator new((index + 1) * granularity);
+}
+
+void deallocate(void* ptr, size_t size) noexcept {
+	if (ptr == nullptr) {
+		return;
+	}
+	if (size > 0 && size <= max_pooled_size && use_cache() && cache().push(ptr, (size - 1) / granularity)) {
+		return;
+	}
+	::operator delete(ptr);
+}
+
+}
+
+void set_coroutine_frame_pool(bool enabled) noexcept {
+	detail::frame_pool::pool_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool coroutine_frame_pool_enabled() noexcept {
+#ifdef DPP_NO_CORO_FRAME_POOL
+	return false;
+#else
+	return detail::frame_pool::pool_enabled.load(std::memory_order_relaxed);
+#endif
+}
+
+}
@@ -30,19 +30,22 @@ namespace dpp::dave {
 
 openssl_aead_cipher::openssl_aead_cipher(dpp::cluster& _creator, const encryption_key& key) :
 	cipher_interface(_creator),
-	ssl_context(EVP_CIPHER_CTX_new()),
+	encrypt_context(EVP_CIPHER_CTX_new()),
+	decrypt_context(EVP_CIPHER_CTX_new()),
 	aes_key(std::vector(key.data(), key.data() + key.size())) {
 }
 
 openssl_aead_cipher::~openssl_aead_cipher() {
-	EVP_CIPHER_CTX_free(ssl_context);
+	EVP_CIPHER_CTX_free(encrypt_context);
+	EVP_CIPHER_CTX_free(decrypt_context);
 }
 
-bool openssl_aead_cipher::encrypt(byte_view ciphertext_buffer_out, const_byte_view plaintext_buffer, const_byte_view nonce_buffer, const_byte_view additional_data, byte_view tag_buffer_out) {
-	
-	int len{};
+bool openssl_aead_cipher::set_key(EVP_CIPHER_CTX* context, bool encrypting) {
+	if (context == nullptr) {
+		return false;
+	}
 
-	if (EVP_EncryptInit_ex(ssl_context, EVP_aes_128_gcm(), nullptr, nullptr, nullptr) == 0) {
+	if (EVP_CipherInit_ex(context, EVP_aes_128_gcm(), nullptr, nullptr, nullptr, encrypting ? 1 : 0) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -50,13 +53,33 @@ bool openssl_aead_cipher::encrypt(byte_view ciphertext_buffer_out, const_byte_vi
 	/*
 	 * Set IV length
 	 */
-	if (EVP_CIPHER_CTX_ctrl(ssl_context, EVP_CTRL_GCM_SET_IVLEN, AES_GCM_128_NONCE_BYTES, nullptr) == 0) {
+	if (EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_IVLEN, AES_GCM_128_NONCE_BYTES, nullptr) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
 
-	/* Initialise key and IV */
-	if (EVP_EncryptInit_ex(ssl_context, nullptr, nullptr, aes_key.data(), nonce_buffer.data()) == 0) {
+	/* Initialise key, expanding the key schedule which is kept for every frame after */
+	if (EVP_CipherInit_ex(context, nullptr, nullptr, aes_key.data(), nullptr, encrypting ? 1 : 0) == 0) {
+		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
+		return false;
+	}
+
+	return true;
+}
+
+bool openssl_aead_cipher::encrypt(byte_view ciphertext_buffer_out, const_byte_view plaintext_buffer, const_byte_view nonce_buffer, const_byte_view additional_data, byte_view tag_buffer_out) {
+	
+	int len{};
+
+	if (!encrypt_keyed) {
+		encrypt_keyed = set_key(encrypt_context, true);
+		if (!encrypt_keyed) {
+			return false;
+		}
+	}
+
+	/* Initialise IV, keeping the key */
+	if (EVP_EncryptInit_ex(encrypt_context, nullptr, nullptr, nullptr, nonce_buffer.data()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -65,7 +88,7 @@ bool openssl_aead_cipher::encrypt(byte_view ciphertext_buffer_out, const_byte_vi
 	 * Provide any AAD data. This can be called zero or more times as
 	 * required
 	 */
-	if (EVP_EncryptUpdate(ssl_context, nullptr, &len, additional_data.data(), (int)additional_data.size()) == 0) {
+	if (EVP_EncryptUpdate(encrypt_context, nullptr, &len, additional_data.data(), (int)additional_data.size()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -74,7 +97,7 @@ bool openssl_aead_cipher::encrypt(byte_view ciphertext_buffer_out, const_byte_vi
 	 * Provide the message to be encrypted, and obtain the encrypted output.
 	 * EVP_EncryptUpdate can be called multiple times if necessary
 	 */
-	if (EVP_EncryptUpdate(ssl_context, ciphertext_buffer_out.data(), &len, plaintext_buffer.data(), (int)plaintext_buffer.size()) == 0) {
+	if (EVP_EncryptUpdate(encrypt_context, ciphertext_buffer_out.data(), &len, plaintext_buffer.data(), (int)plaintext_buffer.size()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -83,13 +106,13 @@ bool openssl_aead_cipher::encrypt(byte_view ciphertext_buffer_out, const_byte_vi
 	 * Finalise the encryption. Normally ciphertext bytes may be written at
 	 * this stage, but this does not occur in GCM mode
 	 */
-	if (EVP_EncryptFinal_ex(ssl_context, ciphertext_buffer_out.data() + len, &len) == 0) {
+	if (EVP_EncryptFinal_ex(encrypt_context, ciphertext_buffer_out.data() + len, &len) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
 
 	/* Get the tag */
-	if (EVP_CIPHER_CTX_ctrl(ssl_context, EVP_CTRL_GCM_GET_TAG, AES_GCM_127_TRUNCATED_TAG_BYTES, tag_buffer_out.data()) == 0) {
+	if (EVP_CIPHER_CTX_ctrl(encrypt_context, EVP_CTRL_GCM_GET_TAG, AES_GCM_127_TRUNCATED_TAG_BYTES, tag_buffer_out.data()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -101,20 +124,15 @@ bool openssl_aead_cipher::decrypt(byte_view plaintext_buffer_out, const_byte_vie
 
 	int len = 0;
 
-	/* Initialise the decryption operation. */
-	if (EVP_DecryptInit_ex(ssl_context, EVP_aes_128_gcm(), nullptr, nullptr, nullptr) == 0) {
-		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
-		return false;
-	}
-
-	/* Set IV length. Not necessary if this is 12 bytes (96 bits) */
-	if (EVP_CIPHER_CTX_ctrl(ssl_context, EVP_CTRL_GCM_SET_IVLEN, AES_GCM_128_NONCE_BYTES, nullptr) == 0) {
-		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
-		return false;	
+	if (!decrypt_keyed) {
+		decrypt_keyed = set_key(decrypt_context, false);
+		if (!decrypt_keyed) {
+			return false;
+		}
 	}
 
-	/* Initialise key and IV */
-	if (EVP_DecryptInit_ex(ssl_context, nullptr, nullptr, aes_key.data(), nonce_buffer.data()) == 0) {
+	/* Initialise IV, keeping the key */
+	if (EVP_DecryptInit_ex(decrypt_context, nullptr, nullptr, nullptr, nonce_buffer.data()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -123,7 +141,7 @@ bool openssl_aead_cipher::decrypt(byte_view plaintext_buffer_out, const_byte_vie
 	 * Provide any AAD data. This can be called zero or more times as
 	 * required
 	 */
-	if (EVP_DecryptUpdate(ssl_context, nullptr, &len, additional_data.data(), (int)additional_data.size()) == 0) {
+	if (EVP_DecryptUpdate(decrypt_context, nullptr, &len, additional_data.data(), (int)additional_data.size()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -132,13 +150,13 @@ bool openssl_aead_cipher::decrypt(byte_view plaintext_buffer_out, const_byte_vie
 	 * Provide the message to be decrypted, and obtain the plaintext output.
 	 * EVP_DecryptUpdate can be called multiple times if necessary
 	 */
-	if (EVP_DecryptUpdate(ssl_context, plaintext_buffer_out.data(), &len, ciphertext_buffer.data(), (int)ciphertext_buffer.size()) == 0) {
+	if (EVP_DecryptUpdate(decrypt_context, plaintext_buffer_out.data(), &len, ciphertext_buffer.data(), (int)ciphertext_buffer.size()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
 
 	/* Set expected tag value. Works in OpenSSL 1.0.1d and later */
-	if (EVP_CIPHER_CTX_ctrl(ssl_context, EVP_CTRL_GCM_SET_TAG, AES_GCM_127_TRUNCATED_TAG_BYTES, (void*)tag_buffer.data()) == 0) {
+	if (EVP_CIPHER_CTX_ctrl(decrypt_context, EVP_CTRL_GCM_SET_TAG, AES_GCM_127_TRUNCATED_TAG_BYTES, (void*)tag_buffer.data()) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
@@ -147,7 +165,7 @@ bool openssl_aead_cipher::decrypt(byte_view plaintext_buffer_out, const_byte_vie
 	 * Finalise the decryption. A positive return value indicates success,
 	 * anything else is a failure - the plaintext is not trustworthy.
 	 */
-	if (EVP_DecryptFinal_ex(ssl_context, plaintext_buffer_out.data() + len, &len) == 0) {
+	if (EVP_DecryptFinal_ex(decrypt_context, plaintext_buffer_out.data() + len, &len) == 0) {
 		creator.log(dpp::ll_warning, "SSL Error: " + std::to_string(ERR_get_error()));
 		return false;
 	}
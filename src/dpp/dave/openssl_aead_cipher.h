@@ -37,6 +37,10 @@ namespace dpp::dave {
  *
  * Replaces the boringSSL AES cipher in the Discord implementation, so we don't
  * have a conflicting dependency.
+ *
+ * A cipher lives for one key ratchet generation, so the AES key schedule is set up
+ * once, the first time the cipher encrypts or decrypts, and each frame after that
+ * only sets its nonce.
  */
 class openssl_aead_cipher : public cipher_interface { // NOLINT
 public:
@@ -58,7 +62,7 @@ public:
 	 * @return True if valid
 	 */
 	[[nodiscard]] bool inline is_valid() const {
-		return ssl_context != nullptr;
+		return encrypt_context != nullptr && decrypt_context != nullptr;
 	}
 
 	/**
@@ -85,9 +89,32 @@ public:
 
 private:
 	/**
-	 * @brief Using EVP_CIPHER_CTX instead of EVP_AEAD_CTX
+	 * @brief Set up a context with the cipher, nonce length and key
+	 * @param context context to set up
+	 * @param encrypting true for an encryption context, false for decryption
+	 * @return true on success
+	 */
+	bool set_key(EVP_CIPHER_CTX* context, bool encrypting);
+
+	/**
+	 * @brief Encryption context. Using EVP_CIPHER_CTX instead of EVP_AEAD_CTX
+	 */
+	EVP_CIPHER_CTX* encrypt_context;
+
+	/**
+	 * @brief Decryption context
+	 */
+	EVP_CIPHER_CTX* decrypt_context;
+
+	/**
+	 * @brief True once set_key() has set up encrypt_context
+	 */
+	bool encrypt_keyed{false};
+
+	/**
+	 * @brief True once set_key() has set up decrypt_context
 	 */
-	EVP_CIPHER_CTX* ssl_context;
+	bool decrypt_keyed{false};
 
 	/**
 	 * @brief Encryption/decryption key
@@ -23,32 +23,106 @@
 #include <dpp/signature_verifier.h>
 #include <dpp/discordevents.h>
 #include <dpp/dispatcher.h>
+#include <atomic>
 #include <memory>
 
 namespace dpp {
 
+namespace {
+
+/**
+ * @brief Sends interaction responses from event handlers as the HTTP response
+ */
+class webhook_response : public detail::interaction_webhook_response {
+	/**
+	 * @brief Deferred HTTP response
+	 */
+	http_server_deferred_response http;
+
+	/**
+	 * @brief Type of the automatic acknowledgement, once it has been sent
+	 */
+	std::shared_ptr<std::atomic<uint8_t>> acknowledged;
+
+public:
+	webhook_response(http_server_deferred_response deferred, std::shared_ptr<std::atomic<uint8_t>> automatic_ack) : http(std::move(deferred)), acknowledged(std::move(automatic_ack)) {
+	}
+
+	bool respond(const std::string& json) override {
+		return http.complete(200, json, {{"Content-Type", "application/json"}});
+	}
+
+	uint8_t get_automatic_ack() const override {
+		return acknowledged->load();
+	}
+};
+
+/**
+ * @brief Get the type of response which acknowledges an interaction without answering it yet
+ * @param interaction_type type of interaction
+ * @return interaction_response_type type of response
+ */
+interaction_response_type automatic_ack(uint64_t interaction_type) {
+	switch (interaction_type) {
+		case it_application_command:
+		case it_modal_submit:
+			return ir_deferred_channel_message_with_source;
+		case it_component_button:
+			return ir_deferred_update_message;
+		case it_autocomplete:
+			return ir_autocomplete_reply;
+		default:
+			return ir_pong;
+	}
+}
+
+/**
+ * @brief Get the response which acknowledges an interaction without answering it yet
+ * @param ack_type type of response, from automatic_ack()
+ * @return std::string JSON interaction response
+ */
+std::string automatic_ack_json(interaction_response_type ack_type) {
+	if (ack_type == ir_autocomplete_reply) {
+		return R"({"type":8,"data":{"choices":[]}})";
+	}
+	return R"({"type":)" + std::to_string(ack_type) + "}";
+}
+
+}
+
 discord_webhook_server::discord_webhook_server(cluster* owner, const std::string& discord_public_key, const std::string_view address, uint16_t port, const std::string& ssl_private_key, const std::string& ssl_public_key)
- : http_server(owner, address, port, [this](http_server_request* request) { handle_request(request); }, ssl_private_key, ssl_public_key), public_key_hex(discord_public_key)
+ : http_server(owner, address, port, [this](http_server_request* request) { handle_request(request); }, ssl_private_key, ssl_public_key), verifier(discord_public_key), public_key_hex(discord_public_key)
 {
 }
 
 void discord_webhook_server::handle_request(http_server_request* request) {
-	std::string signature = request->get_header("X-Signature-Ed25519");
-	std::string timestamp = request->get_header("X-Signature-Timestamp");
+	std::string_view signature = request->get_header_view("X-Signature-Ed25519");
+	std::string_view timestamp = request->get_header_view("X-Signature-Timestamp");
+	const std::string body = request->get_request_body();
 	if (signature.empty() || timestamp.empty()) {
 		request->set_status(401).set_response_header("Content-Type", "text/plain").set_response_body("Unsigned requests are not allowed");
 		return;
 	}
-	if (!verifier.verify_signature(timestamp, request->get_request_body(), signature, public_key_hex)) {
+	if (!verifier.verify_signature(timestamp, body, signature)) {
 		request->set_status(401).set_response_header("Content-Type", "text/plain").set_response_body("Access denied");
 		return;
 	}
 
-	json j = json::parse(request->get_request_body());
-	std::string reply_body = events::internal_handle_interaction(creator, 0, j, request->get_request_body(), true);
+	json j = json::parse(body);
+	const interaction_response_type ack_type = automatic_ack(int64_not_null(&j, "type"));
+	auto acknowledged = std::make_shared<std::atomic<uint8_t>>(0);
+	auto response = std::make_shared<webhook_response>(request->defer(ack_timeout, [ack_type, acknowledged](http_server_request* timed_out) {
+		/* Set before any late reply can see the response is completed, as both hold the deferred response's lock */
+		acknowledged->store(ack_type);
+		timed_out->set_status(200).set_response_header("Content-Type", "application/json").set_response_body(automatic_ack_json(ack_type));
+	}), acknowledged);
 
-	request->set_status(200).set_response_header("Content-Type", "application/json")
-		.set_response_body(reply_body);
+	/* The request may be answered, and its connection reused, as soon as a handler replies */
+	std::string reply_body = events::internal_handle_interaction(creator, 0, j, body, true, response);
+	if (!reply_body.empty()) {
+		/* No handler was called, e.g. for a ping */
+		response->respond(reply_body);
+	}
 }
 
 }
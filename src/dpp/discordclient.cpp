@@ -27,6 +27,7 @@
 #include <dpp/cluster.h>
 #include <thread>
 #include <dpp/json.h>
+#include <dpp/json_writer.h>
 #include <dpp/etf.h>
 #include <utility>
 
@@ -446,7 +447,14 @@ void discord_client::one_second_timer()
 		if (this->heartbeat_interval && this->last_seq) {
 			/* Check if we're due to emit a heartbeat */
 			if (time(nullptr) > last_heartbeat + ((heartbeat_interval / 1000.0) * 0.75)) {
-				last_ping_message = jsonobj_to_string(json({{"op", ft_heartbeat}, {"d", last_seq}}));
+				if (protocol == ws_json) {
+					/* Heartbeats are sent for the life of the shard, so skip building a document for them */
+					heartbeat_writer.clear();
+					heartbeat_writer.begin_object().key("op").value(static_cast<int>(ft_heartbeat)).key("d").value(last_seq).end_object();
+					last_ping_message = heartbeat_writer.str();
+				} else {
+					last_ping_message = jsonobj_to_string(json({{"op", ft_heartbeat}, {"d", last_seq}}));
+				}
 				queue_message(last_ping_message, true);
 				last_heartbeat = time(nullptr);
 			}
@@ -27,6 +27,9 @@
 #include <dpp/exception.h>
 #include <dpp/discordvoiceclient.h>
 #include <dpp/json.h>
+#ifdef __linux__
+	#include <sys/socket.h>
+#endif
 
 #ifdef HAVE_VOICE
 	#include "voice/enabled/enabled.h"
@@ -59,8 +62,108 @@ moving_averager::operator float() {
 	return 0.0f;
 }
 
+voice_out_queue::voice_out_queue(size_t initial_capacity) : slots(std::max<size_t>(initial_capacity, 1)) {
+}
+
+voice_out_packet& voice_out_queue::emplace_back() {
+	if (count == slots.size()) {
+		/* Full; unroll the ring into a new one twice the size, moving the buffers with it */
+		std::vector<voice_out_packet> grown(slots.size() * 2);
+		for (size_t i = 0; i < count; ++i) {
+			grown[i] = std::move((*this)[i]);
+		}
+		slots = std::move(grown);
+		head = 0;
+	}
+	return slots[(head + count++) % slots.size()];
+}
+
+void voice_out_queue::pop_front(size_t n) {
+	n = std::min(n, count);
+	head = (head + n) % slots.size();
+	count -= n;
+}
+
+void voice_out_queue::clear() {
+	head = 0;
+	count = 0;
+}
+
+namespace detail {
+
+size_t udp_send_batch(dpp::socket fd, address_t& destination, const voice_out_queue& packets, size_t count, uint64_t& calls) {
+	constexpr size_t batch_size = discord_voice_client::udp_batch_size;
+	count = std::min(count, batch_size);
+#ifdef __linux__
+	std::array<mmsghdr, batch_size> headers{};
+	std::array<iovec, batch_size> vectors{};
+	for (size_t i = 0; i < count; ++i) {
+		vectors[i].iov_base = const_cast<char*>(packets[i].packet.data());
+		vectors[i].iov_len = packets[i].packet.length();
+		headers[i].msg_hdr.msg_name = destination.get_socket_address();
+		headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(destination.size());
+		headers[i].msg_hdr.msg_iov = &vectors[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+	int sent = sendmmsg(fd, headers.data(), static_cast<unsigned int>(count), 0);
+	++calls;
+	return sent <= 0 ? 0 : static_cast<size_t>(sent);
+#else
+	size_t sent = 0;
+	while (sent < count) {
+		const std::string& packet = packets[sent].packet;
+		int result = static_cast<int>(sendto(fd, packet.data(), static_cast<int>(packet.length()), 0, destination.get_socket_address(), destination.size()));
+		++calls;
+		if (result != static_cast<int>(packet.length())) {
+			break;
+		}
+		++sent;
+	}
+	return sent;
+#endif
+}
+
+size_t udp_recv_batch(dpp::socket fd, uint8_t* slab, std::array<size_t, discord_voice_client::udp_batch_size>& sizes, uint64_t& calls) {
+	constexpr size_t batch_size = discord_voice_client::udp_batch_size;
+	constexpr size_t slot_size = discord_voice_client::udp_slot_size;
+#ifdef __linux__
+	std::array<mmsghdr, batch_size> headers{};
+	std::array<iovec, batch_size> vectors{};
+	for (size_t i = 0; i < batch_size; ++i) {
+		vectors[i].iov_base = slab + i * slot_size;
+		vectors[i].iov_len = slot_size;
+		headers[i].msg_hdr.msg_iov = &vectors[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+	int received = recvmmsg(fd, headers.data(), batch_size, MSG_DONTWAIT, nullptr);
+	++calls;
+	if (received <= 0) {
+		return 0;
+	}
+	for (int i = 0; i < received; ++i) {
+		/* A truncated packet can't be a valid voice packet, so it is passed on as empty and dropped */
+		sizes[i] = (headers[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : headers[i].msg_len;
+	}
+	return static_cast<size_t>(received);
+#else
+	size_t count = 0;
+	for (; count < batch_size; ++count) {
+		int received = static_cast<int>(recv(fd, reinterpret_cast<char*>(slab + count * slot_size), static_cast<int>(slot_size), 0));
+		++calls;
+		if (received < 0) {
+			break;
+		}
+		sizes[count] = static_cast<size_t>(received);
+	}
+	return count;
+#endif
+}
+
+}
+
 discord_voice_client::~discord_voice_client()
 {
+	detach_send_mixer();
 	cleanup();
 }
 
@@ -153,8 +256,8 @@ float discord_voice_client::get_secs_remaining() {
 	std::lock_guard<std::mutex> lock(this->stream_mutex);
 	float ret = 0;
 
-	for (const auto& packet : outbuf) {
-		ret += packet.duration * (timescale / 1000000000.0f);
+	for (size_t i = 0; i < outbuf.size(); ++i) {
+		ret += outbuf[i].duration * (timescale / 1000000000.0f);
 	}
 
 	return ret;
@@ -166,11 +269,18 @@ dpp::utility::uptime discord_voice_client::get_remaining() {
 }
 
 discord_voice_client& discord_voice_client::stop_audio() {
+	cancel_parallel_encodes();
+	{
+		std::lock_guard<std::mutex> lock(this->ogg_playback_mutex);
+		ogg_playback = {};
+	}
+	clear_send_mixer_audio();
 	{
 		std::lock_guard<std::mutex> lock(this->stream_mutex);
 		outbuf.clear();
 		track_meta.clear();
 		tracks = 0;
+		notify_send_queue_space();
 	}
 	this->send_stop_frames();
 	return *this;
@@ -368,21 +478,139 @@ uint32_t discord_voice_client::get_tracks_remaining() {
 	}
 }
 
+voice_udp_stats discord_voice_client::get_udp_stats() const {
+	voice_udp_stats stats;
+	stats.packets_received = udp_packets_received.load(std::memory_order_relaxed);
+	stats.receive_calls = udp_receive_calls.load(std::memory_order_relaxed);
+	stats.packets_sent = udp_packets_sent.load(std::memory_order_relaxed);
+	stats.send_calls = udp_send_calls.load(std::memory_order_relaxed);
+	return stats;
+}
+
+discord_voice_client& discord_voice_client::set_send_queue_limit(size_t max_packets) {
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+	send_queue_limit = max_packets;
+	notify_send_queue_space();
+	return *this;
+}
+
+size_t discord_voice_client::get_send_queue_limit() {
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+	return send_queue_limit;
+}
+
+bool discord_voice_client::send_queue_full() {
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+	return send_queue_limit > 0 && outbuf.size() >= send_queue_limit;
+}
+
+discord_voice_client& discord_voice_client::on_send_queue_space(std::function<void(size_t)> callback) {
+	std::lock_guard<std::mutex> lock(this->stream_mutex);
+	send_queue_space_waiters.emplace_back(std::move(callback));
+	notify_send_queue_space();
+	return *this;
+}
+
+void discord_voice_client::notify_send_queue_space() {
+	if (send_queue_space_waiters.empty() || (send_queue_limit > 0 && outbuf.size() >= send_queue_limit)) {
+		return;
+	}
+	for (auto& callback : send_queue_space_waiters) {
+		creator->queue_work(0, [callback = std::move(callback), queued = outbuf.size()]() {
+			callback(queued);
+		});
+	}
+	send_queue_space_waiters.clear();
+}
+
+#ifndef DPP_NO_CORO
+dpp::async<size_t> discord_voice_client::co_wait_for_send_queue_space() {
+	return dpp::async<size_t>{ [this](auto &&callback) {
+		on_send_queue_space(callback);
+	} };
+}
+#endif
+
+discord_voice_client& discord_voice_client::play_ogg_opus(std::shared_ptr<const ogg_opus_file> file, uint64_t start_ms, bool loop) {
+	{
+		std::lock_guard<std::mutex> lock(this->ogg_playback_mutex);
+		ogg_playback.next_packet = file ? file->find_packet(start_ms) : 0;
+		ogg_playback.file = std::move(file);
+		ogg_playback.loop = loop;
+	}
+	refill_ogg_playback();
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::seek_ogg_opus(uint64_t position_ms) {
+	{
+		std::lock_guard<std::mutex> lock(this->ogg_playback_mutex);
+		if (!ogg_playback.file) {
+			return *this;
+		}
+		ogg_playback.next_packet = ogg_playback.file->find_packet(position_ms);
+		std::lock_guard<std::mutex> stream_lock(this->stream_mutex);
+		outbuf.clear();
+		notify_send_queue_space();
+	}
+	refill_ogg_playback();
+	return *this;
+}
+
+uint64_t discord_voice_client::get_ogg_opus_position() {
+	std::lock_guard<std::mutex> lock(this->ogg_playback_mutex);
+	if (!ogg_playback.file || ogg_playback.next_packet >= ogg_playback.file->get_packet_count()) {
+		return 0;
+	}
+	return ogg_playback.file->get_packet_entry(ogg_playback.next_packet).position / 48;
+}
+
+void discord_voice_client::refill_ogg_playback() {
+	std::lock_guard<std::mutex> lock(this->ogg_playback_mutex);
+	if (!ogg_playback.file) {
+		return;
+	}
+	size_t queued = 0;
+	{
+		std::lock_guard<std::mutex> stream_lock(this->stream_mutex);
+		queued = outbuf.size();
+	}
+	if (queued >= ogg_playback_queue_low) {
+		return;
+	}
+	const ogg_opus_file& file = *ogg_playback.file;
+	for (; queued < ogg_playback_queue_high; ++queued) {
+		if (ogg_playback.next_packet >= file.get_packet_count()) {
+			if (!ogg_playback.loop || file.get_packet_count() == 0) {
+				ogg_playback = {};
+				return;
+			}
+			ogg_playback.next_packet = 0;
+		}
+		const std::string_view packet = file.get_packet(ogg_playback.next_packet);
+		const uint64_t duration = (file.get_packet_entry(ogg_playback.next_packet).samples / 48) / (timescale / 1000000);
+		send_audio_opus(reinterpret_cast<const uint8_t*>(packet.data()), packet.size(), duration);
+		++ogg_playback.next_packet;
+	}
+}
+
 discord_voice_client& discord_voice_client::skip_to_next_marker() {
 	std::lock_guard<std::mutex> lock(this->stream_mutex);
 	if (!outbuf.empty()) {
 		/* Find the first marker to skip to */
-		auto i = std::find_if(outbuf.begin(), outbuf.end(), [](const voice_out_packet &v){
-			return v.packet.size() == sizeof(uint16_t) && (*((uint16_t*)(v.packet.data()))) == AUDIO_TRACK_MARKER;
-		});
+		size_t i = 0;
+		while (i < outbuf.size() && !(outbuf[i].packet.size() == sizeof(uint16_t) && (*((uint16_t*)(outbuf[i].packet.data()))) == AUDIO_TRACK_MARKER)) {
+			++i;
+		}
 
-		if (i != outbuf.end()) {
+		if (i < outbuf.size()) {
 			/* Skip queued packets until including found marker */
-			outbuf.erase(outbuf.begin(), i+1);
+			outbuf.pop_front(i + 1);
 		} else {
 			/* No market found, skip the whole queue */
 			outbuf.clear();
 		}
+		notify_send_queue_space();
 	}
 
 	if (tracks > 0) {
@@ -138,13 +138,59 @@ confirmation_callback_t interaction_create_t::success() const {
 	return confirmation_callback_t(owner, confirmation(), http);
 }
 
-void interaction_create_t::reply(interaction_response_type t, const message& m, command_completion_event_t callback) const {
-	if (from_webhook) {
-		set_queued_response(dpp::interaction_response(t, m).build_json());
+void interaction_create_t::reply_to_webhook(const interaction_response& r, command_completion_event_t callback) const {
+	if (!webhook_response) {
+		set_queued_response(r.build_json());
+	} else if (!webhook_response->respond(r.build_json())) {
+		/* The HTTP response has already been sent, so what the reply can still do depends on what that was */
+		const uint8_t ack = webhook_response->get_automatic_ack();
+		switch (r.type) {
+			case ir_channel_message_with_source:
+				if (ack == ir_deferred_channel_message_with_source) {
+					/* The reply replaces the "thinking" message */
+					owner->interaction_response_edit(this->command.token, r.msg, std::move(callback));
+					return;
+				}
+				if (ack == ir_deferred_update_message) {
+					/* Editing the original response would change the clicked message, and lose the ephemeral flag */
+					owner->interaction_followup_create(this->command.token, r.msg, std::move(callback));
+					return;
+				}
+				break;
+			case ir_update_message:
+				if (ack == ir_deferred_update_message) {
+					owner->interaction_response_edit(this->command.token, r.msg, std::move(callback));
+					return;
+				}
+				break;
+			case ir_deferred_channel_message_with_source:
+			case ir_deferred_update_message:
+				if (callback) {
+					/* Already acknowledged, which is all a deferral asks for */
+					callback(success());
+				}
+				return;
+			default:
+				break;
+		}
 		if (callback) {
-			/* This always succeeds, because we don't have to perform an API call */
-			callback(success());
+			http_request_completion_t http;
+			http.status = 400;
+			http.error = h_unknown;
+			http.body = R"({"code":40060,"message":"Interaction has already been acknowledged."})";
+			callback(confirmation_callback_t(owner, confirmation(), http));
 		}
+		return;
+	}
+	if (callback) {
+		/* This always succeeds, because we don't have to perform an API call */
+		callback(success());
+	}
+}
+
+void interaction_create_t::reply(interaction_response_type t, const message& m, command_completion_event_t callback) const {
+	if (from_webhook) {
+		reply_to_webhook(dpp::interaction_response(t, m), std::move(callback));
 	} else {
 		owner->interaction_response_create(this->command.id, this->command.token, dpp::interaction_response(t, m), std::move(callback));
 	}
@@ -152,11 +198,7 @@ void interaction_create_t::reply(interaction_response_type t, const message& m,
 
 void interaction_create_t::reply(const message& m, command_completion_event_t callback) const {
 	if (from_webhook) {
-                set_queued_response(dpp::interaction_response(ir_channel_message_with_source, m).build_json());
-		if (callback) {
-			/* This always succeeds, because we don't have to perform an API call */
-			callback(success());
-		}
+		reply_to_webhook(dpp::interaction_response(ir_channel_message_with_source, m), std::move(callback));
 	} else {
 		owner->interaction_response_create(
 			this->command.id,
@@ -177,11 +219,16 @@ void interaction_create_t::thinking(bool ephemeral, command_completion_event_t c
 }
 
 void interaction_create_t::set_queued_response(const std::string& response) const {
+	if (webhook_response) {
+		webhook_response->respond(response);
+		return;
+	}
 	queued_response = response;
 }
 
 std::string interaction_create_t::get_queued_response() const {
-	return queued_response;
+	/* With a webhook response, the reply goes straight to it instead */
+	return webhook_response ? std::string() : queued_response;
 }
 
 void interaction_create_t::reply(command_completion_event_t callback) const {
@@ -190,11 +237,7 @@ void interaction_create_t::reply(command_completion_event_t callback) const {
 
 void interaction_create_t::dialog(const interaction_modal_response& mr, command_completion_event_t callback) const {
 	if (from_webhook) {
-                set_queued_response(mr.build_json());
-		if (callback) {
-			/* This always succeeds, because we don't have to perform an API call */
-			callback(success());
-		}
+		reply_to_webhook(mr, std::move(callback));
 	} else {
 		owner->interaction_response_create(this->command.id, this->command.token, mr, std::move(callback));
 	}
@@ -87,7 +87,7 @@ void interaction_create::handle(discord_client* client, json &j, const std::stri
 	internal_handle_interaction(client->creator, client->shard_id, j["d"], raw, false);
 }
 
-std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, json &d, const std::string &raw, bool from_webhook) {
+std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, json &d, const std::string &raw, bool from_webhook, std::shared_ptr<detail::interaction_webhook_response> webhook_response) {
 	dpp::interaction i;
 	/* We must set here because we cant pass it through the nlohmann from_json() */
 	i.cache_policy = creator->cache_policy;
@@ -108,6 +108,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 				mcm.set_message(i.resolved.messages.begin()->second);
 				if (from_webhook) {
 					mcm.from_webhook = true;
+					mcm.webhook_response = webhook_response;
 					creator->on_message_context_menu.call(mcm);
 					return mcm.get_queued_response();
 				} else {
@@ -124,6 +125,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 				ucm.set_user(i.resolved.users.begin()->second);
 				if (from_webhook) {
 					ucm.from_webhook = true;
+					ucm.webhook_response = webhook_response;
 					creator->on_user_context_menu.call(ucm);
 					return ucm.get_queued_response();
 				} else {
@@ -137,6 +139,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 			sc.command = i;
 			if (from_webhook) {
 				sc.from_webhook = true;
+				sc.webhook_response = webhook_response;
 				creator->on_slashcommand.call(sc);
 				return sc.get_queued_response();
 			} else {
@@ -155,6 +158,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 			ic.command = i;
 			if (from_webhook) {
 				ic.from_webhook = true;
+				ic.webhook_response = webhook_response;
 				creator->on_interaction_create.call(ic);
 				return ic.get_queued_response();
 			} else {
@@ -178,6 +182,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 			}
 			if (from_webhook) {
 				fs.from_webhook = true;
+				fs.webhook_response = webhook_response;
 				creator->on_form_submit.call(fs);
 				return fs.get_queued_response();
 			} else {
@@ -196,6 +201,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 			ac.command = i;
 			if (from_webhook) {
 				ac.from_webhook = true;
+				ac.webhook_response = webhook_response;
 				creator->on_autocomplete.call(ac);
 				return ac.get_queued_response();
 			} else {
@@ -214,6 +220,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 				ic.component_type = bi.component_type;
 				if (from_webhook) {
 					ic.from_webhook = true;
+					ic.webhook_response = webhook_response;
 					creator->on_button_click.call(ic);
 					return ic.get_queued_response();
 				} else {
@@ -233,6 +240,7 @@ std::string internal_handle_interaction(cluster* creator, uint16_t shard_id, jso
 				ic.values = bi.values;
 				if (from_webhook) {
 					ic.from_webhook = true;
+					ic.webhook_response = webhook_response;
 					creator->on_select_click.call(ic);
 					return ic.get_queued_response();
 				} else {
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <climits>
+#include <cctype>
 #include <dpp/http_server_request.h>
 #include <dpp/utility.h>
 #include <dpp/cluster.h>
@@ -59,32 +60,93 @@ void http_server_request::connect()
 	read_loop();
 }
 
-const std::string http_server_request::get_header(const std::string& header_name) const {
-	auto hdrs = request_headers.find(lowercase(header_name));
-	if (hdrs != request_headers.end()) {
-		return hdrs->second;
+namespace {
+
+/**
+ * @brief Compare two strings, ignoring the case of ASCII letters
+ * @param a first string
+ * @param b second string
+ * @return true if equal
+ */
+bool iequals(std::string_view a, std::string_view b) {
+	return a.length() == b.length() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+		return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+	});
+}
+
+/**
+ * @brief Returns true if a comma separated header value contains a token, ignoring case
+ * @param list header value, e.g. "keep-alive, Upgrade"
+ * @param token token to find
+ * @return true if present
+ */
+bool has_token(std::string_view list, std::string_view token) {
+	while (!list.empty()) {
+		size_t comma = list.find(',');
+		std::string_view item = list.substr(0, comma);
+		list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+		while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+			item.remove_prefix(1);
+		}
+		while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+			item.remove_suffix(1);
+		}
+		if (iequals(item, token)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Split the next CRLF terminated line from the start of a block of text
+ * @param block block of text, which has the line and its CRLF removed
+ * @return std::string_view line
+ */
+std::string_view next_line(std::string_view& block) {
+	size_t eol = block.find("\r\n");
+	std::string_view line = block.substr(0, eol);
+	block = eol == std::string_view::npos ? std::string_view{} : block.substr(eol + 2);
+	return line;
+}
+
+}
+
+std::string_view http_server_request::get_header_view(std::string_view header_name) const {
+	for (const auto& [name, value] : request_headers) {
+		if (iequals(name, header_name)) {
+			return value;
+		}
 	}
-	return std::string();
+	return {};
+}
+
+const std::string http_server_request::get_header(const std::string& header_name) const {
+	return std::string(get_header_view(header_name));
 }
 
 size_t http_server_request::get_header_count(const std::string& header_name) const {
-	return request_headers.count(lowercase(header_name));
+	return static_cast<size_t>(std::count_if(request_headers.begin(), request_headers.end(), [&header_name](const auto& header) {
+		return iequals(header.first, header_name);
+	}));
 }
 
 std::list<std::string> http_server_request::get_header_list(const std::string& header_name) const {
-	auto hdrs = request_headers.equal_range(lowercase(header_name));
-	if (hdrs.first != request_headers.end()) {
-		std::list<std::string> data;
-		for ( auto i = hdrs.first; i != hdrs.second; ++i ) {
-			data.emplace_back(i->second);
+	std::list<std::string> data;
+	for (const auto& [name, value] : request_headers) {
+		if (iequals(name, header_name)) {
+			data.emplace_back(value);
 		}
-		return data;
 	}
-	return std::list<std::string>();
+	return data;
 }
 
 std::multimap<std::string, std::string> http_server_request::get_headers() const {
-	return request_headers;
+	std::multimap<std::string, std::string> headers;
+	for (const auto& [name, value] : request_headers) {
+		headers.emplace(lowercase(std::string(name)), value);
+	}
+	return headers;
 }
 
 uint64_t http_server_request::get_max_post_size() const {
@@ -95,107 +157,243 @@ uint64_t http_server_request::get_max_header_size() const {
 	return 8192;
 }
 
+uint32_t http_server_request::get_max_keepalive_requests() const {
+	return 1000;
+}
+
 void http_server_request::generate_error(uint16_t error_code, const std::string& message) {
-	status = HTTPS_DONE;
-	owner->queue_work(1, [this, error_code, message]() {
-		status = error_code;
-		response_body = message;
+	/* The rest of the input can't be trusted to start at a request boundary */
+	persistent = false;
+	state = HTTPS_DONE;
+	dispatched = true;
+	status = error_code;
+	response_body = message;
+	owner->queue_work(1, [this]() {
+		if (handler) {
+			handler(this);
+		}
+		handler_returned();
+	});
+}
+
+void http_server_request::respond() {
+	dispatched = true;
+	owner->queue_work(1, [this]() {
 		handler(this);
-		socket_write(get_response());
-		handler = {};
+		handler_returned();
 	});
 }
 
+void http_server_request::finish() {
+	/* Counted as it is sent, so the response which uses up the connection's last request says it closes */
+	if (persistent && ++requests_served >= get_max_keepalive_requests()) {
+		persistent = false;
+	}
+	std::string response = get_response();
+	responded = true;
+	socket_write(response);
+}
+
+void http_server_request::handler_returned() {
+	std::shared_ptr<detail::deferred_http_response> d = get_deferred();
+	if (!d) {
+		finish();
+		return;
+	}
+	std::lock_guard<std::mutex> lock(d->mutex);
+	d->handler_returned = true;
+	if (d->completed && d->request) {
+		d->request = nullptr;
+		finish();
+	}
+}
+
+std::shared_ptr<detail::deferred_http_response> http_server_request::get_deferred() const {
+	std::lock_guard<std::mutex> lock(deferred_mutex);
+	return deferred;
+}
+
+void http_server_request::detach_deferred() {
+	std::shared_ptr<detail::deferred_http_response> d;
+	{
+		std::lock_guard<std::mutex> lock(deferred_mutex);
+		d.swap(deferred);
+	}
+	if (d) {
+		std::lock_guard<std::mutex> lock(d->mutex);
+		d->request = nullptr;
+	}
+}
+
+http_server_deferred_response http_server_request::defer(std::chrono::milliseconds timeout, http_server_request_event on_timeout) {
+	auto d = std::make_shared<detail::deferred_http_response>();
+	d->request = this;
+	if (timeout.count() > 0 && on_timeout) {
+		/* one_second_timer() may check the deadline up to a second after it passes, so check it a second early instead */
+		d->deadline = std::chrono::steady_clock::now() + timeout - std::chrono::seconds(1);
+		d->on_timeout = std::move(on_timeout);
+	}
+	std::lock_guard<std::mutex> lock(deferred_mutex);
+	deferred = d;
+	return http_server_deferred_response(d);
+}
+
+http_server_deferred_response::http_server_deferred_response(std::shared_ptr<detail::deferred_http_response> shared_state) : state(std::move(shared_state)) {
+}
+
+bool http_server_deferred_response::complete(uint16_t status, const std::string& body, const http_headers& headers) const {
+	if (!state) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(state->mutex);
+	http_server_request* request = state->request;
+	if (!request || state->completed) {
+		return false;
+	}
+	state->completed = true;
+	request->set_status(status).set_response_body(body);
+	for (const auto& [name, value] : headers) {
+		request->set_response_header(name, value);
+	}
+	/* If the handler is still running, it sends the response when it returns */
+	if (state->handler_returned) {
+		state->request = nullptr;
+		request->finish();
+	}
+	return true;
+}
+
+bool http_server_request::parse_headers() {
+	std::string_view block(raw_headers);
+
+	/* First line is special */
+	std::string_view request_line = next_line(block);
+	size_t verb_end = request_line.find(' ');
+	size_t path_start = request_line.find_first_not_of(' ', verb_end);
+	size_t path_end = request_line.find(' ', path_start);
+	size_t protocol_start = request_line.find_first_not_of(' ', path_end);
+	if (verb_end == std::string_view::npos || path_start == std::string_view::npos || path_end == std::string_view::npos || protocol_start == std::string_view::npos) {
+		generate_error(400, "Malformed request");
+		return false;
+	}
+	request_type = uppercase(std::string(request_line.substr(0, verb_end)));
+	path = request_line.substr(path_start, path_end - path_start);
+	std::string_view protocol = request_line.substr(protocol_start);
+	while (!protocol.empty() && protocol.back() == ' ') {
+		protocol.remove_suffix(1);
+	}
+
+	if (protocol.length() < 5 || !iequals(protocol.substr(0, 5), "HTTP/")) {
+		generate_error(400, "Malformed request");
+		return false;
+	}
+
+	if (std::find(verb.begin(), verb.end(), request_type) == verb.end()) {
+		generate_error(401, "Unsupported method");
+		return false;
+	}
+
+	while (!block.empty()) {
+		std::string_view line = next_line(block);
+		size_t sep = line.find(':');
+		if (sep != std::string_view::npos) {
+			std::string_view value = line.substr(sep + 1);
+			while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+				value.remove_prefix(1);
+			}
+			while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+				value.remove_suffix(1);
+			}
+			request_headers.emplace_back(line.substr(0, sep), value);
+		}
+	}
+
+	std::string_view version = protocol.substr(5);
+	http11 = version != "1.0" && version != "0.9";
+	std::string_view connection = get_header_view("connection");
+	persistent = http11 ? !has_token(connection, "close") : has_token(connection, "keep-alive");
+	if (!get_header_view("transfer-encoding").empty()) {
+		/* Chunked request bodies aren't supported, so the end of the body can't be found */
+		persistent = false;
+	}
+
+	std::string_view cl = get_header_view("content-length");
+	if (!cl.empty()) {
+		content_length = std::strtoull(std::string(cl).c_str(), nullptr, 10);
+		if (content_length > get_max_post_size()) {
+			/* The remainder of the body won't be read, so the connection can't be reused */
+			content_length = get_max_post_size();
+			persistent = false;
+		}
+	}
+	return true;
+}
+
 bool http_server_request::handle_buffer(std::string &buffer)
 {
 	bool state_changed = false;
 	do {
 		state_changed = false;
 		switch (state) {
-			case HTTPS_HEADERS:
-				if (buffer.length() > get_max_header_size()) {
+			case HTTPS_HEADERS: {
+				/* Clients may send an empty line between pipelined requests */
+				size_t leading = 0;
+				while (buffer.compare(leading, 2, "\r\n") == 0) {
+					leading += 2;
+				}
+				if (leading) {
+					buffer.erase(0, leading);
+				}
+				size_t headers_end = buffer.find("\r\n\r\n");
+				if (headers_end == std::string::npos ? buffer.length() > get_max_header_size() : headers_end > get_max_header_size()) {
 					owner->log(ll_warning, "HTTTP request exceeds max header size, dropped");
 					return false;
-				} else if (buffer.find("\r\n\r\n") != std::string::npos) {
+				} else if (headers_end != std::string::npos) {
 
 					/* Add 10 seconds to retrieve body */
 					timeout += 10;
 
-					/* Got all headers, proceed to new state */
-
-					/* Get headers string */
-					std::string headers = buffer.substr(0, buffer.find("\r\n\r\n"));
-
-					/* Modify buffer, remove headers section */
-					buffer.erase(0, buffer.find("\r\n\r\n") + 4);
+					/* Got all headers, proceed to new state. Anything after them is
+					 * the body, possibly followed by further pipelined requests.
+					 */
+					raw_headers.assign(buffer, 0, headers_end);
+					buffer.erase(0, headers_end + 4);
 
-					/* Process headers into map */
-					std::vector<std::string> h = utility::tokenize(headers);
-
-					if (h.empty()) {
-						generate_error(400, "Malformed request");
-						return true;
-					}
-
-					/* First line is special */
-					std::vector<std::string> verb_path_protocol = utility::tokenize(h[0], " ");
-					if (verb_path_protocol.size() < 3) {
-						generate_error(400, "Malformed request");
-						return true;
-					}
-					std::string req_verb = uppercase(verb_path_protocol[0]);
-					request_type = req_verb;
-					std::string req_path = verb_path_protocol[1];
-					path = req_path;
-					std::string protocol = uppercase(verb_path_protocol[2]);
-					
-					h.erase(h.begin());
-
-					if (protocol.substr(0, 5) != "HTTP/") {
-						generate_error(400, "Malformed request");
+					if (!parse_headers()) {
 						return true;
 					}
-
-					if (std::find(verb.begin(), verb.end(), req_verb) == verb.end()) {
-						generate_error(401, "Unsupported method");
-						return true;
-					}
-
-					for(auto &hd : h) {
-						std::string::size_type sep = hd.find(": ");
-						if (sep != std::string::npos) {
-							std::string key = hd.substr(0, sep);
-							std::string value = hd.substr(sep + 2, hd.length());
-							request_headers.emplace(lowercase(key), value);
-						}
-					}
-					auto it_cl = request_headers.find("content-length");
-					if ( it_cl != request_headers.end()) {
-						content_length = std::stoull(it_cl->second);
-						if (content_length > get_max_post_size()) {
-							content_length = get_max_post_size();
-						}
-					}
 					state = HTTPS_CONTENT;
 					state_changed = true;
 					continue;
 				}
+			}
 			break;
 			case HTTPS_CONTENT:
-				request_body += buffer;
-				buffer.clear();
-				if (request_body.length() > get_max_post_size() || content_length == ULLONG_MAX || request_body.length() >= content_length) {
+				if (content_length == ULLONG_MAX) {
+					/* Without a length, there is no body on a persistent connection;
+					 * otherwise the body is whatever arrived with the headers.
+					 */
+					if (!persistent) {
+						request_body += buffer;
+						buffer.clear();
+					}
 					state = HTTPS_DONE;
 					state_changed = true;
+				} else {
+					size_t wanted = static_cast<size_t>(content_length - std::min<uint64_t>(content_length, request_body.length()));
+					size_t taken = std::min(wanted, buffer.length());
+					request_body.append(buffer, 0, taken);
+					buffer.erase(0, taken);
+					if (request_body.length() >= content_length) {
+						state = HTTPS_DONE;
+						state_changed = true;
+					}
 				}
 			break;
 			case HTTPS_DONE:
-				if (handler) {
-					owner->queue_work(1, [this]() {
-						handler(this);
-						socket_write(get_response());
-						handler = {};
-					});
+				/* Pipelined requests stay in the buffer until this one is answered */
+				if (handler && !dispatched) {
+					respond();
 				}
 				return true;
 			default:
@@ -205,8 +403,36 @@ bool http_server_request::handle_buffer(std::string &buffer)
 	return true;
 }
 
+void http_server_request::reset_request() {
+	raw_headers.clear();
+	request_headers.clear();
+	request_body.clear();
+	request_type.clear();
+	path.clear();
+	response_headers.clear();
+	response_body.clear();
+	status = 0;
+	content_length = ULLONG_MAX;
+	http11 = false;
+	persistent = false;
+	dispatched = false;
+	responded = false;
+	detach_deferred();
+	timeout = time(nullptr) + 10;
+	state = HTTPS_HEADERS;
+}
+
 void http_server_request::on_buffer_drained() {
-	if (state == HTTPS_DONE && status > 0 && !handler) {
+	if (state != HTTPS_DONE || !responded) {
+		return;
+	}
+	if (!persistent) {
+		this->close();
+		return;
+	}
+	reset_request();
+	/* Start on any requests the client pipelined behind the one just answered */
+	if (!buffer.empty() && !handle_buffer(buffer)) {
 		this->close();
 	}
 }
@@ -248,6 +474,18 @@ uint16_t http_server_request::get_status() const {
 }
 
 void http_server_request::one_second_timer() {
+	std::shared_ptr<detail::deferred_http_response> d = get_deferred();
+	if (d && d->on_timeout && std::chrono::steady_clock::now() >= d->deadline) {
+		std::lock_guard<std::mutex> lock(d->mutex);
+		if (!d->completed && d->request) {
+			d->completed = true;
+			d->on_timeout(this);
+			if (d->handler_returned) {
+				d->request = nullptr;
+				finish();
+			}
+		}
+	}
 	if (!tcp_connect_done && time(nullptr) >= timeout) {
 		timed_out = true;
 		this->close();
@@ -261,22 +499,29 @@ void http_server_request::one_second_timer() {
 }
 
 std::string http_server_request::get_response() {
-	std::string response = "HTTP/1.0 " + std::to_string(status) + " OK\r\n";
-	set_response_header("Content-Length", std::to_string(response_body.length()));
+	std::string response;
+	response.reserve(128 + response_body.length());
+	response.append(http11 ? "HTTP/1.1 " : "HTTP/1.0 ").append(std::to_string(status)).append(" OK\r\n");
+	response.append("Content-Length: ").append(std::to_string(response_body.length())).append("\r\n");
+	response.append(persistent ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
 	for (const auto& header : response_headers) {
-		response += header.first + ": " + header.second + "\r\n";
+		if (!iequals(header.first, "content-length") && !iequals(header.first, "connection")) {
+			response.append(header.first).append(": ").append(header.second).append("\r\n");
+		}
 	}
-	response += "\r\n";
-	response += response_body;
+	response.append("\r\n");
+	response.append(response_body);
 	return response;
 }
 
 void http_server_request::close() {
+	detach_deferred();
 	state = HTTPS_DONE;
 	ssl_connection::close();
 }
 
 http_server_request::~http_server_request() {
+	detach_deferred();
 	if (sfd != INVALID_SOCKET) {
 		ssl_connection::close();
 	}
@@ -36,6 +36,37 @@ https_client::https_client(cluster* creator, const std::string &hostname, uint16
 	  request_type(verb),
 	  path(urlpath),
 	  request_body(req_body),
+	  segment_index(0),
+	  segment_offset(0),
+	  body_received(0),
+	  accept_compressed(false),
+	  body_decompressed(0),
+	  decompression_failed(false),
+	  content_length(0),
+	  request_headers(extra_headers),
+	  status(0),
+	  http_protocol(protocol),
+	  timeout(time(nullptr) + request_timeout),
+	  timed_out(false),
+	  completed(done),
+	  state(HTTPS_HEADERS)
+{
+	https_client::connect();
+}
+
+https_client::https_client(cluster* creator, const std::string &hostname, uint16_t port,  const std::string &urlpath, const std::string &verb, const multipart_content &req_body, const http_headers& extra_headers, bool plaintext_connection, uint16_t request_timeout, const std::string &protocol, https_client_completion_event done, https_client_body_event on_body)
+	: ssl_connection(creator, hostname, std::to_string(port), plaintext_connection, false),
+	  request_type(verb),
+	  path(urlpath),
+	  request_body(req_body.body),
+	  request_segments(req_body.segments),
+	  segment_index(0),
+	  segment_offset(0),
+	  body_handler(on_body),
+	  body_received(0),
+	  accept_compressed(false),
+	  body_decompressed(0),
+	  decompression_failed(false),
 	  content_length(0),
 	  request_headers(extra_headers),
 	  status(0),
@@ -52,14 +83,27 @@ void https_client::connect()
 {
 	state = HTTPS_HEADERS;
 	std::string map_headers;
+	accept_compressed = true;
 	for (auto& [k,v] : request_headers) {
 		std::string lower_header = dpp::lowercase(k);
 		if (lower_header == "connection" || lower_header == "content-length" || lower_header == "host") {
 			owner->log(ll_warning, "Detected unnecessary duplicate header '" + k + "' in HTTP request to '" + hostname + "', which has been discarded.");
 			continue;
 		}
+		if (lower_header == "accept-encoding") {
+			/* The caller asked for its own encodings, so they get the body exactly as sent */
+			accept_compressed = false;
+		}
 		map_headers += k + ": " + v + "\r\n";
 	}
+	if (accept_compressed) {
+		map_headers += "Accept-Encoding: gzip, deflate\r\n";
+	}
+
+	uint64_t body_length = request_body.length();
+	for (const auto& segment : request_segments) {
+		body_length += segment.size();
+	}
 
 	if (this->sfd != SOCKET_ERROR) {
 		this->socket_write(
@@ -68,24 +112,70 @@ void https_client::connect()
 			"pragma: no-cache\r\n"
 			"Connection: keep-alive\r\n"
 			"Content-Length: " +
-			std::to_string(this->request_body.length()) +
+			std::to_string(body_length) +
 			"\r\n" +
 			map_headers +
 			"\r\n" +
 			this->request_body
 		);
+		if (!request_segments.empty()) {
+			segment_index = 0;
+			segment_offset = 0;
+			stream_request_body();
+		}
 		read_loop();
 	}
 }
 
+void https_client::stream_request_body()
+{
+	/* Queue at most this much of a streamed body at once, so the body is never held in memory as a whole */
+	constexpr size_t stream_chunk_size = DPP_BUFSIZE * 4;
+	size_t queued = 0;
+	while (segment_index < request_segments.size() && queued < stream_chunk_size) {
+		const http_body_segment& segment = request_segments[segment_index];
+		std::string_view part;
+		if (segment.source) {
+			part = segment.source->read(segment_offset, stream_chunk_size - queued, segment_scratch);
+		} else if (segment_offset < segment.data.length()) {
+			part = std::string_view(segment.data).substr(segment_offset, stream_chunk_size - queued);
+		}
+		if (part.empty()) {
+			if (segment_offset < segment.size()) {
+				/* The source ended early, we can't honour the Content-Length we sent */
+				owner->log(ll_error, "Upload source for HTTP request to '" + hostname + path + "' ended after " + std::to_string(segment_offset) + " of " + std::to_string(segment.size()) + " bytes");
+				this->close();
+				return;
+			}
+			segment_index++;
+			segment_offset = 0;
+			continue;
+		}
+		socket_write(part);
+		queued += part.length();
+		segment_offset += part.length();
+	}
+}
+
+void https_client::on_buffer_drained()
+{
+	if (segment_index < request_segments.size()) {
+		stream_request_body();
+	}
+}
+
 multipart_content https_client::build_multipart(const std::string &json, const std::vector<std::string>& filenames, const std::vector<std::string>& contents, const std::vector<std::string>& mimetypes) {
+	return build_multipart(json, filenames, contents, mimetypes, {});
+}
+
+multipart_content https_client::build_multipart(const std::string &json, const std::vector<std::string>& filenames, const std::vector<std::string>& contents, const std::vector<std::string>& mimetypes, const std::vector<std::shared_ptr<upload_source>>& sources) {
 
 	if (filenames.empty() && contents.empty()) {
 		/* If there are no files to upload, there is no need to build a multipart body */
 		if (!json.empty()) {
-			return { json, "application/json" };
+			return { json, "application/json", {} };
 		}
-		return {json, ""};
+		return {json, "", {}};
 	}
 
 	/* Note: loss of upper 32 bits on this value is INTENTIONAL */
@@ -97,26 +187,43 @@ multipart_content https_client::build_multipart(const std::string &json, const s
 	const std::string mime_type_start("\r\nContent-Type: ");
 	const std::string default_mime_type("application/octet-stream");
 
+	multipart_content result{"", "multipart/form-data; boundary=" + boundary, {}};
 	std::string content("--" + boundary);
 
+	/* Files with an upload source become their own segment, everything else is literal content */
+	auto add_file_content = [&](size_t index) {
+		if (index < sources.size() && sources[index]) {
+			result.segments.push_back({std::move(content), nullptr});
+			result.segments.push_back({"", sources[index]});
+			content.clear();
+		} else if (index < contents.size()) {
+			content += contents[index];
+		}
+	};
+
 	/* Special case, single file */
 	content += "\r\nContent-Type: application/json\r\nContent-Disposition: form-data; name=\"payload_json\"" + two_cr;
 	content += json + "\r\n";
-	if (filenames.size() == 1 && contents.size() == 1) {
+	if (filenames.size() == 1 && (contents.size() == 1 || sources.size() == 1)) {
 		content += part_start + "name=\"file\"; filename=\"" + filenames[0] + "\"";
 		content += mime_type_start + (mimetypes.empty() || mimetypes[0].empty() ? default_mime_type : mimetypes[0]) + two_cr;
-		content += contents[0];
+		add_file_content(0);
 	} else {
 		/* Multiple files */
 		for (size_t i = 0; i < filenames.size(); ++i) {
 			content += part_start + "name=\"files[" + std::to_string(i) + "]\"; filename=\"" + filenames[i] + "\"";
 			content += "\r\nContent-Type: " + (mimetypes.size() <= i || mimetypes[i].empty() ? default_mime_type : mimetypes[i]) + two_cr;
-			content += contents[i];
+			add_file_content(i);
 			content += "\r\n";
 		}
 	}
 	content += "\r\n--" + boundary + "--";
-	return { content, "multipart/form-data; boundary=" + boundary };
+	if (result.segments.empty()) {
+		result.body = std::move(content);
+	} else {
+		result.segments.push_back({std::move(content), nullptr});
+	}
+	return result;
 }
 
 const std::string https_client::get_header(std::string header_name) const {
@@ -203,6 +310,13 @@ bool https_client::handle_buffer(std::string &buffer)
 							} else {
 								content_length = ULLONG_MAX;
 							}
+							auto it_encoding = response_headers.find("content-encoding");
+							if (accept_compressed && it_encoding != response_headers.end()) {
+								std::string encoding = dpp::lowercase(trim(it_encoding->second));
+								if (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate") {
+									inflater = std::make_unique<zlibcontext>(true, DPP_BUFSIZE * 4);
+								}
+							}
 							chunked = false;
 							auto it_txenc = response_headers.find("transfer-encoding");
 							if (it_txenc != response_headers.end()) {
@@ -242,7 +356,7 @@ bool https_client::handle_buffer(std::string &buffer)
 				if (chunk_receive + buffer.size() > chunk_size) {
 					to_read = chunk_size - chunk_receive;
 				}
-				body += buffer.substr(0, to_read);
+				receive_body(std::string_view(buffer).substr(0, to_read));
 				chunk_receive += to_read;
 				buffer.erase(0, to_read);
 				if (chunk_receive >= chunk_size) {
@@ -293,9 +407,9 @@ bool https_client::handle_buffer(std::string &buffer)
 				}
 			break;
 			case HTTPS_CONTENT:
-				body += buffer;
+				receive_body(buffer);
 				buffer.clear();
-				if (content_length == ULLONG_MAX || body.length() >= content_length) {
+				if (content_length == ULLONG_MAX || body_received >= content_length) {
 					if (completed) {
 						completed(this);
 						completed = {};
@@ -319,6 +433,56 @@ bool https_client::handle_buffer(std::string &buffer)
 }
 
 
+void https_client::receive_body(std::string_view data) {
+	if (data.empty()) {
+		return;
+	}
+	body_received += data.length();
+	if (!inflater) {
+		deliver_body(data);
+		return;
+	}
+	if (decompression_failed) {
+		return;
+	}
+	exception_error_code error = inflater->decompress(data, decompressed_part);
+	if (error != err_no_code_specified) {
+		decompression_failed = true;
+		owner->log(ll_error, "Unable to decompress HTTP response body from " + hostname + path + ", error code " + std::to_string(error));
+		return;
+	}
+	body_decompressed += decompressed_part.length();
+	deliver_body(decompressed_part);
+}
+
+void https_client::deliver_body(std::string_view data) {
+	if (data.empty()) {
+		return;
+	}
+	if (body_handler) {
+		try {
+			body_handler(data);
+		}
+		catch (const std::exception& e) {
+			owner->log(ll_error, "Uncaught exception thrown in HTTPS body handler for " + hostname + path + ": " + std::string(e.what()));
+		}
+	} else {
+		body += data;
+	}
+}
+
+uint64_t https_client::get_compressed_bytes_in() const {
+	return inflater ? body_received : 0;
+}
+
+uint64_t https_client::get_decompressed_bytes_in() const {
+	return body_decompressed;
+}
+
+bool https_client::has_decompression_error() const {
+	return decompression_failed;
+}
+
 uint16_t https_client::get_status() const {
 	return status;
 }
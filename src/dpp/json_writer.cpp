@@ -0,0 +1,316 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/json_writer.h>
+#include <dpp/json.h>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define DPP_JSON_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define DPP_JSON_NEON
+#endif
+
+namespace dpp::detail {
+
+namespace {
+
+/**
+ * @brief UTF-8 encoding of U+FFFD, which replaces invalid UTF-8 in strings
+ */
+constexpr std::string_view replacement_character{"\xEF\xBF\xBD"};
+
+/**
+ * @brief Returns true if a byte can be copied into a JSON string as-is without
+ * escaping or UTF-8 validation
+ * @param c byte
+ * @return true if printable ASCII other than quote and backslash
+ */
+inline bool is_plain(unsigned char c) {
+	return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+/**
+ * @brief Find the length of the run of plain bytes at the start of a string
+ * @param p start of string
+ * @param len length of string
+ * @return size_t number of bytes before the first byte needing attention
+ */
+size_t plain_run(const char* p, size_t len) {
+	size_t i = 0;
+#if defined(DPP_JSON_SSE2)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(0x20);
+	for (; i + 16 <= len; i += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+		/* The comparison is signed, so bytes of 0x80 and above count as less than a space */
+		const __m128i special = _mm_or_si128(_mm_cmplt_epi8(chunk, space), _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+		if (_mm_movemask_epi8(special) != 0) {
+			break;
+		}
+	}
+#elif defined(DPP_JSON_NEON)
+	const uint8x16_t quote = vdupq_n_u8('"');
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	const uint8x16_t space = vdupq_n_u8(0x20);
+	const uint8x16_t high = vdupq_n_u8(0x80);
+	for (; i + 16 <= len; i += 16) {
+		const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p + i));
+		const uint8x16_t special = vorrq_u8(vorrq_u8(vcltq_u8(chunk, space), vcgeq_u8(chunk, high)), vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)));
+		if (vmaxvq_u8(special) != 0) {
+			break;
+		}
+	}
+#endif
+	/* Tail of the string, or the block in which the vector loop found something */
+	while (i < len && is_plain(static_cast<unsigned char>(p[i]))) {
+		++i;
+	}
+	return i;
+}
+
+/**
+ * @brief Append an escaped ASCII character which is not plain
+ * @param out buffer to append to
+ * @param c character
+ */
+void escape_ascii(std::string& out, unsigned char c) {
+	static constexpr char hex_digits[] = "0123456789abcdef";
+	switch (c) {
+		case '"':
+			out.append("\\\"", 2);
+			break;
+		case '\\':
+			out.append("\\\\", 2);
+			break;
+		case '\b':
+			out.append("\\b", 2);
+			break;
+		case '\t':
+			out.append("\\t", 2);
+			break;
+		case '\n':
+			out.append("\\n", 2);
+			break;
+		case '\f':
+			out.append("\\f", 2);
+			break;
+		case '\r':
+			out.append("\\r", 2);
+			break;
+		default: {
+			const char escaped[6] = {'\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0x0F]};
+			out.append(escaped, 6);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Copy one UTF-8 encoded code point, replacing it with U+FFFD if it is invalid.
+ * Invalid sequences are handled as nlohmann::json does with error_handler_t::replace:
+ * the valid prefix of a broken sequence is replaced, and the byte which broke it
+ * is examined again as the start of a new code point.
+ *
+ * @param out buffer to append to
+ * @param s string
+ * @param i index of the lead byte of the code point, which must be 0x80 or above
+ * @return size_t index of the byte after the code point
+ */
+size_t copy_utf8(std::string& out, std::string_view s, size_t i) {
+	const auto lead = static_cast<unsigned char>(s[i]);
+	size_t length;
+	unsigned char low = 0x80, high = 0xBF;
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+	} else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		/* Reject overlong encodings and UTF-16 surrogates */
+		if (lead == 0xE0) {
+			low = 0xA0;
+		} else if (lead == 0xED) {
+			high = 0x9F;
+		}
+	} else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		/* Reject overlong encodings and code points above U+10FFFF */
+		if (lead == 0xF0) {
+			low = 0x90;
+		} else if (lead == 0xF4) {
+			high = 0x8F;
+		}
+	} else {
+		/* Continuation byte or invalid lead byte */
+		out.append(replacement_character);
+		return i + 1;
+	}
+	for (size_t n = 1; n < length; ++n) {
+		if (i + n >= s.size()) {
+			out.append(replacement_character);
+			return s.size();
+		}
+		const auto c = static_cast<unsigned char>(s[i + n]);
+		if (c < low || c > high) {
+			out.append(replacement_character);
+			return i + n;
+		}
+		low = 0x80;
+		high = 0xBF;
+	}
+	out.append(s.data() + i, length);
+	return i + length;
+}
+
+}
+
+json_writer::json_writer(size_t reserve) {
+	buffer.reserve(reserve);
+}
+
+void json_writer::escape_string(std::string& out, std::string_view s) {
+	out.push_back('"');
+	size_t i = 0;
+	while (i < s.size()) {
+		const size_t run = plain_run(s.data() + i, s.size() - i);
+		out.append(s.data() + i, run);
+		i += run;
+		if (i >= s.size()) {
+			break;
+		}
+		const auto c = static_cast<unsigned char>(s[i]);
+		if (c < 0x80) {
+			escape_ascii(out, c);
+			++i;
+		} else {
+			i = copy_utf8(out, s, i);
+		}
+	}
+	out.push_back('"');
+}
+
+void json_writer::write_unsigned(uint64_t v) {
+	char digits[20];
+	char* p = digits + sizeof(digits);
+	do {
+		*--p = static_cast<char>('0' + (v % 10));
+		v /= 10;
+	} while (v != 0);
+	buffer.append(p, digits + sizeof(digits) - p);
+}
+
+void json_writer::write_signed(int64_t v) {
+	if (v < 0) {
+		buffer.push_back('-');
+		/* Negate as unsigned, so that the most negative value does not overflow */
+		write_unsigned(0 - static_cast<uint64_t>(v));
+	} else {
+		write_unsigned(static_cast<uint64_t>(v));
+	}
+}
+
+json_writer& json_writer::begin_object() {
+	separator();
+	buffer.push_back('{');
+	need_comma = false;
+	return *this;
+}
+
+json_writer& json_writer::end_object() {
+	buffer.push_back('}');
+	need_comma = true;
+	return *this;
+}
+
+json_writer& json_writer::begin_array() {
+	separator();
+	buffer.push_back('[');
+	need_comma = false;
+	return *this;
+}
+
+json_writer& json_writer::end_array() {
+	buffer.push_back(']');
+	need_comma = true;
+	return *this;
+}
+
+json_writer& json_writer::key(std::string_view k) {
+	separator();
+	escape_string(buffer, k);
+	buffer.push_back(':');
+	after_key = true;
+	return *this;
+}
+
+json_writer& json_writer::value(std::string_view v) {
+	separator();
+	escape_string(buffer, v);
+	return *this;
+}
+
+json_writer& json_writer::value(const char* v) {
+	return value(std::string_view(v));
+}
+
+json_writer& json_writer::value(const std::string& v) {
+	return value(std::string_view(v));
+}
+
+json_writer& json_writer::value(bool v) {
+	separator();
+	if (v) {
+		buffer.append("true", 4);
+	} else {
+		buffer.append("false", 5);
+	}
+	return *this;
+}
+
+json_writer& json_writer::value(double v) {
+	separator();
+	if (!std::isfinite(v)) {
+		buffer.append("null", 4);
+	} else {
+		/* Shortest round-trip formatting is left to nlohmann, so the output matches dump() exactly */
+		buffer.append(json(v).dump());
+	}
+	return *this;
+}
+
+json_writer& json_writer::value(std::nullptr_t) {
+	separator();
+	buffer.append("null", 4);
+	return *this;
+}
+
+const std::string& json_writer::str() const {
+	return buffer;
+}
+
+void json_writer::clear() {
+	buffer.clear();
+	need_comma = false;
+	after_key = false;
+}
+
+}
@@ -967,6 +967,16 @@ message& message::add_file(std::string_view fn, std::string_view fc, std::string
 	return *this;
 }
 
+message& message::add_file(std::string_view fn, std::shared_ptr<upload_source> source, std::string_view fm) {
+	message_file_data data;
+	data.name = fn;
+	data.source = std::move(source);
+	data.mimetype = fm;
+
+	file_data.push_back(data);
+	return *this;
+}
+
 message& message::set_content(std::string_view c)
 {
 	content = utility::utf8substr(c, 0, 4000);
@@ -1772,12 +1782,7 @@ json sticker_pack::to_json_impl(bool with_id) const {
 	j["description"] = description;
 	j["stickers"] = json::array();
 	for (auto& s : stickers) {
-		try {
-			j["stickers"].push_back(json::parse(s.second.build_json(with_id)));
-		}
-		catch (const std::exception &e) {
-			/* Protection against malformed json in sticker */
-		}
+		j["stickers"].push_back(s.second.to_json(with_id));
 	}
 	return j;
 }
@@ -0,0 +1,408 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/ogg_opus.h>
+#include <dpp/exception.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Length of the fixed part of an Ogg page header
+ */
+constexpr size_t ogg_header_size = 27;
+
+/**
+ * @brief Ogg page header flag: the first packet on the page continues one from the previous page
+ */
+constexpr uint8_t ogg_continued = 0x01;
+
+/**
+ * @brief Ogg page header flag: first page of a logical stream
+ */
+constexpr uint8_t ogg_first_page = 0x02;
+
+/**
+ * @brief Ogg page header flag: last page of a logical stream
+ */
+constexpr uint8_t ogg_last_page = 0x04;
+
+/**
+ * @brief Samples per channel after which a page of audio is closed, one second at 48kHz
+ */
+constexpr uint32_t ogg_page_samples = 48000;
+
+/**
+ * @brief Largest packet which fits on one page, which is limited to 255 lacing values
+ */
+constexpr size_t ogg_max_packet = 255 * 254;
+
+/**
+ * @brief CRC-32 lookup table for the Ogg page checksum: polynomial 0x04c11db7, not reflected
+ */
+const std::array<uint32_t, 256> ogg_crc_table = [] {
+	std::array<uint32_t, 256> table{};
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t r = i << 24;
+		for (int bit = 0; bit < 8; ++bit) {
+			r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+		}
+		table[i] = r;
+	}
+	return table;
+}();
+
+/**
+ * @brief Append a little endian value to a buffer
+ * @tparam T unsigned integer type
+ * @param out buffer to append to
+ * @param v value
+ */
+template <typename T>
+void append_le(std::string& out, T v) {
+	for (size_t i = 0; i < sizeof(T); ++i) {
+		out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+	}
+}
+
+/**
+ * @brief Read a little endian value from unaligned memory
+ * @tparam T unsigned integer type
+ * @param p memory to read
+ * @return T value
+ */
+template <typename T>
+T read_le(const char* p) {
+	T v{0};
+	for (size_t i = 0; i < sizeof(T); ++i) {
+		v |= static_cast<T>(static_cast<uint8_t>(p[i])) << (8 * i);
+	}
+	return v;
+}
+
+}
+
+ogg_opus_file::ogg_opus_file(const std::string& path) : ogg_opus_file(upload_source::from_file(path)) {
+}
+
+ogg_opus_file::ogg_opus_file(std::shared_ptr<upload_source> _source) : source(std::move(_source)) {
+	const uint64_t size = source->size();
+	std::string scratch;
+	content = source->read(0, static_cast<size_t>(size), scratch);
+	if (!scratch.empty() && content.data() == scratch.data()) {
+		/* The source read into scratch rather than returning a view of its own memory, so keep that copy */
+		content_copy = std::move(scratch);
+		content = content_copy;
+	}
+	index();
+}
+
+void ogg_opus_file::index() {
+	const char* data = content.data();
+	const size_t size = content.size();
+	size_t pos = 0;
+	bool have_serial = false;
+	uint32_t serial = 0;
+	/* Start of the packet being assembled on the current page, and its length so far */
+	size_t packet_start = 0;
+	size_t packet_length = 0;
+	/* Part of a packet carried over from earlier pages */
+	std::string pending;
+	bool pending_active = false;
+	size_t packet_number = 0;
+	uint64_t position = 0;
+
+	auto add_packet = [&](std::string_view packet, bool joined, uint64_t offset) {
+		if (packet_number == 0) {
+			if (packet.size() < 19 || packet.substr(0, 8) != "OpusHead") {
+				throw dpp::voice_exception(err_opus, "Not an Ogg Opus stream: missing OpusHead header");
+			}
+			channels = static_cast<uint8_t>(packet[9]);
+			pre_skip = read_le<uint16_t>(packet.data() + 10);
+		} else if (packet_number > 1) {
+			/* Packet 1 is OpusTags, everything after it is audio */
+			uint32_t samples = packet_samples(packet);
+			if (samples > 0) {
+				if (joined) {
+					offset = joined_packets.size();
+					joined_packets.append(packet);
+				}
+				packets.push_back(packet_entry{offset, static_cast<uint32_t>(packet.size()), samples, position, joined});
+				position += samples;
+			}
+		}
+		++packet_number;
+	};
+
+	while (pos + ogg_header_size <= size) {
+		if (std::memcmp(data + pos, "OggS", 4) != 0) {
+			throw dpp::voice_exception(err_opus, "Not an Ogg stream: bad page header at offset " + std::to_string(pos));
+		}
+		const uint8_t header_type = static_cast<uint8_t>(data[pos + 5]);
+		const uint32_t page_serial = read_le<uint32_t>(data + pos + 14);
+		const size_t segments = static_cast<uint8_t>(data[pos + 26]);
+		const char* lacing = data + pos + ogg_header_size;
+		size_t body = pos + ogg_header_size + segments;
+		if (body > size) {
+			break;
+		}
+		size_t body_length = 0;
+		for (size_t i = 0; i < segments; ++i) {
+			body_length += static_cast<uint8_t>(lacing[i]);
+		}
+		if (body + body_length > size) {
+			/* Truncated file, keep the complete pages */
+			break;
+		}
+		if (!have_serial) {
+			if (!(header_type & ogg_first_page)) {
+				throw dpp::voice_exception(err_opus, "Not an Ogg stream: first page does not begin a stream");
+			}
+			serial = page_serial;
+			have_serial = true;
+		}
+		if (page_serial == serial) {
+			if (pending_active && !(header_type & ogg_continued)) {
+				/* The rest of the carried over packet is missing */
+				pending.clear();
+				pending_active = false;
+			}
+			bool continuing = pending_active;
+			packet_start = body;
+			packet_length = 0;
+			size_t offset = body;
+			for (size_t i = 0; i < segments; ++i) {
+				const size_t segment = static_cast<uint8_t>(lacing[i]);
+				if (continuing) {
+					pending.append(data + offset, segment);
+				} else {
+					packet_length += segment;
+				}
+				offset += segment;
+				if (segment < 255) {
+					if (continuing) {
+						add_packet(pending, true, 0);
+						pending.clear();
+						pending_active = false;
+						continuing = false;
+					} else {
+						add_packet(std::string_view(data + packet_start, packet_length), false, packet_start);
+					}
+					packet_start = offset;
+					packet_length = 0;
+				}
+			}
+			if (!continuing && packet_length > 0) {
+				/* A packet which continues on the next page */
+				pending.assign(data + packet_start, packet_length);
+				pending_active = true;
+			}
+		}
+		pos = body + body_length;
+	}
+	if (packet_number == 0) {
+		throw dpp::voice_exception(err_opus, "Not an Ogg Opus stream: no packets found");
+	}
+}
+
+size_t ogg_opus_file::get_packet_count() const {
+	return packets.size();
+}
+
+std::string_view ogg_opus_file::get_packet(size_t index) const {
+	const packet_entry& p = packets[index];
+	if (p.joined) {
+		return std::string_view(joined_packets.data() + p.offset, p.length);
+	}
+	return content.substr(static_cast<size_t>(p.offset), p.length);
+}
+
+const ogg_opus_file::packet_entry& ogg_opus_file::get_packet_entry(size_t index) const {
+	return packets[index];
+}
+
+size_t ogg_opus_file::find_packet(uint64_t position_ms) const {
+	const uint64_t target = position_ms * 48;
+	auto i = std::upper_bound(packets.begin(), packets.end(), target, [](uint64_t t, const packet_entry& p) {
+		return t < p.position;
+	});
+	if (i == packets.begin()) {
+		return 0;
+	}
+	--i;
+	if (target >= i->position + i->samples) {
+		return packets.size();
+	}
+	return static_cast<size_t>(i - packets.begin());
+}
+
+uint64_t ogg_opus_file::get_duration_ms() const {
+	if (packets.empty()) {
+		return 0;
+	}
+	return (packets.back().position + packets.back().samples) / 48;
+}
+
+uint8_t ogg_opus_file::get_channels() const {
+	return channels;
+}
+
+uint16_t ogg_opus_file::get_pre_skip() const {
+	return pre_skip;
+}
+
+uint32_t ogg_opus_file::packet_samples(std::string_view packet) {
+	if (packet.empty()) {
+		return 0;
+	}
+	/* RFC 6716 section 3.1: the configuration in the TOC byte gives the frame size */
+	const uint8_t toc = static_cast<uint8_t>(packet[0]);
+	const uint8_t config = toc >> 3;
+	uint32_t frame_samples;
+	if (config < 12) {
+		/* SILK: 10, 20, 40 or 60ms */
+		static constexpr uint32_t silk[4] = {480, 960, 1920, 2880};
+		frame_samples = silk[config & 3];
+	} else if (config < 16) {
+		/* Hybrid: 10 or 20ms */
+		frame_samples = (config & 1) ? 960 : 480;
+	} else {
+		/* CELT: 2.5, 5, 10 or 20ms */
+		static constexpr uint32_t celt[4] = {120, 240, 480, 960};
+		frame_samples = celt[config & 3];
+	}
+	uint32_t frames;
+	switch (toc & 3) {
+		case 0:
+			frames = 1;
+			break;
+		case 1:
+		case 2:
+			frames = 2;
+			break;
+		default:
+			if (packet.size() < 2) {
+				return 0;
+			}
+			frames = static_cast<uint8_t>(packet[1]) & 0x3F;
+			break;
+	}
+	const uint32_t samples = frames * frame_samples;
+	/* A packet may not hold more than 120ms of audio */
+	return samples > 5760 ? 0 : samples;
+}
+
+ogg_opus_writer::ogg_opus_writer(uint8_t channels, uint32_t _serial) : serial(_serial) {
+	/* RFC 7845 section 5: each header packet is alone on its own page */
+	body.assign("OpusHead\x01", 9);
+	body.push_back(static_cast<char>(channels));
+	append_le<uint16_t>(body, 0);
+	append_le<uint32_t>(body, 48000);
+	append_le<uint16_t>(body, 0);
+	body.push_back(0);
+	lacing.push_back(static_cast<uint8_t>(body.size()));
+	flush_page(ogg_first_page);
+
+	body.assign("OpusTags", 8);
+	constexpr std::string_view vendor{"D++"};
+	append_le<uint32_t>(body, static_cast<uint32_t>(vendor.size()));
+	body.append(vendor);
+	append_le<uint32_t>(body, 0);
+	lacing.push_back(static_cast<uint8_t>(body.size()));
+	flush_page(0);
+}
+
+void ogg_opus_writer::flush_page(uint8_t header_type) {
+	const size_t start = output.size();
+	output.append("OggS\0", 5);
+	output.push_back(static_cast<char>(header_type));
+	append_le<uint64_t>(output, granule);
+	append_le<uint32_t>(output, serial);
+	append_le<uint32_t>(output, page_sequence++);
+	append_le<uint32_t>(output, 0);
+	output.push_back(static_cast<char>(lacing.size()));
+	output.append(reinterpret_cast<const char*>(lacing.data()), lacing.size());
+	output.append(body);
+
+	uint32_t crc = 0;
+	for (size_t i = start; i < output.size(); ++i) {
+		crc = (crc << 8) ^ ogg_crc_table[((crc >> 24) ^ static_cast<uint8_t>(output[i])) & 0xFF];
+	}
+	for (size_t i = 0; i < 4; ++i) {
+		output[start + 22 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+	}
+
+	lacing.clear();
+	body.clear();
+	page_samples = 0;
+}
+
+void ogg_opus_writer::write_packet(std::string_view packet, uint32_t samples) {
+	if (finished) {
+		throw dpp::voice_exception(err_opus, "Ogg Opus stream has already been finished");
+	}
+	if (packet.size() > ogg_max_packet) {
+		throw dpp::voice_exception(err_opus, "Opus packet is too large for an Ogg page");
+	}
+	const size_t segments = packet.size() / 255 + 1;
+	if (lacing.size() + segments > 255) {
+		flush_page(0);
+	}
+	for (size_t i = 0; i < segments - 1; ++i) {
+		lacing.push_back(255);
+	}
+	lacing.push_back(static_cast<uint8_t>(packet.size() % 255));
+	body.append(packet);
+	granule += samples;
+	page_samples += samples;
+	if (page_samples >= ogg_page_samples) {
+		flush_page(0);
+	}
+}
+
+void ogg_opus_writer::finish() {
+	if (finished) {
+		return;
+	}
+	/* An empty last page is allowed, and marks the end when the audio ended on a page boundary */
+	flush_page(ogg_last_page);
+	finished = true;
+}
+
+size_t ogg_opus_writer::output_size() const {
+	return output.size();
+}
+
+std::string ogg_opus_writer::take_output() {
+	std::string taken = std::move(output);
+	output.clear();
+	return taken;
+}
+
+uint64_t ogg_opus_writer::get_position() const {
+	return granule;
+}
+
+}
@@ -122,6 +122,8 @@ void http_request::complete(const http_request_completion_t &c) {
 void populate_result(const std::string &url, cluster* owner, http_request_completion_t& rv, const https_client &res) {
 	rv.status = res.get_status();
 	rv.body = res.get_content();
+	rv.compressed_bytes = res.get_compressed_bytes_in();
+	rv.decompressed_bytes = res.get_decompressed_bytes_in();
 	for (auto &v : res.get_headers()) {
 		rv.headers.emplace(v.first, v.second);
 	}
@@ -216,9 +218,9 @@ http_request_completion_t http_request::run(request_concurrency_queue* processor
 
 	multipart_content multipart;
 	if (non_discord) {
-		multipart = { postdata, mimetype };
+		multipart = { postdata, mimetype, {} };
 	} else {
-		multipart = https_client::build_multipart(postdata, file_name, file_content, file_mimetypes);
+		multipart = https_client::build_multipart(postdata, file_name, file_content, file_mimetypes, file_sources);
 	}
 	if (!multipart.mimetype.empty()) {
 		headers.emplace("Content-Type", multipart.mimetype);
@@ -231,7 +233,7 @@ http_request_completion_t http_request::run(request_concurrency_queue* processor
 			hci.port,
 			_url,
 			request_verb[method],
-			multipart.body,
+			multipart,
 			headers,
 			!hci.is_ssl,
 			owner->request_timeout,
@@ -245,8 +247,12 @@ http_request_completion_t http_request::run(request_concurrency_queue* processor
 				} else if (client->get_status() < 100) {
 					result.error = h_connection;
 					owner->log(ll_error, "HTTP(S) error on " + hci.scheme + " connection to " + request_verb[method] + " "  + hci.hostname + ":" + std::to_string(hci.port) + _url + ": Malformed HTTP response");
+				} else if (client->has_decompression_error()) {
+					result.error = h_compression;
 				}
 				populate_result(_url, owner, result, *client);
+				processor->requests->compressed_bytes_in += result.compressed_bytes;
+				processor->requests->decompressed_bytes_in += result.decompressed_bytes;
 				/* Set completion flag */
 
 				bucket_t newbucket;
@@ -262,6 +268,9 @@ http_request_completion_t http_request::run(request_concurrency_queue* processor
 				}
 				processor->buckets[this->endpoint] = newbucket;
 
+				double enqueued = queued_at > 0 ? queued_at : start;
+				processor->requests->record_latency(priority, start - enqueued, dpp::utility::time_f() - enqueued);
+
 				/* Transfer it to completed requests */
 				{
 					std::lock_guard<std::mutex> lock(this_captured_mutex);
@@ -284,7 +293,8 @@ http_request_completion_t http_request::run(request_concurrency_queue* processor
 					}
 					this_captured_signal.notify_all();
 				});
-			}
+			},
+			body_handler
 		);
 	}
 	catch (const std::exception& e) {
@@ -370,31 +380,58 @@ void request_concurrency_queue::tick_and_deliver_requests(uint32_t index)
 			});
 		}
 
+		/* Higher priority classes go first, oldest first within each class */
+		std::stable_sort(requests_view.begin(), requests_view.end(), [](const http_request* lhs, const http_request* rhs) {
+			if (lhs->priority != rhs->priority) {
+				return lhs->priority < rhs->priority;
+			}
+			return lhs->queued_at < rhs->queued_at;
+		});
+
+		/* Buckets holding back a request this tick. As requests are in priority order, the
+		 * lower priority requests for the same bucket wait behind it rather than taking its place.
+		 */
+		std::vector<std::string_view> held;
+
 		for (auto& request_view : requests_view) {
 			const std::string &key = request_view->endpoint;
 			http_request_completion_t rv;
+
+			if (std::find(held.begin(), held.end(), key) != held.end()) {
+				request_view->waiting = true;
+				continue;
+			}
+
 			auto currbucket = buckets.find(key);
 
 			if (currbucket != buckets.end()) {
+				bucket_t& bucket = currbucket->second;
 				/* There's a bucket for this request. Check its status. If the bucket says to wait,
 				 * skip all requests until the timer value indicates the rate limit won't be hit
 				 */
-				if (currbucket->second.remaining < 1) {
-					uint64_t wait = (currbucket->second.retry_after ? currbucket->second.retry_after : currbucket->second.reset_after);
-					if ((uint64_t)time(nullptr) > currbucket->second.timestamp + wait) {
-						/* Time has passed, we can process this bucket again. send its request. */
-						request_view->run(this, creator);
-					} else {
-						if (!request_view->waiting) {
-							request_view->waiting = true;
-						}
-						/* Time not up yet, wait more */
-						break;
+				if (bucket.remaining < 1) {
+					uint64_t wait = (bucket.retry_after ? bucket.retry_after : bucket.reset_after);
+					if ((uint64_t)time(nullptr) <= bucket.timestamp + wait) {
+						/* Time not up yet, wait more. Requests for other buckets in this queue may still be sent. */
+						request_view->waiting = true;
+						held.emplace_back(key);
+						continue;
+					}
+					/* Time has passed, the bucket has reset. Until a reply refreshes it, its limit
+					 * is all that can be sent, so that the requests sent first are the highest priority.
+					 */
+					if (bucket.limit > 0) {
+						bucket.remaining = bucket.limit;
+						bucket.timestamp = time(nullptr);
 					}
-				} else {
-					/* We aren't at the limit, so we can just run the request */
-					request_view->run(this, creator);
 				}
+				/* run() only starts the request, so count it against the bucket now rather than
+				 * when its reply arrives, or every request for the bucket would go out at once.
+				 */
+				if (bucket.remaining > 0) {
+					--bucket.remaining;
+				}
+				request_view->run(this, creator);
 			} else {
 				/* No bucket for this endpoint yet. Just send it, and make one from its reply */
 				request_view->run(this, creator);
@@ -432,6 +469,7 @@ void request_concurrency_queue::tick_and_deliver_requests(uint32_t index)
 /* Post a http_request into the queue */
 void request_concurrency_queue::post_request(std::unique_ptr<http_request> req)
 {
+	req->queued_at = dpp::utility::time_f();
 	{
 		std::scoped_lock lock(in_mutex);
 
@@ -475,6 +513,43 @@ bool request_queue::is_globally_ratelimited() const {
 	return this->globally_ratelimited;
 }
 
+void request_queue::record_latency(request_priority priority, double queue_time, double latency) {
+	if (priority >= rp_count) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	request_priority_stats& stats = priority_stats[priority];
+	stats.completed++;
+	stats.total_queue_time += queue_time;
+	stats.total_latency += latency;
+	stats.max_queue_time = std::max(stats.max_queue_time, queue_time);
+	stats.max_latency = std::max(stats.max_latency, latency);
+}
+
+request_priority_stats request_queue::get_priority_stats(request_priority priority) const {
+	if (priority >= rp_count) {
+		return {};
+	}
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	return priority_stats[priority];
+}
+
+double request_priority_stats::average_queue_time() const {
+	return completed ? total_queue_time / completed : 0;
+}
+
+double request_priority_stats::average_latency() const {
+	return completed ? total_latency / completed : 0;
+}
+
+uint64_t request_queue::get_compressed_bytes_in() const {
+	return compressed_bytes_in;
+}
+
+uint64_t request_queue::get_decompressed_bytes_in() const {
+	return decompressed_bytes_in;
+}
+
 size_t request_queue::get_active_request_count() const {
 	size_t total{};
 	for (auto& pool : requests_in) {
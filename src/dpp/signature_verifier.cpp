@@ -1,4 +1,3 @@
-#include <iostream>
 #include <string>
 #include <openssl/evp.h>
 #include <openssl/sha.h>
@@ -8,65 +7,168 @@
 namespace dpp {
 
 /**
- * @brief Converts a hex-encoded string to a byte vector.
- * @param hex The hex string to convert.
- * @return A vector containing the byte representation, or an empty vector on failure.
+ * @brief A parsed Ed25519 public key
  */
-std::vector<unsigned char> hex_to_bytes(const std::string& hex) {
-    if (hex.length() % 2 != 0) {
-	return {};
-    }
-
-    std::vector<unsigned char> bytes(hex.length() / 2);
-    for (size_t i = 0; i < hex.length(); i += 2) {
-	unsigned int byte;
-	if (sscanf(hex.c_str() + i, "%2x", &byte) != 1) {
-	    return {};
+struct ed25519_public_key {
+	/**
+	 * @brief OpenSSL key, which is safe to share between threads once created
+	 */
+	EVP_PKEY* pkey{nullptr};
+
+	explicit ed25519_public_key(EVP_PKEY* k) : pkey(k) {
+	}
+
+	~ed25519_public_key() {
+		EVP_PKEY_free(pkey);
+	}
+
+	ed25519_public_key(const ed25519_public_key&) = delete;
+	ed25519_public_key& operator=(const ed25519_public_key&) = delete;
+};
+
+namespace {
+
+/**
+ * @brief Value of a hex digit
+ * @param c digit
+ * @return int value, or -1 if not a hex digit
+ */
+inline int hex_value(char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
 	}
-	bytes[i / 2] = static_cast<unsigned char>(byte);
-    }
-    return bytes;
+	return -1;
 }
 
-signature_verifier::signature_verifier() {
-	OpenSSL_add_all_algorithms();
+/**
+ * @brief Decode a hex string of an exact length into a buffer
+ * @param hex The hex string to decode
+ * @param out Buffer to decode into
+ * @param length Number of bytes expected
+ * @return true if hex was exactly length bytes of valid hex
+ */
+bool hex_decode(std::string_view hex, unsigned char* out, size_t length) {
+	if (hex.length() != length * 2) {
+		return false;
+	}
+	for (size_t i = 0; i < length; ++i) {
+		int high = hex_value(hex[i * 2]), low = hex_value(hex[i * 2 + 1]);
+		if (high < 0 || low < 0) {
+			return false;
+		}
+		out[i] = static_cast<unsigned char>((high << 4) | low);
+	}
+	return true;
 }
 
-bool signature_verifier::verify_signature(const std::string& timestamp, const std::string& body, const std::string& signature_hex, const std::string& public_key_hex) {
+/**
+ * @brief Parse a hex encoded Ed25519 public key
+ * @param public_key_hex The hex-encoded public key
+ * @return std::shared_ptr<const ed25519_public_key> key, or empty if invalid
+ */
+std::shared_ptr<const ed25519_public_key> parse_key(std::string_view public_key_hex) {
+	unsigned char public_key[32];
+	if (!hex_decode(public_key_hex, public_key, sizeof(public_key))) {
+		return {};
+	}
+	EVP_PKEY* pkey = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, public_key, sizeof(public_key));
+	if (!pkey) {
+		return {};
+	}
+	return std::make_shared<const ed25519_public_key>(pkey);
+}
+
+/**
+ * @brief Verification state reused by each thread
+ */
+struct verify_context {
+	/**
+	 * @brief Digest context, reset between verifications rather than reallocated
+	 */
+	EVP_MD_CTX* md_ctx{EVP_MD_CTX_new()};
 
-	// Convert hex values to byte arrays
-	std::vector<unsigned char> public_key = hex_to_bytes(public_key_hex);
-	std::vector<unsigned char> signature = hex_to_bytes(signature_hex);
+	/**
+	 * @brief Timestamp and body of the request being verified. Ed25519 signs the whole
+	 * message in one pass, so OpenSSL needs it contiguous; the buffer keeps its capacity.
+	 */
+	std::string message;
 
-	if (public_key.size() != 32 || signature.size() != 64) {
-	    return false;
+	~verify_context() {
+		EVP_MD_CTX_free(md_ctx);
 	}
+};
 
-	// Create EVP_PKEY structure
-	EVP_PKEY* evp_public_key = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, public_key.data(), public_key.size());
-	if (!evp_public_key) {
-	    return false;
+/**
+ * @brief Verify one signature
+ * @param ctx Verification state for this thread
+ * @param key Public key
+ * @param timestamp The timestamp of the request
+ * @param body The body of the request
+ * @param signature_hex The hex-encoded signature
+ * @return true if valid
+ */
+bool verify(verify_context& ctx, const ed25519_public_key& key, std::string_view timestamp, std::string_view body, std::string_view signature_hex) {
+	unsigned char signature[64];
+	if (!ctx.md_ctx || !hex_decode(signature_hex, signature, sizeof(signature))) {
+		return false;
 	}
+	ctx.message.assign(timestamp);
+	ctx.message.append(body);
+	EVP_MD_CTX_reset(ctx.md_ctx);
+	return EVP_DigestVerifyInit(ctx.md_ctx, nullptr, nullptr, nullptr, key.pkey) == 1 &&
+		EVP_DigestVerify(ctx.md_ctx, signature, sizeof(signature), reinterpret_cast<const unsigned char*>(ctx.message.data()), ctx.message.size()) == 1;
+}
 
-	// Create EVP_MD_CTX for signature verification
-	EVP_MD_CTX* md_ctx = EVP_MD_CTX_new();
-	if (!md_ctx) {
-	    EVP_PKEY_free(evp_public_key);
-	    return false;
-	}
+/**
+ * @brief Get the verification state for the calling thread
+ * @return verify_context& state
+ */
+verify_context& thread_context() {
+	thread_local verify_context ctx;
+	return ctx;
+}
 
-	// Prepare the message (concatenate timestamp and body)
-	std::string message = timestamp + body;
+}
 
-	// Verify the signature
-	bool valid = (EVP_DigestVerifyInit(md_ctx, nullptr, nullptr, nullptr, evp_public_key) == 1 && EVP_DigestVerify(md_ctx, signature.data(), signature.size(), reinterpret_cast<const unsigned char*>(message.data()), message.size()) == 1);
+signature_verifier::signature_verifier() {
+	OpenSSL_add_all_algorithms();
+}
 
-	// Clean up
-	EVP_MD_CTX_free(md_ctx);
-	EVP_PKEY_free(evp_public_key);
+signature_verifier::signature_verifier(std::string_view public_key_hex) : key_hex(public_key_hex), key(parse_key(public_key_hex)) {
+	OpenSSL_add_all_algorithms();
+}
+
+std::shared_ptr<const ed25519_public_key> signature_verifier::get_key(std::string_view public_key_hex) const {
+	/* The cached key never changes after construction, so it can be compared without locking */
+	if (key && public_key_hex == key_hex) {
+		return key;
+	}
+	return parse_key(public_key_hex);
+}
 
-	return valid;
+bool signature_verifier::verify_signature(const std::string& timestamp, const std::string& body, const std::string& signature_hex, const std::string& public_key_hex) {
+	std::shared_ptr<const ed25519_public_key> k = get_key(public_key_hex);
+	return k && verify(thread_context(), *k, timestamp, body, signature_hex);
 }
 
+bool signature_verifier::verify_signature(std::string_view timestamp, std::string_view body, std::string_view signature_hex) const {
+	return key && verify(thread_context(), *key, timestamp, body, signature_hex);
 }
 
+std::vector<bool> signature_verifier::verify_signatures(const std::vector<signed_request>& requests) const {
+	std::vector<bool> results(requests.size(), false);
+	if (!key) {
+		return results;
+	}
+	verify_context& ctx = thread_context();
+	for (size_t i = 0; i < requests.size(); ++i) {
+		results[i] = verify(ctx, *key, requests[i].timestamp, requests[i].body, requests[i].signature);
+	}
+	return results;
+}
+
+}
@@ -496,7 +496,7 @@ void ssl_connection::on_write(socket fd, const struct socket_events& e) {
 				/* If we do, copy it to the raw buffer OpenSSL uses */
 				memcpy(&client_to_server_buffer, obuffer.data(), obuffer.length() > DPP_BUFSIZE ? DPP_BUFSIZE : obuffer.length());
 				client_to_server_length = obuffer.length() > DPP_BUFSIZE ? DPP_BUFSIZE : obuffer.length();
-				obuffer = obuffer.substr(client_to_server_length, obuffer.length());
+				obuffer.erase(0, client_to_server_length);
 				client_to_server_offset = 0;
 			}
 		}
@@ -550,17 +550,24 @@ void ssl_connection::on_write(socket fd, const struct socket_events& e) {
 			switch (err) {
 				case SSL_ERROR_NONE: {
 					/* We wrote some or all of the buffer */
-					std::lock_guard<std::mutex> lock(out_mutex);
-					client_to_server_length -= r;
-					client_to_server_offset += r;
-					bytes_out += r;
-					if (!obuffer.empty()) {
-						/* Still content to send? Request that we get a write event */
-						socket_events se{e};
-						se.flags = WANT_READ | WANT_WRITE | WANT_ERROR;
-						owner->socketengine->update_socket(se);
-						do_raw_trace("(OUT,SSL): <MORE BUFFER REMAINS>");
-					} else {
+					bool drained{false};
+					{
+						std::lock_guard<std::mutex> lock(out_mutex);
+						client_to_server_length -= r;
+						client_to_server_offset += r;
+						bytes_out += r;
+						if (!obuffer.empty()) {
+							/* Still content to send? Request that we get a write event */
+							socket_events se{e};
+							se.flags = WANT_READ | WANT_WRITE | WANT_ERROR;
+							owner->socketengine->update_socket(se);
+							do_raw_trace("(OUT,SSL): <MORE BUFFER REMAINS>");
+						} else {
+							drained = true;
+						}
+					}
+					/* Called outside the lock, as the handler may queue more output with socket_write() */
+					if (drained) {
 						on_buffer_drained();
 					}
 					do_raw_trace("(OUT,SSL): <OK>");
@@ -0,0 +1,247 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/upload_source.h>
+#include <dpp/exception.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Upload source over a region of memory
+ */
+class memory_upload_source : public upload_source {
+	/**
+	 * @brief Start of memory region
+	 */
+	const char* data;
+
+	/**
+	 * @brief Length of memory region
+	 */
+	size_t length;
+
+	/**
+	 * @brief Owner of the memory region, if any
+	 */
+	std::shared_ptr<const void> keep_alive;
+
+public:
+	memory_upload_source(const void* _data, size_t _length, std::shared_ptr<const void> owner)
+		: data(static_cast<const char*>(_data)), length(_length), keep_alive(std::move(owner)) {
+	}
+
+	uint64_t size() const override {
+		return length;
+	}
+
+	std::string_view read(uint64_t offset, size_t len, std::string&) const override {
+		if (offset >= length) {
+			return {};
+		}
+		return std::string_view(data + offset, std::min<uint64_t>(len, length - offset));
+	}
+};
+
+/**
+ * @brief Upload source reading on demand from a file descriptor
+ */
+class fd_upload_source : public upload_source {
+	/**
+	 * @brief File descriptor
+	 */
+	int fd;
+
+	/**
+	 * @brief True if fd is closed on destruction
+	 */
+	bool owned;
+
+	/**
+	 * @brief Size of file
+	 */
+	uint64_t length;
+
+#ifdef _WIN32
+	/**
+	 * @brief Windows has no pread(), so seek and read must be serialised
+	 */
+	mutable std::mutex read_mutex;
+#endif
+
+public:
+	fd_upload_source(int _fd, bool take_ownership, uint64_t _length) : fd(_fd), owned(take_ownership), length(_length) {
+	}
+
+	~fd_upload_source() override {
+		if (owned) {
+#ifdef _WIN32
+			_close(fd);
+#else
+			::close(fd);
+#endif
+		}
+	}
+
+	uint64_t size() const override {
+		return length;
+	}
+
+	std::string_view read(uint64_t offset, size_t len, std::string& scratch) const override {
+		if (offset >= length) {
+			return {};
+		}
+		len = static_cast<size_t>(std::min<uint64_t>(len, length - offset));
+		scratch.resize(len);
+		size_t done = 0;
+#ifdef _WIN32
+		std::lock_guard<std::mutex> lock(read_mutex);
+		if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) {
+			return {};
+		}
+#endif
+		while (done < len) {
+#ifdef _WIN32
+			int r = _read(fd, scratch.data() + done, static_cast<unsigned int>(len - done));
+#else
+			ssize_t r = ::pread(fd, scratch.data() + done, len - done, static_cast<off_t>(offset + done));
+#endif
+			if (r <= 0) {
+				break;
+			}
+			done += static_cast<size_t>(r);
+		}
+		return std::string_view(scratch.data(), done);
+	}
+};
+
+#ifndef _WIN32
+/**
+ * @brief Upload source over a read-only memory mapping of a file
+ */
+class mmap_upload_source : public upload_source {
+	/**
+	 * @brief Start of mapping
+	 */
+	void* mapping;
+
+	/**
+	 * @brief Length of mapping
+	 */
+	size_t length;
+
+public:
+	mmap_upload_source(void* _mapping, size_t _length) : mapping(_mapping), length(_length) {
+	}
+
+	~mmap_upload_source() override {
+		munmap(mapping, length);
+	}
+
+	uint64_t size() const override {
+		return length;
+	}
+
+	std::string_view read(uint64_t offset, size_t len, std::string&) const override {
+		if (offset >= length) {
+			return {};
+		}
+		return std::string_view(static_cast<const char*>(mapping) + offset, std::min<uint64_t>(len, length - offset));
+	}
+};
+#endif
+
+/**
+ * @brief Get the size of the file referred to by a file descriptor
+ * @param fd file descriptor
+ * @return uint64_t size in bytes
+ * @throw dpp::file_exception if the size cannot be determined
+ */
+uint64_t fd_size(int fd) {
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_fstat64(fd, &st) != 0) {
+#else
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+#endif
+		throw dpp::file_exception(err_unknown, "Unable to determine size of file descriptor " + std::to_string(fd) + ": " + strerror(errno));
+	}
+	return static_cast<uint64_t>(st.st_size);
+}
+
+}
+
+std::shared_ptr<upload_source> upload_source::from_file(const std::string& path) {
+#ifdef _WIN32
+	int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+#endif
+	if (fd < 0) {
+		throw dpp::file_exception(err_unknown, "Unable to open " + path + ": " + strerror(errno));
+	}
+	uint64_t length{0};
+	try {
+		length = fd_size(fd);
+	}
+	catch (const dpp::file_exception&) {
+#ifdef _WIN32
+		_close(fd);
+#else
+		::close(fd);
+#endif
+		throw;
+	}
+#ifndef _WIN32
+	if (length > 0) {
+		void* mapping = mmap(nullptr, static_cast<size_t>(length), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			/* The mapping holds its own reference to the file */
+			::close(fd);
+			return std::make_shared<mmap_upload_source>(mapping, static_cast<size_t>(length));
+		}
+	}
+#endif
+	return std::make_shared<fd_upload_source>(fd, true, length);
+}
+
+std::shared_ptr<upload_source> upload_source::from_fd(int fd, bool take_ownership) {
+	return std::make_shared<fd_upload_source>(fd, take_ownership, fd_size(fd));
+}
+
+std::shared_ptr<upload_source> upload_source::from_memory(const void* data, size_t length, std::shared_ptr<const void> keep_alive) {
+	return std::make_shared<memory_upload_source>(data, length, std::move(keep_alive));
+}
+
+}
@@ -0,0 +1,161 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <algorithm>
+#include <string_view>
+#include <dpp/exception.h>
+#include <dpp/discordvoiceclient.h>
+#include <dpp/voice_broadcast.h>
+#include <opus/opus.h>
+#include "enabled.h"
+
+namespace dpp {
+
+namespace detail {
+
+voice_broadcast_state::~voice_broadcast_state() {
+	if (encoder != nullptr) {
+		opus_encoder_destroy(encoder);
+	}
+}
+
+}
+
+voice_broadcast::voice_broadcast() : state(std::make_shared<detail::voice_broadcast_state>()) {
+	int opus_error = 0;
+	state->encoder = opus_encoder_create(opus_sample_rate_hz, opus_channel_count, OPUS_APPLICATION_VOIP, &opus_error);
+	if (opus_error) {
+		throw dpp::voice_exception(err_opus, "voice_broadcast::voice_broadcast; opus_encoder_create() failed");
+	}
+	state->encode_buffer.resize(65536);
+}
+
+voice_broadcast::~voice_broadcast() {
+	std::lock_guard lk(state->mtx);
+	for (discord_voice_client* client : state->subscribers) {
+		std::lock_guard<std::mutex> lock(client->stream_mutex);
+		client->broadcasts.erase(std::remove_if(client->broadcasts.begin(), client->broadcasts.end(), [this](const std::weak_ptr<detail::voice_broadcast_state>& b) {
+			return b.expired() || b.lock() == state;
+		}), client->broadcasts.end());
+	}
+	state->subscribers.clear();
+}
+
+voice_broadcast& voice_broadcast::subscribe(discord_voice_client* client) {
+	std::lock_guard lk(state->mtx);
+	if (std::find(state->subscribers.begin(), state->subscribers.end(), client) == state->subscribers.end()) {
+		state->subscribers.push_back(client);
+		std::lock_guard<std::mutex> lock(client->stream_mutex);
+		client->broadcasts.emplace_back(state);
+	}
+	return *this;
+}
+
+voice_broadcast& voice_broadcast::unsubscribe(discord_voice_client* client) {
+	std::lock_guard lk(state->mtx);
+	auto i = std::find(state->subscribers.begin(), state->subscribers.end(), client);
+	if (i != state->subscribers.end()) {
+		state->subscribers.erase(i);
+		std::lock_guard<std::mutex> lock(client->stream_mutex);
+		client->broadcasts.erase(std::remove_if(client->broadcasts.begin(), client->broadcasts.end(), [this](const std::weak_ptr<detail::voice_broadcast_state>& b) {
+			return b.expired() || b.lock() == state;
+		}), client->broadcasts.end());
+	}
+	return *this;
+}
+
+size_t voice_broadcast::get_subscriber_count() const {
+	std::lock_guard lk(state->mtx);
+	return state->subscribers.size();
+}
+
+voice_broadcast& voice_broadcast::send_audio_raw(uint16_t* audio_data, const size_t length) {
+	if (length < 4) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size can't be less than 4");
+	}
+
+	if ((length % 4) != 0) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size should be divisible by 4");
+	}
+
+	if (length > send_audio_raw_max_length) {
+		/* Send whole frames straight from the caller's buffer, and pad the remainder */
+		size_t offset = 0;
+		for (; offset + send_audio_raw_max_length <= length; offset += send_audio_raw_max_length) {
+			send_audio_raw(reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(audio_data) + offset), send_audio_raw_max_length);
+		}
+		if (offset < length) {
+			send_audio_raw(reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(audio_data) + offset), length - offset);
+		}
+		return *this;
+	}
+
+	if (length < send_audio_raw_max_length) {
+		std::string packet(reinterpret_cast<const char*>(audio_data), length);
+		packet.resize(send_audio_raw_max_length, 0);
+
+		return send_audio_raw(reinterpret_cast<uint16_t*>(packet.data()), packet.size());
+	}
+
+	std::lock_guard lk(state->mtx);
+	if (state->subscribers.empty()) {
+		return *this;
+	}
+
+	/*
+	 * A full buffer is one opus frame of 2880 samples per channel. discord_voice_client::encode()
+	 * passes a single frame through the repacketizer, which leaves it as it is, so it isn't needed here.
+	 */
+	constexpr int frame_samples = 2880;
+	int packet_length = opus_encode(state->encoder, reinterpret_cast<const opus_int16*>(audio_data), frame_samples, state->encode_buffer.data(), static_cast<opus_int32>(state->encode_buffer.size()));
+	if (packet_length <= 0) {
+		throw dpp::voice_exception(err_opus, "voice_broadcast::send_audio_raw; opus_encode(): " + std::string(opus_strerror(packet_length)));
+	}
+
+	for (discord_voice_client* client : state->subscribers) {
+		if (client->is_ready()) {
+			client->send_audio_opus(state->encode_buffer.data(), static_cast<size_t>(packet_length));
+		}
+	}
+	return *this;
+}
+
+voice_broadcast& voice_broadcast::send_audio_opus(const uint8_t* opus_packet, const size_t length) {
+	std::lock_guard lk(state->mtx);
+	for (discord_voice_client* client : state->subscribers) {
+		if (client->is_ready()) {
+			client->send_audio_opus(opus_packet, length);
+		}
+	}
+	return *this;
+}
+
+voice_broadcast& voice_broadcast::insert_marker(const std::string& metadata) {
+	std::lock_guard lk(state->mtx);
+	for (discord_voice_client* client : state->subscribers) {
+		if (client->is_ready()) {
+			client->insert_marker(metadata);
+		}
+	}
+	return *this;
+}
+
+}
@@ -20,6 +20,7 @@
  *
  ************************************************************************************/
 
+#include <algorithm>
 #include <string_view>
 #include <fstream>
 #include <dpp/exception.h>
@@ -41,6 +42,27 @@ void discord_voice_client::cleanup()
 		opus_repacketizer_destroy(repacketizer);
 		repacketizer = nullptr;
 	}
+	std::vector<std::weak_ptr<detail::voice_broadcast_state>> subscribed;
+	{
+		std::lock_guard<std::mutex> lock(this->stream_mutex);
+		subscribed.swap(broadcasts);
+	}
+	for (auto& weak_state : subscribed) {
+		/* Leave the broadcast, waiting for it if it is passing audio to us right now */
+		if (auto state = weak_state.lock()) {
+			std::lock_guard lk(state->mtx);
+			state->subscribers.erase(std::remove(state->subscribers.begin(), state->subscribers.end(), this), state->subscribers.end());
+		}
+	}
+	if (decode_pool) {
+		{
+			std::lock_guard lk(voice_courier_shared_state.mtx);
+			voice_courier_shared_state.terminating = true;
+		}
+		decode_pool->cancel(this);
+		/* Deliver whatever was received since the pool last flushed this connection */
+		deliver_parked_payloads(*this, voice_courier_shared_state);
+	}
 	if (voice_courier.joinable()) {
 		{
 			std::lock_guard lk(voice_courier_shared_state.mtx);
@@ -49,6 +71,9 @@ void discord_voice_client::cleanup()
 		voice_courier_shared_state.signal_iteration.notify_one();
 		voice_courier.join();
 	}
+	cancel_parallel_encodes();
+	/* Complete any recording files */
+	stop_opus_recording();
 	if (fd != INVALID_SOCKET) {
 		owner->socketengine->delete_socket(fd);
 	}
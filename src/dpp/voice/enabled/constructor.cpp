@@ -45,10 +45,7 @@ discord_voice_client::discord_voice_client(dpp::cluster* _cluster, full_reconnec
 	encoder(nullptr),
 	repacketizer(nullptr),
 	fd(INVALID_SOCKET),
-	sequence(0),
 	receive_sequence(-1),
-	timestamp(0),
-	packet_nonce(1),
 	last_timestamp(std::chrono::high_resolution_clock::now()),
 	sending(false),
 	tracks(0),
@@ -63,6 +60,7 @@ discord_voice_client::discord_voice_client(dpp::cluster* _cluster, full_reconnec
 	server_id(_server_id),
 	channel_id(_channel_id)
 {
+	decode_pool = _cluster->voice_decoders;
 	setup();
 }
 
@@ -392,8 +392,8 @@ bool discord_voice_client::handle_frame(const std::string &data, ws_opcode opcod
 				}
 				has_secret_key = true;
 
-				/* Reset packet_nonce */
-				packet_nonce = 1;
+				/* The new key starts its nonces from 1 */
+				send_sequence.reset_nonce();
 
 				bool ready_now = false;
 
@@ -0,0 +1,212 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <dpp/exception.h>
+#include <dpp/cluster.h>
+#include <dpp/discordvoiceclient.h>
+#include <opus/opus.h>
+#include "enabled.h"
+
+namespace dpp {
+
+namespace detail {
+
+/**
+ * @brief State of the send mixer of a voice client
+ */
+struct send_mixer_state {
+	/**
+	 * @brief Protects everything below, and is held while frames are mixed and encoded
+	 */
+	std::mutex mutex;
+
+	/**
+	 * @brief Sources and their audio
+	 */
+	voice_mixer mixer;
+
+	/**
+	 * @brief Encoder of the mixed audio, separate from the voice client's so neither disturbs the other's state
+	 */
+	std::unique_ptr<OpusEncoder, decltype(&opus_encoder_destroy)> encoder{nullptr, &opus_encoder_destroy};
+
+	/**
+	 * @brief Client the mixed audio is sent on, nullptr once the client is being destroyed
+	 */
+	discord_voice_client* client{nullptr};
+
+	/**
+	 * @brief True while mixing is queued on the thread pool and has not started yet
+	 */
+	std::atomic<bool> scheduled{false};
+};
+
+}
+
+std::shared_ptr<detail::send_mixer_state> discord_voice_client::get_send_mixer() {
+	std::lock_guard<std::mutex> lock(this->send_mixer_mutex);
+	return send_mixer;
+}
+
+uint32_t discord_voice_client::add_mixer_source(const voice_mixer_source_options& options) {
+	std::shared_ptr<detail::send_mixer_state> state;
+	{
+		std::lock_guard<std::mutex> lock(this->send_mixer_mutex);
+		if (!send_mixer) {
+			auto new_state = std::make_shared<detail::send_mixer_state>();
+			int opus_error = 0;
+			new_state->encoder.reset(opus_encoder_create(opus_sample_rate_hz, opus_channel_count, OPUS_APPLICATION_AUDIO, &opus_error));
+			if (opus_error || !new_state->encoder) {
+				throw dpp::voice_exception(err_opus, "discord_voice_client::add_mixer_source; opus_encoder_create() failed");
+			}
+			new_state->client = this;
+			send_mixer = std::move(new_state);
+		}
+		state = send_mixer;
+	}
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->mixer.add_source(options);
+}
+
+discord_voice_client& discord_voice_client::remove_mixer_source(uint32_t source_id) {
+	if (auto state = get_send_mixer()) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->mixer.remove_source(source_id);
+	}
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::set_mixer_source_options(uint32_t source_id, const voice_mixer_source_options& options) {
+	if (auto state = get_send_mixer()) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->mixer.set_source_options(source_id, options);
+	}
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::send_mixer_audio(uint32_t source_id, const uint16_t* audio_data, size_t length) {
+	if (length < 4) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size can't be less than 4");
+	}
+
+	if ((length % 4) != 0) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size should be divisible by 4");
+	}
+
+	auto state = get_send_mixer();
+	if (!state) {
+		return *this;
+	}
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		if (!state->mixer.send_audio(source_id, reinterpret_cast<const int16_t*>(audio_data), length / sizeof(int16_t))) {
+			return *this;
+		}
+	}
+	refill_send_mixer();
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::flush_mixer_source(uint32_t source_id) {
+	auto state = get_send_mixer();
+	if (!state) {
+		return *this;
+	}
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		if (!state->mixer.flush_source(source_id)) {
+			return *this;
+		}
+	}
+	refill_send_mixer();
+	return *this;
+}
+
+uint64_t discord_voice_client::get_mixer_source_buffered_ms(uint32_t source_id) {
+	auto state = get_send_mixer();
+	if (!state) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->mixer.get_buffered(source_id) / opus_channel_count / (opus_sample_rate_hz / 1000);
+}
+
+void discord_voice_client::clear_send_mixer_audio() {
+	if (auto state = get_send_mixer()) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->mixer.clear();
+	}
+}
+
+void discord_voice_client::refill_send_mixer() {
+	auto state = get_send_mixer();
+	if (!state) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> stream_lock(this->stream_mutex);
+		if (outbuf.size() >= send_mixer_queue_low) {
+			return;
+		}
+	}
+	if (state->scheduled.exchange(true)) {
+		return;
+	}
+	/* Mixing and encoding take a while, so they are kept off the socket engine's thread */
+	creator->queue_work(1, [state]() {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->scheduled = false;
+		if (state->client) {
+			state->client->mix_send_frames(*state);
+		}
+	});
+}
+
+void discord_voice_client::mix_send_frames(detail::send_mixer_state& state) {
+	size_t queued = 0;
+	{
+		std::lock_guard<std::mutex> stream_lock(this->stream_mutex);
+		queued = outbuf.size();
+	}
+	uint8_t packet[4000];
+	for (; queued < send_mixer_queue_high && state.mixer.mix_frame(); ++queued) {
+		const int length = opus_encode(state.encoder.get(), state.mixer.get_frame(), static_cast<int>(voice_mixer::frame_samples), packet, sizeof(packet));
+		if (length <= 0) {
+			log(ll_warning, "mix_send_frames(): opus_encode(): " + std::string(opus_strerror(length)));
+			return;
+		}
+		send_audio_opus(packet, static_cast<size_t>(length));
+	}
+}
+
+void discord_voice_client::detach_send_mixer() {
+	if (auto state = get_send_mixer()) {
+		/* Waits for mixing which is running now, and any which starts later finds no client */
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->client = nullptr;
+	}
+}
+
+}
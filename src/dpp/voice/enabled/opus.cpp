@@ -80,79 +80,89 @@ discord_voice_client& discord_voice_client::send_audio_opus(const uint8_t* opus_
 
 discord_voice_client& discord_voice_client::send_audio_opus(const uint8_t* opus_packet, const size_t length, uint64_t duration, bool send_now) {
 	int frame_size = (int)(48 * duration * (timescale / 1000000));
-	opus_int32 encoded_audio_max_length = (opus_int32)length;
-	std::vector<uint8_t> encoded_audio(encoded_audio_max_length);
-	size_t encoded_audio_length = encoded_audio_max_length;
-
-	encoded_audio_length = length;
-	encoded_audio.reserve(length);
-	memcpy(encoded_audio.data(), opus_packet, length);
-
-	if (this->is_end_to_end_encrypted()) {
-
-		std::vector<uint8_t> encrypted_buffer(this->mls_state->encryptor->get_max_ciphertext_byte_size(dave::media_type::media_audio, length));
-		size_t out_size{0};
-
-		auto result = this->mls_state->encryptor->encrypt(
-			dave::media_type::media_audio,
-			ssrc,
-			dave::make_array_view<const uint8_t>(encoded_audio.data(), length),
-			dave::make_array_view(encrypted_buffer),
-			&out_size
-		);
-		encrypted_buffer.resize(out_size);
-		if (result != dave::encryptor::result_code::rc_success) {
-			log(ll_warning, "DAVE Encryption failure: " + std::to_string(result));
-		} else {
-			encoded_audio = encrypted_buffer;
-			encoded_audio_length = encrypted_buffer.size();
+	bool was_empty = false;
+
+	/* The packet is encrypted and queued under the sequencer's lock, so packets sent from several threads at once are numbered and queued in order */
+	send_sequence.next(static_cast<uint32_t>(frame_size), [&](uint16_t sequence, uint32_t timestamp, uint32_t packet_nonce) {
+		const uint8_t* encoded_audio = opus_packet;
+		size_t encoded_audio_length = length;
+
+		if (this->is_end_to_end_encrypted()) {
+
+			dave_send_buffer.resize(this->mls_state->encryptor->get_max_ciphertext_byte_size(dave::media_type::media_audio, length));
+			size_t out_size{0};
+
+			auto result = this->mls_state->encryptor->encrypt(
+				dave::media_type::media_audio,
+				ssrc,
+				dave::make_array_view<const uint8_t>(opus_packet, length),
+				dave::make_array_view(dave_send_buffer),
+				&out_size
+			);
+			if (result != dave::encryptor::result_code::rc_success) {
+				log(ll_warning, "DAVE Encryption failure: " + std::to_string(result));
+			} else {
+				encoded_audio = dave_send_buffer.data();
+				encoded_audio_length = out_size;
+			}
 		}
-	}
 
-	++sequence;
-	rtp_header header(sequence, timestamp, (uint32_t)ssrc);
-
-	/* Expected payload size is unencrypted header + encrypted opus packet + unencrypted 32 bit nonce */
-	size_t packet_siz = sizeof(header) + (encoded_audio_length + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES) + sizeof(packet_nonce);
-
-	std::vector<uint8_t> payload(packet_siz);
-
-	/* Set RTP header */
-	std::memcpy(payload.data(), &header, sizeof(header));
-
-	/* Convert nonce to big-endian */
-	uint32_t noncel = htonl(packet_nonce);
-
-	/* 24 byte is needed for encrypting, discord just want 4 byte so just fill up the rest with null */
-	unsigned char encrypt_nonce[ssl_crypto_aead_xchacha20poly1305_ietf_NPUBBYTES] = { '\0' };
-	memcpy(encrypt_nonce, &noncel, sizeof(noncel));
-
-	  /* Execute */
-	unsigned long long int clen{0};
-	if (ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(
-		payload.data() + sizeof(header),
-		&clen,
-		encoded_audio.data(),
-		encoded_audio_length,
-		/* The RTP Header as Additional Data */
-		reinterpret_cast<const unsigned char *>(&header),
-		sizeof(header),
-		nullptr,
-		static_cast<const unsigned char*>(encrypt_nonce),
-		secret_key.data()
-	) != 0) {
-		log(dpp::ll_debug, "XChaCha20 Encryption failed");
-	}
-
-	/* Append the 4 byte nonce to the resulting payload */
-	std::memcpy(payload.data() + payload.size() - sizeof(noncel), &noncel, sizeof(noncel));
-
-	this->send(reinterpret_cast<const char *>(payload.data()), payload.size(), duration, send_now);
+		rtp_header header(sequence, timestamp, (uint32_t)ssrc);
+
+		/* Expected payload size is unencrypted header + encrypted opus packet + unencrypted 32 bit nonce */
+		size_t packet_siz = sizeof(header) + (encoded_audio_length + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES) + sizeof(packet_nonce);
+
+		/* Convert nonce to big-endian */
+		uint32_t noncel = htonl(packet_nonce);
+
+		/* 24 byte is needed for encrypting, discord just want 4 byte so just fill up the rest with null */
+		unsigned char encrypt_nonce[ssl_crypto_aead_xchacha20poly1305_ietf_NPUBBYTES] = { '\0' };
+		memcpy(encrypt_nonce, &noncel, sizeof(noncel));
+
+		/* Build the packet directly in the buffer it is sent from */
+		auto seal = [&](uint8_t* payload) {
+			/* Set RTP header */
+			std::memcpy(payload, &header, sizeof(header));
+
+			/* Execute */
+			unsigned long long int clen{0};
+			if (ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(
+				payload + sizeof(header),
+				&clen,
+				encoded_audio,
+				encoded_audio_length,
+				/* The RTP Header as Additional Data */
+				reinterpret_cast<const unsigned char *>(&header),
+				sizeof(header),
+				nullptr,
+				static_cast<const unsigned char*>(encrypt_nonce),
+				secret_key.data()
+			) != 0) {
+				log(dpp::ll_debug, "XChaCha20 Encryption failed");
+			}
 
-	timestamp += frame_size;
+			/* Append the 4 byte nonce to the resulting payload */
+			std::memcpy(payload + packet_siz - sizeof(noncel), &noncel, sizeof(noncel));
+		};
+
+		if (!send_now) [[likely]] {
+			std::lock_guard<std::mutex> lock(this->stream_mutex);
+			was_empty = outbuf.empty();
+			voice_out_packet& frame = outbuf.emplace_back();
+			frame.packet.resize(packet_siz);
+			frame.duration = duration;
+			seal(reinterpret_cast<uint8_t*>(frame.packet.data()));
+		} else [[unlikely]] {
+			immediate_send_buffer.resize(packet_siz);
+			seal(immediate_send_buffer.data());
+			this->udp_send(reinterpret_cast<const char *>(immediate_send_buffer.data()), packet_siz);
+		}
+	});
 
-	/* Increment for next packet */
-	packet_nonce++;
+	if (was_empty) {
+		udp_events.flags = WANT_READ | WANT_WRITE | WANT_ERROR;
+		owner->socketengine->update_socket(udp_events);
+	}
 
 	speak();
 	return *this;
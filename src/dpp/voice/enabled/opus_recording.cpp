@@ -0,0 +1,319 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string_view>
+#include <dpp/exception.h>
+#include <dpp/discordvoiceclient.h>
+#include <dpp/ogg_opus.h>
+#include "enabled.h"
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Packets held back waiting for a late packet before the gap is skipped, 100ms of audio
+ */
+constexpr size_t jitter_packets = 5;
+
+/**
+ * @brief Output buffered for a file before it is handed to the thread pool to write, a few seconds of audio
+ */
+constexpr size_t write_threshold = 32 * 1024;
+
+/**
+ * @brief Longest silence filled in one go, one hour at 48kHz. Longer gaps are shortened to this.
+ */
+constexpr uint32_t max_fill_samples = 48000 * 3600;
+
+/**
+ * @brief Length of the empty frames which fill silence, 20ms at 48kHz
+ */
+constexpr uint32_t fill_samples = 960;
+
+}
+
+namespace detail {
+
+/**
+ * @brief A recording file, written to in order by the thread pool
+ */
+struct opus_recording_file {
+	/**
+	 * @brief Held while writing, so that chunks queued by different work units are written in order
+	 */
+	std::mutex write_mutex;
+
+	/**
+	 * @brief Protects pending
+	 */
+	std::mutex pending_mutex;
+
+	/**
+	 * @brief Output waiting to be written
+	 */
+	std::string pending;
+
+	/**
+	 * @brief The file
+	 */
+	std::ofstream out;
+};
+
+/**
+ * @brief Recording of one user
+ */
+struct opus_recording_track {
+	/**
+	 * @brief Ogg stream being built
+	 */
+	ogg_opus_writer writer;
+
+	/**
+	 * @brief File the stream is written to, or empty if it could not be opened
+	 */
+	std::shared_ptr<opus_recording_file> file;
+
+	/**
+	 * @brief Packets received ahead of a missing one, by count of packets since the first
+	 */
+	std::map<uint32_t, std::pair<uint32_t, std::string>> held;
+
+	/**
+	 * @brief Count since the first packet of the next packet to write
+	 */
+	uint32_t next_index{0};
+
+	/**
+	 * @brief RTP sequence number of the next packet to write
+	 */
+	uint16_t next_seq{0};
+
+	/**
+	 * @brief RTP timestamp at which the next packet should start, if it follows without a gap
+	 */
+	uint32_t next_timestamp{0};
+
+	/**
+	 * @brief TOC byte of the empty frames which fill gaps: 20ms CELT, stereo if the user's audio is
+	 */
+	uint8_t fill_toc{0xFC};
+
+	/**
+	 * @brief True once a packet has been written, so next_timestamp is known
+	 */
+	bool started{false};
+};
+
+/**
+ * @brief State of discord_voice_client::start_opus_recording()
+ */
+struct opus_recording_state {
+	/**
+	 * @brief Chooses the path of each user's file
+	 */
+	std::function<std::string(snowflake)> path_for_user;
+
+	/**
+	 * @brief Recordings by user
+	 */
+	std::map<snowflake, opus_recording_track> tracks;
+};
+
+}
+
+namespace {
+
+/**
+ * @brief Write whatever is pending for a file. Runs on the thread pool.
+ * @param file file to write
+ */
+void write_pending(const std::shared_ptr<detail::opus_recording_file>& file) {
+	std::lock_guard write_lock(file->write_mutex);
+	std::string chunk;
+	{
+		std::lock_guard pending_lock(file->pending_mutex);
+		chunk.swap(file->pending);
+	}
+	if (!chunk.empty()) {
+		file->out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+		file->out.flush();
+	}
+}
+
+/**
+ * @brief Hand a track's output to the thread pool to be written
+ * @param owner cluster whose thread pool writes the file
+ * @param track track to write
+ */
+void queue_output(cluster* owner, detail::opus_recording_track& track) {
+	std::string output = track.writer.take_output();
+	if (!track.file) {
+		return;
+	}
+	{
+		std::lock_guard pending_lock(track.file->pending_mutex);
+		track.file->pending.append(output);
+	}
+	owner->queue_work(0, [file = track.file]() {
+		write_pending(file);
+	});
+}
+
+/**
+ * @brief Write a packet in sequence, first filling any gap in time since the previous one
+ * @param track track to write to
+ * @param timestamp RTP timestamp of the packet
+ * @param packet opus packet
+ */
+void write_in_sequence(detail::opus_recording_track& track, uint32_t timestamp, std::string_view packet) {
+	const uint32_t samples = ogg_opus_file::packet_samples(packet);
+	if (samples == 0) {
+		return;
+	}
+	if (track.started) {
+		/* Lost packets and pauses in speech show as a jump in the timestamp */
+		const auto gap = static_cast<int32_t>(timestamp - track.next_timestamp);
+		if (gap > 0) {
+			const char fill = static_cast<char>(track.fill_toc);
+			for (uint32_t remaining = std::min<uint32_t>(static_cast<uint32_t>(gap), max_fill_samples); remaining >= fill_samples; remaining -= fill_samples) {
+				/* A TOC byte with no frame data decodes as a lost frame */
+				track.writer.write_packet(std::string_view(&fill, 1), fill_samples);
+			}
+		}
+	}
+	track.writer.write_packet(packet, samples);
+	track.next_timestamp = timestamp + samples;
+	track.fill_toc = 0xF8 | (static_cast<uint8_t>(packet[0]) & 0x04);
+	track.started = true;
+}
+
+/**
+ * @brief Write held packets which are next in sequence, or all of them if the wait for a missing one is over
+ * @param track track to write to
+ * @param all true to write every held packet, skipping any missing
+ */
+void drain_held(detail::opus_recording_track& track, bool all) {
+	while (!track.held.empty()) {
+		auto first = track.held.begin();
+		if (first->first != track.next_index && !all && track.held.size() <= jitter_packets) {
+			break;
+		}
+		track.next_seq = static_cast<uint16_t>(track.next_seq + (first->first - track.next_index) + 1);
+		track.next_index = first->first + 1;
+		write_in_sequence(track, first->second.first, first->second.second);
+		track.held.erase(first);
+	}
+}
+
+}
+
+discord_voice_client& discord_voice_client::start_opus_recording(std::function<std::string(snowflake)> path_for_user) {
+	stop_opus_recording();
+	auto state = std::make_shared<detail::opus_recording_state>();
+	state->path_for_user = std::move(path_for_user);
+	std::lock_guard lk(opus_recording_mutex);
+	opus_recording = std::move(state);
+	opus_recording_active = true;
+	return *this;
+}
+
+discord_voice_client& discord_voice_client::start_opus_recording(const std::string& directory) {
+	return start_opus_recording([directory](snowflake user_id) {
+		return directory + "/" + user_id.str() + ".opus";
+	});
+}
+
+discord_voice_client& discord_voice_client::stop_opus_recording() {
+	std::shared_ptr<detail::opus_recording_state> state;
+	{
+		std::lock_guard lk(opus_recording_mutex);
+		state.swap(opus_recording);
+		opus_recording_active = false;
+	}
+	if (!state) {
+		return *this;
+	}
+	for (auto& [user_id, track] : state->tracks) {
+		drain_held(track, true);
+		track.writer.finish();
+		queue_output(creator, track);
+	}
+	return *this;
+}
+
+bool discord_voice_client::is_recording_opus() const {
+	return opus_recording_active;
+}
+
+void discord_voice_client::record_opus_packet(const uint8_t* buffer, size_t packet_size, snowflake user_id, rtp_seq_t seq, rtp_timestamp_t timestamp) {
+	if (user_id.empty()) {
+		/* Speaker not yet known from the voice websocket */
+		return;
+	}
+
+	uint8_t decrypted[udp_slot_size];
+	thread_local std::vector<uint8_t> dave_frame;
+	uint8_t* opus_packet = nullptr;
+	size_t opus_packet_len = 0;
+	if (packet_size > udp_slot_size || !decrypt_rtp_payload(buffer, packet_size, user_id, decrypted, dave_frame, opus_packet, opus_packet_len) || opus_packet_len == 0) {
+		return;
+	}
+
+	std::lock_guard lk(opus_recording_mutex);
+	if (!opus_recording) {
+		return;
+	}
+	auto [it, created] = opus_recording->tracks.try_emplace(user_id);
+	detail::opus_recording_track& track = it->second;
+	if (created) {
+		const std::string path = opus_recording->path_for_user(user_id);
+		auto file = std::make_shared<detail::opus_recording_file>();
+		file->out.open(path, std::ios::binary | std::ios::trunc);
+		if (file->out.is_open()) {
+			track.file = std::move(file);
+		} else {
+			/* The track is kept without a file, so the open is not retried for every packet */
+			log(ll_error, "Unable to open " + path + " to record voice of user " + user_id.str());
+		}
+		track.next_seq = seq;
+	}
+	if (!track.file) {
+		return;
+	}
+
+	const auto ahead = static_cast<int16_t>(seq - track.next_seq);
+	if (ahead < 0) {
+		/* Arrived after the packets following it were written, or a duplicate */
+		return;
+	}
+	track.held.try_emplace(track.next_index + static_cast<uint32_t>(ahead), timestamp, std::string(reinterpret_cast<const char*>(opus_packet), opus_packet_len));
+	drain_held(track, false);
+
+	if (track.writer.output_size() >= write_threshold) {
+		queue_output(creator, track);
+	}
+}
+
+}
@@ -0,0 +1,277 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dpp/exception.h>
+#include <dpp/discordvoiceclient.h>
+#include <opus/opus.h>
+#include "enabled.h"
+
+namespace dpp {
+
+namespace {
+
+/**
+ * @brief Samples per channel in each frame, 60ms at 48kHz, the same frame send_audio_raw() encodes
+ */
+constexpr size_t frame_samples = 2880;
+
+/**
+ * @brief Frames encoded by each work unit, three seconds of audio
+ */
+constexpr size_t chunk_frames = 50;
+
+/**
+ * @brief Frames before its chunk each encoder encodes and discards. This is more than the encoder's lookahead,
+ * so the first packet of the chunk covers the same audio it would from a single encoder, and long enough for the
+ * encoder's state to settle.
+ */
+constexpr size_t warmup_frames = 2;
+
+/**
+ * @brief Chunks of one encode which may be encoding, or encoded and waiting for the chunks before them, at once.
+ * This leaves threads for other work while a long track encodes, and bounds the audio held waiting to be queued.
+ */
+constexpr size_t max_chunks_in_flight = 4;
+
+/**
+ * @brief Thread pool priority of encoding, below that of event handlers, which run at priority 1
+ */
+constexpr int encode_priority = 2;
+
+}
+
+namespace detail {
+
+/**
+ * @brief State of one discord_voice_client::send_audio_raw_parallel()
+ */
+struct parallel_encode_job {
+	/**
+	 * @brief Encoded packets of one chunk
+	 */
+	struct chunk {
+		/**
+		 * @brief Opus packets, one per frame
+		 */
+		std::vector<std::string> packets;
+
+		/**
+		 * @brief True once encoded
+		 */
+		bool done{false};
+	};
+
+	/**
+	 * @brief Cluster, for logging and the thread pool
+	 */
+	cluster* creator;
+
+	/**
+	 * @brief Audio, padded to whole frames. Read by all work units at once, and not changed.
+	 */
+	std::vector<uint16_t> pcm;
+
+	/**
+	 * @brief Protects everything below. Held while packets are queued, so cancelling waits for that to finish.
+	 */
+	std::mutex mtx;
+
+	/**
+	 * @brief Voice client to queue packets on, or nullptr once cancelled
+	 */
+	discord_voice_client* client;
+
+	/**
+	 * @brief Set when cancelled, so work units not yet started can skip encoding without taking the lock
+	 */
+	std::atomic<bool> cancelled{false};
+
+	/**
+	 * @brief Chunks, in order
+	 */
+	std::vector<chunk> chunks;
+
+	/**
+	 * @brief Index of the first chunk not yet queued
+	 */
+	size_t next_chunk{0};
+
+	/**
+	 * @brief Index of the first chunk not yet handed to the thread pool
+	 */
+	size_t next_to_start{0};
+
+	/**
+	 * @brief Number of packets queued so far
+	 */
+	size_t packets_queued{0};
+
+	/**
+	 * @brief Called once everything has been queued
+	 */
+	std::function<void(size_t)> on_queued;
+};
+
+}
+
+namespace {
+
+void encode_chunk(const std::shared_ptr<detail::parallel_encode_job>& job, size_t index);
+
+/**
+ * @brief Hand chunks to the thread pool, until max_chunks_in_flight of them have not yet been queued. job->mtx must be held.
+ * @param job encode
+ */
+void start_chunks(const std::shared_ptr<detail::parallel_encode_job>& job) {
+	while (!job->cancelled && job->next_to_start < job->chunks.size() && job->next_to_start < job->next_chunk + max_chunks_in_flight) {
+		const size_t index = job->next_to_start++;
+		job->creator->queue_work(encode_priority, [job, index]() {
+			encode_chunk(job, index);
+		});
+	}
+}
+
+/**
+ * @brief Encode one chunk, then queue every chunk which is now ready in order. Runs on the thread pool.
+ * @param job encode
+ * @param index index of the chunk
+ */
+void encode_chunk(const std::shared_ptr<detail::parallel_encode_job>& job, size_t index) {
+	std::vector<std::string> packets;
+	if (!job->cancelled) {
+		const size_t total_frames = job->pcm.size() / (frame_samples * opus_channel_count);
+		const size_t first = index * chunk_frames;
+		const size_t last = std::min(first + chunk_frames, total_frames);
+		int opus_error = 0;
+		std::unique_ptr<OpusEncoder, decltype(&opus_encoder_destroy)> encoder(opus_encoder_create(opus_sample_rate_hz, opus_channel_count, OPUS_APPLICATION_VOIP, &opus_error), &opus_encoder_destroy);
+		if (opus_error || !encoder) {
+			job->creator->log(ll_error, "send_audio_raw_parallel(): opus_encoder_create() failed");
+		} else {
+			uint8_t out[65536];
+			packets.reserve(last - first);
+			for (size_t frame = first >= warmup_frames ? first - warmup_frames : 0; frame < last && !job->cancelled; ++frame) {
+				const auto pcm = reinterpret_cast<const opus_int16*>(job->pcm.data() + frame * frame_samples * opus_channel_count);
+				int ret = opus_encode(encoder.get(), pcm, frame_samples, out, sizeof(out));
+				if (ret <= 0) {
+					job->creator->log(ll_warning, "send_audio_raw_parallel(): opus_encode(): " + std::string(opus_strerror(ret)));
+					break;
+				}
+				if (frame >= first) {
+					packets.emplace_back(reinterpret_cast<const char*>(out), static_cast<size_t>(ret));
+				}
+			}
+		}
+	}
+
+	std::function<void(size_t)> completed;
+	size_t packets_queued = 0;
+	{
+		std::lock_guard lk(job->mtx);
+		job->chunks[index].packets = std::move(packets);
+		job->chunks[index].done = true;
+		while (job->next_chunk < job->chunks.size() && job->chunks[job->next_chunk].done) {
+			auto& ready = job->chunks[job->next_chunk];
+			if (job->client) {
+				try {
+					for (const std::string& packet : ready.packets) {
+						job->client->send_audio_opus(reinterpret_cast<const uint8_t*>(packet.data()), packet.size());
+					}
+					job->packets_queued += ready.packets.size();
+				}
+				catch (const std::exception& e) {
+					job->creator->log(ll_error, "send_audio_raw_parallel(): " + std::string(e.what()));
+					job->client = nullptr;
+				}
+			}
+			ready.packets = {};
+			++job->next_chunk;
+		}
+		start_chunks(job);
+		if (job->next_chunk == job->chunks.size() && job->client) {
+			completed = std::move(job->on_queued);
+			packets_queued = job->packets_queued;
+			job->client = nullptr;
+		}
+	}
+	if (completed) {
+		completed(packets_queued);
+	}
+}
+
+}
+
+discord_voice_client& discord_voice_client::send_audio_raw_parallel(std::vector<uint16_t> audio_data, std::function<void(size_t)> on_queued) {
+	if (audio_data.size() < opus_channel_count) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size can't be less than 4");
+	}
+
+	if ((audio_data.size() % opus_channel_count) != 0) {
+		throw dpp::voice_exception(err_invalid_voice_packet_length, "Raw audio packet size should be divisible by 4");
+	}
+
+	constexpr size_t frame_values = frame_samples * opus_channel_count;
+	auto job = std::make_shared<detail::parallel_encode_job>();
+	job->creator = creator;
+	job->client = this;
+	job->on_queued = std::move(on_queued);
+	job->pcm = std::move(audio_data);
+	/* Silence completes the last frame, as send_audio_raw() does */
+	job->pcm.resize((job->pcm.size() + frame_values - 1) / frame_values * frame_values, 0);
+	const size_t total_frames = job->pcm.size() / frame_values;
+	job->chunks.resize((total_frames + chunk_frames - 1) / chunk_frames);
+
+	{
+		std::lock_guard<std::mutex> lock(this->stream_mutex);
+		encode_jobs.erase(std::remove_if(encode_jobs.begin(), encode_jobs.end(), [](const std::weak_ptr<detail::parallel_encode_job>& j) {
+			return j.expired();
+		}), encode_jobs.end());
+		encode_jobs.emplace_back(job);
+	}
+
+	{
+		std::lock_guard lk(job->mtx);
+		start_chunks(job);
+	}
+	return *this;
+}
+
+void discord_voice_client::cancel_parallel_encodes() {
+	std::vector<std::weak_ptr<detail::parallel_encode_job>> jobs;
+	{
+		std::lock_guard<std::mutex> lock(this->stream_mutex);
+		jobs.swap(encode_jobs);
+	}
+	for (auto& weak_job : jobs) {
+		if (auto job = weak_job.lock()) {
+			job->cancelled = true;
+			std::lock_guard lk(job->mtx);
+			job->client = nullptr;
+		}
+	}
+}
+
+}
@@ -20,6 +20,7 @@
  *
  ************************************************************************************/
 
+#include <array>
 #include <chrono>
 #include <string_view>
 #include <dpp/exception.h>
@@ -35,17 +36,28 @@ namespace dpp {
 
 void discord_voice_client::read_ready()
 {
-	uint8_t buffer[65535];
-	int packet_size = this->udp_recv(reinterpret_cast<char*>(buffer), sizeof(buffer));
-
-	bool receive_handler_is_empty = creator->on_voice_receive.empty() && creator->on_voice_receive_combined.empty();
-	if (packet_size <= 0 || receive_handler_is_empty) {
-		/* Nothing to do */
-		return;
-	}
+	/*
+	 * The socket is edge triggered, so read until it is empty. Packets are still read
+	 * when there is nobody to receive them, so the kernel buffer doesn't fill with them.
+	 */
+	std::array<size_t, udp_batch_size> sizes{};
+	size_t received = 0;
+	do {
+		received = udp_recv_batch(sizes);
+		bool receive_handler_is_empty = creator->on_voice_receive.empty() && creator->on_voice_receive_combined.empty();
+		if (receive_handler_is_empty && !opus_recording_active) {
+			continue;
+		}
+		for (size_t i = 0; i < received; ++i) {
+			handle_udp_packet(receive_slab.data() + i * udp_slot_size, sizes[i]);
+		}
+	} while (received == udp_batch_size);
+}
 
+void discord_voice_client::handle_udp_packet(const uint8_t* buffer, size_t packet_size)
+{
 	constexpr size_t header_size = 12;
-	if (static_cast<size_t>(packet_size) < header_size) {
+	if (packet_size < header_size) {
 		/* Invalid RTP payload */
 		return;
 	}
@@ -68,15 +80,14 @@ void discord_voice_client::read_ready()
 
 	voice_payload vp{0, // seq, populate later
 	                 0, // timestamp, populate later
-	                 std::make_unique<voice_receive_t>(owner, 0, std::string(reinterpret_cast<char*>(buffer), packet_size))};
-
-	vp.vr->voice_client = this;
+	                 nullptr};
 
 	uint32_t speaker_ssrc;
+	snowflake speaker;
 	{	/* Get the User ID of the speaker */
 		std::memcpy(&speaker_ssrc, &buffer[8], sizeof(uint32_t));
 		speaker_ssrc = ntohl(speaker_ssrc);
-		vp.vr->user_id = ssrc_map[speaker_ssrc];
+		speaker = ssrc_map[speaker_ssrc];
 	}
 
 	/* Get the sequence number of the voice UDP packet */
@@ -87,8 +98,25 @@ void discord_voice_client::read_ready()
 	std::memcpy(&vp.timestamp, &buffer[4], sizeof(rtp_timestamp_t));
 	vp.timestamp = ntohl(vp.timestamp);
 
+	if (opus_recording_active) {
+		record_opus_packet(buffer, packet_size, speaker, vp.seq, vp.timestamp);
+	}
+
+	if (creator->on_voice_receive.empty() && creator->on_voice_receive_combined.empty()) {
+		/* Only recording, which needs no decoding */
+		return;
+	}
+
+	/*
+	 * The encrypted packet is only needed in audio_data, which is decrypted and then replaced
+	 * by the decoded audio, so it is copied once, there and not into raw_event as well.
+	 */
+	vp.vr = std::make_unique<voice_receive_t>(owner, 0, std::string());
+	vp.vr->voice_client = this;
+	vp.vr->user_id = speaker;
 	vp.vr->audio_data.assign(buffer, buffer + packet_size);
 
+	bool schedule_on_pool = false;
 	{
 		std::lock_guard lk(voice_courier_shared_state.mtx);
 		auto& [range, payload_queue, pending_decoder_ctls, decoder] = voice_courier_shared_state.parked_voice_payloads[vp.vr->user_id];
@@ -120,6 +148,19 @@ void discord_voice_client::read_ready()
 		range.max_seq = vp.seq;
 		range.max_timestamp = vp.timestamp;
 		payload_queue.push(std::move(vp));
+
+		if (decode_pool) {
+			/* The shared decode pool delivers the payloads; make sure it knows this connection has some */
+			schedule_on_pool = !voice_courier_shared_state.scheduled && !voice_courier_shared_state.terminating;
+			voice_courier_shared_state.scheduled = voice_courier_shared_state.scheduled || schedule_on_pool;
+		}
+	}
+
+	if (decode_pool) {
+		if (schedule_on_pool) {
+			decode_pool->schedule(this);
+		}
+		return;
 	}
 
 	voice_courier_shared_state.signal_iteration.notify_one();
@@ -20,6 +20,7 @@
  *
  ************************************************************************************/
 
+#include <array>
 #include <dpp/exception.h>
 #include <dpp/isa_detection.h>
 #include <dpp/discordvoiceclient.h>
@@ -30,15 +31,13 @@ namespace dpp {
 
 void discord_voice_client::send(const char* packet, size_t len, uint64_t duration, bool send_now) {
 	if (!send_now) [[likely]] {
-		voice_out_packet frame;
-		frame.packet.assign(packet, packet + len);
-		frame.duration = duration;
-
 		bool was_empty = false;
 		{
 			std::lock_guard<std::mutex> lock(this->stream_mutex);
 			was_empty = outbuf.empty();
-			outbuf.emplace_back(frame);
+			voice_out_packet& frame = outbuf.emplace_back();
+			frame.packet.assign(packet, len);
+			frame.duration = duration;
 		}
 
 		if (was_empty) {
@@ -51,7 +50,7 @@ void discord_voice_client::send(const char* packet, size_t len, uint64_t duratio
 }
 
 int discord_voice_client::udp_send(const char* data, size_t length) {
-	return static_cast<int>(sendto(
+	int sent = static_cast<int>(sendto(
 		this->fd,
 		data,
 		static_cast<int>(length),
@@ -59,11 +58,40 @@ int discord_voice_client::udp_send(const char* data, size_t length) {
 		destination.get_socket_address(),
 		destination.size()
 	));
+	udp_send_calls.fetch_add(1, std::memory_order_relaxed);
+	if (sent >= 0) {
+		udp_packets_sent.fetch_add(1, std::memory_order_relaxed);
+	}
+	return sent;
+}
+
+size_t discord_voice_client::udp_send_batch(const voice_out_queue& packets, size_t count) {
+	uint64_t calls = 0;
+	size_t sent = detail::udp_send_batch(this->fd, destination, packets, count, calls);
+	udp_send_calls.fetch_add(calls, std::memory_order_relaxed);
+	udp_packets_sent.fetch_add(sent, std::memory_order_relaxed);
+	return sent;
 }
 
 int discord_voice_client::udp_recv(char* data, size_t max_length)
 {
-	return static_cast<int>(recv(this->fd, data, static_cast<int>(max_length), 0));
+	int received = static_cast<int>(recv(this->fd, data, static_cast<int>(max_length), 0));
+	udp_receive_calls.fetch_add(1, std::memory_order_relaxed);
+	if (received >= 0) {
+		udp_packets_received.fetch_add(1, std::memory_order_relaxed);
+	}
+	return received;
+}
+
+size_t discord_voice_client::udp_recv_batch(std::array<size_t, udp_batch_size>& sizes) {
+	if (receive_slab.empty()) {
+		receive_slab.resize(udp_batch_size * udp_slot_size);
+	}
+	uint64_t calls = 0;
+	size_t received = detail::udp_recv_batch(this->fd, receive_slab.data(), sizes, calls);
+	udp_receive_calls.fetch_add(calls, std::memory_order_relaxed);
+	udp_packets_received.fetch_add(received, std::memory_order_relaxed);
+	return received;
 }
 
 }
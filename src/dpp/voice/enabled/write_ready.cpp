@@ -20,6 +20,7 @@
  *
  ************************************************************************************/
 
+#include <chrono>
 #include <dpp/exception.h>
 #include <dpp/isa_detection.h>
 #include <dpp/discordvoiceclient.h>
@@ -48,35 +49,70 @@ void discord_voice_client::write_ready() {
 	bool track_marker_found = false;
 	uint64_t bufsize = 0;
 	send_audio_type_t type = satype_recorded_audio;
+	bool needs_stop_frames = false;
 	{
 		std::lock_guard<std::mutex> lock(this->stream_mutex);
 		if (this->paused) {
-			if (!this->sent_stop_frames) {
-				this->send_stop_frames(true);
-				this->sent_stop_frames = true;
-			}
+			/* Sent once stream_mutex is released, as sending takes send_sequence's lock, which comes first */
+			needs_stop_frames = !this->sent_stop_frames;
+			this->sent_stop_frames = true;
 
 			/* Fallthrough if paused */
 		} else if (!outbuf.empty()) {
 			type = send_audio_type;
 			if (outbuf[0].packet.size() == sizeof(uint16_t) && (*(reinterpret_cast<uint16_t*>(outbuf[0].packet.data()))) == AUDIO_TRACK_MARKER) {
-				outbuf.erase(outbuf.begin());
+				outbuf.pop_front();
 				track_marker_found = true;
 				if (tracks > 0) {
 					tracks--;
 				}
 			}
 			if (!outbuf.empty()) {
-				int sent_siz = this->udp_send(outbuf[0].packet.data(), outbuf[0].packet.length());
-				if (sent_siz == (int)outbuf[0].packet.length()) {
-					duration = outbuf[0].duration * timescale;
-					bufsize = outbuf[0].packet.length();
-					outbuf.erase(outbuf.begin());
+				/*
+				 * If we have fallen behind the recording, e.g. after a scheduling delay, send every
+				 * packet which is already overdue with one system call, rather than one per wakeup.
+				 * Overlap audio paces itself, so it is always sent one packet at a time.
+				 */
+				size_t batch = 1;
+				if (type == satype_recorded_audio) {
+					const uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - last_timestamp).count();
+					uint64_t due = outbuf[0].duration * timescale;
+					while (batch < outbuf.size() && batch < udp_batch_size && due <= latency) {
+						const std::string& next = outbuf[batch].packet;
+						if (next.size() == sizeof(uint16_t) && (*(reinterpret_cast<const uint16_t*>(next.data()))) == AUDIO_TRACK_MARKER) {
+							break;
+						}
+						due += outbuf[batch].duration * timescale;
+						++batch;
+					}
+				}
+				if (batch == 1) {
+					int sent_siz = this->udp_send(outbuf[0].packet.data(), outbuf[0].packet.length());
+					if (sent_siz == (int)outbuf[0].packet.length()) {
+						duration = outbuf[0].duration * timescale;
+						bufsize = outbuf[0].packet.length();
+						outbuf.pop_front();
+					}
+				} else {
+					size_t sent = this->udp_send_batch(outbuf, batch);
+					for (size_t i = 0; i < sent; ++i) {
+						duration += outbuf[i].duration * timescale;
+						bufsize = outbuf[i].packet.length();
+					}
+					outbuf.pop_front(sent);
 				}
+				notify_send_queue_space();
 			}
 		}
 	}
+	if (needs_stop_frames) {
+		this->send_stop_frames(true);
+	}
 	if (duration) {
+		/* Top up the queue from a file being played and the mixer, while this packet's time passes */
+		refill_ogg_playback();
+		refill_send_mixer();
+
 		if (type == satype_recorded_audio) {
 			std::chrono::nanoseconds latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - last_timestamp);
 			std::chrono::nanoseconds sleep_time = std::chrono::nanoseconds(duration) - latency;
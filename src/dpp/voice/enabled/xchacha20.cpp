@@ -27,7 +27,21 @@
 #include <cstring>
 #include <cstdint>
 #include <dpp/exception.h>
-#include "enabled.h"
+#include "xchacha20.h"
+
+/*
+ * HChaCha20 is vectorised with the instruction set the audio mixer was built for (see isa_detection.h).
+ * The state fills four 128 bit registers, a row in each, so each quarter round works on all four columns at once.
+ */
+#if AVX_TYPE == 1024
+	#include <arm_neon.h>
+	#define DPP_HCHACHA20_NEON
+#elif AVX_TYPE == 512 || AVX_TYPE == 2 || AVX_TYPE == 1
+	#include <immintrin.h>
+	#define DPP_HCHACHA20_SSE2
+#endif
+
+namespace {
 
 /**
  * @brief ChaCha static constant
@@ -46,6 +60,7 @@ constexpr size_t KEY_SIZE = 32;
  */
 constexpr size_t CHACHA_NONCE_SIZE = 12;
 
+#if !defined(DPP_HCHACHA20_SSE2) && !defined(DPP_HCHACHA20_NEON)
 /**
  * @brief Rotates the bits of a 32-bit unsigned integer to the left by a specified number of positions.
  * @note From Google's BoringSSL, but made constexpr
@@ -106,129 +121,250 @@ void hchacha20(unsigned char out[KEY_SIZE], const unsigned char key[KEY_SIZE], c
 	std::memcpy(out, &x[0], sizeof(uint32_t) * 4);
 	std::memcpy(&out[16], &x[CHACHA_NONCE_SIZE], sizeof(uint32_t) * 4);
 }
+#endif
 
-int ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(unsigned char *c, unsigned long long *clen, const unsigned char *m, unsigned long long mlen, const unsigned char *ad, unsigned long long adlen, const unsigned char *nsec, const unsigned char *npub, const unsigned char *k) {
-	unsigned char sub_key[KEY_SIZE];
-	/* Regular ChaCha20-Poly1305 uses 12-byte nonce */
-	unsigned char chacha_nonce[CHACHA_NONCE_SIZE] = {0};
-	EVP_CIPHER_CTX *ctx = nullptr;
-	int len = 0;
-	int ciphertext_len = 0;
+#if defined(DPP_HCHACHA20_SSE2)
+/**
+ * @brief Rotate each 32 bit lane left
+ * @tparam shift number of bits to rotate by
+ * @param v lanes to rotate
+ * @return rotated lanes
+ */
+template <int shift>
+inline __m128i rotl_128(__m128i v) {
+	return _mm_or_si128(_mm_slli_epi32(v, shift), _mm_srli_epi32(v, 32 - shift));
+}
 
-	try {
-		/* Derive the sub-key using HChaCha20 */
-		hchacha20(sub_key, k, npub);
+/**
+ * @brief HChaCha20 with the state held a row per SSE2 register. See the scalar version above for details.
+ * @param out output 32 byte subkey
+ * @param key input 32 byte key
+ * @param nonce input 16 byte nonce
+ */
+void hchacha20(unsigned char out[KEY_SIZE], const unsigned char key[KEY_SIZE], const unsigned char nonce[16]) {
+	__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(CHACHA20_CONSTANT_SEED));
+	__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+	__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+	__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nonce));
+	for (size_t i = 0; i < 20; i += 2) {
+		/* Column round */
+		a = _mm_add_epi32(a, b); d = rotl_128<16>(_mm_xor_si128(d, a));
+		c = _mm_add_epi32(c, d); b = rotl_128<12>(_mm_xor_si128(b, c));
+		a = _mm_add_epi32(a, b); d = rotl_128<8>(_mm_xor_si128(d, a));
+		c = _mm_add_epi32(c, d); b = rotl_128<7>(_mm_xor_si128(b, c));
+		/* Turn the diagonals into columns, do a column round, then turn them back */
+		b = _mm_shuffle_epi32(b, 0x39); c = _mm_shuffle_epi32(c, 0x4E); d = _mm_shuffle_epi32(d, 0x93);
+		a = _mm_add_epi32(a, b); d = rotl_128<16>(_mm_xor_si128(d, a));
+		c = _mm_add_epi32(c, d); b = rotl_128<12>(_mm_xor_si128(b, c));
+		a = _mm_add_epi32(a, b); d = rotl_128<8>(_mm_xor_si128(d, a));
+		c = _mm_add_epi32(c, d); b = rotl_128<7>(_mm_xor_si128(b, c));
+		b = _mm_shuffle_epi32(b, 0x93); c = _mm_shuffle_epi32(c, 0x4E); d = _mm_shuffle_epi32(d, 0x39);
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), a);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), d);
+}
+#endif
 
-		/* Use the last 8 bytes of the 24-byte XChaCha20 nonce */
-		std::memcpy(chacha_nonce + 4, npub + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES, 8);
+#if defined(DPP_HCHACHA20_NEON)
+/**
+ * @brief Rotate each 32 bit lane left
+ * @tparam shift number of bits to rotate by
+ * @param v lanes to rotate
+ * @return rotated lanes
+ */
+template <int shift>
+inline uint32x4_t rotl_128(uint32x4_t v) {
+	return vorrq_u32(vshlq_n_u32(v, shift), vshrq_n_u32(v, 32 - shift));
+}
 
-		/* Initialize encryption context with ChaCha20-Poly1305 */
-		ctx = EVP_CIPHER_CTX_new();
-		if ((ctx == nullptr) || (EVP_EncryptInit_ex(ctx, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) == 0)) {
-			throw dpp::encryption_exception("Error initializing encryption context");
-		}
+/**
+ * @brief HChaCha20 with the state held a row per NEON register. See the scalar version above for details.
+ * @param out output 32 byte subkey
+ * @param key input 32 byte key
+ * @param nonce input 16 byte nonce
+ */
+void hchacha20(unsigned char out[KEY_SIZE], const unsigned char key[KEY_SIZE], const unsigned char nonce[16]) {
+	uint32x4_t a = vreinterpretq_u32_u8(vld1q_u8(CHACHA20_CONSTANT_SEED));
+	uint32x4_t b = vreinterpretq_u32_u8(vld1q_u8(key));
+	uint32x4_t c = vreinterpretq_u32_u8(vld1q_u8(key + 16));
+	uint32x4_t d = vreinterpretq_u32_u8(vld1q_u8(nonce));
+	for (size_t i = 0; i < 20; i += 2) {
+		/* Column round */
+		a = vaddq_u32(a, b); d = rotl_128<16>(veorq_u32(d, a));
+		c = vaddq_u32(c, d); b = rotl_128<12>(veorq_u32(b, c));
+		a = vaddq_u32(a, b); d = rotl_128<8>(veorq_u32(d, a));
+		c = vaddq_u32(c, d); b = rotl_128<7>(veorq_u32(b, c));
+		/* Turn the diagonals into columns, do a column round, then turn them back */
+		b = vextq_u32(b, b, 1); c = vextq_u32(c, c, 2); d = vextq_u32(d, d, 3);
+		a = vaddq_u32(a, b); d = rotl_128<16>(veorq_u32(d, a));
+		c = vaddq_u32(c, d); b = rotl_128<12>(veorq_u32(b, c));
+		a = vaddq_u32(a, b); d = rotl_128<8>(veorq_u32(d, a));
+		c = vaddq_u32(c, d); b = rotl_128<7>(veorq_u32(b, c));
+		b = vextq_u32(b, b, 3); c = vextq_u32(c, c, 2); d = vextq_u32(d, d, 1);
+	}
+	vst1q_u8(out, vreinterpretq_u8_u32(a));
+	vst1q_u8(out + 16, vreinterpretq_u8_u32(d));
+}
+#endif
 
-		/* Set key and nonce */
-		if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, sub_key, chacha_nonce) == 0) {
-			throw dpp::encryption_exception("Error setting key and nonce");
-		}
+/**
+ * @brief ChaCha20-Poly1305 cipher contexts, created once per thread and reused for every packet.
+ * The key of each packet differs, so only the allocation and cipher setup are saved, but that is
+ * most of the cost for packets as small as voice packets.
+ */
+struct cipher_contexts {
+	/**
+	 * @brief Encryption context, or nullptr if it could not be created
+	 */
+	EVP_CIPHER_CTX* encrypt{nullptr};
 
-		/* Set additional authenticated data (AAD) */
-		if (EVP_EncryptUpdate(ctx, nullptr, &len, ad, static_cast<int>(adlen)) == 0) {
-			throw dpp::encryption_exception("Error setting additional authenticated data");
-		}
+	/**
+	 * @brief Decryption context, or nullptr if it could not be created
+	 */
+	EVP_CIPHER_CTX* decrypt{nullptr};
 
-		/* Encrypt the plaintext */
-		if (EVP_EncryptUpdate(ctx, c, &len, m, static_cast<int>(mlen)) == 0) {
-			throw dpp::encryption_exception("Error during encryption");
+	cipher_contexts() : encrypt(EVP_CIPHER_CTX_new()), decrypt(EVP_CIPHER_CTX_new()) {
+		if (encrypt && EVP_EncryptInit_ex(encrypt, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) == 0) {
+			EVP_CIPHER_CTX_free(encrypt);
+			encrypt = nullptr;
 		}
-		ciphertext_len = len;
-
-		if (EVP_EncryptFinal_ex(ctx, c + len, &len) == 0) {
-			throw dpp::encryption_exception("Error finalizing encryption");
+		if (decrypt && EVP_DecryptInit_ex(decrypt, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) == 0) {
+			EVP_CIPHER_CTX_free(decrypt);
+			decrypt = nullptr;
 		}
-		ciphertext_len += len;
+	}
 
-		/* Get the authentication tag */
-		if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES, c + ciphertext_len) == 0) {
-			throw dpp::encryption_exception("Error getting authentication tag");
-		}
+	~cipher_contexts() {
+		EVP_CIPHER_CTX_free(encrypt);
+		EVP_CIPHER_CTX_free(decrypt);
+	}
 
-		/* Total ciphertext length (ciphertext + tag) */
-		if (clen != nullptr) {
-			*clen = ciphertext_len + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES;
-		}
+	cipher_contexts(const cipher_contexts&) = delete;
+	cipher_contexts& operator=(const cipher_contexts&) = delete;
+};
+
+/**
+ * @brief Get the cipher contexts of the calling thread
+ * @return cipher_contexts& contexts
+ */
+cipher_contexts& thread_contexts() {
+	thread_local cipher_contexts contexts;
+	return contexts;
+}
 
-	} catch (const dpp::encryption_exception& e) {
-		EVP_CIPHER_CTX_free(ctx);
+/**
+ * @brief Build the ChaCha20-Poly1305 nonce from an XChaCha20 nonce
+ * @param chacha_nonce output 12 byte nonce
+ * @param npub input 24 byte nonce
+ */
+inline void chacha_nonce_from(unsigned char chacha_nonce[CHACHA_NONCE_SIZE], const unsigned char* npub) {
+	/* Regular ChaCha20-Poly1305 uses 12-byte nonce: four zero bytes then the last 8 bytes of the 24-byte XChaCha20 nonce */
+	std::memset(chacha_nonce, 0, 4);
+	std::memcpy(chacha_nonce + 4, npub + 16, 8);
+}
+
+/**
+ * @brief ChaCha20-Poly1305 encrypt with a derived subkey
+ * @return 0 on success, -1 on error
+ */
+int seal_packet(EVP_CIPHER_CTX* ctx, const unsigned char* sub_key, const unsigned char* npub, unsigned char* c, unsigned long long* clen, const unsigned char* m, unsigned long long mlen, const unsigned char* ad, unsigned long long adlen) {
+	unsigned char chacha_nonce[CHACHA_NONCE_SIZE];
+	chacha_nonce_from(chacha_nonce, npub);
+	int len = 0;
+	int ciphertext_len = 0;
+
+	/* Set key and nonce, which resets the context for the new packet */
+	if (ctx == nullptr || EVP_EncryptInit_ex(ctx, nullptr, nullptr, sub_key, chacha_nonce) == 0) {
 		return -1;
 	}
 
-	EVP_CIPHER_CTX_free(ctx);
+	/* Set additional authenticated data (AAD) */
+	if (EVP_EncryptUpdate(ctx, nullptr, &len, ad, static_cast<int>(adlen)) == 0) {
+		return -1;
+	}
+
+	/* Encrypt the plaintext */
+	if (EVP_EncryptUpdate(ctx, c, &len, m, static_cast<int>(mlen)) == 0) {
+		return -1;
+	}
+	ciphertext_len = len;
+
+	if (EVP_EncryptFinal_ex(ctx, c + len, &len) == 0) {
+		return -1;
+	}
+	ciphertext_len += len;
+
+	/* Get the authentication tag */
+	if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES, c + ciphertext_len) == 0) {
+		return -1;
+	}
+
+	/* Total ciphertext length (ciphertext + tag) */
+	if (clen != nullptr) {
+		*clen = ciphertext_len + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES;
+	}
 	return 0;
 }
 
-int ssl_crypto_aead_xchacha20poly1305_ietf_decrypt(unsigned char *m, unsigned long long *mlen, [[maybe_unused]] unsigned char *nsec, const unsigned char *c,  unsigned long long clen, const unsigned char *ad,	unsigned long long adlen, const unsigned char *npub, const unsigned char *k) {
-	unsigned char sub_key[KEY_SIZE];
-	/* Regular ChaCha20-Poly1305 uses 12-byte nonce */
-	unsigned char chacha_nonce[CHACHA_NONCE_SIZE] = {0};
-	EVP_CIPHER_CTX *ctx = nullptr;
+/**
+ * @brief ChaCha20-Poly1305 decrypt and authenticate with a derived subkey
+ * @return 0 on success, -1 on error or if authentication fails
+ */
+int open_packet(EVP_CIPHER_CTX* ctx, const unsigned char* sub_key, const unsigned char* npub, unsigned char* m, unsigned long long* mlen, const unsigned char* c, unsigned long long clen, const unsigned char* ad, unsigned long long adlen) {
+	unsigned char chacha_nonce[CHACHA_NONCE_SIZE];
+	chacha_nonce_from(chacha_nonce, npub);
 	int len = 0;
 	int plaintext_len = 0;
 
-	if (clen < ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES) {
-		/* Ciphertext length must include at least the tag (16 bytes) */
+	/* Set key and nonce, which resets the context for the new packet */
+	if (ctx == nullptr || EVP_DecryptInit_ex(ctx, nullptr, nullptr, sub_key, chacha_nonce) == 0) {
 		return -1;
 	}
 
-	try {
-		/* Derive the sub-key using HChaCha20 */
-		hchacha20(sub_key, k, npub);
-
-		/* Use the last 8 bytes of the 24-byte XChaCha20 nonce */
-		std::memcpy(chacha_nonce + 4, npub + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES, 8);
+	/* Set additional authenticated data (AAD) */
+	if (EVP_DecryptUpdate(ctx, nullptr, &len, ad, static_cast<int>(adlen)) == 0) {
+		return -1;
+	}
 
-		/* Initialize decryption context with ChaCha20-Poly1305 */
-		ctx = EVP_CIPHER_CTX_new();
-		if (!ctx || (EVP_DecryptInit_ex(ctx, EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) == 0)) {
-			throw dpp::decryption_exception("Error initializing decryption context");
-		}
+	/* Decrypt the ciphertext (excluding the tag) */
+	if (EVP_DecryptUpdate(ctx, m, &len, c, static_cast<int>(clen - ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES)) == 0) {
+		return -1;
+	}
+	plaintext_len = len;
 
-		/* Set key and nonce */
-		if (EVP_DecryptInit_ex(ctx, nullptr, nullptr, sub_key, chacha_nonce) == 0) {
-			throw dpp::decryption_exception("Error setting key and nonce");
-		}
+	/* Set the expected tag */
+	if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES, const_cast<unsigned char *>(c + clen - ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES)) == 0) {
+		return -1;
+	}
 
-		/* Set additional authenticated data (AAD) */
-		if (EVP_DecryptUpdate(ctx, nullptr, &len, ad, static_cast<int>(adlen)) == 0) {
-			throw dpp::decryption_exception("Error setting additional authenticated data");
-		}
+	/* Check tag */
+	if (EVP_DecryptFinal_ex(ctx, m + len, &len) <= 0) {
+		return -1;
+	}
 
-		/* Decrypt the ciphertext (excluding the tag) */
-		if (EVP_DecryptUpdate(ctx, m, &len, c, static_cast<int>(clen - ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES)) == 0) {
-			throw dpp::decryption_exception("Error during decryption");
-		}
-		plaintext_len = len;
+	/* Tag is valid, finalize plaintext length */
+	if (mlen != nullptr) {
+		*mlen = plaintext_len + len;
+	}
+	return 0;
+}
 
-		/* Set the expected tag */
-		if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES, const_cast<unsigned char *>(c + clen - ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES)) == 0) {
-			throw dpp::decryption_exception("Error setting authentication tag");
-		}
+}
 
-		/* Check tag */
-		int ret = EVP_DecryptFinal_ex(ctx, m + len, &len);
-		if (ret > 0) {
-			/* Tag is valid, finalize plaintext length */
-			*mlen = plaintext_len + len;
-		} else {
-			throw dpp::decryption_exception("Authentication failed");
-		}
+int ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(unsigned char *c, unsigned long long *clen, const unsigned char *m, unsigned long long mlen, const unsigned char *ad, unsigned long long adlen, [[maybe_unused]] const unsigned char *nsec, const unsigned char *npub, const unsigned char *k) {
+	unsigned char sub_key[KEY_SIZE];
+	/* Derive the sub-key using HChaCha20 */
+	hchacha20(sub_key, k, npub);
+	return seal_packet(thread_contexts().encrypt, sub_key, npub, c, clen, m, mlen, ad, adlen);
+}
 
-	} catch (const dpp::decryption_exception& e) {
-		EVP_CIPHER_CTX_free(ctx);
+int ssl_crypto_aead_xchacha20poly1305_ietf_decrypt(unsigned char *m, unsigned long long *mlen, [[maybe_unused]] unsigned char *nsec, const unsigned char *c,  unsigned long long clen, const unsigned char *ad,	unsigned long long adlen, const unsigned char *npub, const unsigned char *k) {
+	if (clen < ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES) {
+		/* Ciphertext length must include at least the tag (16 bytes) */
 		return -1;
 	}
-
-	EVP_CIPHER_CTX_free(ctx);
-	return 0;
+	unsigned char sub_key[KEY_SIZE];
+	/* Derive the sub-key using HChaCha20 */
+	hchacha20(sub_key, k, npub);
+	return open_packet(thread_contexts().decrypt, sub_key, npub, m, mlen, c, clen, ad, adlen);
 }
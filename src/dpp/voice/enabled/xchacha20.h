@@ -0,0 +1,69 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#pragma once
+
+#include <dpp/export.h>
+#include <cstddef>
+
+/**
+ * @brief OpenSSL based reimplementation of sodium's crypto_aead_xchacha20poly1305_ietf_encrypt
+ * @note Parameters and types are intended to match sodium as to be a drop-in replacement.
+ * @param c Ciphertext + Tag output
+ * @param clen Ciphertext length output
+ * @param m Message (plaintext) input
+ * @param mlen Message length
+ * @param ad Additional authenticated data (AAD)
+ * @param adlen Authenticated data length
+ * @param nsec Secret nonce (optional, nullptr to not use)
+ * @param npub Public nonce (24 bytes)
+ * @param k Key (32 bytes)
+ * @return 0 on success, -1 on error
+ */
+DPP_EXPORT int ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(unsigned char *c, unsigned long long *clen, const unsigned char *m, unsigned long long mlen, const unsigned char *ad, unsigned long long adlen, const unsigned char *nsec, const unsigned char *npub, const unsigned char *k);
+
+/**
+ * @brief OpenSSL based reimplementation of sodium's crypto_aead_xchacha20poly1305_ietf_decrypt
+ * @note Parameters and types are intended to match sodium as to be a drop-in replacement.
+ * @param m Message (plaintext) output
+ * @param mlen message length output
+ * @param nsec Secret nonce (optional, nullptr to not use)
+ * @param c Ciphertext + Tag input
+ * @param clen Ciphertext length
+ * @param ad Additional authenticated data (AAD)
+ * @param adlen Additional authenticated data length
+ * @param npub Public nonce (24 bytes)
+ * @param k Key (32 bytes)
+ * @return 0 on success, -1 on error
+ */
+DPP_EXPORT int ssl_crypto_aead_xchacha20poly1305_ietf_decrypt(unsigned char *m, unsigned long long *mlen, unsigned char *nsec, const unsigned char *c, unsigned long long clen, const unsigned char *ad, unsigned long long adlen, const unsigned char *npub, const unsigned char *k);
+
+/**
+ * @brief Size of public nonce (24 bytes)
+ * @note This constant is a drop-in replacement for one in libsodium
+ */
+inline constexpr unsigned int ssl_crypto_aead_xchacha20poly1305_ietf_NPUBBYTES = 24U;
+
+/**
+ * @brief AAD size
+ * @note This constant is a drop-in replacement for one in libsodium
+ */
+inline constexpr unsigned int ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES = 16U;
@@ -36,9 +36,76 @@ namespace dpp {
 	void discord_voice_client::voice_courier_loop(discord_voice_client& client, courier_shared_state_t& shared_state) {
 	}
 
+	bool discord_voice_client::flush_on_decode_pool() {
+		return false;
+	}
+
 	void discord_voice_client::cleanup() {
 	}
 
+	discord_voice_client& discord_voice_client::start_opus_recording(std::function<std::string(snowflake)> path_for_user) {
+		return *this;
+	}
+
+	discord_voice_client& discord_voice_client::start_opus_recording(const std::string& directory) {
+		return *this;
+	}
+
+	discord_voice_client& discord_voice_client::stop_opus_recording() {
+		return *this;
+	}
+
+	bool discord_voice_client::is_recording_opus() const {
+		return false;
+	}
+
+	discord_voice_client& discord_voice_client::send_audio_raw_parallel(std::vector<uint16_t> audio_data, std::function<void(size_t)> on_queued) {
+		return *this;
+	}
+
+	void discord_voice_client::cancel_parallel_encodes() {
+	}
+
+	uint32_t discord_voice_client::add_mixer_source(const voice_mixer_source_options& options) {
+		return 0;
+	}
+
+	discord_voice_client& discord_voice_client::remove_mixer_source(uint32_t source_id) {
+		return *this;
+	}
+
+	discord_voice_client& discord_voice_client::set_mixer_source_options(uint32_t source_id, const voice_mixer_source_options& options) {
+		return *this;
+	}
+
+	discord_voice_client& discord_voice_client::send_mixer_audio(uint32_t source_id, const uint16_t* audio_data, size_t length) {
+		return *this;
+	}
+
+	uint64_t discord_voice_client::get_mixer_source_buffered_ms(uint32_t source_id) {
+		return 0;
+	}
+
+	discord_voice_client& discord_voice_client::flush_mixer_source(uint32_t source_id) {
+		return *this;
+	}
+
+	std::shared_ptr<detail::send_mixer_state> discord_voice_client::get_send_mixer() {
+		return {};
+	}
+
+	void discord_voice_client::refill_send_mixer() {
+	}
+
+	void discord_voice_client::mix_send_frames(detail::send_mixer_state& state) {
+	}
+
+	void discord_voice_client::detach_send_mixer() {
+	}
+
+	void discord_voice_client::clear_send_mixer_audio() {
+	}
+
 	void discord_voice_client::run() {
 	}
 
@@ -93,4 +160,34 @@ namespace dpp {
 	void discord_voice_client::on_disconnect() {
 	}
 
+	voice_broadcast::voice_broadcast() {
+		throw dpp::voice_exception(err_no_voice_support, "Voice support not enabled in this build of D++");
+	}
+
+	voice_broadcast::~voice_broadcast() = default;
+
+	voice_broadcast& voice_broadcast::subscribe(discord_voice_client* client) {
+		return *this;
+	}
+
+	voice_broadcast& voice_broadcast::unsubscribe(discord_voice_client* client) {
+		return *this;
+	}
+
+	size_t voice_broadcast::get_subscriber_count() const {
+		return 0;
+	}
+
+	voice_broadcast& voice_broadcast::send_audio_raw(uint16_t* audio_data, const size_t length) {
+		return *this;
+	}
+
+	voice_broadcast& voice_broadcast::send_audio_opus(const uint8_t* opus_packet, const size_t length) {
+		return *this;
+	}
+
+	voice_broadcast& voice_broadcast::insert_marker(const std::string& metadata) {
+		return *this;
+	}
+
 }
@@ -0,0 +1,120 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/utility.h>
+#include <dpp/voice_decode_pool.h>
+#include <dpp/discordvoiceclient.h>
+#include <dpp/cluster.h>
+
+namespace dpp {
+
+voice_decode_pool::voice_decode_pool(cluster* creator, size_t num_threads, uint16_t flush_interval_ms)
+	: voice_decode_pool(creator, num_threads, flush_interval_ms, [](discord_voice_client* client) {
+		return client->flush_on_decode_pool();
+	}) {
+}
+
+voice_decode_pool::voice_decode_pool(cluster* creator, size_t num_threads, uint16_t flush_interval_ms, std::function<bool(discord_voice_client*)> flush_connection)
+	: flush_interval(flush_interval_ms), flush(std::move(flush_connection)) {
+	for (size_t i = 0; i < num_threads; ++i) {
+		threads.emplace_back([this, i, creator]() {
+			dpp::utility::set_thread_name("pool/voice/" + std::to_string(i));
+			while (true) {
+				discord_voice_client* client{nullptr};
+				{
+					std::unique_lock<std::mutex> lock(queue_mutex);
+					while (!stop) {
+						if (due.empty()) {
+							cv.wait(lock);
+						} else if (due.begin()->first > std::chrono::steady_clock::now()) {
+							cv.wait_until(lock, due.begin()->first);
+						} else {
+							break;
+						}
+					}
+					if (stop) {
+						return;
+					}
+					client = due.begin()->second;
+					due.erase(due.begin());
+					running.insert(client);
+				}
+
+				bool again = false;
+				try {
+					again = flush(client);
+				}
+				catch (const std::exception &e) {
+					creator->log(ll_critical, "Voice courier unhandled exception: " + std::string(e.what()));
+				}
+
+				{
+					std::unique_lock<std::mutex> lock(queue_mutex);
+					running.erase(client);
+					if (again) {
+						due.emplace(std::chrono::steady_clock::now() + flush_interval, client);
+					}
+				}
+				flushed.notify_all();
+				if (again) {
+					cv.notify_one();
+				}
+			}
+		});
+	}
+}
+
+voice_decode_pool::~voice_decode_pool() {
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		stop = true;
+	}
+
+	cv.notify_all();
+	for (auto &thread: threads) {
+		thread.join();
+	}
+}
+
+void voice_decode_pool::schedule(discord_voice_client* client) {
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		due.emplace(std::chrono::steady_clock::now() + flush_interval, client);
+	}
+	cv.notify_one();
+}
+
+void voice_decode_pool::cancel(discord_voice_client* client) {
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	flushed.wait(lock, [this, client] {
+		/* A flush which was running may have scheduled the connection again as it finished */
+		for (auto i = due.begin(); i != due.end();) {
+			if (i->second == client) {
+				i = due.erase(i);
+			} else {
+				++i;
+			}
+		}
+		return running.find(client) == running.end();
+	});
+}
+
+}
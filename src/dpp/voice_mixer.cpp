@@ -0,0 +1,188 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/voice_mixer.h>
+#include <dpp/isa_detection.h>
+#include <algorithm>
+
+namespace dpp {
+
+static_assert(voice_mixer::frame_values % audio_mixer::byte_blocks_per_register == 0, "Mixed frames must be a whole number of registers");
+
+size_t voice_mixer::source::next_frame_values() const {
+	if (buffered() >= frame_values) {
+		return frame_values;
+	}
+	/* Less than a frame is only mixed at the end of the source's audio */
+	return flushing || removed ? buffered() : 0;
+}
+
+voice_mixer::voice_mixer()
+	: kernel(std::make_unique<audio_mixer>()), mix(frame_values), widened(frame_values), scaled(frame_values), out(frame_values) {
+}
+
+voice_mixer::~voice_mixer() = default;
+
+voice_mixer::source* voice_mixer::find(uint32_t id) {
+	auto it = std::find_if(sources.begin(), sources.end(), [id](const source& s) {
+		return s.id == id && !s.removed;
+	});
+	return it == sources.end() ? nullptr : &*it;
+}
+
+uint32_t voice_mixer::add_source(const voice_mixer_source_options& options) {
+	source& s = sources.emplace_back();
+	s.id = next_id++;
+	s.options = options;
+	return s.id;
+}
+
+bool voice_mixer::remove_source(uint32_t id) {
+	source* s = find(id);
+	if (!s) {
+		return false;
+	}
+	if (s->buffered()) {
+		/* Keep one more frame of it to fade out, and mix_frame() removes it */
+		s->pcm.resize(s->read_pos + std::min(s->buffered(), frame_values));
+		s->removed = true;
+	} else {
+		sources.erase(std::remove_if(sources.begin(), sources.end(), [id](const source& other) {
+			return other.id == id;
+		}), sources.end());
+	}
+	return true;
+}
+
+bool voice_mixer::set_source_options(uint32_t id, const voice_mixer_source_options& options) {
+	source* s = find(id);
+	if (!s) {
+		return false;
+	}
+	s->options = options;
+	return true;
+}
+
+bool voice_mixer::send_audio(uint32_t id, const int16_t* samples, size_t count) {
+	source* s = find(id);
+	if (!s) {
+		return false;
+	}
+	if (s->read_pos > 0 && s->read_pos >= s->pcm.size() / 2) {
+		/* Drop what has been mixed, rather than letting the buffer grow for as long as the source plays */
+		s->pcm.erase(s->pcm.begin(), s->pcm.begin() + static_cast<ptrdiff_t>(s->read_pos));
+		s->read_pos = 0;
+	}
+	s->pcm.insert(s->pcm.end(), samples, samples + count);
+	return true;
+}
+
+bool voice_mixer::flush_source(uint32_t id) {
+	source* s = find(id);
+	if (!s) {
+		return false;
+	}
+	s->flushing = s->buffered() > 0;
+	return true;
+}
+
+size_t voice_mixer::get_buffered(uint32_t id) {
+	source* s = find(id);
+	return s ? s->buffered() : 0;
+}
+
+void voice_mixer::clear() {
+	sources.erase(std::remove_if(sources.begin(), sources.end(), [](const source& s) {
+		return s.removed;
+	}), sources.end());
+	for (source& s : sources) {
+		s.pcm.clear();
+		s.read_pos = 0;
+		s.flushing = false;
+	}
+}
+
+bool voice_mixer::mix_frame() {
+	bool has_audio = false;
+	bool ducking = false;
+	for (const source& s : sources) {
+		if (s.next_frame_values()) {
+			has_audio = true;
+			ducking = ducking || (s.options.ducks_others && !s.removed);
+		}
+	}
+	if (!has_audio) {
+		return false;
+	}
+
+	constexpr size_t block = audio_mixer::byte_blocks_per_register;
+	std::fill(mix.begin(), mix.end(), 0);
+	for (source& s : sources) {
+		float target = s.removed ? 0.0f : s.options.gain;
+		if (ducking && !s.options.ducks_others) {
+			target *= s.options.ducked_gain;
+		}
+		if (!s.started) {
+			s.current_gain = target;
+			s.started = true;
+		}
+		const size_t count = s.next_frame_values();
+		if (count == 0) {
+			/* Nothing to fade while the source sits the frame out */
+			s.current_gain = target;
+			continue;
+		}
+		std::copy_n(s.pcm.data() + s.read_pos, count, widened.data());
+		std::fill(widened.begin() + static_cast<ptrdiff_t>(count), widened.end(), 0);
+		s.read_pos += count;
+		if (s.read_pos == s.pcm.size()) {
+			s.pcm.clear();
+			s.read_pos = 0;
+			s.flushing = false;
+		}
+
+		/* Apply the gain, fading from the last frame's, and add the source to the mix */
+		const float increment = (target - s.current_gain) / static_cast<float>(frame_values);
+		float gain = s.current_gain;
+		for (size_t x = 0; x < frame_values; x += block) {
+			kernel->collect_single_register(widened.data() + x, scaled.data() + x, gain, increment);
+			gain += increment * static_cast<float>(block);
+			kernel->combine_samples(mix.data() + x, scaled.data() + x);
+		}
+		s.current_gain = target;
+	}
+
+	/* Removed sources have now faded out */
+	sources.erase(std::remove_if(sources.begin(), sources.end(), [](const source& s) {
+		return s.removed;
+	}), sources.end());
+
+	for (size_t x = 0; x < frame_values; x += block) {
+		kernel->collect_single_register(mix.data() + x, out.data() + x, 1.0f, 0.0f);
+	}
+	return true;
+}
+
+const int16_t* voice_mixer::get_frame() const {
+	return out.data();
+}
+
+}
@@ -25,14 +25,19 @@
 
 namespace dpp {
 
-zlibcontext::zlibcontext() : d_stream(new z_stream()) {
+zlibcontext::zlibcontext() : zlibcontext(false) {
+}
+
+zlibcontext::zlibcontext(bool accept_gzip, size_t buffer_size) : d_stream(new z_stream()) {
 	std::memset(d_stream, 0, sizeof(z_stream));
-	int error = inflateInit(d_stream);
+	/* Adding 32 to the window bits enables automatic detection of gzip or zlib headers */
+	int error = inflateInit2(d_stream, accept_gzip ? MAX_WBITS + 32 : MAX_WBITS);
 	if (error != Z_OK) {
 		delete d_stream;
 		throw dpp::connection_exception((exception_error_code)error, "Can't initialise stream compression!");
 	}
-	decomp_buffer.resize(DECOMP_BUFFER_SIZE);
+	decomp_buffer.resize(buffer_size);
+	detect_format = accept_gzip;
 }
 
 zlibcontext::~zlibcontext() {
@@ -40,16 +45,43 @@ zlibcontext::~zlibcontext() {
 	delete d_stream;
 }
 
-exception_error_code zlibcontext::decompress(const std::string& buffer, std::string& decompressed) {
+exception_error_code zlibcontext::decompress(std::string_view buffer, std::string& decompressed) {
 	decompressed.clear();
+	if (detect_format) {
+		if (header_bytes.length() + buffer.length() < 2) {
+			header_bytes.append(buffer);
+			return err_no_code_specified;
+		}
+		detect_format = false;
+		const auto first = static_cast<uint8_t>(header_bytes.empty() ? buffer[0] : header_bytes[0]);
+		const auto second = static_cast<uint8_t>(header_bytes.empty() ? buffer[1] : buffer[0]);
+		const bool gzip = first == 0x1f && second == 0x8b;
+		/* A zlib header names the deflate method and a window of at most 32k, and is a multiple of 31 */
+		const bool zlib = (first & 0x0f) == Z_DEFLATED && (first >> 4) <= 7 && ((first << 8) | second) % 31 == 0;
+		if (!gzip && !zlib && inflateReset2(d_stream, -MAX_WBITS) != Z_OK) {
+			return err_compression_stream;
+		}
+		if (!header_bytes.empty()) {
+			std::string first_byte;
+			first_byte.swap(header_bytes);
+			exception_error_code error = inflate_input(first_byte, decompressed);
+			if (error != err_no_code_specified) {
+				return error;
+			}
+		}
+	}
+	return inflate_input(buffer, decompressed);
+}
+
+exception_error_code zlibcontext::inflate_input(std::string_view buffer, std::string& decompressed) {
 	/* This is safe; zlib requires us to cast away the const. The underlying buffer is unchanged. */
 	d_stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer.data()));
 	d_stream->avail_in = static_cast<uInt>(buffer.size());
 	do {
 		d_stream->next_out = static_cast<Bytef*>(decomp_buffer.data());
-		d_stream->avail_out = DECOMP_BUFFER_SIZE;
+		d_stream->avail_out = static_cast<uInt>(decomp_buffer.size());
 		int ret = inflate(d_stream, Z_NO_FLUSH);
-		size_t have = DECOMP_BUFFER_SIZE - d_stream->avail_out;
+		size_t have = decomp_buffer.size() - d_stream->avail_out;
 		switch (ret) {
 			case Z_NEED_DICT:
 			case Z_STREAM_ERROR:
@@ -62,6 +94,11 @@ exception_error_code zlibcontext::decompress(const std::string& buffer, std::str
 				decompressed.append(decomp_buffer.begin(), decomp_buffer.begin() + have);
 				decompressed_total += have;
 				break;
+			case Z_STREAM_END:
+				/* End of a finite stream, e.g. a gzip HTTP body. Anything after it is ignored. */
+				decompressed.append(decomp_buffer.begin(), decomp_buffer.begin() + have);
+				decompressed_total += have;
+				return err_no_code_specified;
 			default:
 				/* Stub */
 				break;
@@ -0,0 +1,101 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/dpp.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Measures Ed25519 verifies per second for signed interaction webhooks, with and
+ * without the cached key, and across threads. Run with an optional iteration count.
+ */
+
+namespace {
+
+const std::string public_key = "3f6a59f1535ab132388b18db4759d23e2f95c531580a1bec3f136237e448ecf9";
+const std::string timestamp = "1700000000";
+const std::string body = R"({"type":1,"id":"123","application_id":"456","token":"abc"})";
+const std::string signature = "841658eb7b01445b0096aaaa6b4569daa2b7b22683b78af1f8eaa691de646c1a6af201607ec25cf574bec686d68b8c974e8ce3b5cfe55c4fa0c10ac58547300b";
+
+template <typename F>
+void measure(const std::string& name, size_t verifies, F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	bool valid = f();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << static_cast<uint64_t>(verifies / seconds) << " verifies/s" << (valid ? "" : " (VERIFICATION FAILED)") << "\n";
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+	const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 20000;
+	const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	measure("Key parsed per request      ", iterations, [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			dpp::signature_verifier v;
+			valid = v.verify_signature(timestamp, body, signature, public_key) && valid;
+		}
+		return valid;
+	});
+
+	dpp::signature_verifier verifier(public_key);
+	measure("Cached key                  ", iterations, [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			valid = verifier.verify_signature(timestamp, body, signature) && valid;
+		}
+		return valid;
+	});
+
+	std::vector<dpp::signed_request> batch(64, dpp::signed_request{timestamp, body, signature});
+	measure("Cached key, batches of 64   ", iterations / batch.size() * batch.size(), [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations / batch.size(); ++n) {
+			for (bool result : verifier.verify_signatures(batch)) {
+				valid = result && valid;
+			}
+		}
+		return valid;
+	});
+
+	measure("Cached key, " + std::to_string(threads) + " threads       ", iterations * threads, [&]() {
+		std::vector<std::thread> workers;
+		std::vector<char> valid(threads, 1);
+		for (size_t t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t]() {
+				for (size_t n = 0; n < iterations; ++n) {
+					valid[t] = verifier.verify_signature(timestamp, body, signature) && valid[t];
+				}
+			});
+		}
+		for (auto& w : workers) {
+			w.join();
+		}
+		return std::find(valid.begin(), valid.end(), 0) == valid.end();
+	});
+	return 0;
+}
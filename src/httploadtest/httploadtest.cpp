@@ -0,0 +1,154 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <dpp/dpp.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+	#include <sys/socket.h>
+#else
+	/* Windows-specific sockets includes */
+	#include <WinSock2.h>
+	#include <WS2tcpip.h>
+	/* Windows sockets library */
+	#pragma comment(lib, "ws2_32")
+#endif
+
+/**
+ * Load test for dpp::http_server. Starts a plaintext server on localhost and drives it
+ * from local client threads, each holding one persistent HTTP/1.1 connection and
+ * pipelining a batch of requests at a time.
+ *
+ * Usage: httploadtest [connections] [pipeline depth] [seconds] [port]
+ */
+
+namespace {
+
+/**
+ * @brief Count the complete responses at the start of a buffer, removing them from it
+ * @param in received data
+ * @return size_t number of responses removed
+ */
+size_t consume_responses(std::string& in) {
+	size_t count = 0, pos = 0;
+	for (;;) {
+		size_t headers_end = in.find("\r\n\r\n", pos);
+		if (headers_end == std::string::npos) {
+			break;
+		}
+		size_t length = 0;
+		size_t cl = in.find("Content-Length: ", pos);
+		if (cl != std::string::npos && cl < headers_end) {
+			length = std::stoul(in.substr(cl + 16, headers_end - cl - 16));
+		}
+		if (in.length() < headers_end + 4 + length) {
+			break;
+		}
+		pos = headers_end + 4 + length;
+		++count;
+	}
+	in.erase(0, pos);
+	return count;
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+	const size_t connections = argc > 1 ? std::stoul(argv[1]) : 8;
+	const size_t depth = argc > 2 ? std::stoul(argv[2]) : 16;
+	const size_t seconds = argc > 3 ? std::stoul(argv[3]) : 5;
+	const uint16_t port = static_cast<uint16_t>(argc > 4 ? std::stoul(argv[4]) : 3013);
+
+	dpp::cluster bot("no-token", 0, dpp::NO_SHARDS, 1, 1, false, dpp::cache_policy::cpol_none);
+	dpp::http_server server(&bot, "127.0.0.1", port, [](dpp::http_server_request* request) {
+		request->set_status(200).set_response_header("Content-Type", "text/plain").set_response_body("OK");
+	});
+	bot.start(dpp::st_return);
+
+	std::string batch;
+	for (size_t n = 0; n < depth; ++n) {
+		batch += "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	}
+
+	std::atomic<bool> stop{false};
+	std::atomic<uint64_t> completed{0}, failures{0};
+	std::vector<std::thread> clients;
+	for (size_t c = 0; c < connections; ++c) {
+		clients.emplace_back([&]() {
+			dpp::address_t address("127.0.0.1", port);
+			char buf[65536];
+			/* The server closes a connection once it has answered its keep-alive limit, so reconnect */
+			while (!stop) {
+				dpp::raii_socket s(dpp::rst_tcp);
+				if (::connect(s.fd, address.get_socket_address(), address.size()) != 0) {
+					++failures;
+					return;
+				}
+				std::string in;
+				bool closed = false;
+				uint64_t answered = 0;
+				while (!stop && !closed) {
+					if (::send(s.fd, batch.data(), static_cast<int>(batch.length()), 0) != static_cast<int>(batch.length())) {
+						closed = true;
+						break;
+					}
+					size_t outstanding = depth;
+					while (outstanding > 0) {
+						int r = static_cast<int>(::recv(s.fd, buf, sizeof(buf), 0));
+						if (r <= 0) {
+							closed = true;
+							break;
+						}
+						in.append(buf, r);
+						size_t got = consume_responses(in);
+						outstanding -= std::min(got, outstanding);
+						completed += got;
+						answered += got;
+					}
+				}
+				if (closed && answered == 0) {
+					/* Closed without answering anything, so it was not the keep-alive limit */
+					++failures;
+					return;
+				}
+			}
+		});
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::seconds(seconds));
+	stop = true;
+	for (auto& t : clients) {
+		t.join();
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << connections << " connections, pipeline depth " << depth << ": " << completed << " requests in " << elapsed << "s, "
+		<< static_cast<uint64_t>(completed / elapsed) << " requests/s, " << failures << " failed connections\n";
+	std::cout << "Accepted " << server.get_accepted() << " connections, dropped " << server.get_dropped() << "\n";
+	bot.shutdown();
+	return failures > 0;
+}
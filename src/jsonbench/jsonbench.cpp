@@ -0,0 +1,99 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/dpp.h>
+#include <dpp/json_writer.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/**
+ * Compares building a nlohmann::json document and dumping it with writing the same
+ * payload into a reused dpp::detail::json_writer, for the gateway heartbeat which is
+ * the payload the library writes this way, and for escaping a long string.
+ * Run with an optional iteration count.
+ */
+
+namespace {
+
+template <typename F>
+void measure(const std::string& name, size_t iterations, size_t bytes_per_iteration, F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t n = 0; n < iterations; ++n) {
+		f();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << (seconds * 1e9 / iterations) << "ns per payload, " << (bytes_per_iteration * iterations / seconds / 1048576.0) << " MiB/s\n";
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+	size_t iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	const uint64_t seq = 1234567;
+
+	/* As discord_client sends heartbeats, with a document per heartbeat or one writer per shard */
+	const std::string reference = dpp::json({{"op", dpp::ft_heartbeat}, {"d", seq}}).dump(-1, ' ', false, dpp::json::error_handler_t::replace);
+	dpp::detail::json_writer writer(32);
+	auto write_heartbeat = [&writer, seq]() {
+		writer.clear();
+		writer.begin_object().key("op").value(static_cast<int>(dpp::ft_heartbeat)).key("d").value(seq).end_object();
+	};
+	write_heartbeat();
+	/* json::dump() sorts the keys, the writer keeps them in the order they were written */
+	if (dpp::json::parse(writer.str()) != dpp::json::parse(reference)) {
+		std::cerr << "json_writer output differs from json::dump()\n";
+		return 1;
+	}
+	std::cout << "Heartbeat: " << writer.str() << "\n";
+
+	size_t sink = 0;
+	measure("heartbeat, DOM build + json::dump()", iterations, reference.length(), [&]() {
+		sink += dpp::json({{"op", dpp::ft_heartbeat}, {"d", seq}}).dump(-1, ' ', false, dpp::json::error_handler_t::replace).length();
+	});
+	measure("heartbeat, reused json_writer      ", iterations, reference.length(), [&]() {
+		write_heartbeat();
+		sink += writer.str().length();
+	});
+
+	std::string text;
+	for (int n = 0; n < 64; ++n) {
+		text += "The quick brown fox jumps over the lazy dog. \"Quoted\" text,\ttabs and caf\xc3\xa9 \xe2\x9c\x85 emoji.\n";
+	}
+	const std::string escaped_reference = dpp::json(text).dump(-1, ' ', false, dpp::json::error_handler_t::replace);
+	std::string escaped;
+	escaped.reserve(escaped_reference.length());
+	dpp::detail::json_writer::escape_string(escaped, text);
+	if (escaped != escaped_reference) {
+		std::cerr << "json_writer::escape_string() output differs from json::dump()\n";
+		return 1;
+	}
+	const size_t string_iterations = std::max<size_t>(iterations / 100, 1);
+	measure("string, json::dump()               ", string_iterations, text.length(), [&]() {
+		sink += dpp::json(text).dump(-1, ' ', false, dpp::json::error_handler_t::replace).length();
+	});
+	measure("string, json_writer::escape_string ", string_iterations, text.length(), [&]() {
+		escaped.clear();
+		dpp::detail::json_writer::escape_string(escaped, text);
+		sink += escaped.length();
+	});
+	return sink == 0;
+}
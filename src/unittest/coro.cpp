@@ -477,6 +477,125 @@ dpp::job coro_awaitable_test() {
 	}
 }
 
+dpp::job when_all_test() {
+	test_t &test = CORO_WHEN_ALL_OFFLINE;
+	try {
+		std::vector<dpp::async<int>> asyncs;
+		for (int i = 0; i < 5; ++i) {
+			asyncs.emplace_back(i % 2 ? &sync_awaitable_fun : &async_awaitable_wait5);
+		}
+		std::vector<int> results = co_await dpp::when_all(std::move(asyncs));
+		if (results != std::vector<int>{69, 42, 69, 42, 69}) {
+			set_status(test, ts_failed, "when_all returned unexpected results");
+			co_return;
+		}
+
+		std::atomic<bool> finished = false;
+		std::vector<dpp::task<void>> tasks;
+		tasks.push_back([](std::atomic<bool> *done) -> dpp::task<void> {
+			co_await dpp::async<int>{&async_awaitable_wait5};
+			throw test_exception<1>{};
+		}(&finished));
+		tasks.push_back([](std::atomic<bool> *done) -> dpp::task<void> {
+			co_await dpp::async<int>{&async_awaitable_wait5};
+			*done = true;
+		}(&finished));
+		bool threw = false;
+		try {
+			co_await dpp::when_all(std::move(tasks));
+		} catch (const test_exception<1> &) {
+			threw = true;
+		}
+		if (!threw || !finished) {
+			set_status(test, ts_failed, "when_all did not await every task before rethrowing");
+			co_return;
+		}
+
+		dpp::semaphore limit{1};
+		if (!limit.try_acquire() || limit.try_acquire() || limit.available() != 0) {
+			set_status(test, ts_failed, "semaphore handed out more permits than it has");
+			co_return;
+		}
+		limit.release();
+
+		std::atomic<int> in_flight = 0;
+		std::atomic<int> peak = 0;
+		std::vector<int> inputs{1, 2, 3, 4, 5, 6};
+		std::vector<int> doubled = co_await dpp::when_all_bounded(2, inputs, [&in_flight, &peak](int n) -> dpp::task<int> {
+			int now = ++in_flight;
+			int seen = peak;
+			while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+			int value = co_await dpp::async<int>{&async_awaitable_wait5};
+			--in_flight;
+			co_return value == 69 ? n * 2 : -1;
+		});
+		if (doubled != std::vector<int>{2, 4, 6, 8, 10, 12}) {
+			set_status(test, ts_failed, "when_all_bounded returned unexpected results");
+		} else if (peak != 2) {
+			set_status(test, ts_failed, "when_all_bounded ran " + std::to_string(peak) + " calls at once with a window of 2");
+		} else {
+			set_status(test, ts_success);
+		}
+	} catch (const std::exception &e) {
+		set_status(test, ts_failed, std::string{"unknown exception thrown: "} + e.what());
+	}
+}
+
+dpp::job async_socket_loopback(dpp::cluster *owner, std::promise<void> *finished) {
+	test_t &test = CORO_ASYNC_SOCKET_OFFLINE;
+	try {
+		dpp::async_socket listener = dpp::async_socket::listen(owner, "127.0.0.1", 0);
+		sockaddr_in bound{};
+		socklen_t bound_size = sizeof(bound);
+		getsockname(listener.get_fd(), reinterpret_cast<sockaddr *>(&bound), &bound_size);
+		dpp::task<dpp::async_socket> accepting = listener.accept();
+		dpp::async_socket client = co_await dpp::async_socket::connect(owner, "127.0.0.1", ntohs(bound.sin_port));
+		dpp::async_socket server = co_await accepting;
+		char buffer[16];
+		co_await client.write("ping");
+		size_t length = co_await server.read(buffer, sizeof(buffer));
+		if (std::string_view(buffer, length) != "ping") {
+			set_status(test, ts_failed, "server read the wrong data");
+		} else {
+			co_await server.write("pong");
+			length = co_await client.read(buffer, sizeof(buffer));
+			server.close();
+			if (std::string_view(buffer, length) != "pong") {
+				set_status(test, ts_failed, "client read the wrong data");
+			} else if (co_await client.read(buffer, sizeof(buffer)) != 0) {
+				set_status(test, ts_failed, "read after the peer closed did not return 0");
+			} else {
+				set_status(test, ts_success);
+			}
+		}
+	} catch (const std::exception &e) {
+		set_status(test, ts_failed, std::string{"unknown exception thrown: "} + e.what());
+	}
+	finished->set_value();
+}
+
+void async_socket_test() {
+	/* Nothing but the socket engine drives the sockets, as start() would connect to Discord */
+	auto owner = std::make_unique<dpp::cluster>("");
+	auto done = std::make_shared<std::atomic<bool>>(false);
+	std::thread engine([cluster = owner.get(), done]() {
+		while (!*done) {
+			cluster->socketengine->process_events();
+		}
+	});
+	std::promise<void> finished;
+	async_socket_loopback(owner.get(), &finished);
+	if (finished.get_future().wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+		set_status(CORO_ASYNC_SOCKET_OFFLINE, ts_failed, "timed out");
+		/* The coroutine is still waiting on the cluster's sockets, so leave both running */
+		owner.release();
+		engine.detach();
+		return;
+	}
+	*done = true;
+	engine.join();
+}
+
 }
 
 void coro_offline_tests()
@@ -518,6 +637,12 @@ void coro_offline_tests()
 
 	start_test(CORO_ASYNC_OFFLINE);
 	async_test();
+
+	start_test(CORO_WHEN_ALL_OFFLINE);
+	when_all_test();
+
+	start_test(CORO_ASYNC_SOCKET_OFFLINE);
+	async_socket_test();
 }
 
 void event_handler_test(dpp::cluster *bot) {
@@ -25,6 +25,9 @@
 #include <dpp/unicode_emoji.h>
 #include <dpp/restrequest.h>
 #include <dpp/json.h>
+#ifdef HAVE_VOICE
+	#include "../dpp/voice/enabled/xchacha20.h"
+#endif
 
 /**
  * @brief global lock for log output
@@ -289,6 +292,823 @@ Markdown lol \\|\\|spoiler\\|\\| \\~\\~strikethrough\\~\\~ \\`small \\*code\\* b
 
 		set_test(HOSTINFO, hci_test);
 
+		{
+			start_test(ZLIB_GZIP);
+			/* "D++ gzip test " repeated 20 times, gzip compressed, fed in two parts as if from a socket */
+			const std::string gzipped("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x73\xd1\xd6\x56\x48\xaf\xca\x2c\x50\x28\x49\x2d\x2e\x51\x70\x19\xe5\x41\x79\x00\xb1\x9f\xb9\xa7\x18\x01\x00\x00", 38);
+			std::string expected;
+			for (int n = 0; n < 20; ++n) {
+				expected += "D++ gzip test ";
+			}
+			dpp::zlibcontext inflater(true, 64);
+			std::string part, decompressed;
+			bool success = inflater.decompress(std::string_view(gzipped).substr(0, 15), part) == dpp::err_no_code_specified;
+			decompressed += part;
+			success = success && inflater.decompress(std::string_view(gzipped).substr(15), part) == dpp::err_no_code_specified;
+			decompressed += part;
+			success = success && decompressed == expected && inflater.decompressed_total == expected.length();
+			/* Content-Encoding: deflate may be a zlib stream or, from some servers, raw deflate data, told apart by the first two bytes */
+			const std::string zlib_wrapped("\x78\xda\x73\xd1\xd6\x56\x48\xaf\xca\x2c\x50\x28\x49\x2d\x2e\x51\x70\x19\xe5\x41\x79\x00\xb3\xa8\x59\x11", 26);
+			const std::string raw_deflate("\x73\xd1\xd6\x56\x48\xaf\xca\x2c\x50\x28\x49\x2d\x2e\x51\x70\x19\xe5\x41\x79\x00", 20);
+			for (const std::string& encoded : {zlib_wrapped, raw_deflate}) {
+				dpp::zlibcontext deflate_inflater(true, 64);
+				decompressed.clear();
+				/* The first byte arrives on its own, before the format can be known */
+				for (size_t offset = 0; offset < encoded.length(); offset += (offset == 0 ? 1 : 7)) {
+					success = success && deflate_inflater.decompress(std::string_view(encoded).substr(offset, offset == 0 ? 1 : 7), part) == dpp::err_no_code_specified;
+					decompressed += part;
+				}
+				success = success && decompressed == expected;
+			}
+			set_test(ZLIB_GZIP, success);
+		}
+
+		{
+			start_test(XCHACHA20_KAT);
+#ifdef HAVE_VOICE
+			/* Test vector A.3.1 of draft-irtf-cfrg-xchacha-03, whose subkey is derived by the HChaCha20 built for this CPU */
+			const std::string plaintext = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+			const std::vector<unsigned char> aad = {0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7};
+			std::vector<unsigned char> key(32), nonce(ssl_crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+			for (size_t i = 0; i < key.size(); ++i) {
+				key[i] = static_cast<unsigned char>(0x80 + i);
+			}
+			for (size_t i = 0; i < nonce.size(); ++i) {
+				nonce[i] = static_cast<unsigned char>(0x40 + i);
+			}
+			auto from_hex = [](std::string_view hex) {
+				std::string bytes;
+				for (size_t i = 0; i + 1 < hex.length(); i += 2) {
+					bytes.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+				}
+				return bytes;
+			};
+			const std::string expected = from_hex(
+				"bd6d179d3e83d43b9576579493c0e939572a1700252bfaccbed2902c21396cbb"
+				"731c7f1b0b4aa6440bf3a82f4eda7e39ae64c6708c54c216cb96b72e1213b452"
+				"2f8c9ba40db5d945b11b69b982c1bb9e3f3fac2bc369488f76b2383565d3fff9"
+				"21f9664c97637da9768812f615c68b13b52e"
+				"c0875924c1c7987947deafd8780acf49"
+			);
+			std::vector<unsigned char> sealed(plaintext.length() + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES);
+			unsigned long long sealed_length = 0;
+			bool success = ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(sealed.data(), &sealed_length, reinterpret_cast<const unsigned char*>(plaintext.data()), plaintext.length(), aad.data(), aad.size(), nullptr, nonce.data(), key.data()) == 0;
+			success = success && sealed_length == expected.length() && std::string(sealed.begin(), sealed.end()) == expected;
+			std::vector<unsigned char> opened(plaintext.length());
+			unsigned long long opened_length = 0;
+			success = success && ssl_crypto_aead_xchacha20poly1305_ietf_decrypt(opened.data(), &opened_length, nullptr, sealed.data(), sealed.size(), aad.data(), aad.size(), nonce.data(), key.data()) == 0;
+			success = success && opened_length == plaintext.length() && std::string(opened.begin(), opened.end()) == plaintext;
+			/* A changed tag must not authenticate */
+			sealed.back() ^= 1;
+			success = success && ssl_crypto_aead_xchacha20poly1305_ietf_decrypt(opened.data(), &opened_length, nullptr, sealed.data(), sealed.size(), aad.data(), aad.size(), nonce.data(), key.data()) != 0;
+			set_test(XCHACHA20_KAT, success);
+#else
+			set_test(XCHACHA20_KAT, true);
+#endif
+		}
+
+		{
+			start_test(JSON_WRITER);
+			/* Long enough to cross a sixteen byte block, with escapes, multibyte UTF-8 and invalid UTF-8 */
+			const std::string awkward = "plain text longer than one block \"quoted\" \\ \t\x01 caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 bad \xc3 \xed\xa0\x80 \xff end";
+			std::string escaped;
+			dpp::detail::json_writer::escape_string(escaped, awkward);
+			bool success = escaped == dpp::json(awkward).dump(-1, ' ', false, dpp::json::error_handler_t::replace);
+
+			dpp::detail::json_writer w;
+			w.begin_object().key("op").value(1).key("d").value(uint64_t(18446744073709551615ULL)).key("n").value(nullptr);
+			w.key("a").begin_array().value(-9223372036854775807LL - 1).value(true).value(0.5).value("x").begin_object().end_object().end_array().end_object();
+			success = success && w.str() == R"({"op":1,"d":18446744073709551615,"n":null,"a":[-9223372036854775808,true,0.5,"x",{}]})";
+			w.clear();
+			w.value(std::string_view("\xc3\xa9\xe2\x82", 4));
+			success = success && w.str() == "\"\xc3\xa9\xef\xbf\xbd\"";
+			set_test(JSON_WRITER, success);
+		}
+
+		{
+			start_test(VOICE_OUT_QUEUE);
+			dpp::voice_out_queue q(4);
+			/* Wrap around the ring, then grow it while it is wrapped */
+			for (int i = 0; i < 3; ++i) {
+				q.emplace_back().packet.assign(1, char('a' + i));
+			}
+			q.pop_front(2);
+			for (int i = 3; i < 9; ++i) {
+				auto& slot = q.emplace_back();
+				slot.packet.assign(1, char('a' + i));
+				slot.duration = i;
+			}
+			bool success = q.size() == 7 && q.capacity() == 8;
+			for (size_t i = 0; i < q.size(); ++i) {
+				success = success && q[i].packet == std::string(1, char('c' + i));
+			}
+			q.pop_front();
+			success = success && q.front().packet == "d" && q.front().duration == 3;
+			q.clear();
+			success = success && q.empty() && q.capacity() == 8;
+			set_test(VOICE_OUT_QUEUE, success);
+		}
+
+		{
+			start_test(VOICE_PACKET_SEQUENCER);
+			/* Packets sent from several threads at once must each take their own sequence number and nonce, and be queued in that order */
+			dpp::voice_packet_sequencer sequencer;
+			struct sent_packet {
+				uint16_t sequence;
+				uint32_t timestamp;
+				uint32_t nonce;
+			};
+			std::vector<sent_packet> queued;
+			std::vector<std::thread> senders;
+			for (int t = 0; t < 4; ++t) {
+				senders.emplace_back([&sequencer, &queued]() {
+					for (int i = 0; i < 2000; ++i) {
+						sequencer.next(960, [&queued](uint16_t sequence, uint32_t timestamp, uint32_t nonce) {
+							queued.push_back({sequence, timestamp, nonce});
+						});
+					}
+				});
+			}
+			for (auto& sender : senders) {
+				sender.join();
+			}
+			bool success = queued.size() == 8000;
+			for (size_t i = 0; success && i < queued.size(); ++i) {
+				success = queued[i].sequence == static_cast<uint16_t>(i + 1) && queued[i].timestamp == i * 960 && queued[i].nonce == i + 1;
+			}
+			sequencer.reset_nonce();
+			sequencer.next(960, [&success](uint16_t sequence, uint32_t, uint32_t nonce) {
+				success = success && sequence == 8001 && nonce == 1;
+			});
+			set_test(VOICE_PACKET_SEQUENCER, success);
+		}
+
+		{
+			start_test(VOICE_MIXER);
+			const std::vector<int16_t> frame(dpp::voice_mixer::frame_values, 1000);
+			auto near = [](int16_t value, int expected) {
+				return std::abs(value - expected) <= 10;
+			};
+			auto frame_near = [&near](const dpp::voice_mixer& mixer, size_t from, size_t to, int expected) {
+				const int16_t* out = mixer.get_frame();
+				return std::all_of(out + from, out + to, [&near, expected](int16_t value) {
+					return near(value, expected);
+				});
+			};
+			constexpr size_t values = dpp::voice_mixer::frame_values;
+			bool success = true;
+
+			/* Gain */
+			{
+				dpp::voice_mixer mixer;
+				uint32_t id = mixer.add_source({0.5f});
+				mixer.send_audio(id, frame.data(), frame.size());
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, values, 500) && !mixer.mix_frame();
+			}
+
+			/* Ducking fades the other sources down over one frame while the ducking source has audio */
+			{
+				dpp::voice_mixer mixer;
+				uint32_t music = mixer.add_source();
+				uint32_t speech = mixer.add_source({1.0f, true});
+				for (int i = 0; i < 3; ++i) {
+					mixer.send_audio(music, frame.data(), frame.size());
+				}
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, values, 1000);
+				const std::vector<int16_t> silence(values * 2, 0);
+				mixer.send_audio(speech, silence.data(), silence.size());
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, 8, 1000) && frame_near(mixer, values - 8, values, 250);
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, values, 250);
+			}
+
+			/* A removed source fades out over one more frame, and the rest of its audio is dropped */
+			{
+				dpp::voice_mixer mixer;
+				uint32_t id = mixer.add_source();
+				for (int i = 0; i < 3; ++i) {
+					mixer.send_audio(id, frame.data(), frame.size());
+				}
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, values, 1000);
+				success = success && mixer.remove_source(id) && mixer.get_buffered(id) == 0 && !mixer.send_audio(id, frame.data(), frame.size());
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, 8, 1000) && frame_near(mixer, values - 8, values, 0);
+				success = success && !mixer.mix_frame();
+			}
+
+			/* Less than a frame waits for more audio, or a flush, without holding up the other sources */
+			{
+				dpp::voice_mixer mixer;
+				uint32_t partial = mixer.add_source();
+				uint32_t full = mixer.add_source({0.5f});
+				const size_t quarter = values / 4;
+				mixer.send_audio(partial, frame.data(), quarter);
+				success = success && !mixer.mix_frame() && mixer.get_buffered(partial) == quarter;
+				mixer.send_audio(full, frame.data(), frame.size());
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, values, 500) && mixer.get_buffered(partial) == quarter;
+				mixer.send_audio(partial, frame.data(), frame.size());
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, values, 1000) && mixer.get_buffered(partial) == quarter;
+				success = success && !mixer.mix_frame() && mixer.flush_source(partial);
+				success = success && mixer.mix_frame() && frame_near(mixer, 0, quarter, 1000) && frame_near(mixer, quarter, values, 0);
+				success = success && !mixer.mix_frame() && mixer.get_buffered(partial) == 0;
+			}
+			set_test(VOICE_MIXER, success);
+		}
+
+		{
+			start_test(VOICE_UDP_BATCH);
+			constexpr size_t batch_size = dpp::discord_voice_client::udp_batch_size;
+			constexpr size_t slot_size = dpp::discord_voice_client::udp_slot_size;
+			dpp::raii_socket sender(dpp::rst_udp), receiver(dpp::rst_udp);
+			dpp::address_t bound("127.0.0.1", 0);
+			bool success = receiver.bind(bound) && dpp::set_nonblocking(receiver.fd, true) && dpp::set_nonblocking(sender.fd, true);
+			dpp::address_t destination("127.0.0.1", bound.get_port(receiver.fd));
+			std::vector<uint8_t> slab(batch_size * slot_size);
+			std::array<size_t, batch_size> sizes{};
+			uint64_t calls = 0;
+			auto queue_packet = [](dpp::voice_out_queue& queue, size_t length, char fill) {
+				dpp::voice_out_packet& slot = queue.emplace_back();
+				slot.packet.assign(length, fill);
+				slot.duration = 20;
+			};
+
+			/* More packets than one batch: only a batch is sent, and the receiver drains them in two batches */
+			dpp::voice_out_queue queue(4);
+			for (size_t i = 0; i < batch_size + 4; ++i) {
+				queue_packet(queue, 100 + i, static_cast<char>('a' + i));
+			}
+			size_t sent = dpp::detail::udp_send_batch(sender.fd, destination, queue, queue.size(), calls);
+			success = success && sent == batch_size;
+			queue.pop_front(sent);
+			success = success && dpp::detail::udp_send_batch(sender.fd, destination, queue, queue.size(), calls) == 4;
+			queue.pop_front(4);
+			size_t received = dpp::detail::udp_recv_batch(receiver.fd, slab.data(), sizes, calls);
+			success = success && received == batch_size && sizes[0] == 100 && slab[0] == 'a' && sizes[batch_size - 1] == 100 + batch_size - 1 && slab[(batch_size - 1) * slot_size] == static_cast<uint8_t>('a' + batch_size - 1);
+			received = dpp::detail::udp_recv_batch(receiver.fd, slab.data(), sizes, calls);
+			success = success && received == 4 && sizes[3] == 100 + batch_size + 3;
+			success = success && dpp::detail::udp_recv_batch(receiver.fd, slab.data(), sizes, calls) == 0;
+
+			/* A packet which can't be sent stops the batch, and the packets before it are counted as sent */
+			queue_packet(queue, 200, 'x');
+			queue_packet(queue, 201, 'y');
+			queue_packet(queue, 70000, 'z');
+			queue_packet(queue, 202, 'w');
+			sent = dpp::detail::udp_send_batch(sender.fd, destination, queue, queue.size(), calls);
+			success = success && sent == 2;
+			queue.pop_front(sent);
+			success = success && dpp::detail::udp_send_batch(sender.fd, destination, queue, queue.size(), calls) == 0 && queue.front().packet.size() == 70000;
+			queue.pop_front();
+			success = success && dpp::detail::udp_send_batch(sender.fd, destination, queue, queue.size(), calls) == 1;
+			received = dpp::detail::udp_recv_batch(receiver.fd, slab.data(), sizes, calls);
+			success = success && received == 3 && sizes[0] == 200 && sizes[1] == 201 && sizes[2] == 202 && slab[2 * slot_size] == 'w';
+#ifdef __linux__
+			/* A packet longer than a slot is truncated, and passed on as empty */
+			queue.pop_front(queue.size());
+			queue_packet(queue, slot_size + 100, 't');
+			queue_packet(queue, 50, 'u');
+			success = success && dpp::detail::udp_send_batch(sender.fd, destination, queue, queue.size(), calls) == 2;
+			received = dpp::detail::udp_recv_batch(receiver.fd, slab.data(), sizes, calls);
+			success = success && received == 2 && sizes[0] == 0 && sizes[1] == 50 && slab[slot_size] == 'u';
+#endif
+			set_test(VOICE_UDP_BATCH, success && calls > 0);
+		}
+
+		{
+			start_test(VOICE_DECODE_POOL);
+			/* The pool only passes connections to its flush function, so they can stand in for voice clients */
+			std::array<int, 3> connections{};
+			dpp::discord_voice_client* const first = reinterpret_cast<dpp::discord_voice_client*>(&connections[0]);
+			dpp::discord_voice_client* const second = reinterpret_cast<dpp::discord_voice_client*>(&connections[1]);
+			dpp::discord_voice_client* const blocked = reinterpret_cast<dpp::discord_voice_client*>(&connections[2]);
+			std::mutex flush_mutex;
+			std::condition_variable flush_cv;
+			std::map<dpp::discord_voice_client*, int> flushes;
+			std::set<dpp::discord_voice_client*> flushing;
+			bool overlapped = false, release_blocked = false;
+			const auto scheduled_at = std::chrono::steady_clock::now();
+			auto earliest_flush = std::chrono::steady_clock::time_point::max();
+			{
+				dpp::voice_decode_pool pool(nullptr, 2, 20, [&](dpp::discord_voice_client* client) {
+					std::unique_lock lock(flush_mutex);
+					earliest_flush = std::min(earliest_flush, std::chrono::steady_clock::now());
+					overlapped = overlapped || !flushing.insert(client).second;
+					int count = ++flushes[client];
+					flush_cv.notify_all();
+					if (client == blocked) {
+						flush_cv.wait(lock, [&release_blocked] { return release_blocked; });
+					}
+					flushing.erase(client);
+					/* The first connection has audio left twice, and the blocked one always has */
+					return (client == first && count < 3) || client == blocked;
+				});
+				pool.schedule(first);
+				pool.schedule(second);
+				bool success = false;
+				{
+					std::unique_lock lock(flush_mutex);
+					success = flush_cv.wait_for(lock, std::chrono::seconds(5), [&flushes, first, second] {
+						return flushes[first] == 3 && flushes[second] == 1;
+					});
+				}
+				/* Connections are flushed no sooner than the interval after they are scheduled */
+				success = success && earliest_flush - scheduled_at >= std::chrono::milliseconds(20);
+
+				/* cancel() waits for a flush in progress, and the connection isn't flushed again although it asked to be */
+				pool.schedule(blocked);
+				{
+					std::unique_lock lock(flush_mutex);
+					success = success && flush_cv.wait_for(lock, std::chrono::seconds(5), [&flushes, blocked] {
+						return flushes[blocked] == 1;
+					});
+				}
+				std::atomic<bool> cancelled{false};
+				std::thread canceller([&pool, &cancelled, blocked]() {
+					pool.cancel(blocked);
+					cancelled = true;
+				});
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				success = success && !cancelled;
+				{
+					std::lock_guard lock(flush_mutex);
+					release_blocked = true;
+				}
+				flush_cv.notify_all();
+				canceller.join();
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				{
+					std::lock_guard lock(flush_mutex);
+					success = success && flushes[blocked] == 1 && flushes[first] == 3 && flushes[second] == 1 && !overlapped;
+				}
+				set_test(VOICE_DECODE_POOL, success);
+			}
+		}
+
+		{
+			start_test(VOICE_BROADCAST);
+#ifdef HAVE_VOICE
+			/* Nothing but the socket engine drives the sockets, as start() would connect to Discord */
+			auto owner = std::make_unique<dpp::cluster>("");
+			auto done = std::make_shared<std::atomic<bool>>(false);
+			std::thread engine([cluster = owner.get(), done]() {
+				while (!*done) {
+					cluster->socketengine->process_events();
+				}
+			});
+			/* The voice connections connect to a local socket which never answers, so they never become ready to send */
+			dpp::raii_socket listener(dpp::rst_tcp);
+			dpp::address_t bound("127.0.0.1", 0);
+			bool success = listener.bind(bound) && listener.listen();
+			const std::string host = "127.0.0.1:" + std::to_string(bound.get_port(listener.fd));
+			std::vector<std::unique_ptr<dpp::discord_voice_client>> clients;
+			for (int i = 0; i < 4; ++i) {
+				clients.emplace_back(std::make_unique<dpp::discord_voice_client>(owner.get(), []() {}, 1, 2, "token", "session", host, false));
+			}
+			auto broadcast = std::make_unique<dpp::voice_broadcast>();
+			std::atomic<bool> sending{true};
+			std::thread sender([&broadcast, &sending]() {
+				std::vector<uint16_t> pcm(dpp::send_audio_raw_max_length / sizeof(uint16_t));
+				while (sending) {
+					broadcast->send_audio_raw(pcm.data(), dpp::send_audio_raw_max_length);
+					broadcast->insert_marker("marker");
+				}
+			});
+			for (int round = 0; round < 200; ++round) {
+				for (const auto& client : clients) {
+					broadcast->subscribe(client.get());
+				}
+				/* Subscribing twice does nothing */
+				broadcast->subscribe(clients[0].get());
+				success = success && broadcast->get_subscriber_count() == clients.size();
+				for (const auto& client : clients) {
+					broadcast->unsubscribe(client.get());
+				}
+				success = success && broadcast->get_subscriber_count() == 0;
+			}
+			/* A connection destroyed while subscribed leaves the broadcast */
+			for (const auto& client : clients) {
+				broadcast->subscribe(client.get());
+			}
+			clients.pop_back();
+			success = success && broadcast->get_subscriber_count() == clients.size();
+			sending = false;
+			sender.join();
+			/* A broadcast destroyed first leaves its subscribers, so they are still safe to destroy */
+			broadcast.reset();
+			clients.clear();
+			*done = true;
+			engine.join();
+			set_test(VOICE_BROADCAST, success);
+#else
+			bool unsupported = false;
+			try {
+				dpp::voice_broadcast broadcast;
+			}
+			catch (const dpp::voice_exception&) {
+				unsupported = true;
+			}
+			set_test(VOICE_BROADCAST, unsupported);
+#endif
+		}
+
+		{
+			start_test(OGG_OPUS);
+			auto ogg = std::make_shared<std::string>();
+			auto page = [&ogg](uint8_t header_type, const std::vector<uint8_t>& lacing, const std::string& body) {
+				std::string header("OggS\0", 5);
+				header.push_back(static_cast<char>(header_type));
+				/* Granule position, serial, sequence and checksum are not checked by the index */
+				header.append(20, '\0');
+				header.push_back(static_cast<char>(lacing.size()));
+				for (uint8_t l : lacing) {
+					header.push_back(static_cast<char>(l));
+				}
+				*ogg += header + body;
+			};
+			std::string head("OpusHead\x01\x02\x38\x01\x80\xbb\0\0\0\0\0", 19);
+			/* 20ms CELT frames; the second packet runs over onto the next page */
+			std::string spanning = "\xf8" + std::string(299, 'x');
+			page(0x02, {19}, head);
+			page(0x00, {8}, "OpusTags");
+			page(0x00, {3, 255}, "\xf8" "ab" + spanning.substr(0, 255));
+			page(0x01, {45, 1}, spanning.substr(255) + "\xf8");
+			dpp::ogg_opus_file f(dpp::upload_source::from_memory(ogg->data(), ogg->size(), ogg));
+			bool success = f.get_channels() == 2 && f.get_pre_skip() == 312 && f.get_packet_count() == 3;
+			success = success && f.get_packet(0) == "\xf8" "ab" && f.get_packet(1) == spanning && f.get_packet(2) == "\xf8";
+			success = success && f.get_duration_ms() == 60 && f.find_packet(20) == 1 && f.find_packet(45) == 2 && f.find_packet(60) == 3;
+			/* Code 3 packet of two 20ms frames */
+			success = success && dpp::ogg_opus_file::packet_samples(std::string_view("\xfb\x02", 2)) == 1920;
+			set_test(OGG_OPUS, success);
+		}
+
+		{
+			start_test(OGG_OPUS_WRITER);
+			dpp::ogg_opus_writer w(2);
+			/* A second of 20ms packets, one of which needs several lacing values */
+			std::string large = "\xfc" + std::string(600, 'y');
+			for (int i = 0; i < 60; ++i) {
+				w.write_packet(i == 7 ? std::string_view(large) : std::string_view("\xfc", 1), 960);
+			}
+			w.finish();
+			auto ogg = std::make_shared<std::string>(w.take_output());
+			dpp::ogg_opus_file f(dpp::upload_source::from_memory(ogg->data(), ogg->size(), ogg));
+			bool success = w.output_size() == 0 && w.get_position() == 57600 && f.get_channels() == 2;
+			success = success && f.get_packet_count() == 60 && f.get_duration_ms() == 1200 && f.get_packet(7) == large && f.get_packet(8) == "\xfc";
+			set_test(OGG_OPUS_WRITER, success);
+		}
+
+		{
+			start_test(WEBHOOK_RESPONSE);
+			/* Accepts the first response only, as an HTTP response can only be sent once */
+			struct test_webhook_response : public dpp::detail::interaction_webhook_response {
+				std::string sent;
+				bool respond(const std::string& json) override {
+					if (!sent.empty()) {
+						return false;
+					}
+					sent = json;
+					return true;
+				}
+				uint8_t get_automatic_ack() const override {
+					return ack;
+				}
+				uint8_t ack{0};
+			};
+			auto response = std::make_shared<test_webhook_response>();
+			dpp::interaction_create_t ic(nullptr, 0, "");
+			ic.from_webhook = true;
+			ic.webhook_response = response;
+			/* Copies of the event, e.g. in a coroutine frame, reply through the same response */
+			dpp::interaction_create_t copy = ic;
+			bool replied = false, dialog_failed = false, deferred = false;
+			copy.reply(dpp::ir_channel_message_with_source, dpp::message("hello"), [&replied](const dpp::confirmation_callback_t& cc) {
+				replied = !cc.is_error();
+			});
+			dpp::json sent = dpp::json::parse(response->sent);
+			bool success = replied && sent["type"] == dpp::ir_channel_message_with_source && sent["data"]["content"] == "hello";
+			/* Too late for a dialog, but a deferral is already satisfied */
+			ic.dialog(dpp::interaction_modal_response("modal", "title"), [&dialog_failed](const dpp::confirmation_callback_t& cc) {
+				dialog_failed = cc.is_error();
+			});
+			ic.reply(dpp::ir_deferred_update_message, dpp::message(), [&deferred](const dpp::confirmation_callback_t& cc) {
+				deferred = !cc.is_error();
+			});
+			/* A handler's reply can't be replaced by another, nor can an autocomplete acknowledged with no choices */
+			bool second_reply_failed = false, autocomplete_reply_failed = false;
+			ic.reply(dpp::message("again"), [&second_reply_failed](const dpp::confirmation_callback_t& cc) {
+				second_reply_failed = cc.is_error();
+			});
+			response->ack = dpp::ir_autocomplete_reply;
+			ic.reply(dpp::message("late"), [&autocomplete_reply_failed](const dpp::confirmation_callback_t& cc) {
+				autocomplete_reply_failed = cc.is_error();
+			});
+			success = success && dialog_failed && deferred && second_reply_failed && autocomplete_reply_failed && ic.get_queued_response().empty();
+			success = success && !dpp::http_server_deferred_response().complete(200, "{}");
+			set_test(WEBHOOK_RESPONSE, success);
+		}
+
+		{
+			start_test(HTTP_SERVER_KEEPALIVE);
+			/* Nothing but the socket engine drives the sockets, as start() would connect to Discord */
+			auto owner = std::make_unique<dpp::cluster>("");
+			auto done = std::make_shared<std::atomic<bool>>(false);
+			std::thread engine([cluster = owner.get(), done]() {
+				while (!*done) {
+					cluster->socketengine->process_events();
+				}
+			});
+			auto server = std::make_unique<dpp::http_server>(owner.get(), "127.0.0.1", 0, [](dpp::http_server_request* request) {
+				request->set_status(200).set_response_body(request->get_path() + request->get_request_body());
+			});
+			dpp::address_t server_address("127.0.0.1", dpp::address_t().get_port(server->fd.fd));
+			auto response = [](const std::string& version, const std::string& connection, const std::string& body) {
+				return version + " 200 OK\r\nContent-Length: " + std::to_string(body.length()) + "\r\nConnection: " + connection + "\r\n\r\n" + body;
+			};
+			/* Reads until the expected bytes have arrived, then if the server should close, until it has */
+			auto exchange = [](dpp::raii_socket& client, const std::vector<std::string>& writes, const std::string& expected, bool expect_close) {
+				if (client.fd == INVALID_SOCKET) {
+					return false;
+				}
+				for (const std::string& data : writes) {
+					if (::send(client.fd, data.data(), static_cast<int>(data.length()), 0) != static_cast<int>(data.length())) {
+						return false;
+					}
+					/* Give the server a chance to read each part separately */
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				}
+				std::string received;
+				bool closed = false;
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+				char chunk[1024];
+				while (std::chrono::steady_clock::now() < deadline && !closed && (received.length() < expected.length() || expect_close)) {
+					int length = static_cast<int>(::recv(client.fd, chunk, sizeof(chunk), 0));
+					if (length > 0) {
+						received.append(chunk, length);
+					} else if (length == 0) {
+						closed = true;
+					} else {
+						std::this_thread::sleep_for(std::chrono::milliseconds(10));
+					}
+				}
+				return received == expected && closed == expect_close;
+			};
+			auto connect_client = [&server_address](dpp::raii_socket& client) {
+				return ::connect(client.fd, server_address.get_socket_address(), static_cast<socklen_t>(server_address.size())) == 0 && dpp::set_nonblocking(client.fd, true);
+			};
+
+			/* A second pipelined request, split between writes, is answered once the first is, and the connection stays open */
+			dpp::raii_socket pipelined(dpp::rst_tcp);
+			bool success = connect_client(pipelined) && exchange(pipelined, {
+				"GET /a HTTP/1.1\r\nHost: localhost\r\n\r\nPOST /b HTTP/1.1\r\nHo",
+				"st: localhost\r\nContent-Length: 5\r\n\r\nhel",
+				"lo"
+			}, response("HTTP/1.1", "keep-alive", "/a") + response("HTTP/1.1", "keep-alive", "/bhello"), false);
+			/* Connection: close is answered, then the connection is closed */
+			success = success && exchange(pipelined, {"GET /c HTTP/1.1\r\nConnection: close\r\n\r\n"}, response("HTTP/1.1", "close", "/c"), true);
+
+			/* HTTP/1.0 connections close unless the client asks for keep-alive */
+			dpp::raii_socket http10(dpp::rst_tcp);
+			success = success && connect_client(http10) && exchange(http10, {"GET /d HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"}, response("HTTP/1.0", "keep-alive", "/d"), false);
+			success = success && exchange(http10, {"GET /e HTTP/1.0\r\n\r\n"}, response("HTTP/1.0", "close", "/e"), true);
+			/* Both connections were counted by the listener */
+			success = success && server->get_accepted() == 2 && server->get_dropped() == 0;
+
+			*done = true;
+			engine.join();
+			server.reset();
+			set_test(HTTP_SERVER_KEEPALIVE, success);
+		}
+
+		{
+			start_test(REQUEST_PRIORITY_ORDER);
+			/* Every request shares one bucket which allows one request per reset. Requests queued
+			 * while it is rate limited go out one at a time, highest priority first.
+			 */
+			auto owner = std::make_unique<dpp::cluster>("");
+			auto done = std::make_shared<std::atomic<bool>>(false);
+			std::thread engine([cluster = owner.get(), done]() {
+				while (!*done) {
+					cluster->socketengine->process_events();
+				}
+			});
+			std::mutex order_mutex;
+			std::vector<std::string> order;
+			auto server = std::make_unique<dpp::http_server>(owner.get(), "127.0.0.1", 0, [&order_mutex, &order](dpp::http_server_request* request) {
+				const std::string body = request->get_request_body();
+				{
+					std::lock_guard lock(order_mutex);
+					order.emplace_back(body);
+				}
+				/* The first reply empties the bucket for long enough that the others queue up behind it */
+				request->set_status(200)
+					.set_response_header("X-RateLimit-Limit", "1")
+					.set_response_header("X-RateLimit-Remaining", "0")
+					.set_response_header("X-RateLimit-Reset-After", body == "first" ? "1" : "0")
+					.set_response_body(body);
+			});
+			const std::string url = "http://127.0.0.1:" + std::to_string(dpp::address_t().get_port(server->fd.fd)) + "/bucket";
+			auto queue = std::make_unique<dpp::request_queue>(owner.get(), 1);
+			std::atomic<int> completed{0};
+			auto post = [&](const std::string& body, dpp::request_priority priority) {
+				auto request = std::make_unique<dpp::http_request>(url, [&completed](const dpp::http_request_completion_t&) {
+					++completed;
+				}, dpp::m_post, body);
+				request->priority = priority;
+				queue->post_request(std::move(request));
+			};
+			auto wait_for = [&completed](int count) {
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+				while (completed < count && std::chrono::steady_clock::now() < deadline) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				}
+				return completed >= count;
+			};
+
+			post("first", dpp::rp_user);
+			bool success = wait_for(1);
+			post("background-1", dpp::rp_background);
+			post("background-2", dpp::rp_background);
+			post("user", dpp::rp_user);
+			post("interaction", dpp::rp_interaction);
+			success = success && wait_for(5);
+			/* Sent one per reset, so the background requests waited for the interaction to be answered */
+			success = success && queue->get_priority_stats(dpp::rp_background).average_queue_time() > queue->get_priority_stats(dpp::rp_interaction).average_queue_time() + 1.0;
+
+			*done = true;
+			engine.join();
+			queue.reset();
+			server.reset();
+			std::lock_guard lock(order_mutex);
+			success = success && order == std::vector<std::string>{"first", "interaction", "user", "background-1", "background-2"};
+			set_test(REQUEST_PRIORITY_ORDER, success);
+		}
+
+		{
+			start_test(SIGNATURE_VERIFIER);
+			const std::string public_key = "3f6a59f1535ab132388b18db4759d23e2f95c531580a1bec3f136237e448ecf9";
+			const std::string timestamp = "1700000000";
+			const std::string body = R"({"type":1,"id":"123","application_id":"456","token":"abc"})";
+			const std::string signature = "841658eb7b01445b0096aaaa6b4569daa2b7b22683b78af1f8eaa691de646c1a6af201607ec25cf574bec686d68b8c974e8ce3b5cfe55c4fa0c10ac58547300b";
+			const std::string bad_signature = "941658eb7b01445b0096aaaa6b4569daa2b7b22683b78af1f8eaa691de646c1a6af201607ec25cf574bec686d68b8c974e8ce3b5cfe55c4fa0c10ac58547300b";
+			dpp::signature_verifier cached(public_key);
+			dpp::signature_verifier uncached;
+			bool success = cached.verify_signature(timestamp, body, signature) && !cached.verify_signature(timestamp, body, bad_signature);
+			success = success && !cached.verify_signature("1700000001", body, signature) && !cached.verify_signature(timestamp, body, "zz");
+			success = success && uncached.verify_signature(timestamp, body, signature, public_key) && !uncached.verify_signature(timestamp, body, signature, "00");
+			/* The key given at construction is reused when it is passed again, any other is parsed for the call */
+			success = success && cached.verify_signature(timestamp, body, signature, public_key) && !cached.verify_signature(timestamp, body, signature, "00");
+			std::vector<bool> batch = cached.verify_signatures({{timestamp, body, signature}, {timestamp, body, bad_signature}, {timestamp, body, signature}});
+			success = success && batch == std::vector<bool>{true, false, true};
+			set_test(SIGNATURE_VERIFIER, success);
+		}
+
+		{
+			start_test(EVENT_ROUTER);
+			dpp::event_router_t<dpp::log_t> router;
+			bool success = router.empty();
+			std::vector<int> order;
+			dpp::event_handle second = 0;
+			router.attach([&order](const dpp::log_t&) {
+				order.push_back(1);
+			});
+			second = router([&](const dpp::log_t&) {
+				order.push_back(2);
+				/* Handlers may change the listeners, which takes effect from the next event */
+				router.detach(second);
+				router.attach([&order](const dpp::log_t&) {
+					order.push_back(3);
+				});
+			});
+			router.call(dpp::log_t(nullptr, 0, ""));
+			router.call(dpp::log_t(nullptr, 0, ""));
+			success = success && order == std::vector<int>{1, 2, 1, 3} && !router.empty() && !router.detach(second);
+			set_test(EVENT_ROUTER, success);
+		}
+
+		{
+			start_test(EVENT_ROUTER_KEYED);
+			/* Keys log events by their message, as the cluster keys button clicks by custom_id */
+			struct keyed_router : public dpp::event_router_t<dpp::log_t> {
+				keyed_router() {
+					set_key_function([](const dpp::log_t& event) {
+						return event.message;
+					});
+				}
+			} router;
+			auto log = [](const std::string& message) {
+				dpp::log_t event(nullptr, 0, "");
+				event.message = message;
+				return event;
+			};
+			std::vector<std::string> seen;
+			dpp::event_handle a = router.attach_key("a", [&seen](const dpp::log_t& event) {
+				seen.push_back("a:" + event.message);
+			});
+			router.attach_key("b", [&seen](const dpp::log_t& event) {
+				seen.push_back("b:" + event.message);
+			});
+			router.attach([&seen](const dpp::log_t& event) {
+				seen.push_back("*:" + event.message);
+			});
+			bool resumed = false;
+#ifndef DPP_NO_CORO
+			[](keyed_router* r, bool* done) -> dpp::job {
+				const dpp::log_t& event = co_await r->when_key("c");
+				*done = event.message == "c";
+			}(&router, &resumed);
+#else
+			resumed = true;
+#endif
+			router.call(log("a"));
+			router.call(log("b"));
+			router.call(log("c"));
+			bool success = router.detach(a) && resumed;
+			router.call(log("a"));
+			success = success && seen == std::vector<std::string>{"*:a", "a:a", "*:b", "b:b", "*:c", "*:a"};
+			set_test(EVENT_ROUTER_KEYED, success);
+		}
+
+		{
+			start_test(EVENT_ROUTER_DETACH_WAITS);
+			/* detach() returns while another thread is still running the listener, and detach_and_wait() does not */
+			dpp::event_router_t<dpp::log_t> router;
+			std::atomic<bool> entered{false};
+			std::atomic<bool> release{false};
+			std::atomic<bool> finished{false};
+			std::atomic<int> calls{0};
+			dpp::event_handle h = router([&](const dpp::log_t&) {
+				++calls;
+				entered = true;
+				while (!release) {
+					std::this_thread::yield();
+				}
+				finished = true;
+			});
+			std::thread dispatcher([&router]() {
+				router.call(dpp::log_t(nullptr, 0, ""));
+			});
+			while (!entered) {
+				std::this_thread::yield();
+			}
+			bool success = router.detach(h) && !finished && !router.detach(h);
+			router.call(dpp::log_t(nullptr, 0, ""));
+			release = true;
+			dispatcher.join();
+			success = success && finished && calls == 1 && router.empty();
+
+			entered = false;
+			finished = false;
+			h = router([&](const dpp::log_t&) {
+				++calls;
+				entered = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(200));
+				finished = true;
+			});
+			std::thread waited([&router]() {
+				router.call(dpp::log_t(nullptr, 0, ""));
+			});
+			while (!entered) {
+				std::this_thread::yield();
+			}
+			success = success && router.detach_and_wait(h) && finished;
+			waited.join();
+			router.call(dpp::log_t(nullptr, 0, ""));
+			success = success && calls == 2 && router.empty();
+			set_test(EVENT_ROUTER_DETACH_WAITS, success);
+		}
+
+		{
+			start_test(COMPONENT_ROUTER);
+			dpp::event_router_t<dpp::button_click_t> clicks;
+			std::vector<std::string> routed;
+			bool success = clicks.empty();
+			{
+				dpp::component_router<dpp::button_click_t> router(clicks);
+				auto click = [&clicks](const std::string& custom_id) {
+					dpp::button_click_t event(nullptr, 0, "");
+					event.custom_id = custom_id;
+					clicks.call(event);
+				};
+				success = success && router.add("vote:close", [&routed](const dpp::button_click_t& event) {
+					routed.push_back("exact " + event.custom_id);
+				});
+				success = success && router.add_prefix("vote:", [&routed](const dpp::button_click_t& event) {
+					routed.push_back("prefix " + event.custom_id);
+				}, 3600);
+				success = success && router.add_prefix("vote:poll:", [&routed](const dpp::button_click_t& event) {
+					routed.push_back("longer " + event.custom_id);
+				});
+				/* A live route is not replaced */
+				success = success && !router.add("vote:close", [](const dpp::button_click_t&) { }) && router.size() == 3 && !clicks.empty();
+				click("vote:close");
+				click("vote:yes");
+				click("vote:poll:1");
+				click("other");
+				success = success && router.remove_prefix("vote:") && !router.remove("missing");
+				click("vote:no");
+				success = success && routed == std::vector<std::string>{"exact vote:close", "prefix vote:yes", "longer vote:poll:1"};
+			}
+			/* The router detaches from its event when destroyed */
+			set_test(COMPONENT_ROUTER, success && clicks.empty());
+		}
+
 		std::vector<uint8_t> testaudio = load_test_audio();
 
 		set_test(READFILE, false);
@@ -299,6 +1119,33 @@ Markdown lol \\|\\|spoiler\\|\\| \\~\\~strikethrough\\~\\~ \\`small \\*code\\* b
 		fclose(fp);
 		set_test(READFILE, off == rf_test.length());
 
+		{
+			start_test(UPLOAD_SOURCE);
+			bool success = true;
+			std::string scratch;
+			auto file_source = dpp::upload_source::from_file(SHARED_OBJECT);
+			success = success && file_source->size() == rf_test.length();
+			success = success && file_source->read(100, 1000, scratch) == std::string_view(rf_test).substr(100, 1000);
+			success = success && file_source->read(rf_test.length(), 1000, scratch).empty();
+
+			const std::string file_content = "ABCDEFGHI";
+			auto memory_source = dpp::upload_source::from_memory(file_content.data(), file_content.length());
+			dpp::multipart_content plain = dpp::https_client::build_multipart("{}", {"test.txt", "blob.blob"}, {"ABCDEFGHI", "BLOB"}, {"text/plain", ""});
+			dpp::multipart_content streamed = dpp::https_client::build_multipart("{}", {"test.txt", "blob.blob"}, {"", "BLOB"}, {"text/plain", ""}, {memory_source, nullptr});
+			std::string joined;
+			for (const auto& segment : streamed.segments) {
+				joined += segment.source ? std::string(segment.source->read(0, segment.size(), scratch)) : segment.data;
+			}
+			/* Boundaries are time based, so may differ between the two */
+			std::string plain_boundary = plain.mimetype.substr(plain.mimetype.find("boundary=") + 9);
+			std::string streamed_boundary = streamed.mimetype.substr(streamed.mimetype.find("boundary=") + 9);
+			for (size_t pos = joined.find(streamed_boundary); pos != std::string::npos; pos = joined.find(streamed_boundary, pos + plain_boundary.length())) {
+				joined.replace(pos, streamed_boundary.length(), plain_boundary);
+			}
+			success = success && streamed.body.empty() && streamed.segments.size() == 3 && joined == plain.body;
+			set_test(UPLOAD_SOURCE, success);
+		}
+
 		set_test(TIMESTAMPTOSTRING, false);
 		set_test(TIMESTAMPTOSTRING, dpp::ts_to_string(1642611864) == "2022-01-19T17:04:24Z");
 
@@ -979,6 +1826,22 @@ Markdown lol \\|\\|spoiler\\|\\| \\~\\~strikethrough\\~\\~ \\`small \\*code\\* b
 			i = dummyval;
 			set_test(ICONHASH, (i.to_string() == dummyval));
 
+			{
+				start_test(REQUEST_PRIORITY);
+				bool success = bot.get_request_priority() == dpp::rp_user && bot.get_request_priority(true) == dpp::rp_interaction;
+				bot.set_request_priority(dpp::rp_background);
+				success = success && bot.get_request_priority(true) == dpp::rp_background && bot.get_request_priority(true) == dpp::rp_interaction;
+				bot.set_default_request_priority(dpp::rp_background);
+				success = success && bot.get_request_priority() == dpp::rp_background;
+				bot.set_default_request_priority(dpp::rp_user);
+				dpp::request_priority_stats stats;
+				success = success && stats.average_latency() == 0;
+				stats.completed = 2;
+				stats.total_latency = 3;
+				success = success && stats.average_latency() == 1.5;
+				set_test(REQUEST_PRIORITY, success);
+			}
+
 			/* This ensures we test both protocols, as voice is json and shard is etf */
 			bot.set_websocket_protocol(dpp::ws_etf);
 
@@ -1803,6 +2666,16 @@ Markdown lol \\|\\|spoiler\\|\\| \\~\\~strikethrough\\~\\~ \\`small \\*code\\* b
 					});
 				}
 
+				set_test(REQUEST_STREAM, false);
+				if (!offline) {
+					auto streamed_bytes = std::make_shared<std::atomic<size_t>>(0);
+					bot.request_stream("https://dpp.dev/DPP-Logo.png", dpp::m_get, [streamed_bytes](std::string_view data) {
+						*streamed_bytes += data.length();
+					}, [streamed_bytes](const dpp::http_request_completion_t &callback) {
+						set_test(REQUEST_STREAM, callback.status == 200 && callback.body.empty() && *streamed_bytes > 0);
+					});
+				}
+
 				set_test(REQUEST_GET_IMAGE, false);
 				if (!offline) {
 					bot.request("https://dpp.dev/DPP-Logo.png", dpp::m_get, [&bot](const dpp::http_request_completion_t &callback) {
@@ -132,6 +132,7 @@ DPP_TEST(CUSTOMCACHE, "Instantiate a cache", tf_offline);
 DPP_TEST(MSGCOLLECT, "message_collector", tf_online);
 DPP_TEST(TS, "managed::get_creation_date()", tf_online);
 DPP_TEST(READFILE, "utility::read_file()", tf_offline);
+DPP_TEST(UPLOAD_SOURCE, "upload_source and streamed https_client::build_multipart()", tf_offline);
 DPP_TEST(TIMESTAMPTOSTRING, "ts_to_string()", tf_offline);
 DPP_TEST(TIMESTRINGTOTIMESTAMP, "ts_not_null()", tf_offline);
 DPP_TEST(OPTCHOICE_DOUBLE, "command_option_choice::fill_from_json: double", tf_offline);
@@ -140,6 +141,26 @@ DPP_TEST(OPTCHOICE_BOOL, "command_option_choice::fill_from_json: bool", tf_offli
 DPP_TEST(OPTCHOICE_SNOWFLAKE, "command_option_choice::fill_from_json: snowflake", tf_offline);
 DPP_TEST(OPTCHOICE_STRING, "command_option_choice::fill_from_json: string", tf_offline);
 DPP_TEST(HOSTINFO, "https_client::get_host_info()", tf_offline);
+DPP_TEST(ZLIB_GZIP, "zlibcontext gzip, zlib and raw deflate response body decompression", tf_offline);
+DPP_TEST(XCHACHA20_KAT, "XChaCha20-Poly1305 voice encryption known answer test", tf_offline);
+DPP_TEST(JSON_WRITER, "json_writer streaming serialization", tf_offline);
+DPP_TEST(VOICE_OUT_QUEUE, "voice_out_queue ring of outbound voice packets", tf_offline);
+DPP_TEST(VOICE_PACKET_SEQUENCER, "voice_packet_sequencer numbers packets sent from several threads in order", tf_offline);
+DPP_TEST(VOICE_MIXER, "voice_mixer gain, ducking, removal and partial frames", tf_offline);
+DPP_TEST(VOICE_UDP_BATCH, "voice client batched UDP sends and receives, including partial sends", tf_offline);
+DPP_TEST(VOICE_DECODE_POOL, "voice_decode_pool scheduling, and cancel() while a connection is being flushed", tf_offline);
+DPP_TEST(VOICE_BROADCAST, "voice_broadcast subscribe and unsubscribe while audio is being sent", tf_offline);
+DPP_TEST(OGG_OPUS, "ogg_opus_file packet index", tf_offline);
+DPP_TEST(OGG_OPUS_WRITER, "ogg_opus_writer round trip through ogg_opus_file", tf_offline);
+DPP_TEST(WEBHOOK_RESPONSE, "interaction replies through a deferred webhook response", tf_offline);
+DPP_TEST(HTTP_SERVER_KEEPALIVE, "http_server pipelined requests split across reads, Connection: close and HTTP/1.0", tf_offline);
+DPP_TEST(REQUEST_PRIORITY_ORDER, "rate limited REST requests are sent one bucket reset at a time, highest priority first", tf_offline);
+DPP_TEST(SIGNATURE_VERIFIER, "signature_verifier Ed25519 verification", tf_offline);
+DPP_TEST(EVENT_ROUTER, "event_router_t attach and detach from within a handler", tf_offline);
+DPP_TEST(EVENT_ROUTER_KEYED, "event_router_t keyed listeners and awaiters", tf_offline);
+DPP_TEST(EVENT_ROUTER_DETACH_WAITS, "event_router_t detach and detach_and_wait with a listener running on another thread", tf_offline);
+DPP_TEST(COMPONENT_ROUTER, "component_router exact and prefix custom_id routes", tf_offline);
+DPP_TEST(REQUEST_PRIORITY, "cluster::set_request_priority()", tf_offline);
 DPP_TEST(HTTPS, "https_client HTTPS request", tf_online);
 DPP_TEST(HTTP, "https_client HTTP request", tf_online);
 DPP_TEST(RUNONCE, "run_once<T>", tf_offline);
@@ -223,6 +244,7 @@ DPP_TEST(AUTOMOD_RULE_GET, "cluster::automod_rule_get", tf_online);
 DPP_TEST(AUTOMOD_RULE_GET_ALL, "cluster::automod_rules_get", tf_online);
 DPP_TEST(AUTOMOD_RULE_DELETE, "cluster::automod_rule_delete", tf_online);
 DPP_TEST(REQUEST_GET_IMAGE, "using the cluster::request method to fetch an image", tf_online);
+DPP_TEST(REQUEST_STREAM, "using the cluster::request_stream method to stream an image", tf_online);
 DPP_TEST(EMOJI_CREATE, "cluster::guild_emoji_create", tf_online);
 DPP_TEST(EMOJI_GET, "cluster::guild_emoji_get", tf_online);
 DPP_TEST(EMOJI_DELETE, "cluster::guild_emoji_delete", tf_online);
@@ -264,6 +286,8 @@ DPP_TEST(CORO_AWAITABLE_OFFLINE, "coro: offline promise & awaitable", tf_offline
 DPP_TEST(CORO_COROUTINE_OFFLINE, "coro: offline coroutine", tf_offline | tf_coro);
 DPP_TEST(CORO_TASK_OFFLINE, "coro: offline task", tf_offline | tf_coro);
 DPP_TEST(CORO_ASYNC_OFFLINE, "coro: offline async", tf_offline | tf_coro);
+DPP_TEST(CORO_WHEN_ALL_OFFLINE, "coro: offline when_all & semaphore", tf_offline | tf_coro);
+DPP_TEST(CORO_ASYNC_SOCKET_OFFLINE, "coro: offline async_socket over loopback", tf_offline | tf_coro);
 DPP_TEST(CORO_EVENT_HANDLER, "coro: online event handler", tf_online | tf_coro);
 DPP_TEST(CORO_API_CALLS, "coro: online api calls", tf_online | tf_coro);
 DPP_TEST(CORO_MUMBO_JUMBO, "coro: online mumbo jumbo in event handler", tf_online | tf_coro | tf_extended);
@@ -0,0 +1,104 @@
+/************************************************************************************
+ *
+ * D++, A Lightweight C++ library for Discord
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright 2021 Craig Edwards and D++ contributors 
+ * (https://github.com/brainboxdotcc/DPP/graphs/contributors)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+#include <dpp/dpp.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Measures voice transport encryption and decryption (XChaCha20-Poly1305) in packets per
+ * second. Run with an optional iteration count.
+ */
+
+#ifdef HAVE_VOICE
+#include "../dpp/voice/enabled/xchacha20.h"
+
+namespace {
+
+/**
+ * Size of a typical 20ms opus voice packet
+ */
+constexpr size_t packet_size = 160;
+
+/**
+ * RTP header, which is authenticated but not encrypted
+ */
+constexpr size_t header_size = 12;
+
+/**
+ * Number of distinct packets, each with its own nonce, cycled through
+ */
+constexpr size_t packet_count = 16;
+
+template <typename F>
+void measure(const std::string& name, size_t packets, F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	bool valid = f();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << static_cast<uint64_t>(packets / seconds) << " packets/s" << (valid ? "" : " (FAILED)") << "\n";
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+	const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+	std::vector<unsigned char> key(32, 0x5a);
+	std::vector<unsigned char> header(header_size, 0x80);
+	std::vector<unsigned char> plaintext(packet_size, 0x42);
+	std::vector<std::vector<unsigned char>> nonces(packet_count, std::vector<unsigned char>(ssl_crypto_aead_xchacha20poly1305_ietf_NPUBBYTES, 0));
+	std::vector<std::vector<unsigned char>> ciphertexts(packet_count, std::vector<unsigned char>(packet_size + ssl_crypto_aead_xchacha20poly1305_IETF_ABYTES));
+	std::vector<std::vector<unsigned char>> decrypted(packet_count, std::vector<unsigned char>(packet_size));
+	std::vector<unsigned long long> lengths(packet_count);
+	for (size_t i = 0; i < packet_count; ++i) {
+		nonces[i][0] = static_cast<unsigned char>(i);
+	}
+
+	measure("Encrypt", iterations, [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			const size_t i = n % packet_count;
+			valid = ssl_crypto_aead_xchacha20poly1305_ietf_encrypt(ciphertexts[i].data(), &lengths[i], plaintext.data(), plaintext.size(), header.data(), header.size(), nullptr, nonces[i].data(), key.data()) == 0 && valid;
+		}
+		return valid;
+	});
+
+	measure("Decrypt", iterations, [&]() {
+		bool valid = true;
+		for (size_t n = 0; n < iterations; ++n) {
+			const size_t i = n % packet_count;
+			valid = ssl_crypto_aead_xchacha20poly1305_ietf_decrypt(decrypted[i].data(), &lengths[i], nullptr, ciphertexts[i].data(), ciphertexts[i].size(), header.data(), header.size(), nonces[i].data(), key.data()) == 0 && valid;
+		}
+		return valid && decrypted[0] == plaintext;
+	});
+	return 0;
+}
+
+#else
+
+int main() {
+	std::cout << "Voice support is not enabled in this build of D++, so there is nothing to measure\n";
+	return 0;
+}
+
+#endif